@@ -0,0 +1,104 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity i2c_fifo is
+    generic (
+        DATA_WIDTH : integer := 8;
+        DEPTH      : integer := 16;
+        LANES      : integer := 1);  -- entries moved by one access
+
+    port
+    (
+        clk     : in  std_logic;
+        reset   : in  std_logic;
+        flush   : in  std_logic;
+
+        wr_en   : in  std_logic;
+        wr_num  : in  integer range 1 to LANES;
+        wr_data : in  std_logic_vector(LANES*DATA_WIDTH-1 downto 0);
+        rd_en   : in  std_logic;
+        rd_num  : in  integer range 1 to LANES;
+        rd_data : out std_logic_vector(LANES*DATA_WIDTH-1 downto 0);
+
+        level   : out integer range 0 to DEPTH;
+        empty   : out std_logic;
+        full    : out std_logic
+    );
+end entity;
+
+architecture rtl of i2c_fifo is
+
+    -- Note: rd_data shows the oldest entries (first word fall through), the oldest one in lane 0.
+    -- wr_en stores lanes 0 to wr_num - 1, rd_en removes rd_num entries.
+    -- A write that does not fit and a read of more entries than stored are ignored.
+
+    type mem_type is array (0 to DEPTH - 1) of std_logic_vector(DATA_WIDTH-1 downto 0);
+    signal mem          : mem_type;
+
+    signal wr_ptr       : integer range 0 to DEPTH - 1 := 0;
+    signal rd_ptr       : integer range 0 to DEPTH - 1 := 0;
+    signal count        : integer range 0 to DEPTH := 0;
+
+    signal do_write     : std_logic;
+    signal do_read      : std_logic;
+
+begin
+
+    do_write <= '1' when (wr_en = '1' and count + wr_num <= DEPTH) else '0';
+    do_read  <= '1' when (rd_en = '1' and rd_num <= count) else '0';
+
+    -- storage
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (do_write = '1') then
+                for i in 0 to LANES - 1 loop
+                    if (i < wr_num) then
+                        mem((wr_ptr + i) mod DEPTH) <= wr_data((i+1)*DATA_WIDTH-1 downto i*DATA_WIDTH);
+                    end if;
+                end loop;
+            end if;
+        end if;
+    end process;
+
+    process(mem, rd_ptr)
+    begin
+        for i in 0 to LANES - 1 loop
+            rd_data((i+1)*DATA_WIDTH-1 downto i*DATA_WIDTH) <= mem((rd_ptr + i) mod DEPTH);
+        end loop;
+    end process;
+
+    -- pointers and level
+    process(clk)
+        variable wr_n, rd_n : integer range 0 to LANES;
+    begin
+        if rising_edge(clk) then
+            if (reset = '1' or flush = '1') then
+                wr_ptr <= 0;
+                rd_ptr <= 0;
+                count  <= 0;
+            else
+                wr_n := 0;
+                rd_n := 0;
+
+                if (do_write = '1') then
+                    wr_n := wr_num;
+                    wr_ptr <= (wr_ptr + wr_num) mod DEPTH;
+                end if;
+
+                if (do_read = '1') then
+                    rd_n := rd_num;
+                    rd_ptr <= (rd_ptr + rd_num) mod DEPTH;
+                end if;
+
+                count <= count + wr_n - rd_n;
+            end if;
+        end if;
+    end process;
+
+    level <= count;
+    empty <= '1' when count = 0 else '0';
+    full  <= '1' when count = DEPTH else '0';
+
+end architecture;
@@ -1,445 +1,690 @@
-library ieee;
-use ieee.std_logic_1164.all;
-use ieee.numeric_std.all;
-
-entity i2c_master is 
-    generic (
-        SYS_CLK_FREQ_HZ : integer := 50_000_000;
-        I2C_FREQ_HZ     : integer := 100_000);
-
-    port 
-    (
-        clk           : in  std_logic;
-        reset         : in  std_logic;
-
-        slave_address : in  std_logic_vector(6 downto 0);
-        data_in       : in  std_logic_vector(7 downto 0);
-        data_out      : out std_logic_vector(7 downto 0);
-
-        enable        : in  std_logic;
-        continue      : in  std_logic;
-        read_write    : in  std_logic;
-        stop_signal   : in  std_logic;
-        busy          : out std_logic;
-        ack_error     : out std_logic;
-        done          : out std_logic;
-        ready         : out std_logic;
-            
-        scl           : out std_logic;
-        sda           : inout std_logic
-    );
-	 
-end entity;
-
-architecture behavioral of i2c_master is
-
-    -- Note: Not all internal signals are strictly necessary; they are included for clarity and code readability. 
-    -- The design could be minimized by removing some of them if desired.
-
-    constant scl_div_const : integer := (SYS_CLK_FREQ_HZ / (I2C_FREQ_HZ * 2 )) ;
-    type state_type is (
-        idle_state,
-        start_state,
-        address_state,
-        address_ack_state,
-        write_data_state,
-        read_data_state,
-        wait_write_state,
-        slave_ack_state,
-        master_ack_state,
-        prep_stop_state,
-        stop_state);
-
-    -- fsm signals
-    signal current_state        : state_type;
-
-    --internal control signals 
-    signal stop_transaction     : std_logic := '0';
-    signal transaction_pending  : std_logic := '0';
-    signal start_i2c            : std_logic := '0';
-    signal byte_ready           : std_logic := '0';
-
-    -- temporary registers 
-    signal bit_count         : integer range 0 to 7 := 7;
-
-    signal temp_addrRW       : std_logic_vector(7 downto 0);
-    signal transfer_reg      : std_logic_vector(7 downto 0);
-    signal receive_reg       : std_logic_vector(7 downto 0);
-    
-    --scl signals 
-    signal scl_counter       : integer range 0 to scl_div_const - 1 := 0;
-    signal scl_enable        : std_logic;
-    signal scl_active        : std_logic;
-
-    signal scl_internal      : std_logic;
-    signal scl_internal_prev : std_logic;
-
-    signal scl_fallingedge   : std_logic;
-    signal scl_risingedge    : std_logic;
-
-    -- sda constants/signals 
-    signal sda_out           : std_logic;
-	signal sda_oe            : std_logic;
-
-    -- stop setuptime counter 
-    constant C_SU_STO_STD    : integer := 200; 
-    signal   su_count        : integer range 0 to C_SU_STO_STD := 0;
-
-
-    
---processes
-begin     
-        -- stop control 
-        process(clk)
-        begin 
-            if rising_edge(clk) then
-                if (reset = '1') then
-                    stop_transaction <= '0';
-                
-                elsif (stop_signal = '1') then
-                    stop_transaction <= '1';
-    
-                elsif (current_state = stop_state) then
-                    stop_transaction <= '0';
-    
-                end if ;
-            end if ;
-        end process;
-    
-        -- start control 
-        process(clk) 
-        begin 
-            if rising_edge(clk) then
-                if (reset = '1') then
-                    start_i2c <= '0';
-    
-                elsif (enable = '1') then
-                    start_i2c <= '1';
-                
-                elsif (current_state = start_state) then
-                    start_i2c <= '0';
-                end if ;
-            end if ;
-        end process;
-    
-        -- continue control  
-        process(clk)
-        begin 
-            if rising_edge(clk) then
-                if (reset = '1') then
-                    transaction_pending <= '0';
-    
-                elsif (continue = '1') then
-                    transaction_pending <= '1';
-                
-                elsif (scl_risingedge = '1' and current_state = slave_ack_state) then
-                   transaction_pending <= '0';
-    
-                elsif (current_state = stop_state) then
-                    transaction_pending <= '0';
-                end if ;
-            end if ;
-        end process;
-    
-        -- ready handshake 
-        process(clk)
-        begin 
-            if rising_edge(clk) then
-                if (reset = '1')  then
-                    byte_ready <= '0';
-    
-                elsif (scl_risingedge= '1' and current_state = slave_ack_state and sda = '0' and read_write = '0') then
-                    byte_ready <= '1';
-    
-                elsif (transaction_pending = '1' or stop_transaction = '1' ) then
-                    byte_ready <= '0';
-                end if;
-            end if;
-        end process;
-        ready <= byte_ready;
-
-
-    --clock divison  
-    process(clk)
-    begin 
-        if rising_edge(clk) then
-
-            if (scl_counter  = scl_div_const - 1) then
-                scl_counter <= 0;
-                scl_enable <= '1';
-            else 
-                scl_counter <= scl_counter + 1;
-                scl_enable <= '0';
-
-            end if;
-        end if;
-    end process ; 
-
-       -- scl toggel control 
-       process(clk)
-       begin
-           if rising_edge(clk) then
-               case current_state is
-                    when idle_state | stop_state  =>
-                        scl_active <= '0'; 
-                       
-                    when wait_write_state  =>
-                       if (scl_fallingedge = '1') then
-                            scl_active <= '0'; 
-                        end if ;
-                    when others =>
-                        scl_active <= '1';    
-               end case;
-           end if;
-       end process;
-
-    --scl generation and edge detection 
-    process(clk)
-    begin 
-        if rising_edge(clk) then
-        
-            --scl generation 
-            if (reset = '1') then 
-                scl_internal <= '1';
-            elsif (scl_enable = '1' and scl_active = '1' ) then 
-                scl_internal <= not scl_internal;
-            else
-                scl_internal <= scl_internal;
-            end if;
-
-             -- scl egde detection 
-            if (scl_internal_prev = '0' and scl_internal = '1') then 
-                scl_risingedge  <= '1';
-                scl_fallingedge <= '0';
-
-            elsif (scl_internal_prev = '1' and scl_internal = '0') then 
-                scl_risingedge  <= '0';
-                scl_fallingedge <= '1';
-
-            else 
-                scl_risingedge  <= '0';
-                scl_fallingedge <= '0';
-
-            end if;
-            scl_internal_prev <= scl_internal;
-        end if;
-    end process; 
-    scl <= scl_internal;
-
-    -- sampling process
-    process(clk)
-    begin
-        if rising_edge(clk) then
-            if (reset = '1') then
-                receive_reg <= (others => '0');
-            elsif (scl_risingedge = '1') then 
-                if (current_state = read_data_state) then
-                    receive_reg(bit_count) <= sda;  
-                end if;
-            end if;
-        end if;
-    end process;
-
-    --sda driving process 
-    process(clk)
-    begin 
-        if rising_edge(clk) then
-                if (reset = '1') then
-                    sda_oe <= '0';
-                    sda_out <= '1';
-
-                elsif (scl_internal = '1' and scl_fallingedge = '0' and scl_risingedge = '0' ) then
-                    if(current_state = start_state) then 
-                        sda_out <= '0';
-                        sda_oe  <= '1';
-
-                    elsif (current_state = stop_state) then
-                        sda_out <= '0';
-                        sda_oe  <= '1';
-                        if (su_count = C_SU_STO_STD) then
-                            sda_out <= '1';
-                            sda_oe  <= '0';  
-                        else
-                            su_count <= su_count + 1;
-                        end if;
-
-                    elsif (current_state = idle_state) then
-                        sda_out <= '1';
-                        sda_oe  <= '0';
-                        
-                    end if;
-
-                elsif (scl_fallingedge = '0' and scl_risingedge='0' and scl_internal = '0' ) then 
-                    case current_state is 
-
-                    when address_state =>
-                        sda_oe  <= NOT temp_addrRW(bit_count);
-                        sda_out   <= '0';
-
-                    when write_data_state =>
-                        sda_oe <= NOT transfer_reg(bit_count);
-                        sda_out   <= '0';
-
-                    when slave_ack_state | read_data_state | address_ack_state | wait_write_state =>
-                        sda_out <= '1';
-                        sda_oe <= '0';
-
-                    when prep_stop_state => 
-                        sda_out <= '0';
-                        sda_oe  <= '1';
-                        su_count <= 0 ;
-
-                    when master_ack_state =>
-                        sda_out <= '1';
-                        sda_oe <= '0'; 
-
-                    when others =>
-                        sda_out <= '1';
-                        sda_oe <= '0';
-
-                    end case;
-                end if;
-        end if;
-    end process; 
-    sda <= '0' when sda_oe = '1' and sda_out = '0' else 'Z';
-
-    -- finite state machine
-    process(clk)
-    begin
-        if rising_edge(clk) then
-            if (reset = '1') then
-                current_state <= idle_state;
-                busy <= '0';
-                done <= '0';
-                ack_error <= '0';
-                bit_count <= 7;
-                data_out <= (others => '0');
-            else
-                -- Idle, start and wait states 
-                if (scl_internal = '1') then
-                    if (current_state = idle_state and start_i2c = '1') then
-                        busy <= '1'; 
-                        ack_error <= '0';
-                        done <= '0';
-                        transfer_reg <= data_in;
-                        temp_addrRW <= slave_address & read_write;
-                        current_state <= start_state;
-                    elsif (current_state = stop_state) then
-                        current_state <= idle_state;
-                    end if;
-
-                    
-                elsif (scl_internal = '0') then
-                    if (current_state = start_state) then
-                        current_state <= address_state;
-                    
-                    elsif (current_state = wait_write_state) then 
-                        if (transaction_pending = '1') then
-                            current_state <= write_data_state; 
-                        elsif (stop_transaction = '1') then
-                            done <= '1'; 
-                            current_state <= prep_stop_state;
-                        else 
-                            current_state <= wait_write_state; 
-                        end if;
-                    
-                    end if ;
-                end if;
-
-                -- Transaction and ack states 
-                if (scl_risingedge = '1') then
-                    case current_state is 
-
-                        when address_state =>
-                            if (bit_count = 0) then 
-                                current_state <= address_ack_state;
-                            else 
-                                bit_count <= bit_count - 1; 
-                                current_state <= address_state;
-                            end if;
-                           
-                        when address_ack_state =>
-                            bit_count <= 7;
-                            if (sda = '0') then
-                                if (read_write = '0' ) then   
-                                    current_state <= write_data_state;
-                                else 
-                                    current_state <= read_data_state;
-                                end if; 
-                            else 
-                                ack_error <= '1';
-                                done <= '1';
-                                busy <= '0';
-                                current_state <= prep_stop_state;
-                            end if;
-                            
-                        when write_data_state => 
-                            if (bit_count = 0) then 
-                                current_state <= slave_ack_state;
-                            else
-                                bit_count <= bit_count - 1;
-                                current_state <= write_data_state;
-                            end if; 
-                           
-                        when read_data_state =>
-                            if (bit_count = 0) then
-                                current_state <= master_ack_state;
-                            else
-                                bit_count <= bit_count - 1;
-                                current_state <= read_data_state;
-                            end if;
-                        
-                        when slave_ack_state =>
-                            if (sda = '0' and stop_transaction = '0') then
-                                transfer_reg <= data_in;
-                                bit_count <= 7;
-                                if (read_write = '0') then
-                                    current_state <= wait_write_state;
-                                else 
-                                    done <= '1';
-                                    busy <= '0'; 
-                                    current_state <= prep_stop_state;   
-                                end if;
-
-                            elsif (stop_transaction = '1') then
-                                done <= '1';
-                                busy <= '0';
-                                current_state <= prep_stop_state;
-
-                            else
-                                ack_error <= '1';
-                                done <= '1';
-                                busy <= '0';
-                                current_state <= prep_stop_state;
-                            end if;
-                            bit_count <= 7;
-                    
-                        when master_ack_state => 
-
-                            data_out <= receive_reg;
-                            if (sda_out = '0') then
-                                current_state <= prep_stop_state;
-                                done <= '1';
-                                busy <= '0';
-                            else 
-                               ack_error<= '1';
-                               done <= '1';
-                               busy <= '0';
-                               current_state <= prep_stop_state;
-                            end if;
-
-                        when prep_stop_state => 
-                            current_state <= stop_state;
-            
-                        when stop_state =>
-                            busy <= '0';
-                            current_state <= idle_state;
-
-                        when others =>
-                            current_state <= idle_state;
-                    end case;
-                end if;
-            end if;
-        end if;
-    end process;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity i2c_master is 
+    port 
+    (
+        clk           : in  std_logic;
+        reset         : in  std_logic;
+
+        slave_address : in  std_logic_vector(6 downto 0);
+        data_in       : in  std_logic_vector(7 downto 0);
+        data_out      : out std_logic_vector(7 downto 0);
+
+        enable        : in  std_logic;
+        continue      : in  std_logic;
+        read_write    : in  std_logic;
+        stop_signal   : in  std_logic;
+        restart       : in  std_logic;
+        recover       : in  std_logic;  -- with enable: bus recovery instead of a transaction
+        busy          : out std_logic;
+        ack_error     : out std_logic;
+        done          : out std_logic;
+        ready         : out std_logic;
+        data_taken    : out std_logic;
+        data_valid    : out std_logic;
+        timeout       : out std_logic;  -- scl held low by a slave for longer than stretch_timeout_cycles
+
+        -- events for the performance counters
+        tx_byte       : out std_logic;  -- one clock per byte sent, at the ack slot
+        cpu_stall     : out std_logic;  -- scl held low waiting for continue/stop/restart
+        scl_stretch   : out std_logic;  -- scl held low by a slave
+
+        -- fsm state for the bus trace, position of current_state in state_type
+        state_code    : out std_logic_vector(3 downto 0);
+
+        -- bus timing in system clock cycles 
+        scl_low_cycles  : in  std_logic_vector(15 downto 0);
+        scl_high_cycles : in  std_logic_vector(15 downto 0);
+        tsu_sta_cycles  : in  std_logic_vector(15 downto 0);
+        thd_sta_cycles  : in  std_logic_vector(15 downto 0);
+        tsu_sto_cycles  : in  std_logic_vector(15 downto 0);
+        tbuf_cycles     : in  std_logic_vector(15 downto 0);
+        stretch_timeout_cycles : in  std_logic_vector(31 downto 0);  -- 0: wait for the slave forever
+            
+        scl           : inout std_logic;
+        sda           : inout std_logic
+    );
+	 
+end entity;
+
+architecture behavioral of i2c_master is
+
+    -- Note: Not all internal signals are strictly necessary; they are included for clarity and code readability. 
+    -- The design could be minimized by removing some of them if desired.
+
+    type state_type is (
+        idle_state,
+        start_state,
+        restart_state,
+        restart_setup_state,
+        address_state,
+        address_ack_state,
+        write_data_state,
+        read_data_state,
+        wait_write_state,
+        wait_read_state,
+        slave_ack_state,
+        master_ack_state,
+        prep_stop_state,
+        stop_state,
+        recover_state);    -- scl pulses with sda released until the line is high
+
+    -- fsm signals
+    signal current_state        : state_type;
+    signal state_prev           : state_type;
+
+    --internal control signals 
+    signal stop_transaction     : std_logic := '0';
+    signal transaction_pending  : std_logic := '0';
+    signal start_i2c            : std_logic := '0';
+    signal restart_pending      : std_logic := '0';
+    signal byte_ready           : std_logic := '0';
+    signal seq_read             : std_logic := '0';
+    signal master_nack          : std_logic := '1';
+    signal recover_bus          : std_logic := '0';
+
+    -- temporary registers 
+    signal bit_count         : integer range 0 to 7 := 7;
+    signal recover_count     : integer range 0 to 8 := 0;   -- scl pulses of the recovery with sda still low
+
+    signal temp_addrRW       : std_logic_vector(7 downto 0);
+    signal transfer_reg      : std_logic_vector(7 downto 0);
+    signal receive_reg       : std_logic_vector(7 downto 0);
+    
+    --scl signals 
+    signal scl_counter       : unsigned(15 downto 0) := (others => '0');
+    signal scl_phase_len     : unsigned(15 downto 0);
+    signal scl_enable        : std_logic;
+    signal scl_active        : std_logic;
+
+    signal scl_internal      : std_logic;
+
+    signal scl_fallingedge   : std_logic;
+    signal scl_risingedge    : std_logic;
+
+    -- clock stretching, scl is released by scl_internal = '1' and is high once scl_line follows
+    signal scl_sync          : std_logic_vector(1 downto 0) := "11";
+    signal scl_line          : std_logic;
+    signal scl_level         : std_logic;
+    signal scl_level_prev    : std_logic;
+    signal scl_wait          : std_logic;
+    signal stretch_count     : unsigned(31 downto 0) := (others => '0');
+    signal stretch_expired   : std_logic;
+    signal start_wait        : std_logic;
+
+    -- sda line, synchronized, every sample of sda is taken from it (same delay as scl_line)
+    signal sda_sync          : std_logic_vector(1 downto 0) := "11";
+    signal sda_line          : std_logic;
+
+    -- sda constants/signals 
+    signal sda_out           : std_logic;
+	signal sda_oe            : std_logic;
+
+    -- start/stop condition timing, clock cycles spent in the current state 
+    signal cond_count        : unsigned(15 downto 0) := (others => '0');
+
+
+    
+--processes
+begin     
+        -- stop control, a stop given with an enable accepted during the stop is kept for the next start
+        process(clk)
+        begin 
+            if rising_edge(clk) then
+                if (reset = '1') then
+                    stop_transaction <= '0';
+                
+                elsif (stop_signal = '1') then
+                    stop_transaction <= '1';
+    
+                elsif (((current_state = prep_stop_state or current_state = stop_state) and start_i2c = '0')
+                       or stretch_expired = '1') then
+                    stop_transaction <= '0';
+    
+                end if ;
+            end if ;
+        end process;
+    
+        -- start control 
+        process(clk) 
+        begin 
+            if rising_edge(clk) then
+                if (reset = '1') then
+                    start_i2c <= '0';
+                    recover_bus <= '0';
+    
+                -- enable is ignored while a transaction is on the bus
+                elsif (enable = '1' and (current_state = idle_state or current_state = prep_stop_state or current_state = stop_state)) then
+                    start_i2c <= '1';
+                    recover_bus <= recover;
+                
+                -- a start that waits for a released scl ends with the stretch timeout as well
+                elsif (current_state = start_state or current_state = recover_state or stretch_expired = '1') then
+                    start_i2c <= '0';
+                end if ;
+            end if ;
+        end process;
+
+        -- repeated start control 
+        process(clk) 
+        begin 
+            if rising_edge(clk) then
+                if (reset = '1') then
+                    restart_pending <= '0';
+    
+                elsif (restart = '1') then
+                    restart_pending <= '1';
+                
+                elsif (current_state = start_state or current_state = idle_state) then
+                    restart_pending <= '0';
+                end if ;
+            end if ;
+        end process;
+    
+        -- continue control  
+        process(clk)
+        begin 
+            if rising_edge(clk) then
+                if (reset = '1') then
+                    transaction_pending <= '0';
+    
+                elsif (continue = '1') then
+                    transaction_pending <= '1';
+                
+                -- a continue given with a restart during a read is kept for the read after the restart
+                elsif (scl_risingedge = '1' and (current_state = slave_ack_state or (current_state = master_ack_state and restart_pending = '0'))) then
+                   transaction_pending <= '0';
+    
+                -- a continue given together with enable/restart only selects a sequential read,
+                -- an enable accepted during the stop keeps it for the next start
+                elsif ((current_state = stop_state and start_i2c = '0') or current_state = start_state
+                       or current_state = recover_state or stretch_expired = '1') then
+                    transaction_pending <= '0';
+                end if ;
+            end if ;
+        end process;
+    
+        -- ready handshake 
+        process(clk)
+        begin 
+            if rising_edge(clk) then
+                if (reset = '1')  then
+                    byte_ready <= '0';
+    
+                elsif (scl_risingedge= '1' and current_state = slave_ack_state and sda_line = '0' and temp_addrRW(0) = '0') then
+                    byte_ready <= '1';
+
+                -- sequential read: byte received, waiting for continue (ack) or stop (nack)
+                elsif (current_state = wait_read_state and state_prev /= wait_read_state and seq_read = '1') then
+                    byte_ready <= '1';
+    
+                elsif (transaction_pending = '1' or stop_transaction = '1' or restart_pending = '1') then
+                    byte_ready <= '0';
+                end if;
+            end if;
+        end process;
+        ready <= byte_ready;
+
+
+    --clock divison, the length of the high and low half periods comes from the timing registers
+    --the high period starts when scl is seen high on the line, a slave may hold it low before
+    --while scl is held high for a start/stop condition the divider waits with scl_enable set:
+    --the first scl low comes on the first clock after tHD;STA, not somewhere in a free running period
+    scl_phase_len <= unsigned(scl_high_cycles) when scl_internal = '1' else unsigned(scl_low_cycles);
+
+    process(clk)
+    begin 
+        if rising_edge(clk) then
+
+            if (scl_wait = '1') then
+                scl_counter <= (others => '0');
+                scl_enable <= '0';
+            elsif (scl_active = '0' and scl_internal = '1') then
+                scl_counter <= (others => '0');
+                scl_enable <= '1';
+            elsif (scl_counter + 1 >= scl_phase_len) then
+                scl_counter <= (others => '0');
+                scl_enable <= '1';
+            else 
+                scl_counter <= scl_counter + 1;
+                scl_enable <= '0';
+
+            end if;
+        end if;
+    end process ; 
+
+    -- condition timer 
+    process(clk)
+    begin 
+        if rising_edge(clk) then
+            if (reset = '1') then
+                state_prev <= idle_state;
+                cond_count <= (others => '0');
+            else
+                state_prev <= current_state;
+                if (current_state /= state_prev) then
+                    cond_count <= (others => '0');
+                elsif (cond_count /= x"FFFF") then
+                    cond_count <= cond_count + 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+       -- scl toggel control 
+       process(clk)
+       begin
+           if rising_edge(clk) then
+               case current_state is
+                    when idle_state | start_state | restart_setup_state | stop_state =>
+                        scl_active <= '0'; 
+                       
+                    when wait_write_state | wait_read_state =>
+                       if (scl_fallingedge = '1') then
+                            scl_active <= '0'; 
+                        end if ;
+                    when others =>
+                        scl_active <= '1';    
+               end case;
+           end if;
+       end process;
+
+    --scl generation and edge detection 
+    process(clk)
+    begin 
+        if rising_edge(clk) then
+        
+            --scl generation 
+            if (reset = '1') then 
+                scl_internal <= '1';
+            elsif (scl_enable = '1' and scl_active = '1' ) then 
+                scl_internal <= not scl_internal;
+            else
+                scl_internal <= scl_internal;
+            end if;
+
+             -- scl egde detection, the rising edge is taken from the line
+            if (scl_level_prev = '0' and scl_level = '1') then 
+                scl_risingedge  <= '1';
+                scl_fallingedge <= '0';
+
+            elsif (scl_level_prev = '1' and scl_level = '0') then 
+                scl_risingedge  <= '0';
+                scl_fallingedge <= '1';
+
+            else 
+                scl_risingedge  <= '0';
+                scl_fallingedge <= '0';
+
+            end if;
+            scl_level_prev    <= scl_level;
+        end if;
+    end process; 
+    scl <= '0' when scl_internal = '0' else 'Z';
+
+    -- scl line, synchronized
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                scl_sync <= "11";
+            else
+                scl_sync <= scl_sync(0) & to_x01(scl);
+            end if;
+        end if;
+    end process;
+    scl_line  <= scl_sync(1);
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                sda_sync <= "11";
+            else
+                sda_sync <= sda_sync(0) & to_x01(sda);
+            end if;
+        end if;
+    end process;
+    sda_line <= sda_sync(1);
+    scl_level <= scl_internal and scl_line;
+
+    -- clock stretching: scl released but still low on the line. the first two cycles are
+    -- the synchronizer delay, everything after it is the slave holding the clock
+    scl_wait <= '1' when (scl_internal = '1' and scl_line = '0' and scl_active = '1') else '0';
+
+    -- a start waits for scl and sda released on the line, a slave holding one of them
+    -- runs into the stretch timeout as well (the recovery does not wait for sda)
+    start_wait <= '1' when (current_state = idle_state and start_i2c = '1'
+                            and (scl_line = '0' or (sda_line = '0' and recover_bus = '0'))) else '0';
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                stretch_count   <= (others => '0');
+                stretch_expired <= '0';
+            else
+                stretch_expired <= '0';
+                if (scl_wait = '0' and start_wait = '0') then
+                    stretch_count <= (others => '0');
+                elsif (stretch_count /= x"FFFFFFFF") then
+                    stretch_count <= stretch_count + 1;
+                end if;
+
+                if ((scl_wait = '1' or start_wait = '1') and unsigned(stretch_timeout_cycles) /= 0
+                    and stretch_count = unsigned(stretch_timeout_cycles)) then
+                    stretch_expired <= '1';
+                end if;
+            end if;
+        end if;
+    end process;
+
+    -- performance counter events
+    cpu_stall   <= '1' when ((current_state = wait_write_state or current_state = wait_read_state) and scl_internal = '0') else '0';
+    scl_stretch <= '1' when (scl_wait = '1' and stretch_count >= 2) else '0';
+
+    state_code  <= std_logic_vector(to_unsigned(state_type'pos(current_state), 4));
+
+    -- sampling process
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                receive_reg <= (others => '0');
+            elsif (scl_risingedge = '1') then 
+                if (current_state = read_data_state) then
+                    receive_reg(bit_count) <= sda_line;  
+                end if;
+            end if;
+        end if;
+    end process;
+
+    --sda driving process 
+    process(clk)
+    begin 
+        if rising_edge(clk) then
+                if (reset = '1') then
+                    sda_oe <= '0';
+                    sda_out <= '1';
+
+                elsif (scl_internal = '1' and scl_fallingedge = '0' and scl_risingedge = '0' ) then
+                    if(current_state = start_state) then 
+                        sda_out <= '0';
+                        sda_oe  <= '1';
+
+                    elsif (current_state = stop_state) then
+                        sda_out <= '0';
+                        sda_oe  <= '1';
+
+                    elsif (current_state = idle_state) then
+                        sda_out <= '1';
+                        sda_oe  <= '0';
+                        
+                    end if;
+
+                elsif (scl_fallingedge = '0' and scl_risingedge='0' and scl_internal = '0' ) then 
+                    case current_state is 
+
+                    when address_state =>
+                        sda_oe  <= NOT temp_addrRW(bit_count);
+                        sda_out   <= '0';
+
+                    when write_data_state =>
+                        sda_oe <= NOT transfer_reg(bit_count);
+                        sda_out   <= '0';
+
+                    when slave_ack_state | read_data_state | address_ack_state | wait_write_state | wait_read_state =>
+                        sda_out <= '1';
+                        sda_oe <= '0';
+
+                    when prep_stop_state => 
+                        sda_out <= '0';
+                        sda_oe  <= '1';
+
+                    when master_ack_state =>
+                        sda_out <= '0';
+                        sda_oe <= not master_nack; 
+
+                    when others =>
+                        sda_out <= '1';
+                        sda_oe <= '0';
+
+                    end case;
+                end if;
+        end if;
+    end process; 
+    sda <= '0' when sda_oe = '1' and sda_out = '0' else 'Z';
+
+    -- finite state machine
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                current_state <= idle_state;
+                busy <= '0';
+                done <= '0';
+                ack_error <= '0';
+                bit_count <= 7;
+                data_out <= (others => '0');
+                data_taken <= '0';
+                data_valid <= '0';
+                tx_byte <= '0';
+                timeout <= '0';
+                seq_read <= '0';
+                master_nack <= '1';
+            else
+                -- one clock strobes towards the registerbank
+                data_taken <= '0';
+                data_valid <= '0';
+                tx_byte <= '0';
+
+                -- Idle, start and wait states 
+                if (scl_internal = '1') then
+                    -- bus recovery, scl may be held low by a slave, then the stretch timeout ends it
+                    if (current_state = idle_state and start_i2c = '1' and recover_bus = '1' and cond_count >= unsigned(tbuf_cycles)) then
+                        busy <= '1';
+                        ack_error <= '0';
+                        timeout <= '0';
+                        done <= '0';
+                        recover_count <= 0;
+                        current_state <= recover_state;
+                    -- a new start waits for the bus free time after the last stop and released lines
+                    elsif (current_state = idle_state and start_i2c = '1' and cond_count >= unsigned(tbuf_cycles)
+                           and scl_line = '1' and sda_line = '1') then
+                        busy <= '1'; 
+                        ack_error <= '0';
+                        timeout <= '0';
+                        done <= '0';
+                        transfer_reg <= data_in;
+                        data_taken <= not read_write;
+                        temp_addrRW <= slave_address & read_write;
+                        seq_read <= transaction_pending;
+                        current_state <= start_state;
+                    -- a line held low by a slave, the start waits for it until the stretch timeout
+                    elsif (start_wait = '1') then
+                        busy <= '1';
+                        ack_error <= '0';
+                        timeout <= '0';
+                        done <= '0';
+                    -- start hold time, scl is released after sda has been low for tHD;STA
+                    elsif (current_state = start_state and cond_count >= unsigned(thd_sta_cycles)) then
+                        current_state <= address_state;
+
+                    -- stop setup time, sda is released in idle after scl has been high for tSU;STO
+                    elsif (current_state = stop_state and cond_count >= unsigned(tsu_sto_cycles)) then
+                        busy <= '0';
+                        current_state <= idle_state;
+
+                    -- repeated start setup time, scl has been high for tSU;STA with sda released
+                    -- the first byte of a write after the repeated start comes from data_in like after a start
+                    elsif (current_state = restart_setup_state and cond_count >= unsigned(tsu_sta_cycles)) then
+                        transfer_reg <= data_in;
+                        data_taken <= not read_write;
+                        seq_read <= transaction_pending;
+                        current_state <= start_state;
+                    end if;
+
+                    
+                elsif (scl_internal = '0') then
+                    if (current_state = wait_write_state) then 
+                        if (restart_pending = '1') then
+                            temp_addrRW <= slave_address & read_write;
+                            bit_count <= 7;
+                            current_state <= restart_state;
+                        elsif (transaction_pending = '1') then
+                            transfer_reg <= data_in;
+                            data_taken <= '1';
+                            current_state <= write_data_state; 
+                        elsif (stop_transaction = '1') then
+                            done <= '1'; 
+                            current_state <= prep_stop_state;
+                        else 
+                            current_state <= wait_write_state; 
+                        end if;
+
+                    -- ack/nack decision for the received byte, scl is held low until there is one
+                    elsif (current_state = wait_read_state) then
+                        if (stop_transaction = '1' or restart_pending = '1') then
+                            master_nack <= '1';
+                            current_state <= master_ack_state;
+                        elsif (transaction_pending = '1') then
+                            master_nack <= '0';
+                            current_state <= master_ack_state;
+                        elsif (seq_read = '0') then
+                            master_nack <= '1';
+                            current_state <= master_ack_state;
+                        else 
+                            current_state <= wait_read_state;
+                        end if;
+                    end if ;
+                end if;
+
+                -- byte received, receive_reg holds all 8 bits one clock after the last sample
+                if (current_state = wait_read_state and state_prev /= wait_read_state) then
+                    data_out <= receive_reg;
+                    data_valid <= '1';
+                end if;
+
+                -- Transaction and ack states 
+                if (scl_risingedge = '1') then
+                    case current_state is 
+
+                        when address_state =>
+                            if (bit_count = 0) then 
+                                current_state <= address_ack_state;
+                            else 
+                                bit_count <= bit_count - 1; 
+                                current_state <= address_state;
+                            end if;
+                           
+                        when address_ack_state =>
+                            bit_count <= 7;
+                            tx_byte <= '1';
+                            if (sda_line = '0') then
+                                if (temp_addrRW(0) = '0' ) then   
+                                    current_state <= write_data_state;
+                                else 
+                                    current_state <= read_data_state;
+                                end if; 
+                            else 
+                                ack_error <= '1';
+                                done <= '1';
+                                busy <= '0';
+                                current_state <= prep_stop_state;
+                            end if;
+                            
+                        when write_data_state => 
+                            if (bit_count = 0) then 
+                                current_state <= slave_ack_state;
+                            else
+                                bit_count <= bit_count - 1;
+                                current_state <= write_data_state;
+                            end if; 
+                           
+                        when read_data_state =>
+                            if (bit_count = 0) then
+                                current_state <= wait_read_state;
+                            else
+                                bit_count <= bit_count - 1;
+                                current_state <= read_data_state;
+                            end if;
+                        
+                        when slave_ack_state =>
+                            tx_byte <= '1';
+                            if (sda_line = '0' and stop_transaction = '0') then
+                                bit_count <= 7;
+                                if (temp_addrRW(0) = '0') then
+                                    current_state <= wait_write_state;
+                                else 
+                                    done <= '1';
+                                    busy <= '0'; 
+                                    current_state <= prep_stop_state;   
+                                end if;
+
+                            elsif (stop_transaction = '1') then
+                                done <= '1';
+                                busy <= '0';
+                                current_state <= prep_stop_state;
+
+                            else
+                                ack_error <= '1';
+                                done <= '1';
+                                busy <= '0';
+                                current_state <= prep_stop_state;
+                            end if;
+                            bit_count <= 7;
+                    
+                        when master_ack_state => 
+                            bit_count <= 7;
+                            if (master_nack = '0') then
+                                current_state <= read_data_state;
+                            elsif (restart_pending = '1') then
+                                temp_addrRW <= slave_address & read_write;
+                                current_state <= restart_state;
+                            else 
+                                done <= '1';
+                                busy <= '0';
+                                current_state <= prep_stop_state;
+                            end if;
+
+                        when restart_state =>
+                            current_state <= restart_setup_state;
+
+                        when prep_stop_state => 
+                            current_state <= stop_state;
+
+                        -- a slave that holds sda in the middle of a byte lets it go within nine clocks,
+                        -- then a stop frees the bus. sda still low after the ninth: ack_error
+                        when recover_state =>
+                            if (sda_line = '1') then
+                                done <= '1';
+                                busy <= '0';
+                                current_state <= prep_stop_state;
+                            elsif (recover_count = 8) then
+                                ack_error <= '1';
+                                done <= '1';
+                                busy <= '0';
+                                current_state <= idle_state;
+                            else
+                                recover_count <= recover_count + 1;
+                            end if;
+            
+                        when others =>
+                            current_state <= idle_state;
+                    end case;
+                end if;
+
+                -- clock stretch timeout, scl and sda are released and the transaction ends without a stop
+                if (stretch_expired = '1' and (current_state /= idle_state or start_i2c = '1')) then
+                    timeout <= '1';
+                    done <= '1';
+                    busy <= '0';
+                    bit_count <= 7;
+                    current_state <= idle_state;
+                end if;
+            end if;
+        end if;
+    end process;
 end behavioral;
\ No newline at end of file
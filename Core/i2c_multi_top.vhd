@@ -0,0 +1,215 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Several independent i2c_top channels behind one SBI slave and one Avalon-MM master.
+--
+-- Channel n takes the 64 words at sbi_addr = n * 64 (byte offset n * 0x100), with the
+-- register map of i2c_top. The window after the last channel is shared:
+--   word 0  IRQ_SUMMARY  bit n is the irq line of channel n
+--   word 1  CHANNELS     number of channels
+-- Writes to the shared window are ignored.
+--
+-- The command sequencers of the channels share the Avalon-MM master, a channel keeps it
+-- until its transfer is accepted and the next requesting channel follows round robin.
+
+entity i2c_multi_top is
+    generic
+    (
+        CHANNELS        : integer := 2;
+        CH_BITS         : integer := 2;   -- channel select bits, 2**CH_BITS > CHANNELS
+        FIFO_DEPTH      : integer := 16;
+        SYS_CLK_FREQ_HZ : integer := 50_000_000;
+        I2C_FREQ_HZ     : integer := 100_000;
+        REGISTERED_READ : boolean := false   -- channel reads take one wait state
+    );
+    port
+    (
+        -- system signals
+        clk        : in  std_logic;
+        reset      : in  std_logic;
+
+        -- sbi interface
+        sbi_cs     : in  std_logic;
+        sbi_we     : in  std_logic;
+        sbi_re     : in  std_logic;
+        sbi_addr   : in  std_logic_vector(CH_BITS+5 downto 0);
+        sbi_wdata  : in  std_logic_vector(31 downto 0);
+        sbi_rdata  : out std_logic_vector(31 downto 0);
+        sbi_ready  : out std_logic;
+
+        -- interrupt, any channel
+        irq        : out std_logic;
+
+        -- avalon-mm master shared by the command sequencers
+        avm_address     : out std_logic_vector(31 downto 0);
+        avm_read        : out std_logic;
+        avm_write       : out std_logic;
+        avm_writedata   : out std_logic_vector(31 downto 0);
+        avm_byteenable  : out std_logic_vector(3 downto 0);
+        avm_readdata    : in  std_logic_vector(31 downto 0) := (others => '0');
+        avm_waitrequest : in  std_logic := '0';
+
+        -- i2c interfaces, one bus per channel
+        sda        : inout std_logic_vector(CHANNELS-1 downto 0);
+        scl        : inout std_logic_vector(CHANNELS-1 downto 0)
+    );
+end entity i2c_multi_top;
+
+architecture struct of i2c_multi_top is
+
+    -- components
+    component i2c_top is
+        generic
+        (
+            FIFO_DEPTH      : integer := 16;
+            SYS_CLK_FREQ_HZ : integer := 50_000_000;
+            I2C_FREQ_HZ     : integer := 100_000;
+            REGISTERED_READ : boolean := false
+        );
+        port
+        (
+            clk        : in  std_logic;
+            reset      : in  std_logic;
+
+            sbi_cs     : in  std_logic;
+            sbi_we     : in  std_logic;
+            sbi_re     : in  std_logic;
+            sbi_addr   : in  std_logic_vector(5 downto 0);
+            sbi_wdata  : in  std_logic_vector(31 downto 0);
+            sbi_rdata  : out std_logic_vector(31 downto 0);
+            sbi_ready  : out std_logic;
+
+            irq        : out std_logic;
+
+            avm_address     : out std_logic_vector(31 downto 0);
+            avm_read        : out std_logic;
+            avm_write       : out std_logic;
+            avm_writedata   : out std_logic_vector(31 downto 0);
+            avm_byteenable  : out std_logic_vector(3 downto 0);
+            avm_readdata    : in  std_logic_vector(31 downto 0) := (others => '0');
+            avm_waitrequest : in  std_logic := '0';
+
+            sda        : inout std_logic;
+            scl        : inout std_logic
+        );
+    end component;
+
+    type word_array is array (0 to CHANNELS - 1) of std_logic_vector(31 downto 0);
+    type be_array   is array (0 to CHANNELS - 1) of std_logic_vector(3 downto 0);
+
+    constant C_IRQ_SUMMARY : integer := 0;
+    constant C_CHANNELS    : integer := 1;
+
+    signal window        : integer range 0 to 2**CH_BITS - 1;
+    signal ch_cs         : std_logic_vector(CHANNELS-1 downto 0);
+    signal ch_rdata      : word_array;
+    signal ch_ready      : std_logic_vector(CHANNELS-1 downto 0);
+    signal ch_irq        : std_logic_vector(CHANNELS-1 downto 0);
+
+    signal ch_address    : word_array;
+    signal ch_read       : std_logic_vector(CHANNELS-1 downto 0);
+    signal ch_write      : std_logic_vector(CHANNELS-1 downto 0);
+    signal ch_writedata  : word_array;
+    signal ch_byteenable : be_array;
+    signal ch_wait       : std_logic_vector(CHANNELS-1 downto 0);
+
+    signal grant         : integer range 0 to CHANNELS - 1;
+
+begin
+
+    assert 2**CH_BITS > CHANNELS
+        report "i2c_multi_top: CH_BITS leaves no room for the shared window" severity failure;
+
+    window <= to_integer(unsigned(sbi_addr(CH_BITS+5 downto 6)));
+
+    -- channel instances
+    channel_gen : for n in 0 to CHANNELS - 1 generate
+
+        ch_cs(n) <= sbi_cs when window = n else '0';
+
+        top_inst : i2c_top
+            generic map
+            (
+                FIFO_DEPTH      => FIFO_DEPTH,
+                SYS_CLK_FREQ_HZ => SYS_CLK_FREQ_HZ,
+                I2C_FREQ_HZ     => I2C_FREQ_HZ,
+                REGISTERED_READ => REGISTERED_READ
+            )
+            port map
+            (
+                clk             => clk,
+                reset           => reset,
+                sbi_cs          => ch_cs(n),
+                sbi_we          => sbi_we,
+                sbi_re          => sbi_re,
+                sbi_addr        => sbi_addr(5 downto 0),
+                sbi_wdata       => sbi_wdata,
+                sbi_rdata       => ch_rdata(n),
+                sbi_ready       => ch_ready(n),
+                irq             => ch_irq(n),
+                avm_address     => ch_address(n),
+                avm_read        => ch_read(n),
+                avm_write       => ch_write(n),
+                avm_writedata   => ch_writedata(n),
+                avm_byteenable  => ch_byteenable(n),
+                avm_readdata    => avm_readdata,
+                avm_waitrequest => ch_wait(n),
+                sda             => sda(n),
+                scl             => scl(n)
+            );
+
+        ch_wait(n) <= avm_waitrequest when grant = n else '1';
+
+    end generate;
+
+    irq <= '1' when ch_irq /= (ch_irq'range => '0') else '0';
+
+    -- the shared registers answer without a wait state
+    sbi_ready <= ch_ready(window) when window < CHANNELS else '1';
+
+    -- read data, the channel window or the shared registers
+    process(window, sbi_addr, ch_rdata, ch_irq)
+    begin
+        sbi_rdata <= (others => '0');
+        if (window < CHANNELS) then
+            sbi_rdata <= ch_rdata(window);
+        elsif (window = CHANNELS) then
+            case to_integer(unsigned(sbi_addr(5 downto 0))) is
+                when C_IRQ_SUMMARY =>
+                    sbi_rdata(CHANNELS-1 downto 0) <= ch_irq;
+                when C_CHANNELS =>
+                    sbi_rdata <= std_logic_vector(to_unsigned(CHANNELS, 32));
+                when others =>
+                    null;
+            end case;
+        end if;
+    end process;
+
+    -- avalon-mm arbitration, the granted channel keeps the master until its transfer is
+    -- accepted, an idle owner hands over to the next requesting channel
+    process(clk)
+        variable next_ch : integer range 0 to CHANNELS - 1;
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                grant <= 0;
+            elsif ((ch_read(grant) = '0' and ch_write(grant) = '0') or avm_waitrequest = '0') then
+                for i in 1 to CHANNELS loop
+                    next_ch := (grant + i) mod CHANNELS;
+                    if (ch_read(next_ch) = '1' or ch_write(next_ch) = '1') then
+                        grant <= next_ch;
+                        exit;
+                    end if;
+                end loop;
+            end if;
+        end if;
+    end process;
+
+    avm_address    <= ch_address(grant);
+    avm_read       <= ch_read(grant);
+    avm_write      <= ch_write(grant);
+    avm_writedata  <= ch_writedata(grant);
+    avm_byteenable <= ch_byteenable(grant);
+
+end architecture struct;
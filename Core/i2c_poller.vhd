@@ -0,0 +1,245 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Auto poller: reads a register range of one slave every period ms on the i2c master
+-- (pointer write, repeated start, sequential read with stop) and keeps the bytes in a
+-- mirror the cpu reads over SBI. The mirror is double buffered, a poll that ends on a
+-- nack or a stretch timeout leaves the last good values in place.
+--
+-- The poller only starts on a free bus, cpu and sequencer transactions go first.
+
+entity i2c_poller is
+    generic
+    (
+        SYS_CLK_FREQ_HZ : integer := 50_000_000
+    );
+    port
+    (
+        clk           : in  std_logic;
+        reset         : in  std_logic;
+
+        -- registerbank
+        enable        : in  std_logic;
+        period        : in  std_logic_vector(15 downto 0);   -- ms from the start of one poll to the next, 0 is taken as 1
+        slave         : in  std_logic_vector(6 downto 0);
+        first_reg     : in  std_logic_vector(7 downto 0);
+        length        : in  integer range 1 to 32;           -- bytes from first_reg on
+        mirror_word   : in  std_logic_vector(2 downto 0);
+        mirror_data   : out std_logic_vector(31 downto 0);   -- bytes 4*mirror_word to 4*mirror_word+3, the first in bits 7:0
+        count         : out std_logic_vector(31 downto 0);   -- polls that updated the mirror
+        age           : out std_logic_vector(15 downto 0);   -- ms since the last update, saturating
+        failed        : out std_logic;                       -- the last poll ended on a nack or timeout
+
+        -- arbitration
+        bus_free      : in  std_logic;
+        running       : out std_logic;   -- the poller has the master
+        owner         : out std_logic;   -- running, or the master still shows the end of the poll
+
+        -- master control, used while running
+        slave_address : out std_logic_vector(6 downto 0);
+        data_in       : out std_logic_vector(7 downto 0);
+        enable_out    : out std_logic;
+        read_write    : out std_logic;
+        stop_signal   : out std_logic;
+        continue      : out std_logic;
+        restart       : out std_logic;
+
+        -- master status
+        data_out      : in  std_logic_vector(7 downto 0);
+        ack_error     : in  std_logic;
+        timeout       : in  std_logic;
+        done          : in  std_logic;
+        ready         : in  std_logic;
+        data_valid    : in  std_logic
+    );
+end entity;
+
+architecture rtl of i2c_poller is
+
+    type state_type is (
+        idle_state,
+        pointer_state,     -- register pointer on the bus, waiting for its ack
+        read_state,
+        wait_done_state,   -- stop given, waiting for the end of the transaction
+        finish_state);
+
+    signal state            : state_type;
+
+    constant C_MS_CYCLES    : integer := SYS_CLK_FREQ_HZ / 1000;
+
+    -- two banks of 32 bytes, the cpu reads bank front, the poll fills the other one
+    type mirror_type is array (0 to 63) of std_logic_vector(7 downto 0);
+    signal mirror           : mirror_type;
+    signal front            : std_logic;
+
+    signal ms_cycles        : integer range 0 to C_MS_CYCLES - 1;
+    signal ms_tick          : std_logic;
+    signal since_start      : unsigned(15 downto 0);   -- ms since the last poll started
+    signal since_update     : unsigned(15 downto 0);
+    signal due              : std_logic;
+
+    signal poll_count       : unsigned(31 downto 0);
+    signal byte_count       : integer range 0 to 32;
+    signal failed_internal  : std_logic;
+
+    signal done_prev        : std_logic;
+    signal ready_prev       : std_logic;
+    signal master_end       : std_logic;
+    signal master_fail      : std_logic;
+
+    signal running_internal : std_logic;
+    signal owner_internal   : std_logic;
+    signal rw_internal      : std_logic;
+
+begin
+
+    -- millisecond tick and the poll period
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                ms_cycles    <= 0;
+                ms_tick      <= '0';
+                since_update <= (others => '1');
+            else
+                ms_tick <= '0';
+                if (ms_cycles = C_MS_CYCLES - 1) then
+                    ms_cycles <= 0;
+                    ms_tick   <= '1';
+                else
+                    ms_cycles <= ms_cycles + 1;
+                end if;
+
+                if (state = finish_state and master_fail = '0') then
+                    since_update <= (others => '0');
+                elsif (ms_tick = '1' and since_update /= x"FFFF") then
+                    since_update <= since_update + 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    due <= '1' when (enable = '1' and (since_start >= unsigned(period) or unsigned(period) = 0)
+                     and since_start /= 0) else '0';
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                state            <= idle_state;
+                front            <= '0';
+                since_start      <= (others => '1');
+                poll_count       <= (others => '0');
+                byte_count       <= 0;
+                failed_internal  <= '0';
+                done_prev        <= '0';
+                ready_prev       <= '0';
+                master_end       <= '0';
+                master_fail      <= '0';
+                running_internal <= '0';
+                owner_internal   <= '0';
+                rw_internal      <= '0';
+                enable_out       <= '0';
+                restart          <= '0';
+                stop_signal      <= '0';
+                continue         <= '0';
+            else
+                -- one clock strobes
+                enable_out  <= '0';
+                restart     <= '0';
+                stop_signal <= '0';
+                continue    <= '0';
+
+                if (ms_tick = '1' and since_start /= x"FFFF") then
+                    since_start <= since_start + 1;
+                end if;
+
+                done_prev  <= done;
+                ready_prev <= ready;
+                if (done = '1' and done_prev = '0') then
+                    master_end  <= '1';
+                    master_fail <= ack_error or timeout;
+                end if;
+
+                -- the registerbank keeps its view of the master until the next transaction clears done
+                if (running_internal = '0' and done = '0') then
+                    owner_internal <= '0';
+                end if;
+
+                case state is
+
+                    when idle_state =>
+                        if (due = '1' and bus_free = '1') then
+                            running_internal <= '1';
+                            owner_internal   <= '1';
+                            rw_internal      <= '0';
+                            enable_out       <= '1';
+                            master_end       <= '0';
+                            byte_count       <= 0;
+                            since_start      <= (others => '0');
+                            state            <= pointer_state;
+                        end if;
+
+                    -- the master waits in wait_write after the pointer, the read follows with a repeated start
+                    when pointer_state =>
+                        if (master_end = '1') then
+                            state <= finish_state;
+                        elsif (ready = '1' and ready_prev = '0') then
+                            rw_internal <= '1';
+                            restart     <= '1';
+                            continue    <= '1';   -- sequential read, every byte waits for the decision
+                            state       <= read_state;
+                        end if;
+
+                    when read_state =>
+                        if (master_end = '1') then
+                            state <= finish_state;
+                        elsif (data_valid = '1') then
+                            mirror(to_integer(unsigned'(not front & to_unsigned(byte_count, 5)))) <= data_out;
+                            byte_count <= byte_count + 1;
+                            if (byte_count = length - 1) then
+                                stop_signal <= '1';
+                                state <= wait_done_state;
+                            else
+                                continue <= '1';
+                            end if;
+                        end if;
+
+                    when wait_done_state =>
+                        if (master_end = '1') then
+                            state <= finish_state;
+                        end if;
+
+                    when finish_state =>
+                        running_internal <= '0';
+                        failed_internal  <= master_fail;
+                        if (master_fail = '0') then
+                            front      <= not front;
+                            poll_count <= poll_count + 1;
+                        end if;
+                        state <= idle_state;
+
+                end case;
+            end if;
+        end if;
+    end process;
+
+    process(mirror, front, mirror_word)
+        variable base : integer range 0 to 63;
+    begin
+        base := to_integer(unsigned'(front & unsigned(mirror_word) & "00"));
+        mirror_data <= mirror(base + 3) & mirror(base + 2) & mirror(base + 1) & mirror(base);
+    end process;
+
+    count   <= std_logic_vector(poll_count);
+    age     <= std_logic_vector(since_update);
+    failed  <= failed_internal;
+    running <= running_internal;
+    owner   <= owner_internal;
+
+    slave_address <= slave;
+    data_in       <= first_reg;
+    read_write    <= rw_internal;
+
+end architecture;
@@ -1,192 +1,1145 @@
-library ieee;
-use ieee.std_logic_1164.all;
-use ieee.numeric_std.all;
-
-
-entity i2c_registerbank is
-    port (
-        -- system signals
-        clk         : in  std_logic;
-        reset       : in  std_logic;
-
-        -- sbi interface
-        sbi_cs      : in  std_logic;
-        sbi_we      : in  std_logic;
-        sbi_re      : in  std_logic;
-        sbi_addr    : in  std_logic_vector(1 downto 0);  
-        sbi_wdata   : in  std_logic_vector(31 downto 0);
-        sbi_rdata   : out std_logic_vector(31 downto 0);
-
-        -- master control 
-        slave_address : out std_logic_vector(6 downto 0);
-        data_in       : out std_logic_vector(7 downto 0);
-        enable        : out std_logic;
-        read_write    : out std_logic;
-        stop_signal   : out std_logic;
-        continue      : out std_logic;
-
-        -- master status 
-        data_out    : in  std_logic_vector(7 downto 0);
-        busy        : in  std_logic;
-        ack_error   : in  std_logic;
-        done        : in  std_logic;
-        ready       : in  std_logic
-    );
-end i2c_registerbank;
-
-architecture rtl of i2c_registerbank is
-    
-    -- Note: Not all internal signals are strictly necessary; they are included for clarity and code readability. 
-    -- The design could be minimized by removing some of them if desired.
-
-    -- internal registers
-    signal control_register : std_logic_vector(3 downto 0);  -- 0x00  (continue - rw - stop - enable)
-    signal write_register   : std_logic_vector(14 downto 0); -- 0x04  (slaveaddress[6:0] & datain[7:0])
-    signal status_register  : std_logic_vector(3 downto 0);  -- 0x08  (ready - ack_error - busy - done)
-    signal read_register    : std_logic_vector(7 downto 0);  -- 0x0C  (dataout)
-
-    -- internal control signals 
-    signal enable_internal, stop_internal, readwrite_internal, continue_internal : std_logic;
-
-    -- internal write signals
-    signal slave_address_internal     : std_logic_vector(6 downto 0);
-    signal datain_internal            : std_logic_vector(7 downto 0);
-
-    -- internal read signals 
-    signal dataout_internal           : std_logic_vector(7 downto 0);
-
-
-begin 
-
-    -- enable    
-    process(clk)
-    begin
-        if rising_edge(clk) then
-            if (reset = '1') then
-                enable_internal <= '0';
-            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "00") then
-                enable_internal <= sbi_wdata(0);
-            else
-                enable_internal <= '0';
-            end if;
-        end if;
-    end process;
-    control_register(0) <= enable_internal;
-    enable <= control_register(0);
-
-    -- stop 
-    process(clk)
-    begin
-        if rising_edge(clk) then
-            if reset = '1' then
-                stop_internal <= '0';
-            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "00") then
-                stop_internal <= sbi_wdata(1);
-            else 
-                stop_internal <= '0';
-            end if;
-        end if;
-    end process;
-    control_register(1) <= stop_internal;
-    stop_signal <= control_register(1);
-
-    -- read/write 
-    process(clk)
-    begin
-        if rising_edge(clk) then
-            if reset = '1' then
-                readwrite_internal <= '0';
-            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "00") then
-                readwrite_internal <= sbi_wdata(2);
-            end if;
-        end if;
-    end process;
-    control_register(2) <= readwrite_internal;
-    read_write <= control_register(2);
-
-    -- continue 
-    process(clk)
-    begin
-        if rising_edge(clk) then
-            if (reset = '1') then
-                continue_internal <= '0';
-            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "00") then
-                continue_internal <= sbi_wdata(3);
-            else 
-                continue_internal <= '0';
-            end if;
-        end if;
-    end process;
-    control_register(3) <= continue_internal;
-    continue <= control_register(3);
-
-    --write process 
-    process(clk)
-    begin 
-        if rising_edge(clk) then
-            if (reset = '1') then
-                slave_address_internal <= (others => '0');
-                datain_internal <= (others => '0');
-
-            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "01") then
-                slave_address_internal <= sbi_wdata(14 downto 8);
-                datain_internal <= sbi_wdata(7 downto 0);
-            end if ;
-        end if ;
-    end process;
-    write_register(14 downto 8) <= slave_address_internal;
-    write_register(7 downto 0)  <= datain_internal;
-
-    slave_address <= write_register(14 downto 8);
-    data_in       <= write_register(7 downto 0);
-
-    -- status register 
-    process(ready, ack_error, busy, done)
-    begin 
-        status_register(3) <= ready;
-        status_register(2) <= ack_error;
-        status_register(1) <= busy;
-        status_register(0) <= done;
-    end process;
-
-    -- reading register 
-    process(clk)
-    begin
-        if rising_edge(clk) then
-            if (reset='1') then
-                dataout_internal <= (others=>'0');
-
-            elsif (done='1') then              
-                dataout_internal <= data_out;
-            end if;
-        end if;
-    end process;
-    read_register <= dataout_internal;
-
-    
-    -- reading process
-    process(sbi_cs, sbi_re, sbi_addr, control_register, write_register, status_register, read_register)
-    begin
-        if (sbi_cs = '1' and sbi_re = '1') then
-            case sbi_addr is
-                when "00" =>
-                    sbi_rdata <= (31 downto 4 => '0') & control_register;
-            
-                when "01" =>
-                    sbi_rdata <= (31 downto 15 => '0') & write_register;
-            
-                when "10" =>
-                    sbi_rdata <= (31 downto 4 => '0') & status_register;
-            
-                when "11" =>
-                    sbi_rdata <= (31 downto 8 => '0') & read_register;
-            
-                when others =>
-                    sbi_rdata <= (others => '0');
-            end case;
-        else
-            sbi_rdata <= (others => '0');
-
-        end if;
-    end process;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+
+entity i2c_registerbank is
+    generic (
+        FIFO_DEPTH      : integer := 16;
+        SYS_CLK_FREQ_HZ : integer := 50_000_000;
+        I2C_FREQ_HZ     : integer := 100_000;
+        REGISTERED_READ : boolean := false);   -- sbi_rdata from a register, reads take one wait state
+
+    port (
+        -- system signals
+        clk         : in  std_logic;
+        reset       : in  std_logic;
+
+        -- sbi interface
+        sbi_cs      : in  std_logic;
+        sbi_we      : in  std_logic;
+        sbi_re      : in  std_logic;
+        sbi_addr    : in  std_logic_vector(5 downto 0);
+        sbi_wdata   : in  std_logic_vector(31 downto 0);
+        sbi_rdata   : out std_logic_vector(31 downto 0);
+        sbi_ready   : out std_logic;
+
+        -- master control 
+        slave_address : out std_logic_vector(6 downto 0);
+        data_in       : out std_logic_vector(7 downto 0);
+        enable        : out std_logic;
+        read_write    : out std_logic;
+        stop_signal   : out std_logic;
+        continue      : out std_logic;
+        restart       : out std_logic;
+        recover       : out std_logic;
+
+        -- master bus timing 
+        scl_low_cycles  : out std_logic_vector(15 downto 0);
+        scl_high_cycles : out std_logic_vector(15 downto 0);
+        tsu_sta_cycles  : out std_logic_vector(15 downto 0);
+        thd_sta_cycles  : out std_logic_vector(15 downto 0);
+        tsu_sto_cycles  : out std_logic_vector(15 downto 0);
+        tbuf_cycles     : out std_logic_vector(15 downto 0);
+        stretch_timeout_cycles : out std_logic_vector(31 downto 0);
+
+        -- master status 
+        data_out    : in  std_logic_vector(7 downto 0);
+        busy        : in  std_logic;
+        ack_error   : in  std_logic;
+        timeout     : in  std_logic;
+        done        : in  std_logic;
+        ready       : in  std_logic;
+        data_taken  : in  std_logic;
+        data_valid  : in  std_logic;
+
+        -- master events for the performance counters
+        tx_byte     : in  std_logic;
+        cpu_stall   : in  std_logic;
+        scl_stretch : in  std_logic;
+
+        -- command sequencer
+        seq_start    : out std_logic;
+        seq_head     : out std_logic_vector(31 downto 0);
+        seq_running  : in  std_logic;
+        seq_error    : in  std_logic;
+        seq_current  : in  std_logic_vector(31 downto 0);
+        seq_finished : in  std_logic;
+
+        -- auto poller
+        poll_enable  : out std_logic;
+        poll_period  : out std_logic_vector(15 downto 0);
+        poll_slave   : out std_logic_vector(6 downto 0);
+        poll_first   : out std_logic_vector(7 downto 0);
+        poll_length  : out integer range 1 to 32;
+        poll_word    : out std_logic_vector(2 downto 0);
+        poll_mirror  : in  std_logic_vector(31 downto 0);
+        poll_count   : in  std_logic_vector(31 downto 0);
+        poll_age     : in  std_logic_vector(15 downto 0);
+        poll_failed  : in  std_logic;
+        poll_running : in  std_logic;
+        poll_owner   : in  std_logic;
+
+        -- bus trace
+        trace_enable   : out std_logic;
+        trace_clear    : out std_logic;
+        trace_states   : out std_logic;
+        trace_trigger  : out std_logic_vector(1 downto 0);
+        trace_address  : out std_logic_vector(6 downto 0);
+        trace_post     : out std_logic_vector(7 downto 0);
+        trace_prescale : out std_logic_vector(3 downto 0);
+        trace_pop      : out std_logic;
+        trace_data     : in  std_logic_vector(31 downto 0);
+        trace_level    : in  std_logic_vector(15 downto 0);
+        trace_flags    : in  std_logic_vector(3 downto 0);  -- wrapped - stopped - triggered - recording
+
+        -- interrupt
+        irq         : out std_logic
+    );
+end i2c_registerbank;
+
+architecture rtl of i2c_registerbank is
+    
+    -- Note: Not all internal signals are strictly necessary; they are included for clarity and code readability. 
+    -- The design could be minimized by removing some of them if desired.
+
+    -- internal registers
+    signal control_register : std_logic_vector(5 downto 0);  -- 0x00  (recover - restart - continue - rw - stop - enable)
+    signal write_register   : std_logic_vector(14 downto 0); -- 0x04  (slaveaddress[6:0] & datain[7:0])
+    signal status_register  : std_logic_vector(8 downto 0);  -- 0x08  (seq_done - hold_empty - timeout - rx_thr - tx_thr - ready - ack_error - busy - done), w1c: seq_done, hold_empty, timeout, ready, ack_error, done
+    signal read_register    : std_logic_vector(7 downto 0);  -- 0x0C  (dataout)
+    signal irq_register     : std_logic_vector(8 downto 0);  -- 0x10  (seq_done - hold_empty - timeout - rx_thr - tx_thr - ready - ack_error - unused - done) interrupt enable
+                                                             -- 0x14  (stop & data[7:0]), write only, pushes into the tx fifo
+    signal rx_data_register : std_logic_vector(7 downto 0);  -- 0x18  (data[7:0]), read pops from the rx fifo
+    signal fifo_status      : std_logic_vector(21 downto 0); -- 0x1C  (rx_thr - tx_thr - rx_full - rx_empty - tx_full - tx_empty - rx_level[7:0] - tx_level[7:0])
+    signal fifo_control     : std_logic_vector(31 downto 0); -- 0x20  (rx_length[7:0] - rx_threshold[7:0] - tx_threshold[7:0] - rx_flush - tx_flush - fifo_enable)
+    signal scl_timing       : std_logic_vector(31 downto 0); -- 0x24  (scl_high[15:0] - scl_low[15:0]) in clock cycles
+    signal start_timing     : std_logic_vector(31 downto 0); -- 0x28  (thd_sta[15:0] - tsu_sta[15:0]) in clock cycles
+    signal stop_timing      : std_logic_vector(31 downto 0); -- 0x2C  (tbuf[15:0] - tsu_sto[15:0]) in clock cycles
+                                                             -- 0x30  (clear - snapshot), performance counter control, write only
+                                                             -- 0x34 - 0x50 performance counters, see C_PERF_*
+    signal stretch_timeout  : std_logic_vector(31 downto 0); -- 0x54  clock cycles a slave may hold scl low, 0 = no limit
+                                                             -- 0x58  (stop & data[7:0]), write only, holding register for the next byte
+                                                             -- 0x5C  (slaveaddress[6:0]), same register as write_register(14 downto 8)
+                                                             -- 0x60  (data3 - data2 - data1 - data0), write only, pushes pack_count bytes into the tx fifo
+    signal pack_control     : std_logic_vector(10 downto 0); -- 0x64  (rx_count[2:0] - unused[4:0] - stop - tx_count[2:0])
+                                                             -- 0x68  (data3 - data2 - data1 - data0), read pops up to 4 bytes from the rx fifo
+    signal seq_control      : std_logic_vector(1 downto 0);  -- 0x6C  (error - running), write bit 0 starts the descriptor list at seq_head
+    signal seq_head_reg     : std_logic_vector(31 downto 0); -- 0x70  address of the first descriptor
+                                                             -- 0x74  address of the current descriptor, read only
+    signal poll_control     : std_logic_vector(31 downto 0); -- 0x78  (period_ms[15:0] - unused - slaveaddress[6:0] - unused[6:0] - enable)
+    signal poll_range       : std_logic_vector(15 downto 0); -- 0x7C  (length[7:0] - first_reg[7:0]), length 1 to 32, others select 32
+                                                             -- 0x80  polls that updated the mirror, read only
+    signal poll_status      : std_logic_vector(31 downto 0); -- 0x84  (failed - unused[14:0] - age_ms[15:0]), read only
+    signal trace_control    : std_logic_vector(27 downto 0); -- 0x88  (prescale[3:0] - post_count[7:0] - unused - trig_address[6:0] - unused[1:0] - trigger[1:0] - unused - states - clear - enable)
+    signal trace_status     : std_logic_vector(31 downto 0); -- 0x8C  (level[15:0] - unused[11:0] - wrapped - stopped - triggered - recording), read only
+                                                             -- 0x90  oldest trace entry, read pops it
+    signal next_register    : std_logic_vector(19 downto 0); -- 0x94  (continue - rw - stop - enable - unused - slaveaddress[6:0] - datain[7:0]), next transaction, enable reads 1 until it started
+                                                             -- 0xE0 - 0xFC  mirror of the polled registers, first in bits 7:0, read only
+
+    -- timing reset values, scl at I2C_FREQ_HZ and the standard mode minimum setup/hold times
+    -- (tSU;STA 4.7 us, tHD;STA 4.0 us, tSU;STO 4.0 us, tBUF 4.7 us)
+    constant C_CLK_PER_US   : integer := SYS_CLK_FREQ_HZ / 1_000_000;
+    constant C_SCL_HALF     : integer := SYS_CLK_FREQ_HZ / (I2C_FREQ_HZ * 2);
+    constant C_TSU_STA      : integer := (C_CLK_PER_US * 47) / 10;
+    constant C_THD_STA      : integer := C_CLK_PER_US * 4;
+    constant C_TSU_STO      : integer := C_CLK_PER_US * 4;
+    constant C_TBUF         : integer := (C_CLK_PER_US * 47) / 10;
+    constant C_STRETCH_MAX  : integer := SYS_CLK_FREQ_HZ / 40;  -- 25 ms, the SMBus clock low timeout
+
+    -- internal control signals 
+    signal enable_internal, stop_internal, readwrite_internal, continue_internal, restart_internal : std_logic;
+    signal recover_internal                              : std_logic;
+
+    -- internal write signals
+    signal slave_address_internal     : std_logic_vector(6 downto 0);
+    signal datain_internal            : std_logic_vector(7 downto 0);
+
+    -- internal read signals 
+    signal dataout_internal           : std_logic_vector(7 downto 0);
+
+    -- internal status/interrupt signals
+    signal done_prev, ackerror_prev, ready_prev          : std_logic;
+    signal done_pending, ackerror_pending, ready_pending : std_logic;
+    signal timeout_prev, timeout_pending                 : std_logic;
+    signal seq_done_pending                              : std_logic;
+    signal status_clear                                  : std_logic;
+    signal irq_enable_internal                           : std_logic_vector(8 downto 0);
+
+    -- internal fifo signals
+    -- in fifo mode the master takes its bytes from the tx fifo and continues on its own
+    -- while the tx fifo holds data, a byte written with bit 8 set ends the transaction
+    -- with a stop. received bytes are pushed into the rx fifo, a read started in fifo
+    -- mode acks rx_length - 1 bytes and nacks the last one (0 reads a single byte).
+    signal fifo_enable_internal       : std_logic;
+    signal tx_flush, rx_flush         : std_logic;
+    signal tx_threshold, rx_threshold : std_logic_vector(7 downto 0);
+
+    signal tx_wr_en, tx_rd_en         : std_logic;
+    signal tx_wr_num                  : integer range 1 to 4;
+    signal tx_wr_data                 : std_logic_vector(35 downto 0);
+    signal tx_rd_data                 : std_logic_vector(35 downto 0);
+    signal tx_level                   : integer range 0 to FIFO_DEPTH;
+    signal tx_empty, tx_full          : std_logic;
+    signal tx_thr_flag                : std_logic;
+
+    signal rx_wr_en, rx_rd_en         : std_logic;
+    signal rx_rd_num                  : integer range 1 to 4;
+    signal rx_wr_data                 : std_logic_vector(31 downto 0);
+    signal rx_rd_data                 : std_logic_vector(31 downto 0);
+    signal rx_level                   : integer range 0 to FIFO_DEPTH;
+    signal rx_empty, rx_full          : std_logic;
+    signal rx_thr_flag                : std_logic;
+
+    signal fifo_continue, fifo_stop   : std_logic;
+
+    -- holding register, register mode: the master takes the byte after the current one from it
+    -- without stopping scl (same handshake as the tx fifo). hold_empty is set when the master
+    -- took the byte and cleared by loading the next one, bit 8 ends the transaction with a stop.
+    -- the first byte after a start still comes from the write register.
+    signal hold_data                  : std_logic_vector(8 downto 0);
+    signal hold_full, hold_select     : std_logic;
+    signal hold_wr_en, hold_taken     : std_logic;
+    signal hold_continue, hold_stop   : std_logic;
+    signal hold_empty_pending         : std_logic;
+
+    -- packed data ports, fifo mode: one access moves up to four bytes, byte 0 in bits 7:0 goes first.
+    -- a tx write that does not fit into the tx fifo is dropped as a whole, the stop bit marks
+    -- the last byte of the next packed write only. an rx read pops min(4, rx_level) bytes,
+    -- the unused bytes read as 0 and the count is kept in pack_control for software.
+    signal tx_packed_wr, rx_packed_rd : std_logic;
+    signal pack_tx_count              : integer range 1 to 4;
+    signal pack_stop                  : std_logic;
+    signal rx_pack_num                : integer range 0 to 4;
+    signal pack_rx_count              : integer range 0 to 4;
+    signal rx_packed_register         : std_logic_vector(31 downto 0);
+
+    signal seq_start_internal         : std_logic;
+
+    -- next transaction: address, first byte and control bits of the cpu transaction after the
+    -- running one. it goes to the master like a write of the write and control registers when
+    -- the running transaction ends without a nack or timeout, the master takes the enable during
+    -- the stop and starts tBUF after it. an error drops it, one loaded while no cpu transaction
+    -- runs goes at once. a write without enable empties the slot. enable reads 1 until the master
+    -- started the transaction, DONE is the one of the last transaction once it reads 0.
+    signal next_word                  : std_logic_vector(19 downto 0);
+    signal next_full, next_start      : std_logic;
+    signal next_waiting               : std_logic;  -- given to the master, not started yet
+    signal next_wr_en                 : std_logic;
+    signal cpu_transfer               : std_logic;  -- between the enable of a cpu transaction and its done
+
+    -- auto poller, its transactions stay out of the status flags, the fifos and the holding register:
+    -- the cpu view of the master status is frozen while the poller owns the master
+    signal master_status, held_status : std_logic_vector(3 downto 0);  -- timeout - ready - done - ack_error
+    signal cpu_ack_error, cpu_timeout : std_logic;
+    signal cpu_done, cpu_ready        : std_logic;
+    signal cpu_data_taken             : std_logic;
+    signal cpu_data_valid             : std_logic;
+    signal poll_length_internal       : integer range 1 to 32;
+    signal nack_prev                  : std_logic;
+
+    signal rx_length                  : std_logic_vector(7 downto 0);
+    signal rx_remaining               : unsigned(7 downto 0);
+    signal rx_active                  : std_logic;
+    signal fifo_read_continue         : std_logic;
+    signal fifo_read_stop             : std_logic;
+
+    -- performance counters, free running and wrapping, reads return the copy taken by the last snapshot
+    constant C_PERF_TX      : integer := 0;  -- 0x34  bytes sent (address and data)
+    constant C_PERF_RX      : integer := 1;  -- 0x38  bytes received
+    constant C_PERF_TRANS   : integer := 2;  -- 0x3C  transactions (starts)
+    constant C_PERF_NACK    : integer := 3;  -- 0x40  nacks from the slave
+    constant C_PERF_BUSY    : integer := 4;  -- 0x44  clock cycles busy
+    constant C_PERF_STALL   : integer := 5;  -- 0x48  clock cycles scl held low waiting for the cpu or the rx fifo
+    constant C_PERF_STRETCH : integer := 6;  -- 0x4C  clock cycles scl held low by a slave
+    constant C_PERF_CYCLES  : integer := 7;  -- 0x50  clock cycles since the last clear
+
+    type perf_array is array (0 to 7) of unsigned(31 downto 0);
+    signal perf_count, perf_snap      : perf_array;
+    signal perf_snapshot, perf_clear  : std_logic;
+    signal busy_prev                  : std_logic;
+
+    -- internal timing signals
+    signal scl_low_internal, scl_high_internal : std_logic_vector(15 downto 0);
+    signal tsu_sta_internal, thd_sta_internal  : std_logic_vector(15 downto 0);
+    signal tsu_sto_internal, tbuf_internal     : std_logic_vector(15 downto 0);
+
+    -- read path, read_wait is the wait state of a registered read
+    signal read_data                  : std_logic_vector(31 downto 0);
+    signal read_wait                  : std_logic;
+
+    component i2c_fifo is
+        generic (
+            DATA_WIDTH : integer := 8;
+            DEPTH      : integer := 16;
+            LANES      : integer := 1);
+        port
+        (
+            clk     : in  std_logic;
+            reset   : in  std_logic;
+            flush   : in  std_logic;
+            wr_en   : in  std_logic;
+            wr_num  : in  integer range 1 to LANES;
+            wr_data : in  std_logic_vector(LANES*DATA_WIDTH-1 downto 0);
+            rd_en   : in  std_logic;
+            rd_num  : in  integer range 1 to LANES;
+            rd_data : out std_logic_vector(LANES*DATA_WIDTH-1 downto 0);
+            level   : out integer range 0 to DEPTH;
+            empty   : out std_logic;
+            full    : out std_logic
+        );
+    end component;
+
+
+begin 
+
+    -- enable    
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                enable_internal <= '0';
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000000") then
+                enable_internal <= sbi_wdata(0);
+            elsif (next_start = '1') then
+                enable_internal <= '1';
+            else
+                enable_internal <= '0';
+            end if;
+        end if;
+    end process;
+    control_register(0) <= enable_internal;
+    enable <= control_register(0);
+
+    -- stop 
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if reset = '1' then
+                stop_internal <= '0';
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000000") then
+                stop_internal <= sbi_wdata(1);
+            elsif (next_start = '1') then
+                stop_internal <= next_word(17);
+            else 
+                stop_internal <= '0';
+            end if;
+        end if;
+    end process;
+    control_register(1) <= stop_internal;
+    stop_signal <= control_register(1) or fifo_stop or fifo_read_stop or hold_stop;
+
+    -- read/write 
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if reset = '1' then
+                readwrite_internal <= '0';
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000000") then
+                readwrite_internal <= sbi_wdata(2);
+            elsif (next_start = '1') then
+                readwrite_internal <= next_word(18);
+            end if;
+        end if;
+    end process;
+    control_register(2) <= readwrite_internal;
+    read_write <= control_register(2);
+
+    -- continue 
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                continue_internal <= '0';
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000000") then
+                continue_internal <= sbi_wdata(3);
+            elsif (next_start = '1') then
+                continue_internal <= next_word(19);
+            else 
+                continue_internal <= '0';
+            end if;
+        end if;
+    end process;
+    control_register(3) <= continue_internal;
+    continue <= control_register(3) or fifo_continue or fifo_read_continue or hold_continue;
+
+    -- repeated start 
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                restart_internal <= '0';
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000000") then
+                restart_internal <= sbi_wdata(4);
+            else 
+                restart_internal <= '0';
+            end if;
+        end if;
+    end process;
+    control_register(4) <= restart_internal;
+    restart <= control_register(4);
+
+    -- bus recovery, given with enable: scl pulses until a slave releases sda, then a stop
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                recover_internal <= '0';
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000000") then
+                recover_internal <= sbi_wdata(5);
+            else 
+                recover_internal <= '0';
+            end if;
+        end if;
+    end process;
+    control_register(5) <= recover_internal;
+    recover <= control_register(5);
+
+    --write process 
+    process(clk)
+    begin 
+        if rising_edge(clk) then
+            if (reset = '1') then
+                slave_address_internal <= (others => '0');
+                datain_internal <= (others => '0');
+
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000001") then
+                slave_address_internal <= sbi_wdata(14 downto 8);
+                datain_internal <= sbi_wdata(7 downto 0);
+
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "010111") then
+                slave_address_internal <= sbi_wdata(6 downto 0);
+
+            elsif (next_start = '1') then
+                slave_address_internal <= next_word(14 downto 8);
+                datain_internal <= next_word(7 downto 0);
+            end if ;
+        end if ;
+    end process;
+    write_register(14 downto 8) <= slave_address_internal;
+    write_register(7 downto 0)  <= datain_internal;
+
+    slave_address <= write_register(14 downto 8);
+    data_in       <= tx_rd_data(7 downto 0) when fifo_enable_internal = '1' else
+                     hold_data(7 downto 0)  when hold_select = '1' else
+                     write_register(7 downto 0);
+
+    -- status flags
+    -- ready, ack_error and done are latched on the rising edge of the master signal and
+    -- stay set until software writes a 1 to the bit or the master drops the signal again
+    status_clear <= '1' when (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000010") else '0';
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                done_prev        <= '0';
+                ackerror_prev    <= '0';
+                ready_prev       <= '0';
+                timeout_prev     <= '0';
+                done_pending     <= '0';
+                ackerror_pending <= '0';
+                ready_pending    <= '0';
+                timeout_pending  <= '0';
+                hold_empty_pending <= '0';
+                seq_done_pending <= '0';
+            else
+                done_prev     <= cpu_done;
+                ackerror_prev <= cpu_ack_error;
+                ready_prev    <= cpu_ready;
+                timeout_prev  <= cpu_timeout;
+
+                if (cpu_done = '1' and done_prev = '0') then
+                    done_pending <= '1';
+                elsif (cpu_done = '0' or (status_clear = '1' and sbi_wdata(0) = '1')) then
+                    done_pending <= '0';
+                end if;
+
+                if (cpu_ack_error = '1' and ackerror_prev = '0') then
+                    ackerror_pending <= '1';
+                elsif (cpu_ack_error = '0' or (status_clear = '1' and sbi_wdata(2) = '1')) then
+                    ackerror_pending <= '0';
+                end if;
+
+                if (cpu_ready = '1' and ready_prev = '0') then
+                    ready_pending <= '1';
+                elsif (cpu_ready = '0' or (status_clear = '1' and sbi_wdata(3) = '1')) then
+                    ready_pending <= '0';
+                end if;
+
+                if (cpu_timeout = '1' and timeout_prev = '0') then
+                    timeout_pending <= '1';
+                elsif (cpu_timeout = '0' or (status_clear = '1' and sbi_wdata(6) = '1')) then
+                    timeout_pending <= '0';
+                end if;
+
+                if (hold_taken = '1') then
+                    hold_empty_pending <= '1';
+                elsif (hold_wr_en = '1' or (status_clear = '1' and sbi_wdata(7) = '1')) then
+                    hold_empty_pending <= '0';
+                end if;
+
+                if (seq_finished = '1') then
+                    seq_done_pending <= '1';
+                elsif (seq_start_internal = '1' or (status_clear = '1' and sbi_wdata(8) = '1')) then
+                    seq_done_pending <= '0';
+                end if;
+            end if;
+        end if;
+    end process;
+
+    -- status register 
+    process(seq_done_pending, hold_empty_pending, timeout_pending, rx_thr_flag, tx_thr_flag, ready_pending, ackerror_pending, busy, done_pending)
+    begin 
+        status_register(8) <= seq_done_pending;
+        status_register(7) <= hold_empty_pending;
+        status_register(6) <= timeout_pending;
+        status_register(5) <= rx_thr_flag;
+        status_register(4) <= tx_thr_flag;
+        status_register(3) <= ready_pending;
+        status_register(2) <= ackerror_pending;
+        status_register(1) <= busy;
+        status_register(0) <= done_pending;
+    end process;
+
+    -- interrupt enable register (busy is a level, it has no interrupt)
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                irq_enable_internal <= (others => '0');
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000100") then
+                irq_enable_internal <= sbi_wdata(8 downto 2) & '0' & sbi_wdata(0);
+            end if;
+        end if;
+    end process;
+    irq_register <= irq_enable_internal;
+
+    -- interrupt line 
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                irq <= '0';
+            elsif ((status_register and irq_register) /= "000000000") then
+                irq <= '1';
+            else
+                irq <= '0';
+            end if;
+        end if;
+    end process;
+
+    -- reading register 
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset='1') then
+                dataout_internal <= (others=>'0');
+
+            elsif (cpu_data_valid = '1' or cpu_done = '1') then
+                dataout_internal <= data_out;
+            end if;
+        end if;
+    end process;
+    read_register <= dataout_internal;
+
+    -- fifo control register 
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                fifo_enable_internal <= '0';
+                tx_flush <= '0';
+                rx_flush <= '0';
+                tx_threshold <= (others => '0');
+                rx_threshold <= (others => '0');
+                rx_length <= (others => '0');
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "001000") then
+                fifo_enable_internal <= sbi_wdata(0);
+                tx_flush <= sbi_wdata(1);
+                rx_flush <= sbi_wdata(2);
+                tx_threshold <= sbi_wdata(15 downto 8);
+                rx_threshold <= sbi_wdata(23 downto 16);
+                rx_length <= sbi_wdata(31 downto 24);
+            else
+                tx_flush <= '0';
+                rx_flush <= '0';
+            end if;
+        end if;
+    end process;
+    fifo_control <= rx_length & rx_threshold & tx_threshold & "0000000" & fifo_enable_internal; -- flush bits read as 0
+
+    -- packed port control, the tx count stays until it is written again
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                pack_tx_count <= 4;
+                pack_stop <= '0';
+                pack_rx_count <= 0;
+            else
+                if (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "011001") then
+                    if (sbi_wdata(2 downto 0) = "001" or sbi_wdata(2 downto 0) = "010" or sbi_wdata(2 downto 0) = "011") then
+                        pack_tx_count <= to_integer(unsigned(sbi_wdata(2 downto 0)));
+                    else
+                        pack_tx_count <= 4;
+                    end if;
+                    pack_stop <= sbi_wdata(3);
+                elsif (tx_packed_wr = '1') then
+                    pack_stop <= '0';
+                end if;
+
+                if (rx_packed_rd = '1') then
+                    pack_rx_count <= rx_pack_num;
+                end if;
+            end if;
+        end if;
+    end process;
+    pack_control <= std_logic_vector(to_unsigned(pack_rx_count, 3)) & "00000" & pack_stop
+                    & std_logic_vector(to_unsigned(pack_tx_count, 3));
+
+    -- tx fifo, bit 8 marks the last byte of a transaction
+    tx_packed_wr <= '1' when (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "011000") else '0';
+    tx_wr_en  <= '1' when (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000101") else tx_packed_wr;
+    tx_wr_num <= pack_tx_count when tx_packed_wr = '1' else 1;
+    tx_rd_en  <= cpu_data_taken and fifo_enable_internal;
+
+    process(tx_packed_wr, sbi_wdata, pack_tx_count, pack_stop)
+    begin
+        if (tx_packed_wr = '1') then
+            for i in 0 to 3 loop
+                if (i = pack_tx_count - 1) then
+                    tx_wr_data(9*i+8) <= pack_stop;
+                else
+                    tx_wr_data(9*i+8) <= '0';
+                end if;
+                tx_wr_data(9*i+7 downto 9*i) <= sbi_wdata(8*i+7 downto 8*i);
+            end loop;
+        else
+            tx_wr_data <= (35 downto 9 => '0') & sbi_wdata(8 downto 0);
+        end if;
+    end process;
+
+    tx_fifo_inst : i2c_fifo
+        generic map 
+        (
+            DATA_WIDTH => 9,
+            DEPTH      => FIFO_DEPTH,
+            LANES      => 4
+        )
+        port map 
+        (
+            clk     => clk,
+            reset   => reset,
+            flush   => tx_flush,
+            wr_en   => tx_wr_en,
+            wr_num  => tx_wr_num,
+            wr_data => tx_wr_data,
+            rd_en   => tx_rd_en,
+            rd_num  => 1,
+            rd_data => tx_rd_data,
+            level   => tx_level,
+            empty   => tx_empty,
+            full    => tx_full
+        );
+
+    -- rx fifo 
+    rx_wr_en     <= cpu_data_valid and fifo_enable_internal;
+    rx_wr_data   <= x"000000" & data_out;
+    rx_packed_rd <= '1' when (sbi_cs = '1' and sbi_re = '1' and read_wait = '0' and sbi_addr = "011010") else '0';
+    rx_rd_en     <= '1' when (sbi_cs = '1' and sbi_re = '1' and read_wait = '0' and sbi_addr = "000110") else rx_packed_rd;
+    rx_pack_num  <= 4 when rx_level >= 4 else rx_level;
+    rx_rd_num    <= 1 when (rx_packed_rd = '0' or rx_pack_num = 0) else rx_pack_num;
+
+    rx_fifo_inst : i2c_fifo
+        generic map 
+        (
+            DATA_WIDTH => 8,
+            DEPTH      => FIFO_DEPTH,
+            LANES      => 4
+        )
+        port map 
+        (
+            clk     => clk,
+            reset   => reset,
+            flush   => rx_flush,
+            wr_en   => rx_wr_en,
+            wr_num  => 1,
+            wr_data => rx_wr_data,
+            rd_en   => rx_rd_en,
+            rd_num  => rx_rd_num,
+            rd_data => rx_rd_data,
+            level   => rx_level,
+            empty   => rx_empty,
+            full    => rx_full
+        );
+    rx_data_register <= rx_rd_data(7 downto 0) when rx_empty = '0' else (others => '0');
+
+    process(rx_rd_data, rx_pack_num)
+    begin
+        for i in 0 to 3 loop
+            if (i < rx_pack_num) then
+                rx_packed_register(8*i+7 downto 8*i) <= rx_rd_data(8*i+7 downto 8*i);
+            else
+                rx_packed_register(8*i+7 downto 8*i) <= (others => '0');
+            end if;
+        end loop;
+    end process;
+
+    -- fifo handshake towards the master
+    fifo_continue <= fifo_enable_internal and not tx_empty and not readwrite_internal;
+
+    -- fifo read: rx_remaining counts the bytes still to come, it is loaded when a read is
+    -- started (enable or restart with rw) and the transaction ends on the nack of the last byte
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                rx_active <= '0';
+                rx_remaining <= (others => '0');
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "000000" and sbi_wdata(2) = '1'
+                   and (sbi_wdata(0) = '1' or sbi_wdata(4) = '1') and fifo_enable_internal = '1') then
+                rx_active <= '1';
+                rx_remaining <= unsigned(rx_length);
+            elsif (next_start = '1' and next_word(18) = '1' and fifo_enable_internal = '1') then
+                rx_active <= '1';
+                rx_remaining <= unsigned(rx_length);
+            elsif (cpu_done = '1' and done_prev = '0') then
+                rx_active <= '0';
+            elsif (cpu_data_valid = '1' and rx_remaining /= 0) then
+                rx_remaining <= rx_remaining - 1;
+            end if;
+        end if;
+    end process;
+
+    -- ack while more bytes are wanted and the rx fifo has room for the next one, otherwise scl is held low
+    fifo_read_continue <= '1' when (rx_active = '1' and readwrite_internal = '1' and rx_remaining > 1
+                                    and rx_level < FIFO_DEPTH - 1) else '0';
+    fifo_read_stop     <= '1' when (rx_active = '1' and readwrite_internal = '1' and rx_remaining <= 1) else '0';
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                fifo_stop <= '0';
+            elsif (tx_rd_en = '1' and tx_empty = '0' and tx_rd_data(8) = '1') then
+                fifo_stop <= '1';
+            else
+                fifo_stop <= '0';
+            end if;
+        end if;
+    end process;
+
+    -- holding register, emptied when the transaction ends
+    hold_wr_en    <= '1' when (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "010110") else '0';
+    hold_select   <= hold_full and busy and not fifo_enable_internal;
+    hold_taken    <= cpu_data_taken and hold_select;
+    hold_continue <= hold_select and not readwrite_internal;
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                hold_data <= (others => '0');
+                hold_full <= '0';
+                hold_stop <= '0';
+            else
+                if (hold_taken = '1') then
+                    hold_stop <= hold_data(8);
+                else
+                    hold_stop <= '0';
+                end if;
+
+                if (hold_wr_en = '1') then
+                    hold_data <= sbi_wdata(8 downto 0);
+                    hold_full <= '1';
+                elsif (hold_taken = '1' or (cpu_done = '1' and done_prev = '0')) then
+                    hold_full <= '0';
+                end if;
+            end if;
+        end if;
+    end process;
+
+    -- fifo status, tx_thr: at most tx_threshold bytes left to send, rx_thr: more than rx_threshold bytes received
+    tx_thr_flag <= '1' when (fifo_enable_internal = '1' and tx_level <= to_integer(unsigned(tx_threshold))) else '0';
+    rx_thr_flag <= '1' when (fifo_enable_internal = '1' and rx_level >  to_integer(unsigned(rx_threshold))) else '0';
+
+    fifo_status(21)          <= rx_thr_flag;
+    fifo_status(20)          <= tx_thr_flag;
+    fifo_status(19)          <= rx_full;
+    fifo_status(18)          <= rx_empty;
+    fifo_status(17)          <= tx_full;
+    fifo_status(16)          <= tx_empty;
+    fifo_status(15 downto 8) <= std_logic_vector(to_unsigned(rx_level, 8));
+    fifo_status(7 downto 0)  <= std_logic_vector(to_unsigned(tx_level, 8));
+
+    -- command sequencer, the doorbell is ignored while a list runs. the sequencer drives
+    -- the master while it runs, fifo mode and the holding register must not be in use.
+    seq_start_internal <= '1' when (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "011011" and sbi_wdata(0) = '1'
+                                    and seq_running = '0') else '0';
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                seq_head_reg <= (others => '0');
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "011100") then
+                seq_head_reg <= sbi_wdata(31 downto 2) & "00";
+            end if;
+        end if;
+    end process;
+    seq_control <= seq_error & seq_running;
+    seq_start   <= seq_start_internal;
+    seq_head    <= seq_head_reg;
+
+    -- next transaction, a done of the sequencer or the poller does not start it,
+    -- one staged while the poller has the bus waits for the end of the poll
+    next_wr_en <= '1' when (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "100101") else '0';
+    next_start <= '1' when (next_full = '1' and next_wr_en = '0' and seq_running = '0' and poll_running = '0'
+                            and ((cpu_done = '1' and done_prev = '0' and cpu_ack_error = '0' and cpu_timeout = '0')
+                                 or cpu_transfer = '0')) else '0';
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                next_word <= (others => '0');
+                next_full <= '0';
+                next_waiting <= '0';
+                cpu_transfer <= '0';
+            else
+                if (enable_internal = '1' or next_start = '1') then
+                    cpu_transfer <= '1';
+                elsif (cpu_done = '1' and done_prev = '0') then
+                    cpu_transfer <= '0';
+                end if;
+
+                if (next_wr_en = '1') then
+                    next_word <= sbi_wdata(19 downto 17) & "00" & sbi_wdata(14 downto 0);
+                    next_full <= sbi_wdata(16);
+                elsif (next_start = '1' or (cpu_done = '1' and done_prev = '0' and seq_running = '0')) then
+                    next_full <= '0';
+                end if;
+
+                if (next_start = '1') then
+                    next_waiting <= '1';
+                elsif (busy = '1' and busy_prev = '0' and poll_running = '0') then
+                    next_waiting <= '0';
+                end if;
+            end if;
+        end if;
+    end process;
+    next_register <= next_word(19 downto 17) & (next_full or next_waiting) & next_word(15 downto 0);
+
+    -- auto poller
+    master_status <= timeout & ready & done & ack_error;
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                held_status <= (others => '0');
+            elsif (poll_owner = '0') then
+                held_status <= master_status;
+            end if;
+        end if;
+    end process;
+
+    cpu_ack_error  <= held_status(0) when poll_owner = '1' else ack_error;
+    cpu_done       <= held_status(1) when poll_owner = '1' else done;
+    cpu_ready      <= held_status(2) when poll_owner = '1' else ready;
+    cpu_timeout    <= held_status(3) when poll_owner = '1' else timeout;
+    cpu_data_taken <= data_taken and not poll_running;
+    cpu_data_valid <= data_valid and not poll_running;
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                poll_control <= (others => '0');
+                poll_range   <= x"2000";
+                poll_length_internal <= 32;
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "011110") then
+                poll_control <= sbi_wdata(31 downto 16) & '0' & sbi_wdata(14 downto 8) & "0000000" & sbi_wdata(0);
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "011111") then
+                if (unsigned(sbi_wdata(15 downto 8)) >= 1 and unsigned(sbi_wdata(15 downto 8)) <= 32) then
+                    poll_range <= sbi_wdata(15 downto 0);
+                    poll_length_internal <= to_integer(unsigned(sbi_wdata(15 downto 8)));
+                else
+                    poll_range <= x"20" & sbi_wdata(7 downto 0);
+                    poll_length_internal <= 32;
+                end if;
+            end if;
+        end if;
+    end process;
+    poll_enable <= poll_control(0);
+    poll_period <= poll_control(31 downto 16);
+    poll_slave  <= poll_control(14 downto 8);
+    poll_first  <= poll_range(7 downto 0);
+    poll_length <= poll_length_internal;
+    poll_word   <= sbi_addr(2 downto 0);
+    poll_status <= poll_failed & (30 downto 16 => '0') & poll_age;
+
+    -- bus trace, clear is a strobe and reads as 0
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                trace_control <= (others => '0');
+            elsif (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "100010") then
+                trace_control <= sbi_wdata(27 downto 16) & '0' & sbi_wdata(14 downto 8) & "00" & sbi_wdata(5 downto 4)
+                                 & '0' & sbi_wdata(2 downto 0);
+            else
+                trace_control(1) <= '0';
+            end if;
+        end if;
+    end process;
+    trace_enable   <= trace_control(0);
+    trace_clear    <= trace_control(1);
+    trace_states   <= trace_control(2);
+    trace_trigger  <= trace_control(5 downto 4);
+    trace_address  <= trace_control(14 downto 8);
+    trace_post     <= trace_control(23 downto 16);
+    trace_prescale <= trace_control(27 downto 24);
+    trace_pop      <= '1' when (sbi_cs = '1' and sbi_re = '1' and read_wait = '0' and sbi_addr = "100100") else '0';
+    trace_status   <= trace_level & (15 downto 4 => '0') & trace_flags;
+
+    -- timing registers, the master uses the values from the next start/stop on 
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                scl_low_internal  <= std_logic_vector(to_unsigned(C_SCL_HALF, 16));
+                scl_high_internal <= std_logic_vector(to_unsigned(C_SCL_HALF, 16));
+                tsu_sta_internal  <= std_logic_vector(to_unsigned(C_TSU_STA, 16));
+                thd_sta_internal  <= std_logic_vector(to_unsigned(C_THD_STA, 16));
+                tsu_sto_internal  <= std_logic_vector(to_unsigned(C_TSU_STO, 16));
+                tbuf_internal     <= std_logic_vector(to_unsigned(C_TBUF, 16));
+                stretch_timeout   <= std_logic_vector(to_unsigned(C_STRETCH_MAX, 32));
+            elsif (sbi_cs = '1' and sbi_we = '1') then
+                if (sbi_addr = "001001") then
+                    scl_low_internal  <= sbi_wdata(15 downto 0);
+                    scl_high_internal <= sbi_wdata(31 downto 16);
+                elsif (sbi_addr = "001010") then
+                    tsu_sta_internal  <= sbi_wdata(15 downto 0);
+                    thd_sta_internal  <= sbi_wdata(31 downto 16);
+                elsif (sbi_addr = "001011") then
+                    tsu_sto_internal  <= sbi_wdata(15 downto 0);
+                    tbuf_internal     <= sbi_wdata(31 downto 16);
+                elsif (sbi_addr = "010101") then
+                    stretch_timeout   <= sbi_wdata;
+                end if;
+            end if;
+        end if;
+    end process;
+    scl_timing   <= scl_high_internal & scl_low_internal;
+    start_timing <= thd_sta_internal & tsu_sta_internal;
+    stop_timing  <= tbuf_internal & tsu_sto_internal;
+
+    scl_low_cycles  <= scl_low_internal;
+    scl_high_cycles <= scl_high_internal;
+    tsu_sta_cycles  <= tsu_sta_internal;
+    thd_sta_cycles  <= thd_sta_internal;
+    tsu_sto_cycles  <= tsu_sto_internal;
+    tbuf_cycles     <= tbuf_internal;
+    stretch_timeout_cycles <= stretch_timeout;
+
+    -- performance counters, a snapshot written together with clear returns the counts up to the clear
+    perf_snapshot <= '1' when (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "001100" and sbi_wdata(0) = '1') else '0';
+    perf_clear    <= '1' when (sbi_cs = '1' and sbi_we = '1' and sbi_addr = "001100" and sbi_wdata(1) = '1') else '0';
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                busy_prev  <= '0';
+                nack_prev  <= '0';
+                perf_count <= (others => (others => '0'));
+                perf_snap  <= (others => (others => '0'));
+            else
+                busy_prev <= busy;
+                nack_prev <= ack_error;
+
+                if (perf_snapshot = '1') then
+                    perf_snap <= perf_count;
+                end if;
+
+                if (perf_clear = '1') then
+                    perf_count <= (others => (others => '0'));
+                else
+                    if (tx_byte = '1') then
+                        perf_count(C_PERF_TX) <= perf_count(C_PERF_TX) + 1;
+                    end if;
+                    if (data_valid = '1') then
+                        perf_count(C_PERF_RX) <= perf_count(C_PERF_RX) + 1;
+                    end if;
+                    if (busy = '1' and busy_prev = '0') then
+                        perf_count(C_PERF_TRANS) <= perf_count(C_PERF_TRANS) + 1;
+                    end if;
+                    if (ack_error = '1' and nack_prev = '0') then
+                        perf_count(C_PERF_NACK) <= perf_count(C_PERF_NACK) + 1;
+                    end if;
+                    if (busy = '1') then
+                        perf_count(C_PERF_BUSY) <= perf_count(C_PERF_BUSY) + 1;
+                    end if;
+                    if (cpu_stall = '1') then
+                        perf_count(C_PERF_STALL) <= perf_count(C_PERF_STALL) + 1;
+                    end if;
+                    if (scl_stretch = '1') then
+                        perf_count(C_PERF_STRETCH) <= perf_count(C_PERF_STRETCH) + 1;
+                    end if;
+                    perf_count(C_PERF_CYCLES) <= perf_count(C_PERF_CYCLES) + 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    
+    -- read path: the mux goes straight to sbi_rdata, or with REGISTERED_READ through a register
+    -- and one wait state. Reads that pop a fifo or the trace do it in the first cycle of the
+    -- access, the cycle the register takes the data in.
+    read_reg_gen : if REGISTERED_READ generate
+        process(clk)
+        begin
+            if rising_edge(clk) then
+                if (reset = '1') then
+                    read_wait <= '0';
+                    sbi_rdata <= (others => '0');
+                else
+                    read_wait <= sbi_cs and sbi_re and not read_wait;
+                    sbi_rdata <= read_data;
+                end if;
+            end if;
+        end process;
+        sbi_ready <= not (sbi_cs and sbi_re and not read_wait);
+    end generate;
+
+    read_comb_gen : if not REGISTERED_READ generate
+        read_wait <= '0';
+        sbi_rdata <= read_data;
+        sbi_ready <= '1';
+    end generate;
+
+    -- reading process
+    process(sbi_cs, sbi_re, sbi_addr, control_register, write_register, status_register, read_register, irq_register,
+            rx_data_register, fifo_status, fifo_control, scl_timing, start_timing, stop_timing, perf_snap, stretch_timeout,
+            slave_address_internal, pack_control, rx_packed_register, seq_control, seq_head_reg, seq_current,
+            poll_control, poll_range, poll_count, poll_status, poll_mirror, trace_control, trace_status, trace_data,
+            next_register)
+    begin
+        if (sbi_cs = '1' and sbi_re = '1' and sbi_addr(5 downto 3) = "111") then
+            read_data <= poll_mirror;
+
+        elsif (sbi_cs = '1' and sbi_re = '1') then
+            case sbi_addr is
+                when "000000" =>
+                    read_data <= (31 downto 6 => '0') & control_register;
+            
+                when "000001" =>
+                    read_data <= (31 downto 15 => '0') & write_register;
+            
+                when "000010" =>
+                    read_data <= (31 downto 9 => '0') & status_register;
+            
+                when "000011" =>
+                    read_data <= (31 downto 8 => '0') & read_register;
+
+                when "000100" =>
+                    read_data <= (31 downto 9 => '0') & irq_register;
+
+                when "000110" =>
+                    read_data <= (31 downto 8 => '0') & rx_data_register;
+
+                when "000111" =>
+                    read_data <= (31 downto 22 => '0') & fifo_status;
+
+                when "001000" =>
+                    read_data <= fifo_control;
+
+                when "001001" =>
+                    read_data <= scl_timing;
+
+                when "001010" =>
+                    read_data <= start_timing;
+
+                when "001011" =>
+                    read_data <= stop_timing;
+
+                when "001101" =>
+                    read_data <= std_logic_vector(perf_snap(C_PERF_TX));
+
+                when "001110" =>
+                    read_data <= std_logic_vector(perf_snap(C_PERF_RX));
+
+                when "001111" =>
+                    read_data <= std_logic_vector(perf_snap(C_PERF_TRANS));
+
+                when "010000" =>
+                    read_data <= std_logic_vector(perf_snap(C_PERF_NACK));
+
+                when "010001" =>
+                    read_data <= std_logic_vector(perf_snap(C_PERF_BUSY));
+
+                when "010010" =>
+                    read_data <= std_logic_vector(perf_snap(C_PERF_STALL));
+
+                when "010011" =>
+                    read_data <= std_logic_vector(perf_snap(C_PERF_STRETCH));
+
+                when "010100" =>
+                    read_data <= std_logic_vector(perf_snap(C_PERF_CYCLES));
+
+                when "010101" =>
+                    read_data <= stretch_timeout;
+
+                when "010111" =>
+                    read_data <= (31 downto 7 => '0') & slave_address_internal;
+
+                when "011001" =>
+                    read_data <= (31 downto 11 => '0') & pack_control;
+
+                when "011010" =>
+                    read_data <= rx_packed_register;
+
+                when "011011" =>
+                    read_data <= (31 downto 2 => '0') & seq_control;
+
+                when "011100" =>
+                    read_data <= seq_head_reg;
+
+                when "011101" =>
+                    read_data <= seq_current;
+
+                when "011110" =>
+                    read_data <= poll_control;
+
+                when "011111" =>
+                    read_data <= x"0000" & poll_range;
+
+                when "100000" =>
+                    read_data <= poll_count;
+
+                when "100001" =>
+                    read_data <= poll_status;
+
+                when "100010" =>
+                    read_data <= x"0" & trace_control(27 downto 2) & '0' & trace_control(0);
+
+                when "100011" =>
+                    read_data <= trace_status;
+
+                when "100100" =>
+                    read_data <= trace_data;
+
+                when "100101" =>
+                    read_data <= (31 downto 20 => '0') & next_register;
+            
+                when others =>
+                    read_data <= (others => '0');
+            end case;
+        else
+            read_data <= (others => '0');
+
+        end if;
+    end process;
 end architecture;
\ No newline at end of file
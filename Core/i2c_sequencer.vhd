@@ -0,0 +1,377 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Command sequencer: runs a linked list of transfer descriptors from memory on the
+-- i2c master without the cpu. Descriptors are four words at a word aligned address:
+--
+--   +0x0  next      byte address of the next descriptor, 0 ends the list
+--   +0x4  control   [31:16] length in bytes (0 is taken as 1), [9] stop, [8] read, [6:0] slave address
+--   +0x8  buffer    word aligned byte address of the data, the first byte in bits 7:0
+--   +0xC  status    written back: [31] done, [17] timeout, [16] ack error, [15:0] bytes transferred
+--
+-- A descriptor without stop is followed by the next one with a repeated start, the
+-- last descriptor of the list always ends with a stop. The list stops at the first
+-- descriptor that ends on a nack or a stretch timeout.
+
+entity i2c_sequencer is
+    port
+    (
+        clk           : in  std_logic;
+        reset         : in  std_logic;
+
+        -- registerbank
+        start         : in  std_logic;                      -- doorbell, ignored while running
+        head          : in  std_logic_vector(31 downto 0);  -- address of the first descriptor
+        running       : out std_logic;
+        error         : out std_logic;                      -- the last list stopped on a nack or timeout
+        current       : out std_logic_vector(31 downto 0);  -- descriptor being executed, or the failed one
+        finished      : out std_logic;                      -- one clock at the end of a list
+
+        -- master control, used while running
+        slave_address : out std_logic_vector(6 downto 0);
+        data_in       : out std_logic_vector(7 downto 0);
+        enable        : out std_logic;
+        read_write    : out std_logic;
+        stop_signal   : out std_logic;
+        continue      : out std_logic;
+        restart       : out std_logic;
+
+        -- master status
+        data_out      : in  std_logic_vector(7 downto 0);
+        ack_error     : in  std_logic;
+        timeout       : in  std_logic;
+        done          : in  std_logic;
+        ready         : in  std_logic;
+        data_taken    : in  std_logic;
+        data_valid    : in  std_logic;
+
+        -- avalon-mm master, one word per transfer
+        avm_address     : out std_logic_vector(31 downto 0);
+        avm_read        : out std_logic;
+        avm_write       : out std_logic;
+        avm_writedata   : out std_logic_vector(31 downto 0);
+        avm_byteenable  : out std_logic_vector(3 downto 0);
+        avm_readdata    : in  std_logic_vector(31 downto 0);
+        avm_waitrequest : in  std_logic
+    );
+end entity;
+
+architecture rtl of i2c_sequencer is
+
+    type state_type is (
+        idle_state,
+        desc_next_state,     -- descriptor fetch, one state per word
+        desc_control_state,
+        desc_buffer_state,
+        data_fetch_state,    -- first data word of a write
+        issue_state,         -- start or repeated start
+        write_state,
+        write_fetch_state,   -- next data word while the master sends the byte before
+        write_end_state,     -- last byte taken, waiting for its ack (repeated start follows)
+        read_state,
+        read_store_state,
+        wait_done_state,     -- stop given, waiting for the end of the transaction
+        status_state);
+
+    signal state            : state_type;
+
+    -- descriptor
+    signal desc_addr        : unsigned(31 downto 0);
+    signal desc_next        : unsigned(31 downto 0);
+    signal desc_slave       : std_logic_vector(6 downto 0);
+    signal desc_read        : std_logic;
+    signal desc_stop        : std_logic;
+    signal desc_len         : unsigned(15 downto 0);
+    signal buf_addr         : unsigned(31 downto 0);
+    signal new_start        : std_logic;   -- the descriptor begins with a start, not a repeated start
+
+    signal count            : unsigned(15 downto 0);   -- bytes taken by the master or received
+    signal remaining        : unsigned(15 downto 0);
+
+    -- write data, data_in shows byte count(1:0) of the word while next_valid is set
+    signal tx_word          : std_logic_vector(31 downto 0);
+    signal next_valid       : std_logic;
+    signal tx_active        : std_logic;
+
+    -- read data, collected up to a word before it is stored
+    signal rx_word          : std_logic_vector(31 downto 0);
+    signal rx_be            : std_logic_vector(3 downto 0);
+
+    -- end of the transaction seen on done
+    signal done_prev        : std_logic;
+    signal master_end       : std_logic;
+    signal master_nack      : std_logic;
+    signal master_timeout   : std_logic;
+
+    signal running_internal : std_logic;
+    signal error_internal   : std_logic;
+    signal continue_pulse   : std_logic;
+
+begin
+
+    process(clk)
+        variable lane : integer range 0 to 3;
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                state            <= idle_state;
+                running_internal <= '0';
+                error_internal   <= '0';
+                finished         <= '0';
+                desc_addr        <= (others => '0');
+                desc_next        <= (others => '0');
+                desc_slave       <= (others => '0');
+                desc_read        <= '0';
+                desc_stop        <= '0';
+                desc_len         <= (others => '0');
+                buf_addr         <= (others => '0');
+                new_start        <= '1';
+                count            <= (others => '0');
+                remaining        <= (others => '0');
+                tx_word          <= (others => '0');
+                next_valid       <= '0';
+                tx_active        <= '0';
+                rx_word          <= (others => '0');
+                rx_be            <= (others => '0');
+                done_prev        <= '0';
+                master_end       <= '0';
+                master_nack      <= '0';
+                master_timeout   <= '0';
+                enable           <= '0';
+                restart          <= '0';
+                stop_signal      <= '0';
+                continue_pulse   <= '0';
+                avm_address      <= (others => '0');
+                avm_read         <= '0';
+                avm_write        <= '0';
+                avm_writedata    <= (others => '0');
+                avm_byteenable   <= (others => '0');
+            else
+                -- one clock strobes
+                finished       <= '0';
+                enable         <= '0';
+                restart        <= '0';
+                stop_signal    <= '0';
+                continue_pulse <= '0';
+
+                done_prev <= done;
+                if (done = '1' and done_prev = '0') then
+                    master_end     <= '1';
+                    master_nack    <= ack_error;
+                    master_timeout <= timeout;
+                end if;
+
+                case state is
+
+                    when idle_state =>
+                        if (start = '1') then
+                            running_internal <= '1';
+                            error_internal   <= '0';
+                            new_start        <= '1';
+                            desc_addr        <= unsigned(head);
+                            avm_address      <= head;
+                            avm_read         <= '1';
+                            state            <= desc_next_state;
+                        end if;
+
+                    -- descriptor fetch, readdata is valid in the clock waitrequest is low
+                    when desc_next_state =>
+                        if (avm_waitrequest = '0') then
+                            desc_next   <= unsigned(avm_readdata);
+                            avm_address <= std_logic_vector(desc_addr + 4);
+                            state       <= desc_control_state;
+                        end if;
+
+                    when desc_control_state =>
+                        if (avm_waitrequest = '0') then
+                            desc_slave <= avm_readdata(6 downto 0);
+                            desc_read  <= avm_readdata(8);
+                            if (avm_readdata(9) = '1' or desc_next = 0) then
+                                desc_stop <= '1';
+                            else
+                                desc_stop <= '0';
+                            end if;
+                            if (unsigned(avm_readdata(31 downto 16)) = 0) then
+                                desc_len <= to_unsigned(1, 16);
+                            else
+                                desc_len <= unsigned(avm_readdata(31 downto 16));
+                            end if;
+                            avm_address <= std_logic_vector(desc_addr + 8);
+                            state       <= desc_buffer_state;
+                        end if;
+
+                    when desc_buffer_state =>
+                        if (avm_waitrequest = '0') then
+                            buf_addr  <= unsigned(avm_readdata(31 downto 2)) & "00";
+                            count     <= (others => '0');
+                            remaining <= desc_len;
+                            rx_be     <= (others => '0');
+                            if (desc_read = '1') then
+                                avm_read <= '0';
+                                state    <= issue_state;
+                            else
+                                avm_address <= avm_readdata(31 downto 2) & "00";
+                                state       <= data_fetch_state;
+                            end if;
+                        end if;
+
+                    when data_fetch_state =>
+                        if (avm_waitrequest = '0') then
+                            tx_word    <= avm_readdata;
+                            next_valid <= '1';
+                            avm_read   <= '0';
+                            state      <= issue_state;
+                        end if;
+
+                    -- the master waits in wait_write/wait_read for a repeated start
+                    when issue_state =>
+                        if (new_start = '1') then
+                            enable <= '1';
+                        else
+                            restart <= '1';
+                        end if;
+                        master_end <= '0';
+                        if (desc_read = '1') then
+                            continue_pulse <= '1';   -- sequential read, every byte waits for the decision
+                            state <= read_state;
+                        else
+                            tx_active <= '1';
+                            state <= write_state;
+                        end if;
+
+                    when write_state =>
+                        if (master_end = '1') then
+                            tx_active  <= '0';
+                            next_valid <= '0';
+                            state      <= status_state;
+                        elsif (data_taken = '1') then
+                            count     <= count + 1;
+                            remaining <= remaining - 1;
+                            if (remaining = 1) then
+                                tx_active  <= '0';
+                                next_valid <= '0';
+                                if (desc_stop = '1') then
+                                    stop_signal <= '1';   -- stop after the ack of this byte
+                                    state <= wait_done_state;
+                                else
+                                    state <= write_end_state;
+                                end if;
+                            elsif (count(1 downto 0) = "11") then
+                                next_valid  <= '0';
+                                avm_address <= std_logic_vector(buf_addr + count + 1);
+                                avm_read    <= '1';
+                                state       <= write_fetch_state;
+                            end if;
+                        end if;
+
+                    when write_fetch_state =>
+                        if (avm_waitrequest = '0') then
+                            tx_word    <= avm_readdata;
+                            next_valid <= '1';
+                            avm_read   <= '0';
+                            state      <= write_state;
+                        end if;
+
+                    when write_end_state =>
+                        if (master_end = '1' or ready = '1') then
+                            state <= status_state;
+                        end if;
+
+                    when read_state =>
+                        if (master_end = '1') then
+                            state <= status_state;
+                        elsif (data_valid = '1') then
+                            lane := to_integer(count(1 downto 0));
+                            rx_word(8*lane+7 downto 8*lane) <= data_out;
+                            rx_be(lane) <= '1';
+                            count     <= count + 1;
+                            remaining <= remaining - 1;
+
+                            -- ack/nack decision before the master reaches it at scl low
+                            if (remaining /= 1) then
+                                continue_pulse <= '1';
+                            elsif (desc_stop = '1') then
+                                stop_signal <= '1';
+                            end if;
+
+                            if (lane = 3 or remaining = 1) then
+                                avm_address    <= std_logic_vector(buf_addr + (count(15 downto 2) & "00"));
+                                avm_writedata  <= rx_word;
+                                avm_writedata(8*lane+7 downto 8*lane) <= data_out;
+                                avm_byteenable <= rx_be;
+                                avm_byteenable(lane) <= '1';
+                                avm_write      <= '1';
+                                state          <= read_store_state;
+                            end if;
+                        end if;
+
+                    when read_store_state =>
+                        if (avm_waitrequest = '0') then
+                            avm_write <= '0';
+                            rx_be     <= (others => '0');
+                            if (remaining /= 0) then
+                                state <= read_state;
+                            elsif (desc_stop = '1') then
+                                state <= wait_done_state;
+                            else
+                                state <= status_state;
+                            end if;
+                        end if;
+
+                    when wait_done_state =>
+                        if (master_end = '1') then
+                            state <= status_state;
+                        end if;
+
+                    -- status write back, then on to the next descriptor or the end of the list
+                    when status_state =>
+                        if (avm_write = '0') then
+                            avm_address    <= std_logic_vector(desc_addr + 12);
+                            avm_writedata  <= x"8000" & count;
+                            if (master_end = '1') then
+                                avm_writedata(16) <= master_nack;
+                                avm_writedata(17) <= master_timeout;
+                            end if;
+                            avm_byteenable <= "1111";
+                            avm_write      <= '1';
+                        elsif (avm_waitrequest = '0') then
+                            avm_write <= '0';
+                            if (master_end = '1' and (master_nack = '1' or master_timeout = '1')) then
+                                error_internal   <= '1';
+                                running_internal <= '0';
+                                finished         <= '1';
+                                state            <= idle_state;
+                            elsif (desc_next = 0) then
+                                running_internal <= '0';
+                                finished         <= '1';
+                                state            <= idle_state;
+                            else
+                                new_start   <= desc_stop;
+                                desc_addr   <= desc_next;
+                                avm_address <= std_logic_vector(desc_next);
+                                avm_read    <= '1';
+                                state       <= desc_next_state;
+                            end if;
+                        end if;
+
+                end case;
+            end if;
+        end if;
+    end process;
+
+    running <= running_internal;
+    error   <= error_internal;
+    current <= std_logic_vector(desc_addr);
+
+    slave_address <= desc_slave;
+    read_write    <= desc_read;
+    data_in       <= tx_word(7 downto 0)   when count(1 downto 0) = "00" else
+                     tx_word(15 downto 8)  when count(1 downto 0) = "01" else
+                     tx_word(23 downto 16) when count(1 downto 0) = "10" else
+                     tx_word(31 downto 24);
+
+    -- writes: a level while the next byte is there (like the tx fifo), reads: one pulse per byte
+    continue <= continue_pulse or (tx_active and next_valid);
+
+end architecture;
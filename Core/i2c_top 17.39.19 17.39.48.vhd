@@ -1,153 +1,667 @@
-library ieee;
-use ieee.std_logic_1164.all;
-use ieee.numeric_std.all;
-
-entity i2c_top is
-    port
-    (
-        -- system signals
-        clk        : in  std_logic;
-        reset      : in  std_logic;
-
-        -- sbi interface
-        sbi_cs     : in  std_logic;
-        sbi_we     : in  std_logic;
-        sbi_re     : in  std_logic;
-        sbi_addr   : in  std_logic_vector(1 downto 0);
-        sbi_wdata  : in  std_logic_vector(31 downto 0);
-        sbi_rdata  : out std_logic_vector(31 downto 0);
-
-        -- i2c interface
-        sda        : inout std_logic;
-        scl        : out std_logic
-    );
-end entity i2c_top;
-
-architecture struct of i2c_top is
-
-    -- components
-    component i2c_registerbank is
-        port 
-        (
-            clk           : in  std_logic;
-            reset         : in  std_logic;
-
-            sbi_cs        : in  std_logic;
-            sbi_we        : in  std_logic;
-            sbi_re        : in  std_logic;
-            sbi_addr      : in  std_logic_vector(1 downto 0);
-            sbi_wdata     : in  std_logic_vector(31 downto 0);
-            sbi_rdata     : out std_logic_vector(31 downto 0);
-
-            slave_address : out std_logic_vector(6 downto 0);
-            data_in       : out std_logic_vector(7 downto 0);
-            enable        : out std_logic;
-            read_write    : out std_logic;
-            stop_signal   : out std_logic;
-            continue      : out std_logic;
-
-            data_out      : in  std_logic_vector(7 downto 0);
-            busy          : in  std_logic;
-            ack_error     : in  std_logic;
-            done          : in  std_logic;
-            ready         : in  std_logic
-        );
-    end component;
-
-    component i2c_master is
-        generic 
-        (
-            SYS_CLK_FREQ_HZ : integer := 50_000_000;
-            I2C_FREQ_HZ     : integer := 100_000
-        );
-        port 
-        (
-            clk           : in  std_logic;
-            reset         : in  std_logic;
-
-            slave_address : in  std_logic_vector(6 downto 0);
-            data_in       : in  std_logic_vector(7 downto 0);
-            data_out      : out std_logic_vector(7 downto 0);
-
-            enable        : in  std_logic;
-            read_write    : in  std_logic;
-            stop_signal   : in  std_logic;
-            continue      : in  std_logic;
-            busy          : out std_logic;
-            ack_error     : out std_logic;
-            done          : out std_logic;
-            ready         : out std_logic;
-
-            scl           : out std_logic;
-            sda           : inout std_logic
-        );
-    end component;
-
-    -- internal signals
-    signal slave_address : std_logic_vector(6 downto 0);
-    signal data_in       : std_logic_vector(7 downto 0);
-    signal data_out      : std_logic_vector(7 downto 0);
-
-    signal enable        : std_logic;
-    signal read_write    : std_logic;
-    signal stop_signal   : std_logic;
-    signal busy          : std_logic;
-    signal ack_error     : std_logic;
-    signal done          : std_logic;
-    signal continue      : std_logic;
-    signal ready         : std_logic;
-
-begin
-
-    -- registerbank instance
-    reg_inst : i2c_registerbank
-        port map 
-        (
-            clk           => clk,
-            reset         => reset,
-            sbi_cs        => sbi_cs,
-            sbi_we        => sbi_we,
-            sbi_re        => sbi_re,
-            sbi_addr      => sbi_addr,
-            sbi_wdata     => sbi_wdata,
-            sbi_rdata     => sbi_rdata,
-            slave_address => slave_address,
-            data_in       => data_in,
-            enable        => enable,
-            read_write    => read_write,
-            stop_signal   => stop_signal,
-            data_out      => data_out,
-            busy          => busy,
-            ack_error     => ack_error,
-            done          => done,
-            ready         => ready,
-            continue      => continue
-        );
-
-    -- i2c master instance
-    master_inst : i2c_master
-        generic map 
-        (
-            SYS_CLK_FREQ_HZ => 50_000_000,
-            I2C_FREQ_HZ     => 100_000
-        )
-        port map 
-        (
-            clk           => clk,
-            reset         => reset,
-            slave_address => slave_address,
-            data_in       => data_in,
-            data_out      => data_out,
-            enable        => enable,
-            read_write    => read_write,
-            stop_signal   => stop_signal,
-            busy          => busy,
-            ack_error     => ack_error,
-            done          => done,
-            ready         => ready,
-            continue      => continue, 
-            scl           => scl,
-            sda           => sda
-        );
-
-end architecture struct;
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+entity i2c_top is
+    generic
+    (
+        FIFO_DEPTH      : integer := 16;
+        SYS_CLK_FREQ_HZ : integer := 50_000_000;
+        I2C_FREQ_HZ     : integer := 100_000;
+        TRACE_DEPTH     : integer := 64;
+        REGISTERED_READ : boolean := false   -- one wait state on reads, for clocks above 100 MHz
+    );
+    port
+    (
+        -- system signals
+        clk        : in  std_logic;
+        reset      : in  std_logic;
+
+        -- sbi interface
+        sbi_cs     : in  std_logic;
+        sbi_we     : in  std_logic;
+        sbi_re     : in  std_logic;
+        sbi_addr   : in  std_logic_vector(5 downto 0);
+        sbi_wdata  : in  std_logic_vector(31 downto 0);
+        sbi_rdata  : out std_logic_vector(31 downto 0);
+        sbi_ready  : out std_logic;
+
+        -- interrupt
+        irq        : out std_logic;
+
+        -- avalon-mm master of the command sequencer, descriptors and data in memory
+        avm_address     : out std_logic_vector(31 downto 0);
+        avm_read        : out std_logic;
+        avm_write       : out std_logic;
+        avm_writedata   : out std_logic_vector(31 downto 0);
+        avm_byteenable  : out std_logic_vector(3 downto 0);
+        avm_readdata    : in  std_logic_vector(31 downto 0) := (others => '0');
+        avm_waitrequest : in  std_logic := '0';
+
+        -- i2c interface
+        sda        : inout std_logic;
+        scl        : inout std_logic
+    );
+end entity i2c_top;
+
+architecture struct of i2c_top is
+
+    -- components
+    component i2c_registerbank is
+        generic 
+        (
+            FIFO_DEPTH      : integer := 16;
+            SYS_CLK_FREQ_HZ : integer := 50_000_000;
+            I2C_FREQ_HZ     : integer := 100_000;
+            REGISTERED_READ : boolean := false
+        );
+        port 
+        (
+            clk           : in  std_logic;
+            reset         : in  std_logic;
+
+            sbi_cs        : in  std_logic;
+            sbi_we        : in  std_logic;
+            sbi_re        : in  std_logic;
+            sbi_addr      : in  std_logic_vector(5 downto 0);
+            sbi_wdata     : in  std_logic_vector(31 downto 0);
+            sbi_rdata     : out std_logic_vector(31 downto 0);
+            sbi_ready     : out std_logic;
+
+            slave_address : out std_logic_vector(6 downto 0);
+            data_in       : out std_logic_vector(7 downto 0);
+            enable        : out std_logic;
+            read_write    : out std_logic;
+            stop_signal   : out std_logic;
+            continue      : out std_logic;
+            restart       : out std_logic;
+            recover       : out std_logic;
+
+            scl_low_cycles  : out std_logic_vector(15 downto 0);
+            scl_high_cycles : out std_logic_vector(15 downto 0);
+            tsu_sta_cycles  : out std_logic_vector(15 downto 0);
+            thd_sta_cycles  : out std_logic_vector(15 downto 0);
+            tsu_sto_cycles  : out std_logic_vector(15 downto 0);
+            tbuf_cycles     : out std_logic_vector(15 downto 0);
+            stretch_timeout_cycles : out std_logic_vector(31 downto 0);
+
+            data_out      : in  std_logic_vector(7 downto 0);
+            busy          : in  std_logic;
+            ack_error     : in  std_logic;
+            timeout       : in  std_logic;
+            done          : in  std_logic;
+            ready         : in  std_logic;
+            data_taken    : in  std_logic;
+            data_valid    : in  std_logic;
+
+            tx_byte       : in  std_logic;
+            cpu_stall     : in  std_logic;
+            scl_stretch   : in  std_logic;
+
+            seq_start     : out std_logic;
+            seq_head      : out std_logic_vector(31 downto 0);
+            seq_running   : in  std_logic;
+            seq_error     : in  std_logic;
+            seq_current   : in  std_logic_vector(31 downto 0);
+            seq_finished  : in  std_logic;
+
+            poll_enable   : out std_logic;
+            poll_period   : out std_logic_vector(15 downto 0);
+            poll_slave    : out std_logic_vector(6 downto 0);
+            poll_first    : out std_logic_vector(7 downto 0);
+            poll_length   : out integer range 1 to 32;
+            poll_word     : out std_logic_vector(2 downto 0);
+            poll_mirror   : in  std_logic_vector(31 downto 0);
+            poll_count    : in  std_logic_vector(31 downto 0);
+            poll_age      : in  std_logic_vector(15 downto 0);
+            poll_failed   : in  std_logic;
+            poll_running  : in  std_logic;
+            poll_owner    : in  std_logic;
+
+            trace_enable   : out std_logic;
+            trace_clear    : out std_logic;
+            trace_states   : out std_logic;
+            trace_trigger  : out std_logic_vector(1 downto 0);
+            trace_address  : out std_logic_vector(6 downto 0);
+            trace_post     : out std_logic_vector(7 downto 0);
+            trace_prescale : out std_logic_vector(3 downto 0);
+            trace_pop      : out std_logic;
+            trace_data     : in  std_logic_vector(31 downto 0);
+            trace_level    : in  std_logic_vector(15 downto 0);
+            trace_flags    : in  std_logic_vector(3 downto 0);
+
+            irq           : out std_logic
+        );
+    end component;
+
+    component i2c_poller is
+        generic
+        (
+            SYS_CLK_FREQ_HZ : integer := 50_000_000
+        );
+        port
+        (
+            clk           : in  std_logic;
+            reset         : in  std_logic;
+
+            enable        : in  std_logic;
+            period        : in  std_logic_vector(15 downto 0);
+            slave         : in  std_logic_vector(6 downto 0);
+            first_reg     : in  std_logic_vector(7 downto 0);
+            length        : in  integer range 1 to 32;
+            mirror_word   : in  std_logic_vector(2 downto 0);
+            mirror_data   : out std_logic_vector(31 downto 0);
+            count         : out std_logic_vector(31 downto 0);
+            age           : out std_logic_vector(15 downto 0);
+            failed        : out std_logic;
+
+            bus_free      : in  std_logic;
+            running       : out std_logic;
+            owner         : out std_logic;
+
+            slave_address : out std_logic_vector(6 downto 0);
+            data_in       : out std_logic_vector(7 downto 0);
+            enable_out    : out std_logic;
+            read_write    : out std_logic;
+            stop_signal   : out std_logic;
+            continue      : out std_logic;
+            restart       : out std_logic;
+
+            data_out      : in  std_logic_vector(7 downto 0);
+            ack_error     : in  std_logic;
+            timeout       : in  std_logic;
+            done          : in  std_logic;
+            ready         : in  std_logic;
+            data_valid    : in  std_logic
+        );
+    end component;
+
+    component i2c_sequencer is
+        port
+        (
+            clk           : in  std_logic;
+            reset         : in  std_logic;
+
+            start         : in  std_logic;
+            head          : in  std_logic_vector(31 downto 0);
+            running       : out std_logic;
+            error         : out std_logic;
+            current       : out std_logic_vector(31 downto 0);
+            finished      : out std_logic;
+
+            slave_address : out std_logic_vector(6 downto 0);
+            data_in       : out std_logic_vector(7 downto 0);
+            enable        : out std_logic;
+            read_write    : out std_logic;
+            stop_signal   : out std_logic;
+            continue      : out std_logic;
+            restart       : out std_logic;
+
+            data_out      : in  std_logic_vector(7 downto 0);
+            ack_error     : in  std_logic;
+            timeout       : in  std_logic;
+            done          : in  std_logic;
+            ready         : in  std_logic;
+            data_taken    : in  std_logic;
+            data_valid    : in  std_logic;
+
+            avm_address     : out std_logic_vector(31 downto 0);
+            avm_read        : out std_logic;
+            avm_write       : out std_logic;
+            avm_writedata   : out std_logic_vector(31 downto 0);
+            avm_byteenable  : out std_logic_vector(3 downto 0);
+            avm_readdata    : in  std_logic_vector(31 downto 0);
+            avm_waitrequest : in  std_logic
+        );
+    end component;
+
+    component i2c_master is
+        port 
+        (
+            clk           : in  std_logic;
+            reset         : in  std_logic;
+
+            slave_address : in  std_logic_vector(6 downto 0);
+            data_in       : in  std_logic_vector(7 downto 0);
+            data_out      : out std_logic_vector(7 downto 0);
+
+            enable        : in  std_logic;
+            read_write    : in  std_logic;
+            stop_signal   : in  std_logic;
+            continue      : in  std_logic;
+            restart       : in  std_logic;
+            recover       : in  std_logic;
+            busy          : out std_logic;
+            ack_error     : out std_logic;
+            timeout       : out std_logic;
+            done          : out std_logic;
+            ready         : out std_logic;
+            data_taken    : out std_logic;
+            data_valid    : out std_logic;
+            tx_byte       : out std_logic;
+            cpu_stall     : out std_logic;
+            scl_stretch   : out std_logic;
+            state_code    : out std_logic_vector(3 downto 0);
+
+            scl_low_cycles  : in  std_logic_vector(15 downto 0);
+            scl_high_cycles : in  std_logic_vector(15 downto 0);
+            tsu_sta_cycles  : in  std_logic_vector(15 downto 0);
+            thd_sta_cycles  : in  std_logic_vector(15 downto 0);
+            tsu_sto_cycles  : in  std_logic_vector(15 downto 0);
+            tbuf_cycles     : in  std_logic_vector(15 downto 0);
+            stretch_timeout_cycles : in  std_logic_vector(31 downto 0);
+
+            scl           : inout std_logic;
+            sda           : inout std_logic
+        );
+    end component;
+
+    component i2c_trace is
+        generic
+        (
+            DEPTH : integer := 64
+        );
+        port
+        (
+            clk          : in  std_logic;
+            reset        : in  std_logic;
+            enable       : in  std_logic;
+            clear        : in  std_logic;
+            states       : in  std_logic;
+            trigger      : in  std_logic_vector(1 downto 0);
+            trig_address : in  std_logic_vector(6 downto 0);
+            post_count   : in  std_logic_vector(7 downto 0);
+            prescale     : in  std_logic_vector(3 downto 0);
+            rd_en        : in  std_logic;
+            rd_data      : out std_logic_vector(31 downto 0);
+            level        : out std_logic_vector(15 downto 0);
+            recording    : out std_logic;
+            triggered    : out std_logic;
+            stopped      : out std_logic;
+            wrapped      : out std_logic;
+            state_code   : in  std_logic_vector(3 downto 0);
+            timeout      : in  std_logic;
+            scl          : in  std_logic;
+            sda          : in  std_logic
+        );
+    end component;
+
+    -- internal signals
+    signal slave_address : std_logic_vector(6 downto 0);
+    signal data_in       : std_logic_vector(7 downto 0);
+    signal data_out      : std_logic_vector(7 downto 0);
+
+    signal enable        : std_logic;
+    signal read_write    : std_logic;
+    signal stop_signal   : std_logic;
+    signal busy          : std_logic;
+    signal ack_error     : std_logic;
+    signal timeout       : std_logic;
+    signal done          : std_logic;
+    signal continue      : std_logic;
+    signal restart       : std_logic;
+    signal recover       : std_logic;
+    signal ready         : std_logic;
+    signal data_taken    : std_logic;
+    signal data_valid    : std_logic;
+    signal tx_byte       : std_logic;
+    signal cpu_stall     : std_logic;
+    signal scl_stretch   : std_logic;
+    signal state_code    : std_logic_vector(3 downto 0);
+
+    signal scl_low_cycles, scl_high_cycles : std_logic_vector(15 downto 0);
+    signal tsu_sta_cycles, thd_sta_cycles  : std_logic_vector(15 downto 0);
+    signal tsu_sto_cycles, tbuf_cycles     : std_logic_vector(15 downto 0);
+    signal stretch_timeout_cycles          : std_logic_vector(31 downto 0);
+
+    -- master control from the registerbank and from the sequencer, the sequencer has the master while it runs
+    signal reg_slave_address, seq_slave_address : std_logic_vector(6 downto 0);
+    signal reg_data_in, seq_data_in             : std_logic_vector(7 downto 0);
+    signal reg_enable, seq_enable               : std_logic;
+    signal reg_read_write, seq_read_write       : std_logic;
+    signal reg_stop_signal, seq_stop_signal     : std_logic;
+    signal reg_continue, seq_continue           : std_logic;
+    signal reg_restart, seq_restart             : std_logic;
+    signal reg_recover                          : std_logic;   -- bus recovery, only from the cpu
+
+    signal seq_start, seq_running, seq_error, seq_finished : std_logic;
+    signal seq_head, seq_current                           : std_logic_vector(31 downto 0);
+
+    -- auto poller, it has the master while it runs. cpu and sequencer starts given meanwhile
+    -- wait for its end, it only starts on a free bus with no other start on the way.
+    signal poll_slave_address : std_logic_vector(6 downto 0);
+    signal poll_data_in       : std_logic_vector(7 downto 0);
+    signal poll_enable_out    : std_logic;
+    signal poll_read_write    : std_logic;
+    signal poll_stop_signal   : std_logic;
+    signal poll_continue      : std_logic;
+    signal poll_restart       : std_logic;
+
+    signal poll_enable, poll_failed, poll_running, poll_owner : std_logic;
+    signal poll_period, poll_age      : std_logic_vector(15 downto 0);
+    signal poll_slave                 : std_logic_vector(6 downto 0);
+    signal poll_first                 : std_logic_vector(7 downto 0);
+    signal poll_length                : integer range 1 to 32;
+    signal poll_word                  : std_logic_vector(2 downto 0);
+    signal poll_mirror, poll_count    : std_logic_vector(31 downto 0);
+    signal poll_bus_free              : std_logic;
+
+    signal reg_enable_held, seq_start_held : std_logic;
+    signal reg_continue_held          : std_logic;   -- a sequential read given with the enable
+    signal reg_recover_held           : std_logic;   -- a recovery given with the enable
+    signal reg_stop_held              : std_logic;   -- a stop given with the enable
+    signal reg_restart_held           : std_logic;   -- a restart given with the enable
+    signal seq_start_gated            : std_logic;
+    signal cpu_enable, cpu_continue   : std_logic;
+    signal cpu_recover                : std_logic;
+    signal cpu_stop, cpu_restart      : std_logic;
+    signal start_waiting              : std_logic;   -- a start given to the master that busy does not show yet
+
+    -- bus trace
+    signal trace_enable, trace_clear, trace_states, trace_pop : std_logic;
+    signal trace_trigger              : std_logic_vector(1 downto 0);
+    signal trace_address              : std_logic_vector(6 downto 0);
+    signal trace_post                 : std_logic_vector(7 downto 0);
+    signal trace_prescale             : std_logic_vector(3 downto 0);
+    signal trace_data                 : std_logic_vector(31 downto 0);
+    signal trace_level                : std_logic_vector(15 downto 0);
+    signal trace_flags                : std_logic_vector(3 downto 0);
+
+begin
+
+    -- registerbank instance
+    reg_inst : i2c_registerbank
+        generic map 
+        (
+            FIFO_DEPTH      => FIFO_DEPTH,
+            SYS_CLK_FREQ_HZ => SYS_CLK_FREQ_HZ,
+            I2C_FREQ_HZ     => I2C_FREQ_HZ,
+            REGISTERED_READ => REGISTERED_READ
+        )
+        port map 
+        (
+            clk           => clk,
+            reset         => reset,
+            sbi_cs        => sbi_cs,
+            sbi_we        => sbi_we,
+            sbi_re        => sbi_re,
+            sbi_addr      => sbi_addr,
+            sbi_wdata     => sbi_wdata,
+            sbi_rdata     => sbi_rdata,
+            sbi_ready     => sbi_ready,
+            slave_address => reg_slave_address,
+            data_in       => reg_data_in,
+            enable        => reg_enable,
+            read_write    => reg_read_write,
+            stop_signal   => reg_stop_signal,
+            data_out      => data_out,
+            busy          => busy,
+            ack_error     => ack_error,
+            timeout       => timeout,
+            done          => done,
+            ready         => ready,
+            data_taken    => data_taken,
+            data_valid    => data_valid,
+            tx_byte       => tx_byte,
+            cpu_stall     => cpu_stall,
+            scl_stretch   => scl_stretch,
+            continue      => reg_continue,
+            restart       => reg_restart,
+            recover       => reg_recover,
+            scl_low_cycles  => scl_low_cycles,
+            scl_high_cycles => scl_high_cycles,
+            tsu_sta_cycles  => tsu_sta_cycles,
+            thd_sta_cycles  => thd_sta_cycles,
+            tsu_sto_cycles  => tsu_sto_cycles,
+            tbuf_cycles     => tbuf_cycles,
+            stretch_timeout_cycles => stretch_timeout_cycles,
+            seq_start     => seq_start,
+            seq_head      => seq_head,
+            seq_running   => seq_running,
+            seq_error     => seq_error,
+            seq_current   => seq_current,
+            seq_finished  => seq_finished,
+            poll_enable   => poll_enable,
+            poll_period   => poll_period,
+            poll_slave    => poll_slave,
+            poll_first    => poll_first,
+            poll_length   => poll_length,
+            poll_word     => poll_word,
+            poll_mirror   => poll_mirror,
+            poll_count    => poll_count,
+            poll_age      => poll_age,
+            poll_failed   => poll_failed,
+            poll_running  => poll_running,
+            poll_owner    => poll_owner,
+            trace_enable   => trace_enable,
+            trace_clear    => trace_clear,
+            trace_states   => trace_states,
+            trace_trigger  => trace_trigger,
+            trace_address  => trace_address,
+            trace_post     => trace_post,
+            trace_prescale => trace_prescale,
+            trace_pop      => trace_pop,
+            trace_data     => trace_data,
+            trace_level    => trace_level,
+            trace_flags    => trace_flags,
+            irq           => irq
+        );
+
+    -- command sequencer instance
+    seq_inst : i2c_sequencer
+        port map
+        (
+            clk           => clk,
+            reset         => reset,
+            start         => seq_start_gated,
+            head          => seq_head,
+            running       => seq_running,
+            error         => seq_error,
+            current       => seq_current,
+            finished      => seq_finished,
+            slave_address => seq_slave_address,
+            data_in       => seq_data_in,
+            enable        => seq_enable,
+            read_write    => seq_read_write,
+            stop_signal   => seq_stop_signal,
+            continue      => seq_continue,
+            restart       => seq_restart,
+            data_out      => data_out,
+            ack_error     => ack_error,
+            timeout       => timeout,
+            done          => done,
+            ready         => ready,
+            data_taken    => data_taken,
+            data_valid    => data_valid,
+            avm_address     => avm_address,
+            avm_read        => avm_read,
+            avm_write       => avm_write,
+            avm_writedata   => avm_writedata,
+            avm_byteenable  => avm_byteenable,
+            avm_readdata    => avm_readdata,
+            avm_waitrequest => avm_waitrequest
+        );
+
+    -- auto poller instance
+    poll_inst : i2c_poller
+        generic map
+        (
+            SYS_CLK_FREQ_HZ => SYS_CLK_FREQ_HZ
+        )
+        port map
+        (
+            clk           => clk,
+            reset         => reset,
+            enable        => poll_enable,
+            period        => poll_period,
+            slave         => poll_slave,
+            first_reg     => poll_first,
+            length        => poll_length,
+            mirror_word   => poll_word,
+            mirror_data   => poll_mirror,
+            count         => poll_count,
+            age           => poll_age,
+            failed        => poll_failed,
+            bus_free      => poll_bus_free,
+            running       => poll_running,
+            owner         => poll_owner,
+            slave_address => poll_slave_address,
+            data_in       => poll_data_in,
+            enable_out    => poll_enable_out,
+            read_write    => poll_read_write,
+            stop_signal   => poll_stop_signal,
+            continue      => poll_continue,
+            restart       => poll_restart,
+            data_out      => data_out,
+            ack_error     => ack_error,
+            timeout       => timeout,
+            done          => done,
+            ready         => ready,
+            data_valid    => data_valid
+        );
+
+    -- arbitration: a cpu enable (with its stop, continue, restart) or a doorbell given while the poller runs is kept until it ended
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                reg_enable_held <= '0';
+                reg_continue_held <= '0';
+                reg_recover_held <= '0';
+                reg_stop_held   <= '0';
+                reg_restart_held <= '0';
+                seq_start_held  <= '0';
+                start_waiting   <= '0';
+            else
+                if (poll_running = '0') then
+                    reg_enable_held <= '0';
+                elsif (reg_enable = '1') then
+                    reg_enable_held <= '1';
+                end if;
+
+                if (poll_running = '0') then
+                    reg_continue_held <= '0';
+                elsif (reg_continue = '1') then
+                    reg_continue_held <= '1';
+                end if;
+
+                if (poll_running = '0') then
+                    reg_recover_held <= '0';
+                elsif (reg_recover = '1') then
+                    reg_recover_held <= '1';
+                end if;
+
+                if (poll_running = '0') then
+                    reg_stop_held <= '0';
+                elsif (reg_stop_signal = '1') then
+                    reg_stop_held <= '1';
+                end if;
+
+                if (poll_running = '0') then
+                    reg_restart_held <= '0';
+                elsif (reg_restart = '1') then
+                    reg_restart_held <= '1';
+                end if;
+
+                if (poll_running = '0') then
+                    seq_start_held <= '0';
+                elsif (seq_start = '1') then
+                    seq_start_held <= '1';
+                end if;
+
+                if (enable = '1' and poll_running = '0') then
+                    start_waiting <= '1';
+                elsif (busy = '1') then
+                    start_waiting <= '0';
+                end if;
+            end if;
+        end if;
+    end process;
+
+    cpu_enable      <= (reg_enable or reg_enable_held) and not poll_running;
+    cpu_continue    <= reg_continue or reg_continue_held;
+    cpu_recover     <= reg_recover or reg_recover_held;
+    cpu_stop        <= reg_stop_signal or reg_stop_held;
+    cpu_restart     <= reg_restart or reg_restart_held;
+    seq_start_gated <= (seq_start or seq_start_held) and not poll_running;
+
+    poll_bus_free <= '1' when (busy = '0' and start_waiting = '0' and seq_running = '0' and reg_enable = '0'
+                               and seq_start = '0' and reg_enable_held = '0' and seq_start_held = '0') else '0';
+
+    slave_address <= poll_slave_address when poll_running = '1' else seq_slave_address when seq_running = '1' else reg_slave_address;
+    data_in       <= poll_data_in       when poll_running = '1' else seq_data_in       when seq_running = '1' else reg_data_in;
+    enable        <= poll_enable_out    when poll_running = '1' else seq_enable        when seq_running = '1' else cpu_enable;
+    read_write    <= poll_read_write    when poll_running = '1' else seq_read_write    when seq_running = '1' else reg_read_write;
+    stop_signal   <= poll_stop_signal   when poll_running = '1' else seq_stop_signal   when seq_running = '1' else cpu_stop;
+    continue      <= poll_continue      when poll_running = '1' else seq_continue      when seq_running = '1' else cpu_continue;
+    restart       <= poll_restart       when poll_running = '1' else seq_restart       when seq_running = '1' else cpu_restart;
+    recover       <= cpu_recover when (poll_running = '0' and seq_running = '0') else '0';
+
+    -- i2c master instance
+    master_inst : i2c_master
+        port map 
+        (
+            clk           => clk,
+            reset         => reset,
+            slave_address => slave_address,
+            data_in       => data_in,
+            data_out      => data_out,
+            enable        => enable,
+            read_write    => read_write,
+            stop_signal   => stop_signal,
+            busy          => busy,
+            ack_error     => ack_error,
+            timeout       => timeout,
+            done          => done,
+            ready         => ready,
+            data_taken    => data_taken,
+            data_valid    => data_valid,
+            tx_byte       => tx_byte,
+            cpu_stall     => cpu_stall,
+            scl_stretch   => scl_stretch,
+            state_code    => state_code,
+            continue      => continue, 
+            restart       => restart,
+            recover       => recover,
+            scl_low_cycles  => scl_low_cycles,
+            scl_high_cycles => scl_high_cycles,
+            tsu_sta_cycles  => tsu_sta_cycles,
+            thd_sta_cycles  => thd_sta_cycles,
+            tsu_sto_cycles  => tsu_sto_cycles,
+            tbuf_cycles     => tbuf_cycles,
+            stretch_timeout_cycles => stretch_timeout_cycles,
+            scl           => scl,
+            sda           => sda
+        );
+
+    -- bus trace instance, it only watches the bus lines
+    trace_inst : i2c_trace
+        generic map
+        (
+            DEPTH => TRACE_DEPTH
+        )
+        port map
+        (
+            clk          => clk,
+            reset        => reset,
+            enable       => trace_enable,
+            clear        => trace_clear,
+            states       => trace_states,
+            trigger      => trace_trigger,
+            trig_address => trace_address,
+            post_count   => trace_post,
+            prescale     => trace_prescale,
+            rd_en        => trace_pop,
+            rd_data      => trace_data,
+            level        => trace_level,
+            recording    => trace_flags(0),
+            triggered    => trace_flags(1),
+            stopped      => trace_flags(2),
+            wrapped      => trace_flags(3),
+            state_code   => state_code,
+            timeout      => timeout,
+            scl          => scl,
+            sda          => sda
+        );
+
+end architecture struct;
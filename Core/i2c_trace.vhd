@@ -0,0 +1,339 @@
+library ieee;
+use ieee.std_logic_1164.all;
+use ieee.numeric_std.all;
+
+-- Bus trace: records the bus as seen on sda/scl (start, stop, every byte with its ack bit),
+-- the master stretch timeouts and optionally the master fsm states into a ring buffer the
+-- cpu drains over SBI. The trace is passive, it does not change the timing of the master.
+--
+-- entry  (type[2:0] - trigger - payload[8:0] - delta[18:0])
+--   type    0 state    payload(3:0) fsm state of the master (position in its state_type)
+--           1 start    payload(0) repeated start
+--           2 stop
+--           3 byte     payload(8) ack bit (1 = nack), payload(7:0) the byte, address bytes included
+--           4 timeout
+--   trigger the entry fired the trigger
+--   delta   ticks of 2**prescale clock cycles since the entry before, saturating
+--
+-- Until the trigger fires the buffer keeps the newest DEPTH entries (wrapped is set when an
+-- entry was overwritten), after it post_count more entries are recorded and the trace stops.
+-- Without a trigger condition it records until disabled. Reading the data register pops the
+-- oldest entry, draining works while the trace records.
+
+entity i2c_trace is
+    generic
+    (
+        DEPTH : integer := 64
+    );
+    port
+    (
+        clk          : in  std_logic;
+        reset        : in  std_logic;
+
+        -- registerbank
+        enable       : in  std_logic;
+        clear        : in  std_logic;
+        states       : in  std_logic;                      -- record fsm state changes
+        trigger      : in  std_logic_vector(1 downto 0);   -- 0 none, 1 nack on an address or written byte, 2 address, 3 timeout
+        trig_address : in  std_logic_vector(6 downto 0);
+        post_count   : in  std_logic_vector(7 downto 0);
+        prescale     : in  std_logic_vector(3 downto 0);
+        rd_en        : in  std_logic;
+        rd_data      : out std_logic_vector(31 downto 0);  -- oldest entry, 0 when empty
+        level        : out std_logic_vector(15 downto 0);
+        recording    : out std_logic;
+        triggered    : out std_logic;
+        stopped      : out std_logic;
+        wrapped      : out std_logic;
+
+        -- master
+        state_code   : in  std_logic_vector(3 downto 0);
+        timeout      : in  std_logic;
+
+        -- bus lines
+        scl          : in  std_logic;
+        sda          : in  std_logic
+    );
+end entity;
+
+architecture rtl of i2c_trace is
+
+    constant C_STATE   : std_logic_vector(2 downto 0) := "000";
+    constant C_START   : std_logic_vector(2 downto 0) := "001";
+    constant C_STOP    : std_logic_vector(2 downto 0) := "010";
+    constant C_BYTE    : std_logic_vector(2 downto 0) := "011";
+    constant C_TIMEOUT : std_logic_vector(2 downto 0) := "100";
+
+    constant C_DELTA_MAX : unsigned(18 downto 0) := (others => '1');
+
+    type mem_type is array (0 to DEPTH - 1) of std_logic_vector(31 downto 0);
+    signal mem               : mem_type;
+
+    signal wr_ptr            : integer range 0 to DEPTH - 1;
+    signal rd_ptr            : integer range 0 to DEPTH - 1;
+    signal count             : integer range 0 to DEPTH;
+    signal do_write, do_read : std_logic;
+
+    -- bus decoder on the synchronized lines
+    signal scl_sync, sda_sync : std_logic_vector(1 downto 0);
+    signal scl_prev, sda_prev : std_logic;
+    signal bus_busy          : std_logic;
+    signal bit_count         : integer range 0 to 8;
+    signal shift_reg         : std_logic_vector(7 downto 0);
+    signal first_byte        : std_logic;   -- the next byte is the address
+    signal reading           : std_logic;   -- read transfer, the acks come from the master
+
+    -- events waiting to be written, bus events go first
+    signal bus_pending       : std_logic;
+    signal bus_type          : std_logic_vector(2 downto 0);
+    signal bus_payload       : std_logic_vector(8 downto 0);
+    signal bus_trigger       : std_logic;
+    signal timeout_pending   : std_logic;
+    signal state_pending     : std_logic;
+    signal state_prev        : std_logic_vector(3 downto 0);
+    signal timeout_prev      : std_logic;
+
+    signal entry             : std_logic_vector(31 downto 0);
+    signal entry_valid       : std_logic;
+    signal trace_idle        : std_logic;
+
+    -- time stamps
+    signal tick_count        : unsigned(15 downto 0);
+    signal tick              : std_logic;
+    signal delta             : unsigned(18 downto 0);
+
+    signal triggered_internal : std_logic;
+    signal stopped_internal   : std_logic;
+    signal wrapped_internal   : std_logic;
+    signal post_remaining     : unsigned(7 downto 0);
+
+begin
+
+    -- bus lines, synchronized
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                scl_sync <= "11";
+                sda_sync <= "11";
+            else
+                scl_sync <= scl_sync(0) & to_x01(scl);
+                sda_sync <= sda_sync(0) & to_x01(sda);
+            end if;
+        end if;
+    end process;
+
+    -- bus decoder: start and stop are sda edges while scl is high, bits are taken on the rising scl edge
+    process(clk)
+        variable byte_v : std_logic_vector(7 downto 0);
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                scl_prev    <= '1';
+                sda_prev    <= '1';
+                bus_busy    <= '0';
+                bit_count   <= 0;
+                shift_reg   <= (others => '0');
+                first_byte  <= '0';
+                reading     <= '0';
+                bus_pending <= '0';
+                bus_type    <= C_STATE;
+                bus_payload <= (others => '0');
+                bus_trigger <= '0';
+            else
+                scl_prev <= scl_sync(1);
+                sda_prev <= sda_sync(1);
+
+                if (entry_valid = '1' or trace_idle = '1') then
+                    bus_pending <= '0';
+                end if;
+
+                if (scl_sync(1) = '1' and scl_prev = '1' and sda_prev = '1' and sda_sync(1) = '0') then
+                    bus_pending <= '1';
+                    bus_type    <= C_START;
+                    bus_payload <= (0 => bus_busy, others => '0');
+                    bus_trigger <= '0';
+                    bus_busy    <= '1';
+                    bit_count   <= 0;
+                    first_byte  <= '1';
+
+                elsif (scl_sync(1) = '1' and scl_prev = '1' and sda_prev = '0' and sda_sync(1) = '1') then
+                    bus_pending <= '1';
+                    bus_type    <= C_STOP;
+                    bus_payload <= (others => '0');
+                    bus_trigger <= '0';
+                    bus_busy    <= '0';
+
+                elsif (scl_prev = '0' and scl_sync(1) = '1' and bus_busy = '1') then
+                    if (bit_count = 8) then
+                        -- ack bit
+                        byte_v      := shift_reg;
+                        bus_pending <= '1';
+                        bus_type    <= C_BYTE;
+                        bus_payload <= sda_sync(1) & byte_v;
+                        bus_trigger <= '0';
+                        if (trigger = "01" and sda_sync(1) = '1' and (first_byte = '1' or reading = '0')) then
+                            bus_trigger <= '1';
+                        elsif (trigger = "10" and first_byte = '1' and byte_v(7 downto 1) = trig_address) then
+                            bus_trigger <= '1';
+                        end if;
+                        if (first_byte = '1') then
+                            reading <= byte_v(0);
+                        end if;
+                        first_byte <= '0';
+                        bit_count  <= 0;
+                    else
+                        shift_reg <= shift_reg(6 downto 0) & sda_sync(1);
+                        bit_count <= bit_count + 1;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    -- master events
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1') then
+                state_prev      <= (others => '0');
+                timeout_prev    <= '0';
+                state_pending   <= '0';
+                timeout_pending <= '0';
+            else
+                state_prev   <= state_code;
+                timeout_prev <= timeout;
+
+                -- a state change waiting behind a bus event is replaced by the next one
+                if (states = '1' and state_code /= state_prev) then
+                    state_pending <= '1';
+                elsif ((entry_valid = '1' and bus_pending = '0' and timeout_pending = '0') or trace_idle = '1') then
+                    state_pending <= '0';
+                end if;
+
+                if (timeout = '1' and timeout_prev = '0') then
+                    timeout_pending <= '1';
+                elsif ((entry_valid = '1' and bus_pending = '0') or trace_idle = '1') then
+                    timeout_pending <= '0';
+                end if;
+            end if;
+        end if;
+    end process;
+
+    -- next entry, events that come while the trace does not record are dropped
+    trace_idle <= not enable or stopped_internal;
+
+    process(bus_pending, bus_type, bus_payload, bus_trigger, timeout_pending, state_pending, state_prev,
+            trigger, delta, trace_idle)
+        variable trig_v : std_logic;
+    begin
+        trig_v := '0';
+        if (bus_pending = '1') then
+            entry  <= bus_type & bus_trigger & bus_payload & std_logic_vector(delta);
+        elsif (timeout_pending = '1') then
+            if (trigger = "11") then
+                trig_v := '1';
+            end if;
+            entry  <= C_TIMEOUT & trig_v & "000000000" & std_logic_vector(delta);
+        else
+            entry  <= C_STATE & '0' & "00000" & state_prev & std_logic_vector(delta);
+        end if;
+        entry_valid <= (bus_pending or timeout_pending or state_pending) and not trace_idle;
+    end process;
+
+    -- time since the last entry
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1' or clear = '1') then
+                tick_count <= (others => '0');
+                tick       <= '0';
+                delta      <= (others => '0');
+            else
+                tick <= '0';
+                if (tick_count >= shift_left(to_unsigned(1, 16), to_integer(unsigned(prescale))) - 1) then
+                    tick_count <= (others => '0');
+                    tick       <= '1';
+                else
+                    tick_count <= tick_count + 1;
+                end if;
+
+                if (entry_valid = '1') then
+                    delta <= (others => '0');
+                elsif (tick = '1' and delta /= C_DELTA_MAX) then
+                    delta <= delta + 1;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    -- ring buffer, a full buffer drops its oldest entry
+    do_write <= entry_valid;
+    do_read  <= '1' when (rd_en = '1' and count > 0) else '0';
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (do_write = '1') then
+                mem(wr_ptr) <= entry;
+            end if;
+        end if;
+    end process;
+
+    process(clk)
+    begin
+        if rising_edge(clk) then
+            if (reset = '1' or clear = '1') then
+                wr_ptr             <= 0;
+                rd_ptr             <= 0;
+                count              <= 0;
+                triggered_internal <= '0';
+                stopped_internal   <= '0';
+                wrapped_internal   <= '0';
+                post_remaining     <= (others => '0');
+            else
+                if (do_write = '1') then
+                    wr_ptr <= (wr_ptr + 1) mod DEPTH;
+                end if;
+
+                if (do_write = '1' and count = DEPTH) then
+                    rd_ptr <= (rd_ptr + 1) mod DEPTH;
+                    if (do_read = '0') then
+                        wrapped_internal <= '1';
+                    end if;
+                elsif (do_read = '1') then
+                    rd_ptr <= (rd_ptr + 1) mod DEPTH;
+                    if (do_write = '0') then
+                        count <= count - 1;
+                    end if;
+                elsif (do_write = '1') then
+                    count <= count + 1;
+                end if;
+
+                -- post trigger entries
+                if (do_write = '1') then
+                    if (triggered_internal = '0' and entry(28) = '1') then
+                        triggered_internal <= '1';
+                        post_remaining     <= unsigned(post_count);
+                        if (unsigned(post_count) = 0) then
+                            stopped_internal <= '1';
+                        end if;
+                    elsif (triggered_internal = '1') then
+                        post_remaining <= post_remaining - 1;
+                        if (post_remaining = 1) then
+                            stopped_internal <= '1';
+                        end if;
+                    end if;
+                end if;
+            end if;
+        end if;
+    end process;
+
+    rd_data   <= mem(rd_ptr) when count > 0 else (others => '0');
+    level     <= std_logic_vector(to_unsigned(count, 16));
+    recording <= not trace_idle;
+    triggered <= triggered_internal;
+    stopped   <= stopped_internal;
+    wrapped   <= wrapped_internal;
+
+end architecture;
@@ -0,0 +1,123 @@
+library ieee;
+use     ieee.std_logic_1164.all;
+
+library work;
+use     work.i2c_sim_pkg.all;
+
+-- Simulation only: watches scl and sda and keeps the figures of t_i2c_bus_stats
+-- from the last clear on. A byte is counted on the falling scl edge of its ack bit.
+
+entity i2c_bus_monitor is
+    port
+    (
+        scl   : in  std_logic;
+        sda   : in  std_logic;
+        clear : in  std_logic;
+        stats : out t_i2c_bus_stats
+    );
+end entity;
+
+architecture behav of i2c_bus_monitor is
+begin
+
+    process
+        variable s           : t_i2c_bus_stats := C_I2C_BUS_STATS_CLEAR;
+        variable scl_v       : std_logic := '1';
+        variable sda_v       : std_logic := '1';
+        variable busy        : boolean := false;
+        variable started     : boolean := false;   -- a start since the last clear
+        variable first_fall  : boolean := false;   -- start given, scl not low yet
+        variable bit_count   : natural := 0;
+        variable byte_count  : natural := 0;       -- bytes since the last (repeated) start
+        variable t_edge      : time := 0 ns;       -- last scl edge
+        variable t_start     : time := 0 ns;
+        variable t_stop      : time := 0 ns;
+        variable t_byte_end  : time := 0 ns;
+        variable gap_pending : boolean := false;
+        variable gap         : time := 0 ns;
+    begin
+        wait on scl, sda, clear;
+
+        if (clear = '1') then
+            s       := C_I2C_BUS_STATS_CLEAR;
+            started := false;
+
+        else
+            if (to_x01(scl) /= scl_v) then
+                scl_v := to_x01(scl);
+                if (busy and scl_v = '1') then
+                    s.scl_low := s.scl_low + (now - t_edge);
+                    -- the low phase after an ack is a byte gap unless a repeated start or a stop follows
+                    if (bit_count = 0 and byte_count > 0) then
+                        gap_pending := true;
+                        gap         := now - t_byte_end;
+                    elsif (not first_fall) then
+                        s.bit_lows := s.bit_lows + 1;
+                        s.bit_low  := s.bit_low + (now - t_edge);
+                    end if;
+                elsif (busy and scl_v = '0') then
+                    if (first_fall) then
+                        first_fall   := false;
+                        s.start_stop := s.start_stop + (now - t_start);
+                    else
+                        s.scl_high := s.scl_high + (now - t_edge);
+                        if (gap_pending) then
+                            gap_pending := false;
+                            s.byte_gaps := s.byte_gaps + 1;
+                            s.byte_gap  := s.byte_gap + gap;
+                            if (gap > s.byte_gap_max) then
+                                s.byte_gap_max := gap;
+                            end if;
+                        end if;
+                        bit_count := bit_count + 1;
+                        if (bit_count = 9) then
+                            bit_count  := 0;
+                            t_byte_end := now;
+                            if (byte_count = 0) then
+                                s.addr_bytes := s.addr_bytes + 1;
+                            else
+                                s.data_bytes := s.data_bytes + 1;
+                            end if;
+                            byte_count := byte_count + 1;
+                        end if;
+                    end if;
+                end if;
+                t_edge := now;
+            end if;
+
+            if (to_x01(sda) /= sda_v) then
+                sda_v := to_x01(sda);
+                if (scl_v = '1' and sda_v = '0') then
+                    -- start or repeated start
+                    if (busy) then
+                        s.restarts := s.restarts + 1;
+                    else
+                        if (started) then
+                            s.bus_free := s.bus_free + (now - t_stop);
+                        else
+                            s.first_start := now;
+                        end if;
+                        s.transactions := s.transactions + 1;
+                    end if;
+                    busy        := true;
+                    started     := true;
+                    first_fall  := true;
+                    gap_pending := false;
+                    bit_count   := 0;
+                    byte_count  := 0;
+                    t_start     := now;
+                elsif (scl_v = '1' and sda_v = '1' and busy) then
+                    -- stop
+                    busy         := false;
+                    gap_pending  := false;
+                    s.start_stop := s.start_stop + (now - t_edge);
+                    s.last_stop  := now;
+                    t_stop       := now;
+                end if;
+            end if;
+        end if;
+
+        stats <= s;
+    end process;
+
+end architecture;
@@ -0,0 +1,114 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+
+-- Simulation only: bus figures gathered by i2c_bus_monitor and the line the
+-- throughput bench prints for every scenario (collected by Sim/Makefile).
+
+package i2c_sim_pkg is
+
+    type t_i2c_bus_stats is record
+        transactions : natural;   -- starts after a stop
+        restarts     : natural;   -- repeated starts
+        addr_bytes   : natural;   -- address bytes, first byte after every start
+        data_bytes   : natural;
+        first_start  : time;      -- window of the figures, first start to last stop
+        last_stop    : time;
+        scl_high     : time;      -- scl high and low while the bus is busy
+        scl_low      : time;
+        bit_lows     : natural;   -- scl low phases inside a byte
+        bit_low      : time;
+        byte_gaps    : natural;   -- scl low phases between two bytes
+        byte_gap     : time;
+        byte_gap_max : time;
+        start_stop   : time;      -- start to the first scl low plus the last scl high to stop
+        bus_free     : time;      -- stop to the next start
+    end record;
+
+    constant C_I2C_BUS_STATS_CLEAR : t_i2c_bus_stats := (
+        transactions => 0,
+        restarts     => 0,
+        addr_bytes   => 0,
+        data_bytes   => 0,
+        first_start  => 0 ns,
+        last_stop    => 0 ns,
+        scl_high     => 0 ns,
+        scl_low      => 0 ns,
+        bit_lows     => 0,
+        bit_low      => 0 ns,
+        byte_gaps    => 0,
+        byte_gap     => 0 ns,
+        byte_gap_max => 0 ns,
+        start_stop   => 0 ns,
+        bus_free     => 0 ns);
+
+    -- PERF <scenario> bytes=.. time_ns=.. bytes_per_s=.. scl_duty=.. gap_ns=.. gap_max_ns=.. start_stop_ns=.. free_ns=..
+    --   gap_ns        mean scl low between two bytes beyond the low phase of a bit
+    --   start_stop_ns start and stop time per transaction (repeated starts count as transactions)
+    --   free_ns       mean bus free time between transactions
+    procedure report_bus_stats(
+        constant scenario : in string;
+        constant s        : in t_i2c_bus_stats);
+
+end package;
+
+package body i2c_sim_pkg is
+
+    function to_ns(t : time) return natural is
+    begin
+        return t / 1 ns;
+    end function;
+
+    procedure report_bus_stats(
+        constant scenario : in string;
+        constant s        : in t_i2c_bus_stats) is
+        variable l          : line;
+        variable window     : time;
+        variable trans      : natural;
+        variable bit_low    : time := 0 ns;
+        variable gap        : time := 0 ns;
+        variable duty       : natural := 0;
+        variable per_s      : natural := 0;
+    begin
+        window := s.last_stop - s.first_start;
+        trans  := s.transactions + s.restarts;
+        if (s.bit_lows > 0) then
+            bit_low := s.bit_low / s.bit_lows;
+        end if;
+        if (s.byte_gaps > 0 and s.byte_gap / s.byte_gaps > bit_low) then
+            gap := s.byte_gap / s.byte_gaps - bit_low;
+        end if;
+        if (s.scl_high + s.scl_low > 0 ns) then
+            duty := integer(100.0 * real(to_ns(s.scl_high)) / real(to_ns(s.scl_high + s.scl_low)));
+        end if;
+        if (window > 0 ns) then
+            per_s := integer(real(s.data_bytes) * 1.0e9 / real(to_ns(window)));
+        end if;
+
+        write(l, string'("PERF ") & scenario);
+        write(l, string'(" bytes=") & integer'image(s.data_bytes));
+        write(l, string'(" time_ns=") & integer'image(to_ns(window)));
+        write(l, string'(" bytes_per_s=") & integer'image(per_s));
+        write(l, string'(" scl_duty=") & integer'image(duty));
+        write(l, string'(" gap_ns=") & integer'image(to_ns(gap)));
+        if (gap > 0 ns) then
+            write(l, string'(" gap_max_ns=") & integer'image(to_ns(s.byte_gap_max - bit_low)));
+        else
+            write(l, string'(" gap_max_ns=0"));
+        end if;
+        if (trans > 0) then
+            write(l, string'(" start_stop_ns=") & integer'image(to_ns(s.start_stop) / trans));
+        else
+            write(l, string'(" start_stop_ns=0"));
+        end if;
+        if (s.transactions > 1) then
+            write(l, string'(" free_ns=") & integer'image(to_ns(s.bus_free) / (s.transactions - 1)));
+        else
+            write(l, string'(" free_ns=0"));
+        end if;
+        writeline(output, l);
+    end procedure;
+
+end package body;
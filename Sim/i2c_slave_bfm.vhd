@@ -0,0 +1,156 @@
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+-- Simulation only: i2c slave with 256 byte registers, register n holds n after the start.
+-- A write sets the register pointer with its first byte and stores the following bytes
+-- from the pointer on, a read returns the registers from the pointer on until the master
+-- nacks. Both wrap at 255. Other addresses are not acked.
+--
+-- STRETCH_TIME > 0 holds scl low for that time after every ack.
+
+entity i2c_slave_bfm is
+    generic
+    (
+        ADDRESS      : std_logic_vector(6 downto 0) := "1101000";
+        STRETCH_TIME : time := 0 ns
+    );
+    port
+    (
+        scl : inout std_logic;
+        sda : inout std_logic
+    );
+end entity;
+
+architecture behav of i2c_slave_bfm is
+
+    type mem_type is array (0 to 255) of std_logic_vector(7 downto 0);
+
+    function mem_init return mem_type is
+        variable m : mem_type;
+    begin
+        for i in m'range loop
+            m(i) := std_logic_vector(to_unsigned(i, 8));
+        end loop;
+        return m;
+    end function;
+
+    type cond_type is (none, start_cond, stop_cond);
+
+begin
+
+    process
+        variable mem     : mem_type := mem_init;
+        variable pointer : natural range 0 to 255 := 0;
+        variable byte_v  : std_logic_vector(7 downto 0);
+        variable bit_v   : std_logic;
+        variable cond    : cond_type;
+        variable first   : boolean;
+
+        -- one bit from the master, returns after the falling scl edge
+        -- or on a start or stop while scl is high
+        procedure get_bit(variable b : out std_logic; variable c : out cond_type) is
+            variable v : std_logic;
+        begin
+            c := none;
+            wait until to_x01(scl) = '1';
+            v := to_x01(sda);
+            b := v;
+            wait on scl, sda until to_x01(scl) = '0' or to_x01(sda) /= v;
+            if (to_x01(scl) = '1') then
+                if (v = '0') then
+                    c := stop_cond;
+                else
+                    c := start_cond;
+                end if;
+            end if;
+        end procedure;
+
+        procedure get_byte(variable d : out std_logic_vector(7 downto 0); variable c : out cond_type) is
+            variable b : std_logic;
+        begin
+            for i in 7 downto 0 loop
+                get_bit(b, c);
+                d(i) := b;
+                exit when c /= none;
+            end loop;
+        end procedure;
+
+        -- ack clock, scl is low on entry and on return
+        procedure ack is
+        begin
+            sda <= '0';
+            wait until to_x01(scl) = '1';
+            wait until to_x01(scl) = '0';
+            sda <= 'Z';
+            if (STRETCH_TIME > 0 ns) then
+                scl <= '0';
+                wait for STRETCH_TIME;
+                scl <= 'Z';
+            end if;
+        end procedure;
+
+    begin
+        sda <= 'Z';
+        scl <= 'Z';
+
+        -- start
+        wait on sda until to_x01(sda) = '0' and to_x01(scl) = '1';
+
+        transaction : loop
+            get_byte(byte_v, cond);
+            exit transaction when cond = stop_cond;
+            next transaction when cond = start_cond;
+            exit transaction when byte_v(7 downto 1) /= ADDRESS;
+            ack;
+
+            if (byte_v(0) = '0') then
+                -- write, register pointer first
+                first := true;
+                loop
+                    get_byte(byte_v, cond);
+                    exit when cond /= none;
+                    if (first) then
+                        pointer := to_integer(unsigned(byte_v));
+                        first   := false;
+                    else
+                        mem(pointer) := byte_v;
+                        pointer      := (pointer + 1) mod 256;
+                    end if;
+                    ack;
+                end loop;
+                exit transaction when cond = stop_cond;
+
+            else
+                -- read until the master nacks
+                loop
+                    byte_v  := mem(pointer);
+                    pointer := (pointer + 1) mod 256;
+                    for i in 7 downto 0 loop
+                        if (byte_v(i) = '0') then
+                            sda <= '0';
+                        else
+                            sda <= 'Z';
+                        end if;
+                        wait until to_x01(scl) = '1';
+                        wait until to_x01(scl) = '0';
+                    end loop;
+                    sda <= 'Z';
+                    get_bit(bit_v, cond);
+                    exit when cond /= none or bit_v = '1';
+                    if (STRETCH_TIME > 0 ns) then
+                        scl <= '0';
+                        wait for STRETCH_TIME;
+                        scl <= 'Z';
+                    end if;
+                end loop;
+                -- nack, the master gives a stop or a repeated start next
+                if (cond = none) then
+                    get_bit(bit_v, cond);
+                end if;
+                exit transaction when cond /= start_cond;
+            end if;
+        end loop;
+    end process;
+
+end architecture;
@@ -0,0 +1,31 @@
+# bytes/s of every scenario in perf.txt against perf_baseline.txt (make check)
+# fails when a scenario is more than tol percent slower than its baseline
+
+{
+    split("", f)
+    for (i = 3; i <= NF; i++) {
+        split($i, kv, "=")
+        f[kv[1]] = kv[2]
+    }
+}
+
+FNR == NR {
+    base[$2] = f["bytes_per_s"]
+    next
+}
+
+{
+    if (!($2 in base) || base[$2] == 0) {
+        printf "  %-16s %8d bytes/s  no baseline\n", $2, f["bytes_per_s"]
+        next
+    }
+    d = 100.0 * (f["bytes_per_s"] - base[$2]) / base[$2]
+    slow = d < -tol
+    failed += slow
+    printf "  %-16s %8d bytes/s  %+6.1f%%  scl duty %3d%%  gap %6d ns  start/stop %6d ns%s\n",
+           $2, f["bytes_per_s"], d, f["scl_duty"], f["gap_ns"], f["start_stop_ns"], slow ? "  SLOWER" : ""
+}
+
+END {
+    exit failed != 0
+}
@@ -0,0 +1,178 @@
+#include "i2c_sched.h"
+
+// Pending requests, sorted by priority, submit order within a priority
+static struct i2c_request *queue = NULL;
+static int coalesce = 0;
+
+// The transaction on the bus and the requests it serves
+static struct {
+    int running;
+    struct i2c_async xfer;
+    struct i2c_msg msgs[2];
+    struct i2c_request *members[I2C_SCHED_MAX_BATCH];
+    int count;
+    byte lo;                                // first register of the transaction
+    byte data[1 + I2C_SCHED_MAX_BURST];     // register pointer and data
+} batch;
+
+static struct i2c_sched_stats stats;
+
+static void sched_complete(struct i2c_async *xfer);
+
+static void enqueue(struct i2c_request *req) {
+    struct i2c_request **p = &queue;
+    while (*p != NULL && (*p)->priority <= req->priority) {
+        p = &(*p)->next;
+    }
+    req->next = *p;
+    *p = req;
+}
+
+// Reads queued behind the first one that can share its transaction. The search
+// stops at a write to the same slave, no read is moved in front of it.
+static void collect_reads(struct i2c_request *first, int *lo, int *hi) {
+    struct i2c_request **p = &queue;
+    struct i2c_request *r;
+    int nlo, nhi;
+
+    while (*p != NULL && batch.count < I2C_SCHED_MAX_BATCH) {
+        r = *p;
+        if (r->addr == first->addr && !(r->flags & I2C_REQ_READ)) {
+            break;
+        }
+        if (r->addr == first->addr && !(r->flags & I2C_REQ_NO_MERGE)) {
+            nlo = r->reg < *lo ? r->reg : *lo;
+            nhi = r->reg + r->len > *hi ? r->reg + r->len : *hi;
+            if (r->reg <= *hi && r->reg + r->len >= *lo && nhi - nlo <= I2C_SCHED_MAX_BURST) {
+                *p = r->next;
+                batch.members[batch.count++] = r;
+                *lo = nlo;
+                *hi = nhi;
+                continue;
+            }
+        }
+        p = &r->next;
+    }
+}
+
+// Start the next transaction, called with the lock held and the bus free
+static void dispatch(void) {
+    struct i2c_request *first = queue;
+    int lo, hi, i, num;
+
+    if (first == NULL) {
+        return;
+    }
+    queue = first->next;
+    batch.members[0] = first;
+    batch.count = 1;
+    lo = first->reg;
+    hi = first->reg + first->len;
+
+    if (first->flags & I2C_REQ_READ) {
+        if (coalesce && !(first->flags & I2C_REQ_NO_MERGE)) {
+            collect_reads(first, &lo, &hi);
+        }
+        // pointer write, repeated START, read
+        batch.data[0] = lo;
+        batch.msgs[0].addr = first->addr;
+        batch.msgs[0].flags = 0;
+        batch.msgs[0].len = 1;
+        batch.msgs[0].buf = batch.data;
+        batch.msgs[1].addr = first->addr;
+        batch.msgs[1].flags = I2C_M_RD;
+        batch.msgs[1].len = hi - lo;
+        batch.msgs[1].buf = batch.data + 1;
+        num = 2;
+    } else {
+        batch.data[0] = lo;
+        for (i = 0; i < first->len; i++) {
+            batch.data[1 + i] = first->buf[i];
+        }
+        batch.msgs[0].addr = first->addr;
+        batch.msgs[0].flags = 0;
+        batch.msgs[0].len = 1 + first->len;
+        batch.msgs[0].buf = batch.data;
+        num = 1;
+    }
+    batch.lo = lo;
+    batch.running = 1;
+    stats.transactions++;
+    stats.merged += batch.count - 1;
+    stats.bytes += hi - lo;
+
+    if (i2c_submit(i2c_get_channel(I2C_SCHED_CHANNEL), &batch.xfer, batch.msgs, num, sched_complete, NULL) != 0) {
+        batch.xfer.status = -1;
+        sched_complete(&batch.xfer);
+    }
+}
+
+// Transaction finished (ISR or i2c_poll): hand out the data, start the next
+// transaction, then run the callbacks outside the lock
+static void sched_complete(struct i2c_async *xfer) {
+    struct i2c_request *done[I2C_SCHED_MAX_BATCH];
+    struct i2c_request *r;
+    int count, i, j;
+    I2C_SCHED_LOCK_DECL;
+
+    I2C_SCHED_LOCK();
+    count = batch.count;
+    for (i = 0; i < count; i++) {
+        r = batch.members[i];
+        if (xfer->status < 0) {
+            r->status = -1;
+        } else {
+            if (r->flags & I2C_REQ_READ) {
+                for (j = 0; j < r->len; j++) {
+                    r->buf[j] = batch.data[1 + r->reg - batch.lo + j];
+                }
+            }
+            r->status = r->len;
+        }
+        done[i] = r;
+    }
+    batch.running = 0;
+    batch.count = 0;
+    dispatch();
+    I2C_SCHED_UNLOCK();
+
+    for (i = 0; i < count; i++) {
+        if (done[i]->complete != NULL) {
+            done[i]->complete(done[i]);
+        }
+    }
+}
+
+int i2c_sched_submit(struct i2c_request *req) {
+    I2C_SCHED_LOCK_DECL;
+
+    if (req->len < 1 || req->len > I2C_SCHED_MAX_BURST || req->reg + req->len > 0x100) {
+        return -1;
+    }
+    req->status = I2C_ASYNC_BUSY;
+
+    I2C_SCHED_LOCK();
+    stats.requests++;
+    enqueue(req);
+    if (!batch.running) {
+        dispatch();
+    }
+    I2C_SCHED_UNLOCK();
+    return 0;
+}
+
+int i2c_sched_wait(struct i2c_request *req) {
+    while (req->status == I2C_ASYNC_BUSY) {
+        i2c_poll(i2c_get_channel(I2C_SCHED_CHANNEL));
+        I2C_IDLE_HOOK();
+    }
+    return req->status;
+}
+
+void i2c_sched_coalesce(int on) {
+    coalesce = on;
+}
+
+const struct i2c_sched_stats *i2c_sched_get_stats(void) {
+    return &stats;
+}
@@ -0,0 +1,69 @@
+/* i2c_sched.h */
+#ifndef I2C_SCHED_H
+#define I2C_SCHED_H
+
+#include "rtc_driver.h"
+
+// Transaction queue in front of i2c_submit() for several clients sharing one
+// channel of the controller. Requests are register reads and writes, served by
+// priority and in submit order within a priority. Once the scheduler is used,
+// clients must not call i2c_transfer()/i2c_submit() on that channel directly.
+
+// Channel the scheduler runs on
+#ifndef I2C_SCHED_CHANNEL
+#define I2C_SCHED_CHANNEL     0
+#endif
+
+#define I2C_SCHED_MAX_BURST   32    // bytes of one request or coalesced read
+#define I2C_SCHED_MAX_BATCH   8     // requests served by one coalesced read
+
+// Critical section around the queue, requests complete in the ISR. The default
+// disables the interrupts with the HAL; under uC/OS-II define both before
+// including this header as OS_ENTER_CRITICAL()/OS_EXIT_CRITICAL() (OS_CPU_SR cpu_sr
+// declared by I2C_SCHED_LOCK_DECL).
+#ifndef I2C_SCHED_LOCK
+#define I2C_SCHED_LOCK_DECL   alt_irq_context i2c_sched_irq_ctx
+#define I2C_SCHED_LOCK()      (i2c_sched_irq_ctx = alt_irq_disable_all())
+#define I2C_SCHED_UNLOCK()    alt_irq_enable_all(i2c_sched_irq_ctx)
+#endif
+
+// Request flags
+#define I2C_REQ_READ      0x01
+#define I2C_REQ_NO_MERGE  0x02  // registers with read side effects, never coalesced
+
+struct i2c_request {
+    // set by the client
+    byte addr;              // 7 bit slave address
+    byte reg;               // first register
+    byte flags;
+    byte priority;          // 0 is the highest
+    int len;                // 1 to I2C_SCHED_MAX_BURST
+    byte *buf;
+    void (*complete)(struct i2c_request *req);  // called after the request finished, may be NULL
+    void *context;
+    volatile int status;    // I2C_ASYNC_BUSY, then len or -1 on a NACK
+
+    struct i2c_request *next;   // scheduler queue
+};
+
+struct i2c_sched_stats {
+    unsigned long requests;
+    unsigned long transactions;     // bus transactions issued
+    unsigned long merged;           // requests served by the read of another request
+    unsigned long bytes;            // data bytes read or written, register pointers excluded
+};
+
+// Queue the request, the bus is started when it is free.
+// Returns 0, or -1 for an invalid length
+int i2c_sched_submit(struct i2c_request *req);
+
+// Block until the request finished, returns req->status
+int i2c_sched_wait(struct i2c_request *req);
+
+// Merge reads of adjacent or overlapping registers of the same slave that are
+// queued when the bus becomes free (off after reset)
+void i2c_sched_coalesce(int on);
+
+const struct i2c_sched_stats *i2c_sched_get_stats(void);
+
+#endif // I2C_SCHED_H
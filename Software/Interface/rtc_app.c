@@ -1,17 +1,136 @@
-#include "rtc_driver.h"
-#include "rtc_driver.c"
-
-
-int main(void) {
-    byte s,m,h,wd,d,mo,yr;
-    float temp;
-
-    set_rtc_time(0,0,12,3,1,1,25);
-    get_rtc_time(&s,&m,&h,&wd,&d,&mo,&yr);
-    temp = get_rtc_temp();
-
-    printf("Time: %02d:%02d:%02d\n", h,m,s);
-    printf("Date: %02d/%02d/20%02d\n", d,mo,yr);
-    printf("Temp: %.2f°C\n", temp);
-    return 0;
-}
+#include "rtc_driver.h"
+#include "rtc_driver.c"
+#include <string.h>
+
+
+// Time and temperature sweep run by the command sequencer: register pointer, seconds
+// to year, register pointer, temperature, each read after a repeated start
+static I2C_SEQ_MEM struct i2c_desc sweep[4];
+static I2C_SEQ_MEM byte sweep_regs[2][4] = { { REG_SECONDS }, { REG_TEMP_HIGH } };
+static I2C_SEQ_MEM byte sweep_time[8];
+static I2C_SEQ_MEM byte sweep_temp[4];
+
+// Stand-in for the control loop work done while the RTC is read
+static unsigned long control_steps = 0;
+
+static void control_step(void) {
+    control_steps++;
+    I2C_IDLE_HOOK();
+}
+
+int main(void) {
+    byte s,m,h,wd,d,mo,yr;
+    float temp;
+    struct rtc_request req;
+    struct i2c_perf perf;
+    struct i2c_channel *bus = i2c_get_channel(0);
+
+    if (i2c_enable_interrupts(bus) != 0) {
+        printf("I2C interrupt not available, polling status\n");
+    }
+    i2c_set_device_speed(bus, RTC_ADDRESS, RTC_BUS_SPEED);
+    i2c_perf_read(bus, &perf, 1);
+
+    printf("Blocking calls end within %lu us\n", i2c_transfer_bound_us());
+    if (set_rtc_time(0,0,12,3,1,1,25) != 0 ||
+        get_rtc_time(&s,&m,&h,&wd,&d,&mo,&yr) != 0 ||
+        get_rtc_temp_checked(&temp) != 0) {
+        printf("RTC not answering\n");
+        return 1;
+    }
+
+    printf("Time: %02d:%02d:%02d\n", h,m,s);
+    printf("Date: %02d/%02d/20%02d\n", d,mo,yr);
+    printf("Temp: %.2f°C\n", temp);
+
+    // Non-blocking read, the loop keeps running until the time arrived
+    if (get_rtc_time_async(&req, NULL, NULL) == 0) {
+        while (!i2c_async_done(&req.xfer)) {
+            control_step();
+            i2c_poll(bus);
+        }
+        rtc_decode_time(&req, &s,&m,&h,&wd,&d,&mo,&yr);
+        printf("Time: %02d:%02d:%02d after %lu control steps\n", h,m,s, control_steps);
+    }
+
+    // Both reads after one register write, one interrupt at the end of the list
+    i2c_desc_set(&sweep[0], RTC_ADDRESS, 0, sweep_regs[0], 1, &sweep[1]);
+    i2c_desc_set(&sweep[1], RTC_ADDRESS, I2C_DESC_READ | I2C_DESC_STOP, sweep_time, 7, &sweep[2]);
+    i2c_desc_set(&sweep[2], RTC_ADDRESS, 0, sweep_regs[1], 1, &sweep[3]);
+    i2c_desc_set(&sweep[3], RTC_ADDRESS, I2C_DESC_READ, sweep_temp, 2, NULL);
+    control_steps = 0;
+    if (i2c_seq_start(bus, sweep) == 0) {
+        while (i2c_seq_busy(bus)) {
+            control_step();
+        }
+        if (i2c_seq_wait(bus) == 0) {
+            memcpy(req.raw, sweep_time, 7);
+            rtc_decode_time(&req, &s,&m,&h,&wd,&d,&mo,&yr);
+            memcpy(req.raw, sweep_temp, 2);
+            printf("Time: %02d:%02d:%02d, Temp: %.2f°C from the sequencer after %lu control steps\n",
+                   h,m,s, rtc_decode_temp(&req), control_steps);
+        } else {
+            printf("Sequencer list failed, status %08X %08X %08X %08X\n",
+                   sweep[0].status, sweep[1].status, sweep[2].status, sweep[3].status);
+        }
+    }
+
+    // Time and temperature kept current by the core, the reads do not touch the bus
+    control_steps = 0;
+    if (i2c_autopoll_start(bus, RTC_ADDRESS, REG_SECONDS, REG_TEMP_LOW + 1, 1) == 0) {
+        byte regs[REG_TEMP_LOW + 1];
+        unsigned int age;
+        while (i2c_autopoll_read(bus, regs, 0, sizeof(regs), &age) < 2) {
+            control_step();
+        }
+        i2c_autopoll_stop(bus);
+        memcpy(req.raw, &regs[REG_SECONDS], 7);
+        rtc_decode_time(&req, &s,&m,&h,&wd,&d,&mo,&yr);
+        memcpy(req.raw, &regs[REG_TEMP_HIGH], 2);
+        printf("Time: %02d:%02d:%02d, Temp: %.2f°C from the poll mirror (%u ms old) after %lu control steps\n",
+               h,m,s, rtc_decode_temp(&req), age, control_steps);
+    }
+
+    // Time asked for on every control step, the bus is read once per minute at most
+    {
+        unsigned long reads = 0, transactions;
+        byte start;
+        i2c_perf_read(bus, &perf, 0);
+        transactions = perf.transactions;
+        get_rtc_time_cached(&s,&m,&h,&wd,&d,&mo,&yr);
+        start = s;
+        while (s < start + 2 && reads < 10000000UL) {
+            control_step();
+            get_rtc_time_cached(&s,&m,&h,&wd,&d,&mo,&yr);
+            reads++;
+        }
+        i2c_perf_read(bus, &perf, 0);
+        printf("Time: %02d:%02d:%02d after %lu cached reads, %lu bus transactions, read %lu ms ago\n",
+               h,m,s, reads, perf.transactions - transactions, rtc_time_age_ms());
+        printf("Temp: %.2f°C cached\n", get_rtc_temp_cached());
+    }
+
+    // Bus trace up to the first NACK: a time read, then a device that is not on the bus
+    {
+        unsigned long entries[64];
+        byte probe;
+        struct i2c_msg msg = { 0x50, I2C_M_RD, 1, &probe };
+        int n;
+        i2c_trace_start(bus, TRACE_TRIGGER_NACK | TRACE_POST(1) | TRACE_PRESCALE(4));
+        get_rtc_time(&s,&m,&h,&wd,&d,&mo,&yr);
+        i2c_transfer(bus, &msg, 1);
+        i2c_trace_stop(bus);
+        n = i2c_trace_read(bus, entries, 64, NULL);
+        printf("Bus trace of a time read and a probe of 0x50, %d entries:\n", n);
+        i2c_trace_print(entries, n, 4);
+    }
+
+    i2c_perf_read(bus, &perf, 0);
+    printf("I2C: %lu transactions, %lu bytes out, %lu bytes in, %lu nacks\n",
+           perf.transactions, perf.tx_bytes, perf.rx_bytes, perf.nacks);
+    if (perf.cycles != 0 && perf.busy_cycles != 0) {
+        printf("I2C: bus busy %lu%% of the time, scl held for the cpu %lu%% of the busy time\n",
+               perf.busy_cycles * 100UL / perf.cycles, perf.stall_cycles * 100UL / perf.busy_cycles);
+    }
+    return 0;
+}
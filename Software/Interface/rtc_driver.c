@@ -1,114 +1,1453 @@
-#include "rtc_driver.h"
-
-// Read the raw status register
-static byte read_status(void) {
-    return IORD_32DIRECT(I2C_0_BASE, STATUS_REGISTER);
-}
-
-// Clear specified status bits (write-1-to-clear)
-static void clear_status_bits(byte bits) {
-    IOWR_32DIRECT(I2C_0_BASE, STATUS_REGISTER, bits);
-}
-
-// Wait until READY or ACK error, then clear error if any
-static void wait_ready(void) {
-    byte status;
-    do {
-        status = read_status();
-    } while (!(status & (READY_BIT | ACKERROR_BIT)));
-    if (status & ACKERROR_BIT) {
-        clear_status_bits(ACKERROR_BIT);
-    }
-}
-
-// Wait until DONE or ACK error, then clear error if any
-static void wait_done(void) {
-    byte status;
-    do {
-        status = read_status();
-    } while (!(status & (DONE_BIT | ACKERROR_BIT)));
-    if (status & ACKERROR_BIT) {
-        clear_status_bits(ACKERROR_BIT);
-    }
-}
-
-// Write a single byte to the given register
-static void write_byte(byte reg, byte data) {
-    // Point to register
-    IOWR_32DIRECT(I2C_0_BASE, CONTROL_REGISTER, 0);
-    IOWR_32DIRECT(I2C_0_BASE, WRITE_REGISTER, (RTC_ADDRESS << 8) | reg);
-    IOWR_32DIRECT(I2C_0_BASE, CONTROL_REGISTER, ENABLE_BIT);
-    wait_ready();
-
-    // Write data and issue STOP
-    IOWR_32DIRECT(I2C_0_BASE, WRITE_REGISTER, (RTC_ADDRESS << 8) | data);
-    IOWR_32DIRECT(I2C_0_BASE, CONTROL_REGISTER, ENABLE_BIT | STOP_BIT);
-    wait_done();
-}
-
-// Read a single byte from the given register
-static byte read_byte(byte reg) {
-    byte result;
-
-    // Point to register
-    IOWR_32DIRECT(I2C_0_BASE, CONTROL_REGISTER, 0);
-    IOWR_32DIRECT(I2C_0_BASE, WRITE_REGISTER, (RTC_ADDRESS << 8) | reg);
-    IOWR_32DIRECT(I2C_0_BASE, CONTROL_REGISTER, ENABLE_BIT);
-    wait_ready();
-
-    // Issue STOP for pointer write
-    IOWR_32DIRECT(I2C_0_BASE, CONTROL_REGISTER, ENABLE_BIT | STOP_BIT);
-    wait_done();
-
-    // Read data byte
-    IOWR_32DIRECT(I2C_0_BASE, CONTROL_REGISTER, ENABLE_BIT | RW_BIT);
-    wait_done();
-    result = IORD_32DIRECT(I2C_0_BASE, READ_REGISTER);
-    return result;
-}
-
-void set_rtc_time(byte second, byte minute, byte hour,
-                  byte week_day, byte day, byte month, byte year) {
-    byte bcd;
-    bcd = ((second / 10) << 4) | (second % 10);
-    write_byte(REG_SECONDS, bcd);
-    bcd = ((minute / 10) << 4) | (minute % 10);
-    write_byte(REG_MINUTES, bcd);
-    bcd = ((hour   / 10) << 4) | (hour   % 10);
-    write_byte(REG_HOURS,   bcd);
-    bcd = ((week_day/ 10) << 4) | (week_day% 10);
-    write_byte(REG_WEEKDAY, bcd);
-    bcd = ((day    / 10) << 4) | (day    % 10);
-    write_byte(REG_DAY,     bcd);
-    bcd = ((month  / 10) << 4) | (month  % 10);
-    write_byte(REG_MONTH,   bcd);
-    bcd = ((year   / 10) << 4) | (year   % 10);
-    write_byte(REG_YEAR,    bcd);
-}
-
-void get_rtc_time(byte *second, byte *minute, byte *hour,
-                  byte *week_day, byte *day, byte *month, byte *year) {
-    byte raw;
-    raw = read_byte(REG_SECONDS);
-    *second   = ((raw >> 4) * 10) + (raw & 0x0F);
-    raw = read_byte(REG_MINUTES);
-    *minute   = ((raw >> 4) * 10) + (raw & 0x0F);
-    raw = read_byte(REG_HOURS);
-    *hour     = ((raw >> 4) * 10) + (raw & 0x0F);
-    raw = read_byte(REG_WEEKDAY);
-    *week_day = ((raw >> 4) * 10) + (raw & 0x0F);
-    raw = read_byte(REG_DAY);
-    *day      = ((raw >> 4) * 10) + (raw & 0x0F);
-    raw = read_byte(REG_MONTH);
-    *month    = ((raw >> 4) * 10) + (raw & 0x0F);
-    raw = read_byte(REG_YEAR);
-    *year     = ((raw >> 4) * 10) + (raw & 0x0F);
-}
-
-float get_rtc_temp(void) {
-    byte hi = read_byte(REG_TEMP_HIGH);
-    byte lo = read_byte(REG_TEMP_LOW);
-    int ti = (hi & 0x80) ? hi - 256 : hi;
-    return ti + (((lo >> 6) & 0x03) * 0.25f);
-}
-
+#include "rtc_driver.h"
+
+// Bus timing per speed in ns: scl low, scl high, tSU;STA, tHD;STA, tSU;STO, tBUF
+// (minimum values from the I2C specification, scl low/high rounded up to the bus period)
+struct i2c_timing {
+    unsigned long hz;
+    unsigned int scl_low, scl_high, su_sta, hd_sta, su_sto, buf;
+};
+
+static const struct i2c_timing timing_table[] = {
+    { I2C_SPEED_STANDARD,  5000, 5000, 4700, 4000, 4000, 4700 },
+    { I2C_SPEED_FAST,      1500, 1000,  600,  600,  600, 1300 },
+    { I2C_SPEED_FAST_PLUS,  550,  450,  260,  260,  260,  500 },
+};
+#define TIMING_COUNT (sizeof(timing_table) / sizeof(timing_table[0]))
+
+// Driver state of one channel, every channel runs its own transfers
+struct i2c_channel {
+    unsigned long base;     // 0 until i2c_get_channel() set the channel up
+
+    // Status events are handled by the ISR while interrupts are in use, by i2c_poll() otherwise
+    int irq_mode;
+
+    // Transfer run by the driver state machine, NULL while the bus is free
+    struct i2c_async *volatile active;
+
+    // Speed per device, index into timing_table
+    struct {
+        byte address;
+        byte timing;
+    } device_speed[I2C_MAX_DEVICES];
+    int device_count;
+
+    // Timing currently programmed into the core, -1 after reset of the driver
+    int current_timing;
+
+    // Command sequencer list running, and the result of the last one
+    volatile int seq_running;
+    int seq_result;
+
+    // FIFO mode of the core and the TX_PACKED byte count, 0 = not written yet
+    int fifo_mode;
+    int pack_count;
+
+#if I2C_DRIVER_TRACE
+    unsigned long polls;    // reads of STATUS_REGISTER
+#endif
+};
+
+static struct i2c_channel channels[I2C_CHANNELS];
+
+// The interrupt line is shared by the channels, the ISR is registered once
+static int isr_registered = 0;
+
+// Error handling, see i2c_set_timeout() and i2c_set_retry()
+static unsigned long timeout_us = I2C_TIMEOUT_US;
+static int retries = I2C_RETRIES;
+static unsigned long backoff_us = I2C_BACKOFF_US;
+#define POLLS_PER_US      10    // bound of the waits without a timestamp timer
+
+// Timestamp timer of the timeouts and the cached RTC time: 1 running, -1 none (or
+// slower than 1 MHz), 0 not started yet
+static int timer_state = 0;
+static unsigned long ticks_per_us;
+
+static int timer_ready(void) {
+    if (timer_state == 0) {
+        timer_state = -1;
+        if (alt_timestamp_start() >= 0 && alt_timestamp_freq() >= 1000000UL) {
+            ticks_per_us = alt_timestamp_freq() / 1000000UL;
+            timer_state = 1;
+        }
+    }
+    return timer_state > 0;
+}
+
+// us since the timestamp, the timer must be running
+static unsigned long timer_us(alt_timestamp_type since) {
+    return (unsigned long)((alt_timestamp_type)(alt_timestamp() - since) / ticks_per_us);
+}
+
+// Bound of a wait, on the timestamp timer or, without one, in polls
+struct deadline {
+    alt_timestamp_type start;
+    unsigned long polls;
+};
+
+static void deadline_start(struct deadline *d) {
+    d->polls = 0;
+    d->start = timer_ready() ? alt_timestamp() : 0;
+}
+
+// 1 once us passed, never for 0
+static int deadline_passed(struct deadline *d, unsigned long us) {
+    if (us == 0) {
+        return 0;
+    }
+    if (timer_state > 0) {
+        return timer_us(d->start) >= us;
+    }
+    return ++d->polls >= us * POLLS_PER_US;
+}
+
+static void delay_us(unsigned long us) {
+    struct deadline d;
+    deadline_start(&d);
+    while (us != 0 && !deadline_passed(&d, us)) {
+        I2C_IDLE_HOOK();
+    }
+}
+
+#if I2C_DRIVER_TRACE
+// Driver tracing, see I2C_DRIVER_TRACE in rtc_driver.h
+static struct i2c_op_stats op_stats[I2C_OP_COUNT];
+static struct i2c_log_event log_ring[I2C_LOG_DEPTH];
+static unsigned long log_head = 0;      // events logged since the clear
+static unsigned long retry_count = 0;
+
+static void log_event(byte type, byte op, unsigned int arg, long value) {
+    alt_irq_context ctx = alt_irq_disable_all();
+    struct i2c_log_event *e = &log_ring[log_head++ & (I2C_LOG_DEPTH - 1)];
+    e->time = timer_ready() ? alt_timestamp() : 0;
+    e->type = type;
+    e->op = op;
+    e->arg = arg;
+    e->value = value;
+    alt_irq_enable_all(ctx);
+}
+
+#define TRACE_POLL(ch)                   ((ch)->polls++)
+#define TRACE_LOG(type, arg, value)      log_event((type), 0, (arg), (value))
+#define TRACE_RETRY(attempt, result)     (retry_count++, log_event(I2C_LOG_RETRY, 0, (attempt), (result)))
+
+// Bucket of a value: below I2C_HIST_SUB its own, above I2C_HIST_SUB per power of two
+static int hist_bucket(unsigned long v) {
+    int e = 0;
+    if (v < I2C_HIST_SUB) {
+        return (int)v;
+    }
+    while ((v >> e) >= 2 * I2C_HIST_SUB) {
+        e++;
+    }
+    return (e + 1) * I2C_HIST_SUB + (int)(v >> e) - I2C_HIST_SUB;
+}
+
+// Largest value of a bucket
+static unsigned long hist_top(int b) {
+    int e = b / I2C_HIST_SUB - 1;
+    if (b < I2C_HIST_SUB) {
+        return b;
+    }
+    return ((unsigned long)(b % I2C_HIST_SUB + I2C_HIST_SUB + 1) << e) - 1;
+}
+
+// One timed operation of a kind
+struct op_trace {
+    enum i2c_op op;
+    struct i2c_channel *ch;
+    alt_timestamp_type start;
+    unsigned long polls, retries;
+};
+
+static void op_begin(struct op_trace *t, struct i2c_channel *ch, enum i2c_op op,
+                     unsigned int addr, unsigned long bytes) {
+    t->op = op;
+    t->ch = ch;
+    t->polls = ch->polls;
+    t->retries = retry_count;
+    log_event(I2C_LOG_START, op, addr, (long)bytes);
+    t->start = timer_ready() ? alt_timestamp() : 0;
+}
+
+static void op_end(struct op_trace *t, int result, unsigned long bytes) {
+    struct i2c_op_stats *st = &op_stats[t->op];
+    unsigned long ticks = timer_ready() ? (alt_timestamp_type)(alt_timestamp() - t->start) : 0;
+    unsigned long polls = t->ch->polls - t->polls;
+
+    if (st->count == 0 || ticks < st->min) {
+        st->min = ticks;
+    }
+    if (ticks > st->max) {
+        st->max = ticks;
+    }
+    st->count++;
+    st->ticks += ticks;
+    st->hist[hist_bucket(ticks)]++;
+    st->polls += polls;
+    st->retries += retry_count - t->retries;
+    if (result < 0) {
+        st->errors++;
+    } else {
+        st->bytes += bytes;
+    }
+    log_event(I2C_LOG_END, t->op, polls > 0xFFFF ? 0xFFFF : polls, result);
+}
+
+// Kind and data bytes of a transfer
+static enum i2c_op classify(const struct i2c_msg *msgs, int num, unsigned long *bytes) {
+    unsigned long rd = 0, wr = 0;
+    int n;
+    for (n = 0; n < num; n++) {
+        if (msgs[n].flags & I2C_M_RD) {
+            rd += msgs[n].len;
+        } else {
+            wr += msgs[n].len;
+        }
+    }
+    *bytes = rd + wr;
+    if (rd > 0) {
+        return rd == 1 ? I2C_OP_READ_BYTE : I2C_OP_BURST_READ;
+    }
+    return wr <= 2 ? I2C_OP_WRITE_BYTE : I2C_OP_BURST_WRITE;
+}
+
+const struct i2c_op_stats *i2c_stats_get(enum i2c_op op) {
+    return (unsigned int)op < I2C_OP_COUNT ? &op_stats[op] : NULL;
+}
+
+static unsigned long ticks_to_us(unsigned long long ticks) {
+    return timer_ready() ? (unsigned long)(ticks / ticks_per_us) : 0;
+}
+
+unsigned long i2c_stats_percentile_us(enum i2c_op op, unsigned int permille) {
+    const struct i2c_op_stats *st = i2c_stats_get(op);
+    unsigned long long need, seen = 0;
+    int b;
+
+    if (st == NULL || st->count == 0) {
+        return 0;
+    }
+    need = ((unsigned long long)st->count * permille + 999) / 1000;
+    for (b = 0; b < I2C_HIST_BUCKETS - 1; b++) {
+        seen += st->hist[b];
+        if (seen >= need && seen > 0) {
+            break;
+        }
+    }
+    return ticks_to_us(hist_top(b) < st->max ? hist_top(b) : st->max);
+}
+
+void i2c_stats_clear(void) {
+    alt_irq_context ctx = alt_irq_disable_all();
+    int i, b;
+    for (i = 0; i < I2C_OP_COUNT; i++) {
+        op_stats[i].count = op_stats[i].errors = op_stats[i].retries = op_stats[i].polls = 0;
+        op_stats[i].bytes = op_stats[i].ticks = 0;
+        op_stats[i].min = op_stats[i].max = 0;
+        for (b = 0; b < I2C_HIST_BUCKETS; b++) {
+            op_stats[i].hist[b] = 0;
+        }
+    }
+    log_head = 0;
+    alt_irq_enable_all(ctx);
+}
+
+static const char *const op_names[I2C_OP_COUNT] = {
+    "write_byte", "read_byte", "burst_write", "burst_read", "get_rtc_time"
+};
+
+void i2c_stats_print(void) {
+    const struct i2c_op_stats *st;
+    int i;
+
+    printf("  %-12s %9s %7s %7s %8s %8s %8s %8s %7s\n",
+           "op", "count", "errors", "retries", "p50 us", "p99 us", "max us", "mean us", "polls");
+    for (i = 0; i < I2C_OP_COUNT; i++) {
+        st = &op_stats[i];
+        if (st->count == 0) {
+            continue;
+        }
+        printf("  %-12s %9lu %7lu %7lu %8lu %8lu %8lu %8lu %7lu\n", op_names[i], st->count,
+               st->errors, st->retries, i2c_stats_percentile_us(i, 500), i2c_stats_percentile_us(i, 990),
+               ticks_to_us(st->max), ticks_to_us(st->ticks / st->count), st->polls / st->count);
+    }
+}
+
+int i2c_log_read(struct i2c_log_event *log, int max) {
+    alt_irq_context ctx = alt_irq_disable_all();
+    unsigned long first = log_head > I2C_LOG_DEPTH ? log_head - I2C_LOG_DEPTH : 0;
+    int n = 0;
+
+    if (log_head - first > (unsigned long)max) {
+        first = log_head - max;
+    }
+    for (; first != log_head; first++) {
+        log[n++] = log_ring[first & (I2C_LOG_DEPTH - 1)];
+    }
+    alt_irq_enable_all(ctx);
+    return n;
+}
+
+void i2c_log_print(const struct i2c_log_event *log, int n) {
+    static const char *const types[] = { "?", "start", "end", "retry", "recover", "abort", "irq" };
+    int i;
+
+    for (i = 0; i < n; i++) {
+        printf("  %10lu us  %-7s", ticks_to_us((alt_timestamp_type)(log[i].time - log[0].time)),
+               log[i].type < sizeof(types) / sizeof(types[0]) ? types[log[i].type] : "?");
+        switch (log[i].type) {
+        case I2C_LOG_START:
+            printf(" %-12s address %02X, %ld bytes\n", op_names[log[i].op], log[i].arg, log[i].value);
+            break;
+        case I2C_LOG_END:
+            printf(" %-12s result %ld, %u polls\n", op_names[log[i].op], log[i].value, log[i].arg);
+            break;
+        case I2C_LOG_RETRY:
+            printf(" attempt %u after %ld\n", log[i].arg, log[i].value);
+            break;
+        case I2C_LOG_IRQ:
+            printf(" status %03lX\n", (unsigned long)log[i].value);
+            break;
+        default:
+            printf(" %ld\n", log[i].value);
+            break;
+        }
+    }
+}
+#else
+#define TRACE_POLL(ch)                   do { } while (0)
+#define TRACE_LOG(type, arg, value)      do { } while (0)
+#define TRACE_RETRY(attempt, result)     do { } while (0)
+#endif
+
+// Read the raw status register
+static unsigned int read_status(struct i2c_channel *ch) {
+    TRACE_POLL(ch);
+    return IORD_32DIRECT(ch->base, STATUS_REGISTER);
+}
+
+// Clear specified status bits (write-1-to-clear)
+static void clear_status_bits(struct i2c_channel *ch, unsigned int bits) {
+    IOWR_32DIRECT(ch->base, STATUS_REGISTER, bits);
+}
+
+static void i2c_event(struct i2c_channel *ch, unsigned int status);
+
+// Acknowledge the pending events of the channel and advance its transfer
+static void channel_isr(struct i2c_channel *ch) {
+    unsigned int status = read_status(ch) & IRQ_EVENTS;
+    clear_status_bits(ch, status);
+    TRACE_LOG(I2C_LOG_IRQ, 0, status);
+    i2c_event(ch, status);
+}
+
+// Interrupt handler of the core, IRQ_SUMMARY names the channels with a raised line
+static void i2c_isr(void *context) {
+    (void)context;
+#if I2C_CHANNELS > 1
+    unsigned int pending = IORD_32DIRECT(I2C_SHARED_BASE, IRQ_SUMMARY_REGISTER);
+    int n;
+    for (n = 0; n < I2C_CHANNELS; n++) {
+        if ((pending & (1U << n)) && channels[n].base != 0) {
+            channel_isr(&channels[n]);
+        }
+    }
+#else
+    channel_isr(&channels[0]);
+#endif
+}
+
+struct i2c_channel *i2c_get_channel(int n) {
+    struct i2c_channel *ch;
+    if (n < 0 || n >= I2C_CHANNELS) {
+        return NULL;
+    }
+    ch = &channels[n];
+    if (ch->base == 0) {
+        ch->base = I2C_CHANNEL_BASE(n);
+        ch->current_timing = -1;
+    }
+    return ch;
+}
+
+// Write the control register
+static void write_control(struct i2c_channel *ch, byte ctrl) {
+    IOWR_32DIRECT(ch->base, CONTROL_REGISTER, ctrl);
+}
+
+int i2c_enable_interrupts(struct i2c_channel *ch) {
+    int err;
+    if (!isr_registered) {
+        err = alt_ic_isr_register(I2C_0_IRQ_INTERRUPT_CONTROLLER_ID, I2C_0_IRQ,
+                                  i2c_isr, NULL, NULL);
+        if (err) {
+            return err;
+        }
+        isr_registered = 1;
+    } else {
+        alt_ic_irq_enable(I2C_0_IRQ_INTERRUPT_CONTROLLER_ID, I2C_0_IRQ);
+    }
+    clear_status_bits(ch, IRQ_EVENTS);
+    IOWR_32DIRECT(ch->base, IRQ_ENABLE_REGISTER, IRQ_EVENTS);
+    ch->irq_mode = 1;
+    return 0;
+}
+
+void i2c_disable_interrupts(struct i2c_channel *ch) {
+    int n;
+
+    IOWR_32DIRECT(ch->base, IRQ_ENABLE_REGISTER, 0);
+    ch->irq_mode = 0;
+    // the line is shared by the channels, off with the last one in interrupt mode
+    for (n = 0; n < I2C_CHANNELS; n++) {
+        if (channels[n].irq_mode) {
+            return;
+        }
+    }
+    if (isr_registered) {
+        alt_ic_irq_disable(I2C_0_IRQ_INTERRUPT_CONTROLLER_ID, I2C_0_IRQ);
+    }
+}
+
+void i2c_perf_read(struct i2c_channel *ch, struct i2c_perf *p, int clear) {
+    IOWR_32DIRECT(ch->base, PERF_CONTROL_REGISTER, PERF_SNAPSHOT_BIT | (clear ? PERF_CLEAR_BIT : 0));
+    p->tx_bytes       = IORD_32DIRECT(ch->base, PERF_TX_REGISTER);
+    p->rx_bytes       = IORD_32DIRECT(ch->base, PERF_RX_REGISTER);
+    p->transactions   = IORD_32DIRECT(ch->base, PERF_TRANS_REGISTER);
+    p->nacks          = IORD_32DIRECT(ch->base, PERF_NACK_REGISTER);
+    p->busy_cycles    = IORD_32DIRECT(ch->base, PERF_BUSY_REGISTER);
+    p->stall_cycles   = IORD_32DIRECT(ch->base, PERF_STALL_REGISTER);
+    p->stretch_cycles = IORD_32DIRECT(ch->base, PERF_STRETCH_REGISTER);
+    p->cycles         = IORD_32DIRECT(ch->base, PERF_CYCLES_REGISTER);
+}
+
+void i2c_trace_start(struct i2c_channel *ch, unsigned long control) {
+    IOWR_32DIRECT(ch->base, TRACE_CONTROL_REGISTER, control | TRACE_CLEAR_BIT | TRACE_ENABLE_BIT);
+}
+
+void i2c_trace_stop(struct i2c_channel *ch) {
+    IOWR_32DIRECT(ch->base, TRACE_CONTROL_REGISTER,
+                  IORD_32DIRECT(ch->base, TRACE_CONTROL_REGISTER) & ~TRACE_ENABLE_BIT);
+}
+
+int i2c_trace_read(struct i2c_channel *ch, unsigned long *entries, int max, unsigned long *status) {
+    unsigned long ts = IORD_32DIRECT(ch->base, TRACE_STATUS_REGISTER);
+    int n, level = TRACE_LEVEL(ts);
+
+    if (status != NULL) {
+        *status = ts;
+    }
+    for (n = 0; n < level && n < max; n++) {
+        entries[n] = IORD_32DIRECT(ch->base, TRACE_DATA_REGISTER);
+    }
+    return n;
+}
+
+// Names of the master states, in the order of state_type in i2c_master
+static const char *const trace_states[] = {
+    "idle", "start", "restart", "restart_setup", "address", "address_ack", "write_data",
+    "read_data", "wait_write", "wait_read", "slave_ack", "master_ack", "prep_stop", "stop",
+    "recover"
+};
+
+void i2c_trace_print(const unsigned long *entries, int n, unsigned int prescale) {
+    unsigned long per_us = I2C_SYS_CLK_HZ / 1000000UL;
+    unsigned long long cycles = 0;
+    unsigned long e, payload;
+    int i, address = 0;
+
+    for (i = 0; i < n; i++) {
+        e = entries[i];
+        payload = TRACE_PAYLOAD(e);
+        if (i != 0) {
+            cycles += (unsigned long long)TRACE_DELTA(e) << prescale;
+        }
+        printf("%s%8lu.%02lu us  ", i != 0 && TRACE_DELTA(e) == TRACE_DELTA_MAX ? ">" : " ",
+               (unsigned long)(cycles / per_us), (unsigned long)(cycles % per_us * 100 / per_us));
+        switch (TRACE_TYPE(e)) {
+        case TRACE_TYPE_STATE:
+            printf("state %s", (payload & 0xF) < sizeof(trace_states) / sizeof(trace_states[0])
+                               ? trace_states[payload & 0xF] : "?");
+            break;
+        case TRACE_TYPE_START:
+            printf((payload & 1) ? "repeated START" : "START");
+            address = 1;
+            break;
+        case TRACE_TYPE_STOP:
+            printf("STOP");
+            break;
+        case TRACE_TYPE_BYTE:
+            if (address) {
+                printf("address %02lX %s", (payload >> 1) & 0x7F, (payload & 1) ? "R" : "W");
+            } else {
+                printf("%02lX", payload & 0xFF);
+            }
+            printf((payload & 0x100) ? " NACK" : " ACK");
+            address = 0;
+            break;
+        case TRACE_TYPE_TIMEOUT:
+            printf("stretch timeout");
+            break;
+        default:
+            printf("? %08lX", e);
+            break;
+        }
+        printf((e & TRACE_TRIGGER_BIT) ? "  <- trigger\n" : "\n");
+    }
+}
+
+void i2c_set_stretch_timeout(struct i2c_channel *ch, unsigned long us) {
+    IOWR_32DIRECT(ch->base, STRETCH_TIMEOUT_REGISTER, us * (I2C_SYS_CLK_HZ / 1000000UL));
+}
+
+// Convert ns to core clock cycles, rounded up
+static unsigned long ns_to_cycles(unsigned int ns) {
+    return ((unsigned long)ns * (I2C_SYS_CLK_HZ / 1000000UL) + 999UL) / 1000UL;
+}
+
+static int find_timing(unsigned long hz) {
+    int i;
+    for (i = 0; i < (int)TIMING_COUNT; i++) {
+        if (timing_table[i].hz == hz) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int i2c_set_device_speed(struct i2c_channel *ch, byte address, unsigned long hz) {
+    int i;
+    int timing = find_timing(hz);
+    if (timing < 0) {
+        return -1;
+    }
+    for (i = 0; i < ch->device_count; i++) {
+        if (ch->device_speed[i].address == address) {
+            ch->device_speed[i].timing = timing;
+            return 0;
+        }
+    }
+    if (ch->device_count == I2C_MAX_DEVICES) {
+        return -1;
+    }
+    ch->device_speed[ch->device_count].address = address;
+    ch->device_speed[ch->device_count].timing = timing;
+    ch->device_count++;
+    return 0;
+}
+
+// Program the timing registers for the device, only when the speed changes.
+// The new values are used from the next START on, a running STOP finishes first.
+static void select_device(struct i2c_channel *ch, byte address) {
+    const struct i2c_timing *t;
+    struct deadline d;
+    int i;
+    int timing = 0;
+
+    for (i = 0; i < ch->device_count; i++) {
+        if (ch->device_speed[i].address == address) {
+            timing = ch->device_speed[i].timing;
+            break;
+        }
+    }
+    if (timing == ch->current_timing) {
+        return;
+    }
+
+    // a lost transfer may keep BUSY, the timing goes in anyway after the timeout
+    deadline_start(&d);
+    while ((read_status(ch) & BUSY_BIT) && !deadline_passed(&d, timeout_us)) {
+    }
+    t = &timing_table[timing];
+    IOWR_32DIRECT(ch->base, SCL_TIMING_REGISTER,
+                  (ns_to_cycles(t->scl_high) << 16) | ns_to_cycles(t->scl_low));
+    IOWR_32DIRECT(ch->base, START_TIMING_REGISTER,
+                  (ns_to_cycles(t->hd_sta) << 16) | ns_to_cycles(t->su_sta));
+    IOWR_32DIRECT(ch->base, STOP_TIMING_REGISTER,
+                  (ns_to_cycles(t->buf) << 16) | ns_to_cycles(t->su_sto));
+    ch->current_timing = timing;
+}
+
+int i2c_autopoll_start(struct i2c_channel *ch, byte addr, byte first, int len, unsigned int period_ms) {
+    if (len < 1 || len > POLL_MAX) {
+        return -1;
+    }
+    select_device(ch, addr);
+    IOWR_32DIRECT(ch->base, POLL_CONTROL_REGISTER, 0);
+    IOWR_32DIRECT(ch->base, POLL_RANGE_REGISTER, (len << 8) | first);
+    IOWR_32DIRECT(ch->base, POLL_CONTROL_REGISTER,
+                  ((period_ms & 0xFFFF) << 16) | ((addr & 0x7F) << 8) | POLL_ENABLE_BIT);
+    return 0;
+}
+
+void i2c_autopoll_stop(struct i2c_channel *ch) {
+    IOWR_32DIRECT(ch->base, POLL_CONTROL_REGISTER, 0);
+}
+
+unsigned long i2c_autopoll_read(struct i2c_channel *ch, byte *buf, int first, int len, unsigned int *age_ms) {
+    unsigned int word, status;
+    unsigned long count;
+    int i;
+
+    // the mirror changes as a whole at the end of a poll, read again when one ended in between
+    do {
+        count = IORD_32DIRECT(ch->base, POLL_COUNT_REGISTER);
+        word = 0;
+        for (i = 0; i < len; i++) {
+            if (i == 0 || ((first + i) & 3) == 0) {
+                word = IORD_32DIRECT(ch->base, POLL_MIRROR_REGISTER + ((first + i) & ~3));
+            }
+            buf[i] = (word >> (8 * ((first + i) & 3))) & 0xFF;
+        }
+        status = IORD_32DIRECT(ch->base, POLL_STATUS_REGISTER);
+    } while (IORD_32DIRECT(ch->base, POLL_COUNT_REGISTER) != count);
+
+    if (age_ms != NULL) {
+        *age_ms = POLL_AGE(status);
+    }
+    return count;
+}
+
+// Finish the running transfer, the callback may submit the next one
+static void async_finish(struct i2c_channel *ch, int result) {
+    struct i2c_async *req = ch->active;
+    ch->active = NULL;
+    req->status = result;
+    if (req->complete != NULL) {
+        req->complete(req);
+    }
+}
+
+// A transfer fits the fifos when all messages go to one device, only the last one reads
+// and every message fits without waiting for the cpu (the master holds scl while the
+// rx fifo has only one entry left)
+static int fits_fifo(const struct i2c_msg *msgs, int num) {
+    int n;
+    for (n = 0; n < num; n++) {
+        if (msgs[n].addr != msgs[0].addr) {
+            return 0;
+        }
+        if (msgs[n].flags & I2C_M_RD) {
+            if (n != num - 1 || msgs[n].len > FIFO_DEPTH - 1) {
+                return 0;
+            }
+        } else if (msgs[n].len > FIFO_DEPTH) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Push len bytes into the tx fifo, four per access
+static void fifo_write(struct i2c_channel *ch, const byte *buf, int len, int stop) {
+    unsigned long word;
+    int n, i;
+
+    while (len > 0) {
+        n = len < 4 ? len : 4;
+        if (n != ch->pack_count || (stop && n == len)) {
+            IOWR_32DIRECT(ch->base, PACK_CONTROL_REGISTER,
+                          PACK_COUNT(n) | ((stop && n == len) ? PACK_STOP_BIT : 0));
+            ch->pack_count = n;
+        }
+        word = 0;
+        for (i = 0; i < n; i++) {
+            word |= (unsigned long)buf[i] << (8 * i);
+        }
+        IOWR_32DIRECT(ch->base, TX_PACKED_REGISTER, word);
+        buf += n;
+        len -= n;
+    }
+}
+
+// Pop len received bytes from the rx fifo, four per access
+static void fifo_read(struct i2c_channel *ch, byte *buf, int len) {
+    unsigned long word;
+    int i;
+
+    while (len > 0) {
+        word = IORD_32DIRECT(ch->base, RX_PACKED_REGISTER);
+        for (i = 0; i < 4 && i < len; i++) {
+            buf[i] = (word >> (8 * i)) & 0xFF;
+        }
+        buf += i;
+        len -= i;
+    }
+}
+
+// FIFO mode: a write message is queued as a whole and sent with its START/RESTART,
+// READY comes when the tx fifo ran empty. A read acks len - 1 bytes into the rx fifo
+// and ends with NACK and STOP. DONE ends the transfer.
+static void fifo_next(struct i2c_channel *ch) {
+    struct i2c_async *req = ch->active;
+    const struct i2c_msg *msg = &req->msgs[req->msg];
+    byte start = (req->msg == 0) ? ENABLE_BIT : RESTART_BIT;
+    int last = req->msg == req->num - 1;
+
+    if (msg->flags & I2C_M_RD) {
+        write_control(ch, start | RW_BIT);
+    } else {
+        fifo_write(ch, msg->buf, msg->len, last);
+        write_control(ch, start);
+    }
+    req->pos = msg->len;
+    req->wait = last ? DONE_BIT : READY_BIT;
+}
+
+// Issue the command for the next byte of the running transfer
+static void async_next(struct i2c_channel *ch) {
+    struct i2c_async *req = ch->active;
+    const struct i2c_msg *msg = &req->msgs[req->msg];
+    byte start;
+    int last;
+
+    // message complete: STOP after the last one, otherwise on to the next message
+    if (req->pos == msg->len) {
+        if (req->msg == req->num - 1) {
+            write_control(ch, ((msg->flags & I2C_M_RD) ? RW_BIT : 0) | STOP_BIT);
+            req->wait = DONE_BIT;
+            return;
+        }
+        req->msg++;
+        req->pos = 0;
+        msg = &req->msgs[req->msg];
+    }
+    start = (req->msg == 0) ? ENABLE_BIT : RESTART_BIT;
+
+    if (!(msg->flags & I2C_M_RD)) {
+        // the first byte goes out with the START/RESTART, each following one is loaded into the
+        // holding register while the byte before it is on the bus. pos counts the bytes handed
+        // to the core, READY comes after the last one unless it carries the STOP.
+        if (req->pos == 0) {
+            IOWR_32DIRECT(ch->base, WRITE_REGISTER, (msg->addr << 8) | msg->buf[0]);
+            write_control(ch, start);
+            req->pos = 1;
+        }
+        if (req->pos == msg->len) {
+            req->wait = READY_BIT;
+            return;
+        }
+        last = req->pos == msg->len - 1 && req->msg == req->num - 1;
+        IOWR_32DIRECT(ch->base, TX_HOLD_REGISTER, msg->buf[req->pos] | (last ? TX_STOP_BIT : 0));
+        req->pos++;
+        if (last) {
+            req->wait = DONE_BIT;
+        } else if (req->pos < msg->len) {
+            req->wait = HOLD_EMPTY_BIT;
+        } else {
+            req->wait = READY_BIT;
+        }
+    } else if (req->pos > 0) {
+        // ACK the previous byte and receive the next one
+        write_control(ch, RW_BIT | CONTINUE_BIT);
+        req->wait = READY_BIT;
+    } else if (req->msg == req->num - 1 && msg->len == 1) {
+        // single byte read at the end: the master NACKs it and stops by itself
+        IOWR_32DIRECT(ch->base, WRITE_REGISTER, msg->addr << 8);
+        write_control(ch, start | RW_BIT);
+        req->wait = DONE_BIT;
+    } else {
+        // sequential read, every byte waits for the ACK (CONTINUE) or the NACK
+        // with STOP or with the RESTART of the next message
+        IOWR_32DIRECT(ch->base, WRITE_REGISTER, msg->addr << 8);
+        write_control(ch, start | RW_BIT | CONTINUE_BIT);
+        req->wait = READY_BIT;
+    }
+}
+
+// End of a command sequencer list
+static void seq_finish(struct i2c_channel *ch) {
+    ch->seq_result = (IORD_32DIRECT(ch->base, SEQ_CONTROL_REGISTER) & SEQ_ERROR_BIT) ? -1 : 0;
+    if (ch->irq_mode) {
+        // the events of the list's transactions are stale by now
+        clear_status_bits(ch, IRQ_EVENTS);
+        IOWR_32DIRECT(ch->base, IRQ_ENABLE_REGISTER, IRQ_EVENTS);
+    }
+    ch->seq_running = 0;
+}
+
+// Advance the running transfer on READY, DONE, ACKERROR and TIMEOUT
+static void i2c_event(struct i2c_channel *ch, unsigned int status) {
+    struct i2c_async *req = ch->active;
+    const struct i2c_msg *msg;
+
+    if (ch->seq_running && (status & SEQ_DONE_BIT)) {
+        seq_finish(ch);
+        return;
+    }
+    if (req == NULL) {
+        return;
+    }
+    if (status & (ACKERROR_BIT | TIMEOUT_BIT)) {
+        // the master ends the transaction by itself
+        async_finish(ch, (status & TIMEOUT_BIT) ? I2C_ERR_STRETCH : I2C_ERR_NACK);
+        return;
+    }
+    if (!(status & req->wait)) {
+        return;
+    }
+
+    msg = &req->msgs[req->msg];
+    if (req->fifo) {
+        if (req->wait == DONE_BIT) {
+            if (msg->flags & I2C_M_RD) {
+                fifo_read(ch, msg->buf, msg->len);
+            }
+            async_finish(ch, req->num);
+        } else {
+            req->msg++;
+            fifo_next(ch);
+        }
+        return;
+    }
+    if (req->wait == DONE_BIT) {
+        if (req->pos < msg->len) {
+            msg->buf[req->pos] = IORD_32DIRECT(ch->base, READ_REGISTER);
+        }
+        async_finish(ch, req->num);
+        return;
+    }
+    if (msg->flags & I2C_M_RD) {
+        msg->buf[req->pos] = IORD_32DIRECT(ch->base, READ_REGISTER);
+        req->pos++;
+    }
+    async_next(ch);
+}
+
+int i2c_submit(struct i2c_channel *ch, struct i2c_async *req, const struct i2c_msg *msgs, int num,
+               void (*complete)(struct i2c_async *req), void *context) {
+    int n;
+
+    if (ch->active != NULL || ch->seq_running || num <= 0) {
+        return I2C_ERR_INVAL;
+    }
+    for (n = 0; n < num; n++) {
+        // the master sends at least one data byte after a write address
+        if (msgs[n].len == 0) {
+            return I2C_ERR_INVAL;
+        }
+    }
+
+    req->msgs = msgs;
+    req->num = num;
+    req->complete = complete;
+    req->context = context;
+    req->status = I2C_ASYNC_BUSY;
+    req->msg = 0;
+    req->pos = 0;
+    req->fifo = fits_fifo(msgs, num);
+    req->ch = ch;
+
+    write_control(ch, 0);
+    select_device(ch, msgs[0].addr);
+    ch->active = req;
+    if (req->fifo) {
+        // the flush drops bytes left behind by a transfer that ended on a NACK
+        IOWR_32DIRECT(ch->base, FIFO_CONTROL_REGISTER, FIFO_ENABLE_BIT | TX_FLUSH_BIT | RX_FLUSH_BIT
+                      | RX_LENGTH((msgs[num - 1].flags & I2C_M_RD) ? msgs[num - 1].len : 0));
+        IOWR_32DIRECT(ch->base, ADDRESS_REGISTER, msgs[0].addr);
+        ch->fifo_mode = 1;
+        fifo_next(ch);
+    } else {
+        if (ch->fifo_mode) {
+            IOWR_32DIRECT(ch->base, FIFO_CONTROL_REGISTER, 0);
+            ch->fifo_mode = 0;
+        }
+        async_next(ch);
+    }
+    return 0;
+}
+
+void i2c_poll(struct i2c_channel *ch) {
+    unsigned int status;
+    if (ch->irq_mode || (ch->active == NULL && !ch->seq_running)) {
+        return;
+    }
+    status = read_status(ch) & IRQ_EVENTS;
+    if (status) {
+        clear_status_bits(ch, status);
+        i2c_event(ch, status);
+    }
+}
+
+int i2c_async_done(const struct i2c_async *req) {
+    return req->status != I2C_ASYNC_BUSY;
+}
+
+// Give up on the running transfer, a STOP ends it when the master waits for the cpu
+static void async_abort(struct i2c_async *req) {
+    struct i2c_channel *ch = req->ch;
+    alt_irq_context ctx = alt_irq_disable_all();
+    if (ch->active == req) {
+        write_control(ch, STOP_BIT);
+        TRACE_LOG(I2C_LOG_ABORT, 0, I2C_ERR_TIMEOUT);
+        async_finish(ch, I2C_ERR_TIMEOUT);
+    }
+    alt_irq_enable_all(ctx);
+}
+
+int i2c_wait(struct i2c_async *req) {
+    struct i2c_channel *ch = req->ch;
+    struct deadline d;
+
+    deadline_start(&d);
+    while (req->status == I2C_ASYNC_BUSY) {
+        if (deadline_passed(&d, timeout_us)) {
+            async_abort(req);
+            break;
+        }
+        if (ch->irq_mode) {
+            // Only RAM is polled here, the Avalon bus stays free
+            I2C_IDLE_HOOK();
+        } else {
+            i2c_poll(ch);
+        }
+    }
+    return req->status;
+}
+
+void i2c_desc_set(struct i2c_desc *d, byte addr, unsigned int flags,
+                  byte *buf, unsigned short len, struct i2c_desc *next) {
+    d->next = next != NULL ? I2C_BUS_ADDRESS(next) : 0;
+    d->control = I2C_DESC_LEN(len) | (flags & (I2C_DESC_READ | I2C_DESC_STOP)) | (addr & 0x7F);
+    d->buffer = I2C_BUS_ADDRESS(buf);
+    d->status = 0;
+}
+
+int i2c_seq_start(struct i2c_channel *ch, struct i2c_desc *list) {
+    if (ch->active != NULL || ch->seq_running) {
+        return I2C_ERR_INVAL;
+    }
+    select_device(ch, list->control & 0x7F);
+    // the sequencer feeds the master itself, the fifos stay out of the way
+    if (ch->fifo_mode) {
+        IOWR_32DIRECT(ch->base, FIFO_CONTROL_REGISTER, 0);
+        ch->fifo_mode = 0;
+    }
+    ch->seq_running = 1;
+    if (ch->irq_mode) {
+        // one interrupt at the end of the list instead of one per byte
+        IOWR_32DIRECT(ch->base, IRQ_ENABLE_REGISTER, SEQ_DONE_BIT);
+    }
+    IOWR_32DIRECT(ch->base, SEQ_HEAD_REGISTER, I2C_BUS_ADDRESS(list));
+    IOWR_32DIRECT(ch->base, SEQ_CONTROL_REGISTER, SEQ_START_BIT);
+    return 0;
+}
+
+int i2c_seq_busy(struct i2c_channel *ch) {
+    if (ch->seq_running) {
+        i2c_poll(ch);
+    }
+    return ch->seq_running;
+}
+
+int i2c_seq_wait(struct i2c_channel *ch) {
+    struct deadline d;
+
+    deadline_start(&d);
+    while (ch->seq_running) {
+        if (deadline_passed(&d, timeout_us)) {
+            return I2C_ERR_TIMEOUT;
+        }
+        if (ch->irq_mode) {
+            I2C_IDLE_HOOK();
+        } else {
+            i2c_poll(ch);
+        }
+    }
+    return ch->seq_result;
+}
+
+void i2c_set_timeout(unsigned long us) {
+    timeout_us = us;
+}
+
+void i2c_set_retry(int n, unsigned long us) {
+    retries = n > 0 ? n : 0;
+    backoff_us = us;
+}
+
+unsigned long i2c_transfer_bound_us(void) {
+    if (timeout_us == 0) {
+        return 0;
+    }
+    // per attempt the wait for a free bus before a speed change and the transfer,
+    // per retry a recovery and the backoff
+    return (unsigned long)(retries + 1) * 2 * timeout_us + (unsigned long)retries * timeout_us
+           + backoff_us * ((1UL << retries) - 1);
+}
+
+int i2c_recover(struct i2c_channel *ch) {
+    struct deadline d;
+    unsigned int status = 0;
+
+    if (ch->active != NULL || ch->seq_running) {
+        return I2C_ERR_INVAL;
+    }
+    if (ch->fifo_mode) {
+        IOWR_32DIRECT(ch->base, FIFO_CONTROL_REGISTER, 0);
+        ch->fifo_mode = 0;
+    }
+    // the result is polled, the ISR stays out of it
+    if (ch->irq_mode) {
+        IOWR_32DIRECT(ch->base, IRQ_ENABLE_REGISTER, 0);
+    }
+    clear_status_bits(ch, IRQ_EVENTS);
+    write_control(ch, RECOVER_BIT | ENABLE_BIT);
+    deadline_start(&d);
+    while (!(status & DONE_BIT) && !deadline_passed(&d, timeout_us)) {
+        status = read_status(ch);
+    }
+    write_control(ch, 0);
+    clear_status_bits(ch, IRQ_EVENTS);
+    if (ch->irq_mode) {
+        IOWR_32DIRECT(ch->base, IRQ_ENABLE_REGISTER, IRQ_EVENTS);
+    }
+
+    if (!(status & DONE_BIT)) {
+        return I2C_ERR_TIMEOUT;
+    }
+    if (status & TIMEOUT_BIT) {
+        return I2C_ERR_STRETCH;
+    }
+    return (status & ACKERROR_BIT) ? I2C_ERR_BUS : 0;
+}
+
+// i2c_transfer() without the tracing
+static int transfer(struct i2c_channel *ch, const struct i2c_msg *msgs, int num) {
+    struct i2c_async req;
+    unsigned long backoff = backoff_us;
+    int result = 0;
+    int attempt;
+
+    for (attempt = 0; attempt <= retries; attempt++) {
+        if (attempt > 0) {
+            TRACE_RETRY(attempt, result);
+            // a line held low or a lost transfer, clock the bus free before the next try
+            if (result == I2C_ERR_STRETCH || result == I2C_ERR_TIMEOUT) {
+                result = i2c_recover(ch);
+                TRACE_LOG(I2C_LOG_RECOVER, 0, result);
+            }
+            delay_us(backoff);
+            backoff <<= 1;
+        }
+        result = i2c_submit(ch, &req, msgs, num, NULL, NULL);
+        if (result != 0) {
+            return result;
+        }
+        result = i2c_wait(&req);
+        if (result >= 0) {
+            break;
+        }
+    }
+    return result;
+}
+
+int i2c_transfer(struct i2c_channel *ch, const struct i2c_msg *msgs, int num) {
+#if I2C_DRIVER_TRACE
+    struct op_trace t;
+    unsigned long bytes;
+    int result;
+    enum i2c_op op = classify(msgs, num, &bytes);
+
+    op_begin(&t, ch, op, num > 0 ? msgs[0].addr : 0, bytes);
+    result = transfer(ch, msgs, num);
+    op_end(&t, result, bytes);
+    return result;
+#else
+    return transfer(ch, msgs, num);
+#endif
+}
+
+// Registers [reg, reg + len) of the shadow written to the device in one transaction
+static int regcache_put(struct i2c_regcache *c, int reg, int len) {
+    byte buf[1 + I2C_REGCACHE_MAX];
+    struct i2c_msg msg = { 0, 0, 0, buf };
+    int i;
+
+    msg.addr = c->addr;
+    msg.len = 1 + len;
+    buf[0] = reg;
+    for (i = 0; i < len; i++) {
+        buf[1 + i] = c->value[reg + i];
+    }
+    c->stats.transactions++;
+    i = i2c_transfer(c->ch, &msg, 1);
+    return i < 0 ? i : 0;
+}
+
+void i2c_regcache_init(struct i2c_regcache *c, struct i2c_channel *ch, byte addr, int count,
+                       unsigned long volatile_mask) {
+    int i;
+    c->ch = ch;
+    c->addr = addr;
+    c->count = count < I2C_REGCACHE_MAX ? count : I2C_REGCACHE_MAX;
+    c->volatile_mask = volatile_mask;
+    c->valid = 0;
+    c->dirty = 0;
+    for (i = 0; i < I2C_REGCACHE_MAX; i++) {
+        c->value[i] = 0;
+    }
+    c->stats.writes = c->stats.elided = c->stats.reads = c->stats.hits = c->stats.transactions = 0;
+}
+
+int i2c_regcache_write(struct i2c_regcache *c, byte reg, const byte *data, int len) {
+    unsigned long bit;
+    int i, r, end, result = 0, err;
+
+    if (len < 1 || reg + len > c->count) {
+        return I2C_ERR_INVAL;
+    }
+    for (i = 0; i < len; i++) {
+        bit = 1UL << (reg + i);
+        c->stats.writes++;
+        if (!(c->volatile_mask & bit) && (c->valid & bit) && c->value[reg + i] == data[i]) {
+            c->stats.elided++;
+            continue;
+        }
+        c->value[reg + i] = data[i];
+        if (!(c->volatile_mask & bit)) {
+            c->valid |= bit;
+            c->dirty |= bit;
+        }
+    }
+    // the volatile registers at once, one transaction per run of them
+    for (r = reg; r < reg + len; r = end) {
+        for (end = r; end < reg + len && (c->volatile_mask & (1UL << end)); end++) {
+        }
+        if (end == r) {
+            end++;
+        } else if ((err = regcache_put(c, r, end - r)) != 0 && result == 0) {
+            result = err;
+        }
+    }
+    return result;
+}
+
+int i2c_regcache_read(struct i2c_regcache *c, byte reg, byte *data, int len) {
+    unsigned long range, bit;
+    struct i2c_msg msgs[2];
+    int i, result;
+
+    if (len < 1 || reg + len > c->count) {
+        return I2C_ERR_INVAL;
+    }
+    c->stats.reads += len;
+    range = (len == 32 ? 0xFFFFFFFFUL : (1UL << len) - 1) << reg;
+    if ((range & c->valid & ~c->volatile_mask) == range) {
+        for (i = 0; i < len; i++) {
+            data[i] = c->value[reg + i];
+        }
+        c->stats.hits += len;
+        return 0;
+    }
+
+    msgs[0].addr = c->addr;
+    msgs[0].flags = 0;
+    msgs[0].len = 1;
+    msgs[0].buf = &reg;
+    msgs[1].addr = c->addr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = len;
+    msgs[1].buf = data;
+    c->stats.transactions++;
+    result = i2c_transfer(c->ch, msgs, 2);
+    if (result < 0) {
+        return result;
+    }
+    for (i = 0; i < len; i++) {
+        bit = 1UL << (reg + i);
+        if (c->volatile_mask & bit) {
+            continue;
+        }
+        if (c->dirty & bit) {
+            data[i] = c->value[reg + i];
+        } else {
+            c->value[reg + i] = data[i];
+            c->valid |= bit;
+        }
+    }
+    return 0;
+}
+
+int i2c_regcache_flush(struct i2c_regcache *c) {
+    unsigned long rewrite = c->valid & ~c->volatile_mask & ~c->dirty;
+    int r, end, gap, err, result = 0;
+
+    for (r = 0; r < c->count; r = end) {
+        end = r + 1;
+        if (!(c->dirty & (1UL << r))) {
+            continue;
+        }
+        // the run, joined with the next one over a few unchanged registers
+        for (;;) {
+            while (end < c->count && (c->dirty & (1UL << end))) {
+                end++;
+            }
+            for (gap = 0; gap < I2C_REGCACHE_GAP && end + gap < c->count && (rewrite & (1UL << (end + gap))); gap++) {
+            }
+            if (gap == 0 || end + gap >= c->count || !(c->dirty & (1UL << (end + gap)))) {
+                break;
+            }
+            end += gap;
+        }
+        err = regcache_put(c, r, end - r);
+        if (err != 0) {
+            if (result == 0) {
+                result = err;
+            }
+            continue;
+        }
+        c->dirty &= ~(((end - r == 32) ? 0xFFFFFFFFUL : (1UL << (end - r)) - 1) << r);
+    }
+    return result;
+}
+
+void i2c_regcache_invalidate(struct i2c_regcache *c) {
+    c->valid = 0;
+    c->dirty = 0;
+}
+
+// Cached time and temperature, see get_rtc_time_cached()
+static struct {
+    int time_valid;
+    byte time[7];                   // second to year
+    alt_timestamp_type time_read;
+    unsigned long time_interval_ms;
+    int temp_valid;
+    float temp;
+    alt_timestamp_type temp_read;
+    unsigned long temp_interval_ms;
+} rtc_cache = { 0, { 0 }, 0, RTC_TIME_INTERVAL_MS, 0, RTC_TEMP_INVALID, 0, RTC_TEMP_INTERVAL_MS };
+
+// Channel of the DS3231, channel 0 until rtc_set_channel()
+static struct i2c_channel *rtc_channel = NULL;
+
+// Shadow of the DS3231 registers, set up on the first rtc_regcache()
+static struct i2c_regcache rtc_regs;
+static int rtc_regs_ready = 0;
+
+void rtc_set_channel(struct i2c_channel *ch) {
+    rtc_channel = ch;
+    rtc_cache.time_valid = 0;
+    rtc_cache.temp_valid = 0;
+    rtc_regs_ready = 0;
+}
+
+static struct i2c_channel *rtc_bus(void) {
+    if (rtc_channel == NULL) {
+        rtc_channel = i2c_get_channel(0);
+    }
+    return rtc_channel;
+}
+
+struct i2c_regcache *rtc_regcache(void) {
+    if (!rtc_regs_ready) {
+        i2c_regcache_init(&rtc_regs, rtc_bus(), RTC_ADDRESS, RTC_REGISTERS, RTC_VOLATILE_REGS);
+        rtc_regs_ready = 1;
+    }
+    return &rtc_regs;
+}
+
+// Write len consecutive registers starting at reg in one transaction
+static int rtc_write(byte reg, const byte *data, int len) {
+    byte buf[8];   // register pointer and up to seconds to year
+    struct i2c_msg msg = { RTC_ADDRESS, 0, 0, buf };
+    int i;
+
+    if (len > (int)sizeof(buf) - 1) {
+        return I2C_ERR_INVAL;
+    }
+    buf[0] = reg;
+    for (i = 0; i < len; i++) {
+        buf[1 + i] = data[i];
+    }
+    msg.len = 1 + len;
+    i = i2c_transfer(rtc_bus(), &msg, 1);
+    return i < 0 ? i : 0;
+}
+
+// Messages reading len consecutive registers at reg (pointer write, repeated START, read)
+static void rtc_read_msgs(struct rtc_request *req, byte reg, int len) {
+    int i;
+    for (i = 0; i < (int)sizeof(req->raw); i++) {
+        req->raw[i] = 0;
+    }
+    req->reg = reg;
+    req->msgs[0].addr = RTC_ADDRESS;
+    req->msgs[0].flags = 0;
+    req->msgs[0].len = 1;
+    req->msgs[0].buf = &req->reg;
+    req->msgs[1].addr = RTC_ADDRESS;
+    req->msgs[1].flags = I2C_M_RD;
+    req->msgs[1].len = len;
+    req->msgs[1].buf = req->raw;
+}
+
+static int rtc_read_async(struct rtc_request *req, byte reg, int len,
+                          void (*complete)(struct i2c_async *xfer), void *context) {
+    rtc_read_msgs(req, reg, len);
+    return i2c_submit(rtc_bus(), &req->xfer, req->msgs, 2, complete, context);
+}
+
+// Blocking read with the retries of i2c_transfer(), req->raw holds the registers
+static int rtc_read(struct rtc_request *req, byte reg, int len) {
+    int result;
+    rtc_read_msgs(req, reg, len);
+    result = i2c_transfer(rtc_bus(), req->msgs, 2);
+    return result < 0 ? result : 0;
+}
+
+static byte from_bcd(byte v) {
+    return ((v >> 4) * 10) + (v & 0x0F);
+}
+
+int set_rtc_time(byte second, byte minute, byte hour,
+                 byte week_day, byte day, byte month, byte year) {
+    // Seconds to year in one transaction, the DS3231 restarts its countdown chain
+    // on the seconds write, so the registers cannot roll over between the writes
+    byte bcd[7];
+    bcd[0] = ((second / 10) << 4) | (second % 10);
+    bcd[1] = ((minute / 10) << 4) | (minute % 10);
+    bcd[2] = ((hour   / 10) << 4) | (hour   % 10);
+    bcd[3] = ((week_day/ 10) << 4) | (week_day% 10);
+    bcd[4] = ((day    / 10) << 4) | (day    % 10);
+    bcd[5] = ((month  / 10) << 4) | (month  % 10);
+    bcd[6] = ((year   / 10) << 4) | (year   % 10);
+    rtc_cache.time_valid = 0;
+    return rtc_write(REG_SECONDS, bcd, 7);
+}
+
+int get_rtc_time_async(struct rtc_request *req,
+                       void (*complete)(struct i2c_async *xfer), void *context) {
+    // Seconds to year in one transaction, the DS3231 latches all of them at the START
+    return rtc_read_async(req, REG_SECONDS, 7, complete, context);
+}
+
+int get_rtc_temp_async(struct rtc_request *req,
+                       void (*complete)(struct i2c_async *xfer), void *context) {
+    return rtc_read_async(req, REG_TEMP_HIGH, 2, complete, context);
+}
+
+void rtc_decode_time(const struct rtc_request *req,
+                     byte *second, byte *minute, byte *hour,
+                     byte *week_day, byte *day, byte *month, byte *year) {
+    *second   = from_bcd(req->raw[0]);
+    *minute   = from_bcd(req->raw[1]);
+    *hour     = from_bcd(req->raw[2]);
+    *week_day = from_bcd(req->raw[3]);
+    *day      = from_bcd(req->raw[4]);
+    *month    = from_bcd(req->raw[5]);
+    *year     = from_bcd(req->raw[6]);
+}
+
+float rtc_decode_temp(const struct rtc_request *req) {
+    byte hi = req->raw[0];
+    byte lo = req->raw[1];
+    int ti = (hi & 0x80) ? hi - 256 : hi;
+    return ti + (((lo >> 6) & 0x03) * 0.25f);
+}
+
+int get_rtc_time(byte *second, byte *minute, byte *hour,
+                 byte *week_day, byte *day, byte *month, byte *year) {
+    struct rtc_request req;
+    int result;
+#if I2C_DRIVER_TRACE
+    struct op_trace t;
+    op_begin(&t, rtc_bus(), I2C_OP_RTC_TIME, RTC_ADDRESS, 8);
+#endif
+    result = rtc_read(&req, REG_SECONDS, 7);
+    if (result == 0) {
+        rtc_decode_time(&req, second, minute, hour, week_day, day, month, year);
+    }
+#if I2C_DRIVER_TRACE
+    op_end(&t, result, 8);
+#endif
+    return result;
+}
+
+int get_rtc_temp_checked(float *temp) {
+    struct rtc_request req;
+    int result = rtc_read(&req, REG_TEMP_HIGH, 2);
+    if (result == 0) {
+        *temp = rtc_decode_temp(&req);
+    }
+    return result;
+}
+
+float get_rtc_temp(void) {
+    float temp = RTC_TEMP_INVALID;
+    get_rtc_temp_checked(&temp);
+    return temp;
+}
+
+static unsigned long cache_age(int valid, alt_timestamp_type read) {
+    if (!valid || !timer_ready()) {
+        return RTC_AGE_NONE;
+    }
+    return timer_us(read) / 1000;
+}
+
+unsigned long rtc_time_age_ms(void) {
+    return cache_age(rtc_cache.time_valid, rtc_cache.time_read);
+}
+
+unsigned long rtc_temp_age_ms(void) {
+    return cache_age(rtc_cache.temp_valid, rtc_cache.temp_read);
+}
+
+void rtc_cache_interval(unsigned long time_ms, unsigned long temp_ms) {
+    if (time_ms != 0) {
+        rtc_cache.time_interval_ms = time_ms;
+    }
+    if (temp_ms != 0) {
+        rtc_cache.temp_interval_ms = temp_ms;
+    }
+}
+
+int get_rtc_time_cached(byte *second, byte *minute, byte *hour,
+                        byte *week_day, byte *day, byte *month, byte *year) {
+    byte *t = rtc_cache.time;
+    unsigned long age = rtc_time_age_ms();
+    int result;
+
+    if (!timer_ready()) {
+        return get_rtc_time(second, minute, hour, week_day, day, month, year);
+    }
+    if (age == RTC_AGE_NONE || age >= rtc_cache.time_interval_ms || t[0] + age / 1000 >= 60) {
+        result = get_rtc_time(&t[0], &t[1], &t[2], &t[3], &t[4], &t[5], &t[6]);
+        if (result != 0) {
+            // t may hold a partial read, the next call reads again
+            rtc_cache.time_valid = 0;
+            return result;
+        }
+        // the DS3231 latched the registers at the START, close enough to the end of the read
+        rtc_cache.time_read = alt_timestamp();
+        rtc_cache.time_valid = 1;
+        age = 0;
+    }
+    *second   = t[0] + age / 1000;
+    *minute   = t[1];
+    *hour     = t[2];
+    *week_day = t[3];
+    *day      = t[4];
+    *month    = t[5];
+    *year     = t[6];
+    return 0;
+}
+
+float get_rtc_temp_cached(void) {
+    unsigned long age = rtc_temp_age_ms();
+
+    if (!timer_ready()) {
+        return get_rtc_temp();
+    }
+    if (age == RTC_AGE_NONE || age >= rtc_cache.temp_interval_ms) {
+        if (get_rtc_temp_checked(&rtc_cache.temp) == 0) {
+            rtc_cache.temp_read = alt_timestamp();
+            rtc_cache.temp_valid = 1;
+        }
+    }
+    return rtc_cache.temp;
+}
@@ -1,53 +1,574 @@
-/* rtc_driver.h */
-#ifndef RTC_DRIVER_H
-#define RTC_DRIVER_H
-
-#include <system.h>
-#include <io.h>
-#include <stdio.h>
-
-typedef unsigned char byte;
-
-// Register addresses for Avalon-I2C core
-#define I2C_0_BASE        0x81000
-#define CONTROL_REGISTER  0x00  // CONTINUE (bit3), RW (bit2), STOP (bit1), ENABLE (bit0)
-#define WRITE_REGISTER    0x04  // [14:8]=slave address, [7:0]=data
-#define STATUS_REGISTER   0x08  // READY (bit3), ACKERROR (bit2), BUSY (bit1), DONE (bit0)
-#define READ_REGISTER     0x0C  // [7:0]=data out
-
-// Control bits
-#define ENABLE_BIT        0x01
-#define STOP_BIT          0x02
-#define RW_BIT            0x04
-#define CONTINUE_BIT      0x08
-
-// Status bits
-#define READY_BIT         0x08
-#define ACKERROR_BIT      0x04
-#define DONE_BIT          0x01
-
-// DS3231 I2C address and register map
-#define RTC_ADDRESS       0x68
-#define REG_SECONDS       0x00
-#define REG_MINUTES       0x01
-#define REG_HOURS         0x02
-#define REG_WEEKDAY       0x03
-#define REG_DAY           0x04
-#define REG_MONTH         0x05
-#define REG_YEAR          0x06
-#define REG_TEMP_HIGH     0x11
-#define REG_TEMP_LOW      0x12
-
-// Set the RTC time: second, minute, hour, weekday, day, month, year (BCD)
-void set_rtc_time(byte second, byte minute, byte hour,
-                  byte week_day, byte day, byte month, byte year);
-
-// Retrieve the RTC time via pointers
-void get_rtc_time(byte *second, byte *minute, byte *hour,
-                  byte *week_day, byte *day, byte *month, byte *year);
-
-// Read temperature from RTC and return as float
-float get_rtc_temp(void);
-
-
-#endif // RTC_DRIVER_H
+/* rtc_driver.h */
+#ifndef RTC_DRIVER_H
+#define RTC_DRIVER_H
+
+#include <system.h>
+#include <io.h>
+#include <sys/alt_irq.h>
+#include <sys/alt_timestamp.h>
+#include <stdio.h>
+
+typedef unsigned char byte;
+
+// Register addresses for Avalon-I2C core
+#define I2C_0_BASE        0x81000
+#define CONTROL_REGISTER  0x00  // RECOVER (bit5), RESTART (bit4), CONTINUE (bit3), RW (bit2), STOP (bit1), ENABLE (bit0)
+#define WRITE_REGISTER    0x04  // [14:8]=slave address, [7:0]=data
+#define STATUS_REGISTER   0x08  // SEQ_DONE (bit8), HOLD_EMPTY (bit7), TIMEOUT (bit6), RXTHR (bit5), TXTHR (bit4), READY (bit3), ACKERROR (bit2), BUSY (bit1), DONE (bit0)
+#define READ_REGISTER     0x0C  // [7:0]=data out
+#define IRQ_ENABLE_REGISTER   0x10  // same bit layout as STATUS_REGISTER, BUSY has no interrupt
+#define TX_DATA_REGISTER      0x14  // [8]=STOP after this byte, [7:0]=data, write pushes into the tx fifo
+#define RX_DATA_REGISTER      0x18  // [7:0]=data, read pops from the rx fifo
+#define FIFO_STATUS_REGISTER  0x1C  // see FIFO status bits, [15:8]=rx level, [7:0]=tx level
+#define FIFO_CONTROL_REGISTER 0x20  // [31:24]=rx length, [23:16]=rx threshold, [15:8]=tx threshold, RXFLUSH (bit2), TXFLUSH (bit1), FIFO_ENABLE (bit0)
+#define SCL_TIMING_REGISTER   0x24  // [31:16]=scl high, [15:0]=scl low, in clock cycles
+#define START_TIMING_REGISTER 0x28  // [31:16]=tHD;STA, [15:0]=tSU;STA, in clock cycles
+#define STOP_TIMING_REGISTER  0x2C  // [31:16]=tBUF, [15:0]=tSU;STO, in clock cycles
+#define PERF_CONTROL_REGISTER 0x30  // CLEAR (bit1), SNAPSHOT (bit0), write only
+#define PERF_TX_REGISTER      0x34  // bytes sent, address bytes included
+#define PERF_RX_REGISTER      0x38  // bytes received
+#define PERF_TRANS_REGISTER   0x3C  // transactions (START, a repeated START is not counted)
+#define PERF_NACK_REGISTER    0x40  // transactions ended by a NACK from the slave
+#define PERF_BUSY_REGISTER    0x44  // clock cycles with BUSY set
+#define PERF_STALL_REGISTER   0x48  // clock cycles scl is held low waiting for the cpu
+#define PERF_STRETCH_REGISTER 0x4C  // clock cycles scl is held low by a slave
+#define PERF_CYCLES_REGISTER  0x50  // clock cycles since the last clear
+#define STRETCH_TIMEOUT_REGISTER 0x54  // clock cycles a slave may hold scl low, 0 = no limit (reset: 25 ms)
+#define TX_HOLD_REGISTER      0x58  // [8]=STOP after this byte, [7:0]=data, next byte of a write in register mode
+#define ADDRESS_REGISTER      0x5C  // [6:0]=slave address, same as WRITE_REGISTER [14:8]
+#define TX_PACKED_REGISTER    0x60  // up to 4 bytes, first in [7:0], count from PACK_CONTROL, write pushes into the tx fifo
+#define PACK_CONTROL_REGISTER 0x64  // [10:8]=bytes of the last RX_PACKED read, STOP (bit3), [2:0]=bytes per TX_PACKED write (1-4)
+#define RX_PACKED_REGISTER    0x68  // up to 4 bytes, first in [7:0], read pops min(4, rx level) from the rx fifo
+#define SEQ_CONTROL_REGISTER  0x6C  // write: START (bit0) runs the list at SEQ_HEAD; read: ERROR (bit1), RUNNING (bit0)
+#define SEQ_HEAD_REGISTER     0x70  // bus address of the first descriptor
+#define SEQ_CURRENT_REGISTER  0x74  // bus address of the running descriptor, after an error the failed one
+#define POLL_CONTROL_REGISTER 0x78  // [31:16]=period in ms, [14:8]=slave address, ENABLE (bit0)
+#define POLL_RANGE_REGISTER   0x7C  // [15:8]=registers to read (1-32, others select 32), [7:0]=first register
+#define POLL_COUNT_REGISTER   0x80  // polls that updated the mirror
+#define POLL_STATUS_REGISTER  0x84  // FAILED (bit31), [15:0]=ms since the last update (0xFFFF: none yet or older)
+#define TRACE_CONTROL_REGISTER 0x88 // [27:24]=prescale, [23:16]=post count, [14:8]=trigger address, [5:4]=trigger, STATES (bit2), CLEAR (bit1), ENABLE (bit0)
+#define TRACE_STATUS_REGISTER 0x8C  // [31:16]=entries, WRAPPED (bit3), STOPPED (bit2), TRIGGERED (bit1), RECORDING (bit0)
+#define TRACE_DATA_REGISTER   0x90  // oldest trace entry, read pops it (0 when empty)
+#define NEXT_REGISTER         0x94  // [19:16]=CONTINUE, RW, STOP, ENABLE (read: waiting), [14:8]=slave address, [7:0]=data, transaction after the running one
+#define POLL_MIRROR_REGISTER  0xE0  // 8 words up to 0xFC, register first + n in byte n, read only
+#define FIFO_DEPTH            16    // FIFO_DEPTH generic of i2c_top
+
+// Channels of the core: 1 for i2c_top, CHANNELS generic of i2c_multi_top. Channel n has
+// the register map above at I2C_CHANNEL_BASE(n), the shared registers follow the last one.
+#ifndef I2C_CHANNELS
+#define I2C_CHANNELS          1
+#endif
+#define I2C_CHANNEL_SPAN      0x100
+#define I2C_CHANNEL_BASE(n)   (I2C_0_BASE + (n) * I2C_CHANNEL_SPAN)
+#define I2C_SHARED_BASE       I2C_CHANNEL_BASE(I2C_CHANNELS)
+#define IRQ_SUMMARY_REGISTER  0x00  // bit n: interrupt of channel n pending, read only
+#define CHANNELS_REGISTER     0x04  // CHANNELS generic, read only
+
+// Clock of the I2C core, SYS_CLK_FREQ_HZ generic of i2c_top
+#ifndef I2C_SYS_CLK_HZ
+#define I2C_SYS_CLK_HZ    50000000UL
+#endif
+
+// Interrupt line of the core, normally provided by system.h
+#ifndef I2C_0_IRQ
+#define I2C_0_IRQ                          1
+#endif
+#ifndef I2C_0_IRQ_INTERRUPT_CONTROLLER_ID
+#define I2C_0_IRQ_INTERRUPT_CONTROLLER_ID  0
+#endif
+
+// Called while waiting for an interrupt, e.g. OSTimeDly(0) under an RTOS
+#ifndef I2C_IDLE_HOOK
+#define I2C_IDLE_HOOK()   do { } while (0)
+#endif
+
+// Control bits
+#define ENABLE_BIT        0x01
+#define STOP_BIT          0x02
+#define RW_BIT            0x04
+#define CONTINUE_BIT      0x08  // next byte; with ENABLE/RESTART and RW: sequential read
+#define RESTART_BIT       0x10  // repeated start to WRITE_REGISTER address, direction from RW
+#define RECOVER_BIT       0x20  // with ENABLE: scl pulses until a slave releases sda, then STOP
+
+// Status bits
+#define READY_BIT         0x08
+#define ACKERROR_BIT      0x04
+#define BUSY_BIT          0x02
+#define DONE_BIT          0x01
+#define TXTHR_BIT         0x10  // fifo mode: at most tx threshold bytes left to send
+#define RXTHR_BIT         0x20  // fifo mode: more than rx threshold bytes received
+#define TIMEOUT_BIT       0x40  // a slave held scl (or sda before the START) low too long, the transaction ended without STOP
+#define HOLD_EMPTY_BIT    0x80  // the master took the byte from TX_HOLD_REGISTER, load the next one
+#define SEQ_DONE_BIT      0x100 // the command sequencer reached the end of its list or an error
+#define IRQ_EVENTS        (SEQ_DONE_BIT | HOLD_EMPTY_BIT | TIMEOUT_BIT | READY_BIT | ACKERROR_BIT | DONE_BIT)
+
+// TX data and holding register bits
+#define TX_STOP_BIT       0x100
+
+// Next transaction register, the control bits of CONTROL_REGISTER shifted by 16
+#define NEXT_CONTROL_SHIFT 16
+
+// FIFO status bits
+#define TX_EMPTY_BIT      0x010000
+#define TX_FULL_BIT       0x020000
+#define RX_EMPTY_BIT      0x040000
+#define RX_FULL_BIT       0x080000
+#define TX_LEVEL(fs)      ((fs) & 0xFF)
+#define RX_LEVEL(fs)      (((fs) >> 8) & 0xFF)
+
+// FIFO control bits
+#define FIFO_ENABLE_BIT   0x01
+#define TX_FLUSH_BIT      0x02
+#define RX_FLUSH_BIT      0x04
+#define TX_THRESHOLD(n)   (((n) & 0xFF) << 8)
+#define RX_THRESHOLD(n)   (((n) & 0xFF) << 16)
+#define RX_LENGTH(n)      (((n) & 0xFF) << 24)  // bytes of a read started in fifo mode
+
+// Packed port control bits
+#define PACK_COUNT(n)     ((n) & 0x07)  // 1-4, others select 4
+#define PACK_STOP_BIT     0x08          // STOP after the last byte of the next TX_PACKED write
+#define PACK_RX_COUNT(pc) (((pc) >> 8) & 0x07)
+
+// Command sequencer control bits
+#define SEQ_START_BIT     0x01
+#define SEQ_RUNNING_BIT   0x01
+#define SEQ_ERROR_BIT     0x02
+
+// Auto poller bits
+#define POLL_ENABLE_BIT   0x01
+#define POLL_FAILED_BIT   0x80000000U
+#define POLL_MAX          32            // registers in the mirror
+#define POLL_AGE(ps)      ((ps) & 0xFFFF)
+
+// Bus trace control bits
+#define TRACE_ENABLE_BIT      0x01
+#define TRACE_CLEAR_BIT       0x02          // empty the buffer and restart the trigger, reads as 0
+#define TRACE_STATES_BIT      0x04          // record the fsm states of the master as well
+#define TRACE_TRIGGER_NACK    0x10          // NACK to an address or a written byte
+#define TRACE_TRIGGER_ADDRESS 0x20          // address byte to TRACE_ADDRESS(a)
+#define TRACE_TRIGGER_TIMEOUT 0x30          // stretch timeout
+#define TRACE_ADDRESS(a)      (((a) & 0x7F) << 8)
+#define TRACE_POST(n)         (((unsigned long)(n) & 0xFF) << 16)   // entries after the trigger entry
+#define TRACE_PRESCALE(p)     (((unsigned long)(p) & 0xF) << 24)    // time stamps in 2^p clock cycles
+
+// Bus trace status bits
+#define TRACE_RECORDING_BIT   0x01
+#define TRACE_TRIGGERED_BIT   0x02
+#define TRACE_STOPPED_BIT     0x04          // post count reached after the trigger
+#define TRACE_WRAPPED_BIT     0x08          // entries were overwritten before they were read
+#define TRACE_LEVEL(ts)       (((ts) >> 16) & 0xFFFF)
+
+// Bus trace entries: type[31:29], trigger (bit28), payload[27:19], delta[18:0]
+#define TRACE_TYPE(e)         (((e) >> 29) & 0x7)
+#define TRACE_TYPE_STATE      0             // payload: fsm state of the master
+#define TRACE_TYPE_START      1             // payload bit0: repeated START
+#define TRACE_TYPE_STOP       2
+#define TRACE_TYPE_BYTE       3             // payload bit8: NACK, [7:0]: the byte
+#define TRACE_TYPE_TIMEOUT    4
+#define TRACE_TRIGGER_BIT     0x10000000UL
+#define TRACE_PAYLOAD(e)      (((e) >> 19) & 0x1FF)
+#define TRACE_DELTA(e)        ((e) & 0x7FFFF)   // ticks since the entry before, saturating
+#define TRACE_DELTA_MAX       0x7FFFFUL
+
+// Descriptors and buffers of the command sequencer must be in memory the core masters,
+// I2C_SEQ_MEM places them there and I2C_BUS_ADDRESS gives their address on that bus.
+// With a data cache on the Nios, use an uncached memory (or flush the lines).
+#ifndef I2C_SEQ_MEM
+#define I2C_SEQ_MEM         __attribute__((aligned(4)))
+#endif
+#ifndef I2C_BUS_ADDRESS
+#define I2C_BUS_ADDRESS(p)  ((unsigned int)(unsigned long)(p))
+#endif
+
+// Performance counter control bits, the counter registers return the last snapshot
+#define PERF_SNAPSHOT_BIT 0x01
+#define PERF_CLEAR_BIT    0x02  // restart the counters, a snapshot in the same write sees the old counts
+
+// Bus speeds
+#define I2C_SPEED_STANDARD   100000UL
+#define I2C_SPEED_FAST       400000UL
+#define I2C_SPEED_FAST_PLUS  1000000UL
+#define I2C_MAX_DEVICES      8      // devices with their own speed, others run at standard mode
+
+// DS3231 I2C address and register map
+#define RTC_ADDRESS       0x68
+#define REG_SECONDS       0x00
+#define REG_MINUTES       0x01
+#define REG_HOURS         0x02
+#define REG_WEEKDAY       0x03
+#define REG_DAY           0x04
+#define REG_MONTH         0x05
+#define REG_YEAR          0x06
+#define REG_ALARM1_SECONDS 0x07 // alarm 1: seconds, minutes, hours, day/date
+#define REG_ALARM2_MINUTES 0x0B // alarm 2: minutes, hours, day/date
+#define REG_CONTROL       0x0E
+#define REG_STATUS        0x0F  // alarm and oscillator flags, set by the DS3231
+#define REG_AGING         0x10
+#define REG_TEMP_HIGH     0x11
+#define REG_TEMP_LOW      0x12
+#define RTC_REGISTERS     0x13
+#define RTC_BUS_SPEED     I2C_SPEED_FAST  // the DS3231 supports fast mode
+
+// Registers the DS3231 changes by itself: time, status and temperature
+#define RTC_VOLATILE_REGS  (0x7FUL | (1UL << REG_STATUS) | (1UL << REG_TEMP_HIGH) | (1UL << REG_TEMP_LOW))
+
+#define RTC_TEMP_INVALID      (-128.0f) // get_rtc_temp() after an error, below the DS3231 range
+
+// Cached time and temperature, see get_rtc_time_cached()
+#define RTC_TIME_INTERVAL_MS  60000UL   // longest time between two reads of the clock registers
+#define RTC_TEMP_INTERVAL_MS  64000UL   // the DS3231 converts the temperature every 64 s
+#define RTC_AGE_NONE          0xFFFFFFFFUL
+
+// One segment of a combined transaction, see i2c_transfer()
+struct i2c_msg {
+    byte addr;              // 7 bit slave address
+    byte flags;             // I2C_M_RD
+    unsigned short len;     // bytes, at least 1
+    byte *buf;
+};
+#define I2C_M_RD          0x01  // read into buf, otherwise write buf
+
+// Handle of one channel, see i2c_get_channel()
+struct i2c_channel;
+
+// Results of the transfers, num (or 0) on success
+#define I2C_ERR_NACK      (-1)  // the slave did not acknowledge
+#define I2C_ASYNC_BUSY    (-2)  // still running
+#define I2C_ERR_STRETCH   (-3)  // a line held low beyond the stretch timeout, no STOP was sent
+#define I2C_ERR_TIMEOUT   (-4)  // no end within the driver timeout, see i2c_set_timeout()
+#define I2C_ERR_BUS       (-5)  // sda still low after the recovery clocks
+#define I2C_ERR_INVAL     (-6)  // empty message, or the bus is taken by another transfer
+
+// Defaults of the error handling
+#define I2C_TIMEOUT_US    50000UL   // two stretch timeouts
+#define I2C_RETRIES       2
+#define I2C_BACKOFF_US    100UL
+
+// Handle of channel n (0 to I2C_CHANNELS - 1), NULL outside. Every channel has its own
+// bus and runs its transfers independently of the others.
+struct i2c_channel *i2c_get_channel(int n);
+
+// Run the messages as one transaction: START, every following message after a
+// repeated START, STOP after the last one. Read messages ACK all bytes but the last.
+// The bus speed of the first message's device is used for the whole transaction.
+// Failed attempts are retried, see i2c_set_retry(). Returns num or an I2C_ERR_ code
+// within i2c_transfer_bound_us()
+int i2c_transfer(struct i2c_channel *ch, const struct i2c_msg *msgs, int num);
+
+// Longest wait of the driver for the end of a transfer, a recovery or a command
+// sequencer list, 0 waits forever. Without a timestamp timer the wait is counted in
+// status polls, roughly 10 per us.
+void i2c_set_timeout(unsigned long us);
+
+// Retries of i2c_transfer() after an error; a stretch or driver timeout runs the bus
+// recovery first. The n-th retry waits backoff_us << (n - 1) before it starts.
+void i2c_set_retry(int retries, unsigned long backoff_us);
+
+// The timeout and the retries hold for all channels.
+// Worst case time i2c_transfer() blocks with the current settings, 0 when unbounded
+unsigned long i2c_transfer_bound_us(void);
+
+// Bus recovery: up to nine scl pulses until a slave cut off in the middle of a byte
+// releases sda, then a STOP. Returns 0, I2C_ERR_BUS when sda stays low,
+// I2C_ERR_STRETCH when scl is held low, I2C_ERR_TIMEOUT, or I2C_ERR_INVAL while a
+// transfer runs
+int i2c_recover(struct i2c_channel *ch);
+
+// Non-blocking transfer, the caller owns the request until it completed
+struct i2c_async {
+    const struct i2c_msg *msgs;
+    int num;
+    void (*complete)(struct i2c_async *req);   // called from i2c_poll() or the ISR, may be NULL
+    void *context;
+    volatile int status;    // I2C_ASYNC_BUSY, then num or an I2C_ERR_ code
+    // driver state
+    int msg, pos;
+    byte wait;
+    byte fifo;              // messages run through the fifos and the packed data ports
+    struct i2c_channel *ch;
+};
+
+// Start the messages as one transaction (see i2c_transfer) and return at once, no retries.
+// Returns 0, or I2C_ERR_INVAL if a transfer is still running or a message is empty
+int i2c_submit(struct i2c_channel *ch, struct i2c_async *req, const struct i2c_msg *msgs, int num,
+               void (*complete)(struct i2c_async *req), void *context);
+
+// Advance the running transfer on the status register; call it from the main
+// loop while polling, it does nothing with interrupts enabled
+void i2c_poll(struct i2c_channel *ch);
+
+// 1 when the request completed, the result is in req->status
+int i2c_async_done(const struct i2c_async *req);
+
+// Block until the request completed, returns req->status. After the driver timeout
+// the transfer is abandoned with I2C_ERR_TIMEOUT
+int i2c_wait(struct i2c_async *req);
+
+// Shadow of the registers of one device. Volatile registers (bit n of the mask for
+// register n) are always read from the device and written to it at once. The others
+// are read from the device once, then from memory; a write that does not change the
+// value is dropped, a change is held until i2c_regcache_flush() writes the changed
+// registers in register order, one transaction per run.
+#define I2C_REGCACHE_MAX  32    // registers per device, 0 to 31
+#define I2C_REGCACHE_GAP  2     // unchanged registers a flush writes again to join two runs
+
+struct i2c_regcache_stats {
+    unsigned long writes;           // registers written by the caller
+    unsigned long elided;           // of them, unchanged and dropped
+    unsigned long reads;            // registers read by the caller
+    unsigned long hits;             // of them, served from memory
+    unsigned long transactions;     // on the bus
+};
+
+struct i2c_regcache {
+    struct i2c_channel *ch;
+    byte addr;
+    byte count;                     // registers 0 to count - 1
+    unsigned long volatile_mask;
+    unsigned long valid;            // the value in memory is the device's (or pending)
+    unsigned long dirty;            // changed, waiting for the flush
+    byte value[I2C_REGCACHE_MAX];
+    struct i2c_regcache_stats stats;
+};
+
+// Empty shadow of count registers of the device at addr on the channel
+void i2c_regcache_init(struct i2c_regcache *c, struct i2c_channel *ch, byte addr, int count,
+                       unsigned long volatile_mask);
+
+// Write len registers from reg on: volatile ones go to the device now (the result of
+// that is returned), the others into memory. Returns 0, an I2C_ERR_ code, or
+// I2C_ERR_INVAL for a range outside the device
+int i2c_regcache_write(struct i2c_regcache *c, byte reg, const byte *data, int len);
+
+// Read len registers from reg on, from memory when none of them is volatile or
+// unknown, otherwise in one transaction (pending writes keep their value)
+int i2c_regcache_read(struct i2c_regcache *c, byte reg, byte *data, int len);
+
+// Write the pending registers, a failed run stays pending. Returns 0 or the first error
+int i2c_regcache_flush(struct i2c_regcache *c);
+
+// Forget the values in memory, e.g. after a power cycle of the device. Pending writes are lost
+void i2c_regcache_invalidate(struct i2c_regcache *c);
+
+// Channel the DS3231 is on, channel 0 until set. Drops the cached time and temperature
+// and the shadow of its registers
+void rtc_set_channel(struct i2c_channel *ch);
+
+// Shadow of the DS3231 registers (RTC_REGISTERS, volatile RTC_VOLATILE_REGS), for the
+// alarms, control and aging offset
+struct i2c_regcache *rtc_regcache(void);
+
+// Set the RTC time: second, minute, hour, weekday, day, month, year (BCD)
+// Returns 0 or an I2C_ERR_ code, like the blocking reads within i2c_transfer_bound_us()
+int set_rtc_time(byte second, byte minute, byte hour,
+                 byte week_day, byte day, byte month, byte year);
+
+// Retrieve the RTC time via pointers, they are left alone on an error
+int get_rtc_time(byte *second, byte *minute, byte *hour,
+                 byte *week_day, byte *day, byte *month, byte *year);
+
+// Read temperature from RTC
+int get_rtc_temp_checked(float *temp);
+
+// Read temperature from RTC and return as float, RTC_TEMP_INVALID on an error
+float get_rtc_temp(void);
+
+// Non-blocking RTC reads, the request holds the messages and the raw registers
+struct rtc_request {
+    struct i2c_async xfer;      // first member, the callback argument points to the request
+    struct i2c_msg msgs[2];
+    byte reg;
+    byte raw[7];
+};
+
+int get_rtc_time_async(struct rtc_request *req,
+                       void (*complete)(struct i2c_async *xfer), void *context);
+int get_rtc_temp_async(struct rtc_request *req,
+                       void (*complete)(struct i2c_async *xfer), void *context);
+
+// Decode a completed request
+void rtc_decode_time(const struct rtc_request *req,
+                     byte *second, byte *minute, byte *hour,
+                     byte *week_day, byte *day, byte *month, byte *year);
+float rtc_decode_temp(const struct rtc_request *req);
+
+// Time from memory: the clock registers are read in one burst, then the seconds
+// are counted on the HAL timestamp timer (timestamp_timer in the BSP). The RTC is
+// read again after the resync interval or when the count reaches the next minute,
+// so no date arithmetic is done here. In between the time lags the RTC by less than
+// a second (the phase of its seconds is not known) plus the timer drift. Without a
+// timestamp timer every call reads the RTC. With a 32 bit timer, call it at least
+// once per timer wrap (85 s at 50 MHz). Returns 0, or the error of a failed read.
+int get_rtc_time_cached(byte *second, byte *minute, byte *hour,
+                        byte *week_day, byte *day, byte *month, byte *year);
+
+// Temperature from memory, read again after the temperature interval. A failed read
+// keeps the last value (RTC_TEMP_INVALID before the first one)
+float get_rtc_temp_cached(void);
+
+// Resync intervals of the cached time and temperature in ms, 0 keeps the current value
+void rtc_cache_interval(unsigned long time_ms, unsigned long temp_ms);
+
+// ms since the cached time or temperature was read from the RTC, RTC_AGE_NONE before
+// the first read
+unsigned long rtc_time_age_ms(void);
+unsigned long rtc_temp_age_ms(void);
+
+// Bus speed used for transactions to the given 7 bit address (100 kHz, 400 kHz or 1 MHz)
+// Returns 0 on success, -1 for an unsupported speed or a full device table
+int i2c_set_device_speed(struct i2c_channel *ch, byte address, unsigned long hz);
+
+// Longest clock stretch a slave may do before the transaction is abandoned, 0 waits forever
+void i2c_set_stretch_timeout(struct i2c_channel *ch, unsigned long us);
+
+// Finish transactions on the interrupt line instead of polling STATUS_REGISTER
+// (not while a transfer is running). The channels share one line, the first call
+// registers the ISR.
+int i2c_enable_interrupts(struct i2c_channel *ch);
+
+// Go back to polling STATUS_REGISTER
+void i2c_disable_interrupts(struct i2c_channel *ch);
+
+// Command sequencer descriptor, one transfer to one slave
+struct i2c_desc {
+    unsigned int next;              // bus address of the next descriptor, 0 ends the list
+    unsigned int control;           // I2C_DESC_LEN(n), I2C_DESC_READ, I2C_DESC_STOP, [6:0]=slave address
+    unsigned int buffer;            // bus address of the data, word aligned
+    volatile unsigned int status;   // written back by the core, see I2C_DESC_DONE
+};
+#define I2C_DESC_LEN(n)      (((unsigned int)(n) & 0xFFFF) << 16)
+#define I2C_DESC_READ        0x0100
+#define I2C_DESC_STOP        0x0200       // STOP after this descriptor, otherwise a repeated START follows
+#define I2C_DESC_DONE        0x80000000U
+#define I2C_DESC_NACK        0x00010000U
+#define I2C_DESC_TIMEOUT     0x00020000U
+#define I2C_DESC_COUNT(st)   ((st) & 0xFFFF)   // bytes transferred
+
+// Fill a descriptor and link it to next (NULL ends the list, always with a STOP).
+// flags: I2C_DESC_READ, I2C_DESC_STOP; len at least 1
+void i2c_desc_set(struct i2c_desc *d, byte addr, unsigned int flags,
+                  byte *buf, unsigned short len, struct i2c_desc *next);
+
+// Run a descriptor list on the core without the cpu, the list stops at the first NACK
+// or stretch timeout. The bus speed of the first descriptor's device is used.
+// Returns 0, or I2C_ERR_INVAL while a transfer or another list is running
+int i2c_seq_start(struct i2c_channel *ch, struct i2c_desc *list);
+
+// 1 while the list runs; polling mode advances on the status register like i2c_poll()
+int i2c_seq_busy(struct i2c_channel *ch);
+
+// Block until the list finished, returns 0, -1 when a descriptor failed, or
+// I2C_ERR_TIMEOUT after the driver timeout (the list keeps running)
+int i2c_seq_wait(struct i2c_channel *ch);
+
+// Let the core read len registers from first on of the slave every period_ms (at least 1)
+// without the cpu. The polls run between the other transfers, at the bus speed set
+// up for the last of them. Returns 0, or -1 for a len outside 1 to POLL_MAX
+int i2c_autopoll_start(struct i2c_channel *ch, byte addr, byte first, int len, unsigned int period_ms);
+
+void i2c_autopoll_stop(struct i2c_channel *ch);
+
+// Copy len mirrored registers from first on (relative to the polled range) out of
+// one poll. age_ms, if not NULL, gets the ms since that poll.
+// Returns the number of that poll, 0 if none completed yet
+unsigned long i2c_autopoll_read(struct i2c_channel *ch, byte *buf, int first, int len,
+                                unsigned int *age_ms);
+
+// Hardware performance counters, 32 bit and wrapping
+struct i2c_perf {
+    unsigned long tx_bytes, rx_bytes, transactions, nacks;
+    unsigned long busy_cycles, stall_cycles, stretch_cycles, cycles;
+};
+
+// Snapshot and read the counters, clear != 0 restarts them after the snapshot
+void i2c_perf_read(struct i2c_channel *ch, struct i2c_perf *p, int clear);
+
+// Empty the bus trace and record with control: TRACE_STATES_BIT, one TRACE_TRIGGER_*
+// with TRACE_ADDRESS and TRACE_POST, TRACE_PRESCALE. Without a trigger the newest
+// entries are kept until i2c_trace_stop()
+void i2c_trace_start(struct i2c_channel *ch, unsigned long control);
+
+// Stop recording, the entries stay until they are read or the next start
+void i2c_trace_stop(struct i2c_channel *ch);
+
+// Pop up to max entries, oldest first, status (if not NULL) gets the trace status
+// from before the reads. Returns the number of entries read
+int i2c_trace_read(struct i2c_channel *ch, unsigned long *entries, int max, unsigned long *status);
+
+// Print entries, one line each with the time since the first, prescale as recorded
+void i2c_trace_print(const unsigned long *entries, int n, unsigned int prescale);
+
+// Driver tracing, compiled in with I2C_DRIVER_TRACE defined as 1 (before this header or
+// on the command line), nothing of it is in the driver otherwise. Every i2c_transfer()
+// and get_rtc_time() is timed on the timestamp timer into a latency histogram of its
+// kind, with its status polls and bytes, and the transfers, retries, recoveries and
+// interrupts are logged with a time stamp into a ring buffer in RAM.
+#ifndef I2C_DRIVER_TRACE
+#define I2C_DRIVER_TRACE  0
+#endif
+
+#if I2C_DRIVER_TRACE
+
+#define I2C_LOG_DEPTH     256   // events kept, power of two
+#define I2C_HIST_SUB      4     // histogram buckets per power of two
+#define I2C_HIST_BUCKETS  (32 * I2C_HIST_SUB)
+
+// Kinds of operation, a transfer is classified by its messages
+enum i2c_op {
+    I2C_OP_WRITE_BYTE,      // one write message of at most 2 bytes (register pointer, data)
+    I2C_OP_READ_BYTE,       // reads one byte
+    I2C_OP_BURST_WRITE,     // writes more than 2 bytes
+    I2C_OP_BURST_READ,      // reads more than one byte
+    I2C_OP_RTC_TIME,        // get_rtc_time(), its transfer counts as a burst read as well
+    I2C_OP_COUNT
+};
+
+struct i2c_op_stats {
+    unsigned long count;
+    unsigned long errors;           // ended with an I2C_ERR_ code after the retries
+    unsigned long retries;
+    unsigned long polls;            // reads of STATUS_REGISTER
+    unsigned long long bytes;       // data bytes of the completed operations
+    unsigned long long ticks;       // timestamp ticks, for the mean
+    unsigned long min, max;         // ticks
+    unsigned long hist[I2C_HIST_BUCKETS];
+};
+
+// Log events, arg and value per type
+#define I2C_LOG_START     1     // op, arg: address, value: bytes
+#define I2C_LOG_END       2     // op, arg: status polls, value: result
+#define I2C_LOG_RETRY     3     // arg: attempt, value: result of the failed one
+#define I2C_LOG_RECOVER   4     // value: result of i2c_recover()
+#define I2C_LOG_ABORT     5     // the driver timeout ended a transfer
+#define I2C_LOG_IRQ       6     // value: status events handled by the ISR
+
+struct i2c_log_event {
+    alt_timestamp_type time;
+    byte type;
+    byte op;
+    unsigned short arg;
+    long value;
+};
+
+// Statistics of one kind, NULL outside
+const struct i2c_op_stats *i2c_stats_get(enum i2c_op op);
+
+// Latency in us below which permille of the operations ended (500: median), the upper
+// end of the histogram bucket; 0 without operations or a timestamp timer
+unsigned long i2c_stats_percentile_us(enum i2c_op op, unsigned int permille);
+
+// Clear the statistics and the log
+void i2c_stats_clear(void);
+
+// One line per kind: count, errors, p50/p99/max/mean latency, polls per operation
+void i2c_stats_print(void);
+
+// Copy the newest events into log, up to max, oldest first. Returns the number copied
+int i2c_log_read(struct i2c_log_event *log, int max);
+
+// Print events, one line each with the time since the first
+void i2c_log_print(const struct i2c_log_event *log, int n);
+
+#endif // I2C_DRIVER_TRACE
+
+#endif // RTC_DRIVER_H
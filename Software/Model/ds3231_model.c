@@ -0,0 +1,119 @@
+#include <string.h>
+#include "ds3231_model.h"
+
+#define REG_SECONDS    0x00
+#define REG_MINUTES    0x01
+#define REG_HOURS      0x02
+#define REG_WEEKDAY    0x03
+#define REG_DAY        0x04
+#define REG_MONTH      0x05
+#define REG_YEAR       0x06
+#define REG_TEMP_HIGH  0x11
+#define REG_TEMP_LOW   0x12
+
+static unsigned char from_bcd(unsigned char v) {
+    return ((v >> 4) * 10) + (v & 0x0F);
+}
+
+static unsigned char to_bcd(unsigned char v) {
+    return ((v / 10) << 4) | (v % 10);
+}
+
+// Increment a BCD register, returns 1 on wrap around to first
+static int count(unsigned char *reg, unsigned char mask, int first, int last) {
+    int v = from_bcd(*reg & mask) + 1;
+    if (v > last) {
+        *reg = (*reg & ~mask) | to_bcd(first);
+        return 1;
+    }
+    *reg = (*reg & ~mask) | to_bcd(v);
+    return 0;
+}
+
+static int days_in_month(int month, int year) {
+    static const int days[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    if (month == 2 && (year % 4) == 0) {
+        return 29;
+    }
+    return days[(month - 1) % 12];
+}
+
+// One second, 24 hour mode only
+static void tick(struct ds3231_model *rtc) {
+    unsigned char *r = rtc->regs;
+    if (!count(&r[REG_SECONDS], 0x7F, 0, 59)) {
+        return;
+    }
+    if (!count(&r[REG_MINUTES], 0x7F, 0, 59)) {
+        return;
+    }
+    if (!count(&r[REG_HOURS], 0x3F, 0, 23)) {
+        return;
+    }
+    count(&r[REG_WEEKDAY], 0x07, 1, 7);
+    if (!count(&r[REG_DAY], 0x3F, 1, days_in_month(from_bcd(r[REG_MONTH] & 0x1F),
+                                                      from_bcd(r[REG_YEAR])))) {
+        return;
+    }
+    if (!count(&r[REG_MONTH], 0x1F, 1, 12)) {
+        return;
+    }
+    count(&r[REG_YEAR], 0xFF, 0, 99);
+}
+
+// Catch up with the model time
+static void sync(struct ds3231_model *rtc) {
+    uint64_t now = i2c_model_now();
+    while (now - rtc->time_base >= I2C_MODEL_CLK_HZ) {
+        rtc->time_base += I2C_MODEL_CLK_HZ;
+        tick(rtc);
+    }
+}
+
+static void rtc_start(void *ctx) {
+    struct ds3231_model *rtc = ctx;
+    sync(rtc);
+    rtc->first_write = 1;
+}
+
+static int rtc_write(void *ctx, unsigned char data) {
+    struct ds3231_model *rtc = ctx;
+    if (rtc->first_write) {
+        rtc->first_write = 0;
+        rtc->ptr = data % DS3231_REGISTERS;
+        return 1;
+    }
+    if (rtc->ptr == REG_SECONDS) {
+        // writing the seconds restarts the countdown chain
+        rtc->time_base = i2c_model_now();
+    }
+    if (rtc->ptr != REG_TEMP_HIGH && rtc->ptr != REG_TEMP_LOW) {
+        rtc->regs[rtc->ptr] = data;
+    }
+    rtc->ptr = (rtc->ptr + 1) % DS3231_REGISTERS;
+    return 1;
+}
+
+static unsigned char rtc_read(void *ctx) {
+    struct ds3231_model *rtc = ctx;
+    unsigned char v = rtc->regs[rtc->ptr];
+    rtc->ptr = (rtc->ptr + 1) % DS3231_REGISTERS;
+    return v;
+}
+
+void ds3231_model_init(struct ds3231_model *rtc) {
+    memset(rtc, 0, sizeof(*rtc));
+    rtc->regs[REG_WEEKDAY] = 0x01;
+    rtc->regs[REG_DAY] = 0x01;
+    rtc->regs[REG_MONTH] = 0x01;
+    rtc->regs[REG_TEMP_HIGH] = 0x19;   // 25.25 degrees
+    rtc->regs[REG_TEMP_LOW] = 0x40;
+    rtc->time_base = i2c_model_now();
+
+    rtc->slave.address = DS3231_ADDRESS;
+    rtc->slave.ctx = rtc;
+    rtc->slave.start = rtc_start;
+    rtc->slave.write = rtc_write;
+    rtc->slave.read = rtc_read;
+    rtc->slave.stop = NULL;
+}
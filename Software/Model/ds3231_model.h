@@ -0,0 +1,22 @@
+/* ds3231_model.h */
+#ifndef DS3231_MODEL_H
+#define DS3231_MODEL_H
+
+#include "i2c_model.h"
+
+#define DS3231_ADDRESS    0x68
+#define DS3231_REGISTERS  0x13
+
+// DS3231 on the modelled bus: register pointer with auto increment, the time
+// registers count with the model time and are latched at every START
+struct ds3231_model {
+    unsigned char regs[DS3231_REGISTERS];
+    unsigned char ptr;
+    int first_write;            // the first byte of a write sets the pointer
+    uint64_t time_base;         // model time of the last seconds update
+    struct i2c_slave_model slave;
+};
+
+void ds3231_model_init(struct ds3231_model *rtc);
+
+#endif // DS3231_MODEL_H
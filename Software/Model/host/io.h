@@ -0,0 +1,10 @@
+/* io.h for the host build, register accesses go through the i2c_regs layer */
+#ifndef IO_H
+#define IO_H
+
+#include "i2c_regs.h"
+
+#define IORD_32DIRECT(base, offset)        i2c_regs_read((base), (offset))
+#define IOWR_32DIRECT(base, offset, data)  i2c_regs_write((base), (offset), (data))
+
+#endif // IO_H
@@ -0,0 +1,42 @@
+/* sys/alt_irq.h for the host build, the irq line of the backend calls the handler */
+#ifndef ALT_IRQ_H
+#define ALT_IRQ_H
+
+#include "i2c_regs.h"
+
+typedef void (*alt_isr_func)(void *isr_context);
+
+static inline int alt_ic_isr_register(unsigned int ic_id, unsigned int irq,
+                                      alt_isr_func isr, void *isr_context, void *flags) {
+    (void)ic_id;
+    (void)irq;
+    (void)flags;
+    return i2c_regs_register_isr(isr, isr_context);
+}
+
+// The line of the core, a disabled line does not call the handler and the backend does not wait for it
+static inline int alt_ic_irq_enable(unsigned int ic_id, unsigned int irq) {
+    (void)ic_id;
+    (void)irq;
+    i2c_regs_irq_line(1);
+    return 0;
+}
+
+static inline int alt_ic_irq_disable(unsigned int ic_id, unsigned int irq) {
+    (void)ic_id;
+    (void)irq;
+    i2c_regs_irq_line(0);
+    return 0;
+}
+
+typedef unsigned int alt_irq_context;
+
+static inline alt_irq_context alt_irq_disable_all(void) {
+    return i2c_regs_irq_disable();
+}
+
+static inline void alt_irq_enable_all(alt_irq_context context) {
+    i2c_regs_irq_restore(context);
+}
+
+#endif // ALT_IRQ_H
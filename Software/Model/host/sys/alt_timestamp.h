@@ -0,0 +1,21 @@
+/* sys/alt_timestamp.h for the host build, the timestamp counts core clock cycles of the model */
+#ifndef ALT_TIMESTAMP_H
+#define ALT_TIMESTAMP_H
+
+#include "host_board.h"
+
+typedef uint32_t alt_timestamp_type;   // a 32 bit timer, wraps like the Nios interval timer
+
+static inline int alt_timestamp_start(void) {
+    return 0;
+}
+
+static inline alt_timestamp_type alt_timestamp(void) {
+    return host_timestamp();
+}
+
+static inline uint32_t alt_timestamp_freq(void) {
+    return host_timestamp_freq();
+}
+
+#endif // ALT_TIMESTAMP_H
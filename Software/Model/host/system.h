@@ -0,0 +1,14 @@
+/* system.h for the host build, the Nios BSP version is generated by Platform Designer */
+#ifndef SYSTEM_H
+#define SYSTEM_H
+
+#include "host_board.h"
+
+// Waiting for an interrupt lets the backend advance, see i2c_regs_idle()
+#define I2C_IDLE_HOOK()   i2c_regs_idle()
+
+// Descriptors and buffers of the command sequencer, mapped into the model by host_board
+#define I2C_SEQ_MEM         __attribute__((section("i2c_seq_mem"), aligned(4)))
+#define I2C_BUS_ADDRESS(p)  host_bus_address(p)
+
+#endif // SYSTEM_H
@@ -0,0 +1,66 @@
+#include <stdlib.h>
+#include "host_board.h"
+#include "i2c_model.h"
+#include "ds3231_model.h"
+
+// Bus address of the I2C_SEQ_MEM section, as an on-chip memory in Platform Designer
+#define HOST_SEQ_MEM_BASE  0x00010000UL
+
+// I2C_0_BASE of the driver, the model finds the channel in the offset from it
+#define HOST_I2C_BASE      0x00081000UL
+
+// A DS3231 on the bus of every channel
+static struct ds3231_model rtc[I2C_MODEL_CHANNELS];
+
+// Bounds of the section, null when the program has no I2C_SEQ_MEM variable
+extern char __start_i2c_seq_mem[] __attribute__((weak));
+extern char __stop_i2c_seq_mem[] __attribute__((weak));
+
+static uint32_t model_read(void *ctx, uint32_t base, uint32_t offset) {
+    (void)ctx;
+    return i2c_model_read(base - HOST_I2C_BASE + offset);
+}
+
+static void model_write(void *ctx, uint32_t base, uint32_t offset, uint32_t value) {
+    (void)ctx;
+    i2c_model_write(base - HOST_I2C_BASE + offset, value);
+}
+
+static void model_idle(void *ctx) {
+    (void)ctx;
+    i2c_model_idle();
+}
+
+static const struct i2c_reg_backend model_backend = {
+    "model", model_read, model_write, model_idle, NULL
+};
+
+static void report(void) {
+    i2c_model_report(stderr);
+}
+
+uint32_t host_bus_address(const void *p) {
+    return p == NULL ? 0 : HOST_SEQ_MEM_BASE + (uint32_t)((const char *)p - __start_i2c_seq_mem);
+}
+
+uint32_t host_timestamp(void) {
+    return (uint32_t)i2c_model_now();
+}
+
+uint32_t host_timestamp_freq(void) {
+    return I2C_MODEL_CLK_HZ;
+}
+
+const struct i2c_reg_backend *host_board_init(void) {
+    int c;
+    for (c = 0; c < I2C_MODEL_CHANNELS; c++) {
+        ds3231_model_init(&rtc[c]);
+        i2c_model_attach_channel(c, &rtc[c].slave);
+    }
+    if (__start_i2c_seq_mem != NULL) {
+        i2c_model_map_memory(__start_i2c_seq_mem, HOST_SEQ_MEM_BASE,
+                             (uint32_t)(__stop_i2c_seq_mem - __start_i2c_seq_mem));
+    }
+    atexit(report);
+    return &model_backend;
+}
@@ -0,0 +1,20 @@
+/* host_board.h */
+#ifndef HOST_BOARD_H
+#define HOST_BOARD_H
+
+#include "i2c_regs.h"
+
+// Default board of the host build: the i2c_top model with a DS3231 at 0x68 (one per
+// channel with I2C_MODEL_CHANNELS).
+// The model statistics are printed to stderr when the program exits.
+const struct i2c_reg_backend *host_board_init(void);
+
+// Bus address of a variable in the I2C_SEQ_MEM section, the memory the command
+// sequencer of the model reaches
+uint32_t host_bus_address(const void *p);
+
+// Timestamp timer of the host build, the model time in core clock cycles
+uint32_t host_timestamp(void);
+uint32_t host_timestamp_freq(void);
+
+#endif // HOST_BOARD_H
@@ -0,0 +1,1700 @@
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include "i2c_model.h"
+#include "i2c_regs.h"
+
+// Cost of a CPU access in core clock cycles (Avalon transfer of an uncached IORD/IOWR)
+#ifndef I2C_MODEL_ACCESS_CYCLES
+#define I2C_MODEL_ACCESS_CYCLES  6
+#endif
+
+// Time the CPU spends in I2C_IDLE_HOOK() before it looks at the interrupt again
+#ifndef I2C_MODEL_IDLE_CYCLES
+#define I2C_MODEL_IDLE_CYCLES    50
+#endif
+
+// Register offsets and bits, same map as i2c_registerbank
+#define REG_CONTROL       0x00
+#define REG_WRITE         0x04
+#define REG_STATUS        0x08
+#define REG_READ          0x0C
+#define REG_IRQ_ENABLE    0x10
+#define REG_TX_DATA       0x14
+#define REG_RX_DATA       0x18
+#define REG_FIFO_STATUS   0x1C
+#define REG_FIFO_CONTROL  0x20
+#define REG_SCL_TIMING    0x24
+#define REG_START_TIMING  0x28
+#define REG_STOP_TIMING   0x2C
+#define REG_PERF_CONTROL  0x30
+#define REG_PERF_TX       0x34   // first counter, PERF_* order up to 0x50
+#define REG_STRETCH_LIMIT 0x54
+#define REG_TX_HOLD       0x58
+#define REG_ADDRESS       0x5C
+#define REG_TX_PACKED     0x60
+#define REG_PACK_CONTROL  0x64
+#define REG_RX_PACKED     0x68
+#define REG_SEQ_CONTROL   0x6C
+#define REG_SEQ_HEAD      0x70
+#define REG_SEQ_CURRENT   0x74
+#define REG_POLL_CONTROL  0x78
+#define REG_POLL_RANGE    0x7C
+#define REG_POLL_COUNT    0x80
+#define REG_POLL_STATUS   0x84
+#define REG_TRACE_CONTROL 0x88
+#define REG_TRACE_STATUS  0x8C
+#define REG_TRACE_DATA    0x90
+#define REG_NEXT          0x94
+#define REG_POLL_MIRROR   0xE0   // 8 words up to 0xFC
+
+// Shared registers of i2c_multi_top, in the window after the last channel
+#define REG_IRQ_SUMMARY   0x00
+#define REG_CHANNELS      0x04
+
+#define CTRL_ENABLE       0x01
+#define CTRL_STOP         0x02
+#define CTRL_RW           0x04
+#define CTRL_CONTINUE     0x08
+#define CTRL_RESTART      0x10
+#define CTRL_RECOVER      0x20
+
+#define NEXT_ENABLE       0x10000  // control bits of the next transaction in [19:16]
+#define NEXT_MASK         0xE7FFFUL
+
+#define ST_DONE           0x01
+#define ST_ACKERROR       0x04
+#define ST_READY          0x08
+#define ST_TIMEOUT        0x40
+#define ST_HOLD_EMPTY     0x80
+#define ST_SEQ_DONE       0x100
+
+// scl synchronizer of the master, the high period starts this many cycles after scl is released
+#define SCL_SYNC_CYCLES   2
+
+#define PACK_STOP         0x08
+
+#define SEQ_START         0x01
+
+#define POLL_ENABLE       0x01
+#define POLL_MAX          32     // mirror bytes
+
+#define TRACE_ENABLE      0x01
+#define TRACE_CLEAR       0x02
+#define TRACE_CONTROL_MASK 0x0FFF7F35UL
+
+// Bus trace entry types and trigger modes
+#define TRACE_START       1
+#define TRACE_STOP        2
+#define TRACE_BYTE        3
+#define TRACE_TIMEOUT     4
+#define TRIGGER_NACK      1
+#define TRIGGER_ADDRESS   2
+#define TRIGGER_TIMEOUT   3
+#define TRACE_DELTA_MAX   0x7FFFFUL
+
+// Descriptor control word of the command sequencer
+#define DESC_READ         0x100
+#define DESC_STOP         0x200
+
+// Descriptor status word written back
+#define DESC_DONE         0x80000000UL
+#define DESC_NACK         0x00010000UL
+#define DESC_TIMEOUT      0x00020000UL
+
+#define PERF_SNAPSHOT     0x01
+#define PERF_CLEAR        0x02
+
+// Performance counters in register order
+enum perf_counter {
+    PERF_TX,
+    PERF_RX,
+    PERF_TRANS,
+    PERF_NACK,
+    PERF_BUSY,
+    PERF_STALL,
+    PERF_STRETCH,
+    PERF_CYCLES,
+    PERF_COUNT
+};
+
+// Position of the master, timed phases and the points where it waits for the cpu
+enum bus_state {
+    BUS_IDLE,
+    BUS_START,
+    BUS_ADDRESS,
+    BUS_WRITE,
+    BUS_READ,
+    BUS_MASTER_ACK,
+    BUS_RESTART,
+    BUS_STOP,
+    BUS_WAIT_WRITE,
+    BUS_WAIT_READ,
+    BUS_TIMEOUT,               // slave holds scl beyond the stretch timeout
+    BUS_RECOVER                // scl pulses until sda is released
+};
+
+// Where the auto poller is within its transaction
+enum poll_state {
+    POLL_POINTER,              // register pointer on the bus, the read follows with a repeated start
+    POLL_READ,
+    POLL_WAIT_DONE
+};
+
+// Where the command sequencer is within the running descriptor
+enum seq_state {
+    SEQ_WRITE,                 // bytes of the buffer go to the master
+    SEQ_WRITE_END,             // last byte taken, the next descriptor follows with a repeated start
+    SEQ_READ,
+    SEQ_WAIT_DONE              // stop given, waiting for the end of the transaction
+};
+
+struct model {
+    uint64_t t;                // time of the bus, catches up with the time of the cpu
+    uint64_t phase_end;
+    int phase_active;
+    enum bus_state state;
+
+    // registers
+    uint32_t write_reg;
+    int rw;
+    uint32_t irq_enable;
+    unsigned char read_reg;
+    uint32_t pending;          // ready, ack_error and done flags of STATUS
+
+    int fifo_enable;
+    unsigned int tx_threshold, rx_threshold, rx_length;
+    uint16_t tx[I2C_MODEL_FIFO_DEPTH];
+    unsigned int tx_head, tx_count;
+    unsigned char rx[I2C_MODEL_FIFO_DEPTH];
+    unsigned int rx_head, rx_count;
+    int rx_active;
+    unsigned int rx_remaining;
+    unsigned int pack_tx_count, pack_rx_count;   // packed data ports
+    int pack_stop;
+
+    uint16_t hold;             // holding register, next byte of a write in register mode
+    int hold_full;
+
+    // next transaction, goes to the master when the running cpu transaction ends without an error
+    uint32_t next;
+    int next_full, next_due;
+    int next_waiting;          // given to the master, not started yet
+    int cpu_transfer;          // between the enable of a cpu transaction and its done
+
+    // command sequencer, drives the master while running
+    int seq_running, seq_error;
+    enum seq_state seq_state;
+    uint32_t seq_head;
+    uint32_t desc_addr, desc_next, desc_buf;
+    unsigned int desc_len, desc_count;
+    unsigned char desc_slave;
+    int desc_read, desc_stop, new_start;
+
+    // auto poller, has the master while running, the cpu view of the status flags is
+    // frozen while it owns the master (until the next transaction starts)
+    uint32_t poll_control;
+    unsigned int poll_first, poll_length;
+    int poll_running, poll_owner, poll_rw, poll_failed;
+    enum poll_state poll_state;
+    unsigned int poll_bytes;
+    unsigned char poll_mirror[2][POLL_MAX];
+    int poll_front;
+    uint32_t poll_count;
+    int poll_started, poll_updated;
+    uint64_t poll_last_start, poll_last_update;
+    int cpu_start_held, cpu_continue_held, seq_start_held;
+    int cpu_stop_held, cpu_restart_held;
+
+    // bus trace, oldest entry at trace_head
+    uint32_t trace_control;
+    uint32_t trace_buf[I2C_MODEL_TRACE_DEPTH];
+    unsigned int trace_head, trace_count, trace_post;
+    int trace_triggered, trace_stopped, trace_wrapped;
+    uint64_t trace_last;       // time of the last entry, delta counts from here
+
+    uint16_t scl_low, scl_high, tsu_sta, thd_sta, tsu_sto, tbuf;
+    uint32_t stretch_limit;
+
+    // master
+    int busy, done, ack_error, ready, timeout;
+    int start_pending, transaction_pending, stop_pending, restart_pending;
+    int recover, recover_ok;   // the pending start is a bus recovery, and its outcome
+    int seq_read, master_nack;
+    unsigned char addr_rw, transfer;
+    uint64_t last_stop, start_time, stall_start;
+    uint64_t stretch_until;    // the slave releases scl at this time
+    const struct i2c_slave_model *selected;
+
+    // performance counters, busy, stall and cycles are added up from m->t when read
+    uint32_t perf[PERF_COUNT];
+    uint32_t perf_snap[PERF_COUNT];
+    uint64_t perf_base;        // time of the last clear
+
+    const struct i2c_slave_model *slaves[I2C_MODEL_MAX_SLAVES];
+    int slave_count;
+
+    // scl pulses a slave still holds sda low for, the reset of the core does not reach it
+    unsigned int sda_hold;
+
+    struct i2c_model_stats stats;
+};
+
+// The channels of i2c_multi_top, m is the one the register access goes to
+static struct model channel[I2C_MODEL_CHANNELS];
+static struct model *m = &channel[0];
+static uint64_t now;           // time of the cpu
+static int initialized = 0;
+static int trace_on = 0;
+
+// Memory on the Avalon master of the sequencer, kept over a reset like the slaves
+static struct {
+    unsigned char *host;
+    uint32_t base, size;
+} mem;
+
+static void run_until(uint64_t target);
+
+static void trace(const char *fmt, ...) {
+    va_list ap;
+    if (trace_on) {
+        va_start(ap, fmt);
+        vfprintf(stderr, fmt, ap);
+        va_end(ap);
+    }
+}
+
+static void reset_channel(void) {
+    const struct i2c_slave_model *slaves[I2C_MODEL_MAX_SLAVES];
+    struct i2c_model_stats stats = m->stats;
+    int slave_count = m->slave_count;
+    unsigned int sda_hold = m->sda_hold;
+    unsigned int half = I2C_MODEL_CLK_HZ / (100000UL * 2);
+    unsigned int per_us = I2C_MODEL_CLK_HZ / 1000000UL;
+
+    memcpy(slaves, m->slaves, sizeof(slaves));
+    memset(m, 0, sizeof(*m));
+    memcpy(m->slaves, slaves, sizeof(slaves));
+    m->slave_count = slave_count;
+    m->stats = stats;
+    m->sda_hold = sda_hold;
+    m->t = now;
+    m->perf_base = now;
+    m->trace_last = now;
+
+    // timing reset values, 100 kHz and the standard mode minimum setup/hold times
+    m->scl_low = half;
+    m->scl_high = half;
+    m->tsu_sta = per_us * 47 / 10;
+    m->thd_sta = per_us * 4;
+    m->tsu_sto = per_us * 4;
+    m->tbuf = per_us * 47 / 10;
+    m->stretch_limit = I2C_MODEL_CLK_HZ / 40;
+    m->pack_tx_count = 4;
+    m->poll_length = POLL_MAX;
+    m->master_nack = 1;
+    m->state = BUS_IDLE;
+}
+
+void i2c_model_reset(void) {
+    int c;
+    for (c = 0; c < I2C_MODEL_CHANNELS; c++) {
+        m = &channel[c];
+        reset_channel();
+    }
+    m = &channel[0];
+    initialized = 1;
+}
+
+static void init(void) {
+    const char *env;
+    if (initialized) {
+        return;
+    }
+    i2c_model_reset();
+    env = getenv("I2C_MODEL_TRACE");
+    trace_on = env != NULL && env[0] == '1';
+}
+
+void i2c_model_hold_sda(unsigned int pulses) {
+    channel[0].sda_hold = pulses;
+}
+
+int i2c_model_attach_channel(int ch, const struct i2c_slave_model *slave) {
+    struct model *c;
+    init();
+    if (ch < 0 || ch >= I2C_MODEL_CHANNELS || channel[ch].slave_count == I2C_MODEL_MAX_SLAVES) {
+        return -1;
+    }
+    c = &channel[ch];
+    c->slaves[c->slave_count++] = slave;
+    return 0;
+}
+
+int i2c_model_attach(const struct i2c_slave_model *slave) {
+    return i2c_model_attach_channel(0, slave);
+}
+
+void i2c_model_map_memory(void *host, uint32_t bus_address, uint32_t size) {
+    mem.host = host;
+    mem.base = bus_address;
+    mem.size = size;
+}
+
+uint64_t i2c_model_now(void) {
+    return now;
+}
+
+void i2c_model_trace(int on) {
+    init();
+    trace_on = on;
+}
+
+// ---- bus trace
+
+// Entry at time t (not before the last one), trigger tells whether it fires the trigger
+static void trace_entry(uint64_t t, unsigned int type, unsigned int payload, int trigger) {
+    unsigned int prescale = (m->trace_control >> 24) & 0xF;
+    uint64_t delta = t > m->trace_last ? (t - m->trace_last) >> prescale : 0;
+
+    if (!(m->trace_control & TRACE_ENABLE) || m->trace_stopped) {
+        return;
+    }
+    m->trace_last = t;
+    if (delta > TRACE_DELTA_MAX) {
+        delta = TRACE_DELTA_MAX;
+    }
+    if (m->trace_count == I2C_MODEL_TRACE_DEPTH) {
+        m->trace_head = (m->trace_head + 1) % I2C_MODEL_TRACE_DEPTH;
+        m->trace_count--;
+        m->trace_wrapped = 1;
+    }
+    m->trace_buf[(m->trace_head + m->trace_count++) % I2C_MODEL_TRACE_DEPTH] =
+        ((uint32_t)type << 29) | (trigger ? 1UL << 28 : 0) | ((uint32_t)payload << 19) | (uint32_t)delta;
+
+    // post trigger entries
+    if (!m->trace_triggered && trigger) {
+        m->trace_triggered = 1;
+        m->trace_post = (m->trace_control >> 16) & 0xFF;
+        m->trace_stopped = m->trace_post == 0;
+    } else if (m->trace_triggered) {
+        m->trace_stopped = --m->trace_post == 0;
+    }
+}
+
+static void trace_byte(unsigned char data, int nack, int first) {
+    unsigned int mode = (m->trace_control >> 4) & 3;
+    int trigger = (mode == TRIGGER_NACK && nack && (first || !(m->addr_rw & 1)))
+               || (mode == TRIGGER_ADDRESS && first && (data >> 1) == ((m->trace_control >> 8) & 0x7F));
+    trace_entry(m->t, TRACE_BYTE, (nack ? 0x100 : 0) | data, trigger);
+}
+
+static void trace_clear(void) {
+    m->trace_head = 0;
+    m->trace_count = 0;
+    m->trace_triggered = 0;
+    m->trace_stopped = 0;
+    m->trace_wrapped = 0;
+    m->trace_last = m->t;
+}
+
+static uint32_t trace_pop(void) {
+    uint32_t v;
+    if (m->trace_count == 0) {
+        return 0;
+    }
+    v = m->trace_buf[m->trace_head];
+    m->trace_head = (m->trace_head + 1) % I2C_MODEL_TRACE_DEPTH;
+    m->trace_count--;
+    return v;
+}
+
+static uint32_t trace_status(void) {
+    return ((uint32_t)m->trace_count << 16) | (m->trace_wrapped << 3) | (m->trace_stopped << 2)
+         | (m->trace_triggered << 1) | ((m->trace_control & TRACE_ENABLE) && !m->trace_stopped);
+}
+
+// ---- status flags, set on the rising edge of the master signal and dropped with it
+
+static void set_flag(int *level, uint32_t bit, int value) {
+    if (m->poll_owner) {
+        *level = value;
+    } else if (value && !*level) {
+        m->pending |= bit;
+    } else if (!value) {
+        m->pending &= ~bit;
+    }
+    *level = value;
+}
+
+static void seq_end_descriptor(uint32_t flags);
+static void poll_end(int failed);
+static void poll_pointer_acked(void);
+
+static void set_done(int value) {
+    int rising = value && !m->done;
+
+    if (rising) {
+        m->rx_active = 0;
+        m->hold_full = 0;
+    }
+    // the next transaction starts with the stop that follows, an error drops it
+    if (rising && !m->poll_running) {
+        m->cpu_transfer = 0;
+        if (m->next_full && !m->seq_running) {
+            m->next_due = !m->ack_error && !m->timeout;
+            m->next_full = m->next_due;
+        }
+    }
+    set_flag(&m->done, ST_DONE, value);
+    // ack error and timeout are set before done
+    if (rising && m->poll_running) {
+        poll_end(m->ack_error || m->timeout);
+    } else if (rising && m->seq_running) {
+        seq_end_descriptor((m->ack_error ? DESC_NACK : 0) | (m->timeout ? DESC_TIMEOUT : 0));
+    }
+}
+
+static void set_ack_error(int value) {
+    if (value && !m->ack_error) {
+        m->perf[PERF_NACK]++;
+    }
+    if (value) {
+        m->stats.nacks++;
+    }
+    set_flag(&m->ack_error, ST_ACKERROR, value);
+}
+
+static void set_timeout(int value) {
+    set_flag(&m->timeout, ST_TIMEOUT, value);
+}
+
+static void set_ready(int value) {
+    int rising = value && !m->ready;
+
+    set_flag(&m->ready, ST_READY, value);
+    if (rising && m->poll_running && m->poll_state == POLL_POINTER) {
+        poll_pointer_acked();
+    } else if (rising && m->seq_running && m->seq_state == SEQ_WRITE_END) {
+        seq_end_descriptor(0);
+    }
+}
+
+// ---- fifos
+
+static unsigned int tx_level(void) {
+    return m->tx_count;
+}
+
+static uint16_t tx_head_entry(void) {
+    return m->tx[m->tx_head];
+}
+
+static void tx_push(uint16_t v) {
+    if (m->tx_count < I2C_MODEL_FIFO_DEPTH) {
+        m->tx[(m->tx_head + m->tx_count) % I2C_MODEL_FIFO_DEPTH] = v;
+        m->tx_count++;
+    }
+}
+
+static void tx_pop(void) {
+    if (m->tx_count > 0) {
+        m->tx_head = (m->tx_head + 1) % I2C_MODEL_FIFO_DEPTH;
+        m->tx_count--;
+    }
+}
+
+static void rx_push(unsigned char v) {
+    if (m->rx_count < I2C_MODEL_FIFO_DEPTH) {
+        m->rx[(m->rx_head + m->rx_count) % I2C_MODEL_FIFO_DEPTH] = v;
+        m->rx_count++;
+    }
+}
+
+// Packed tx write, dropped as a whole when it does not fit
+static void tx_push_packed(uint32_t value) {
+    unsigned int i;
+
+    if (m->tx_count + m->pack_tx_count <= I2C_MODEL_FIFO_DEPTH) {
+        for (i = 0; i < m->pack_tx_count; i++) {
+            tx_push(((value >> (8 * i)) & 0xFF) | (m->pack_stop && i == m->pack_tx_count - 1 ? 0x100 : 0));
+        }
+    }
+    m->pack_stop = 0;
+}
+
+static unsigned char rx_pop(void) {
+    unsigned char v = 0;
+    if (m->rx_count > 0) {
+        v = m->rx[m->rx_head];
+        m->rx_head = (m->rx_head + 1) % I2C_MODEL_FIFO_DEPTH;
+        m->rx_count--;
+    }
+    return v;
+}
+
+// Packed rx read, up to four bytes with the first one in bits 7:0
+static uint32_t rx_pop_packed(void) {
+    uint32_t v = 0;
+    unsigned int i;
+
+    m->pack_rx_count = m->rx_count < 4 ? m->rx_count : 4;
+    for (i = 0; i < m->pack_rx_count; i++) {
+        v |= (uint32_t)rx_pop() << (8 * i);
+    }
+    return v;
+}
+
+static int tx_thr_flag(void) {
+    return m->fifo_enable && tx_level() <= m->tx_threshold;
+}
+
+static int rx_thr_flag(void) {
+    return m->fifo_enable && m->rx_count > m->rx_threshold;
+}
+
+static uint32_t status_register(void) {
+    return (rx_thr_flag() << 5) | (tx_thr_flag() << 4) | m->pending | (m->busy << 1);
+}
+
+// ---- command sequencer memory, little endian words like the Avalon fabric
+
+static unsigned char *mem_at(uint32_t addr, uint32_t len) {
+    if (mem.host != NULL && len <= mem.size && addr >= mem.base && addr - mem.base <= mem.size - len) {
+        return mem.host + (addr - mem.base);
+    }
+    trace(" [no memory at %08lX]", (unsigned long)addr);
+    return NULL;
+}
+
+static uint32_t mem_read32(uint32_t addr) {
+    unsigned char *p = mem_at(addr & ~3UL, 4);
+    return p == NULL ? 0 : p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void mem_write32(uint32_t addr, uint32_t value) {
+    unsigned char *p = mem_at(addr & ~3UL, 4);
+    if (p != NULL) {
+        p[0] = value & 0xFF;
+        p[1] = (value >> 8) & 0xFF;
+        p[2] = (value >> 16) & 0xFF;
+        p[3] = value >> 24;
+    }
+}
+
+static unsigned char mem_read8(uint32_t addr) {
+    unsigned char *p = mem_at(addr, 1);
+    return p == NULL ? 0 : *p;
+}
+
+static void mem_write8(uint32_t addr, unsigned char value) {
+    unsigned char *p = mem_at(addr, 1);
+    if (p != NULL) {
+        *p = value;
+    }
+}
+
+// ---- command sequencer
+
+// Fetch the descriptor at desc_addr and hand it to the master, with a start after
+// a stop and a repeated start otherwise
+static void seq_issue(void) {
+    uint32_t control;
+
+    m->stats.descriptors++;
+    m->desc_next = mem_read32(m->desc_addr);
+    control = mem_read32(m->desc_addr + 4);
+    m->desc_buf = mem_read32(m->desc_addr + 8) & ~3UL;
+    m->desc_slave = control & 0x7F;
+    m->desc_read = (control & DESC_READ) != 0;
+    m->desc_stop = (control & DESC_STOP) != 0 || m->desc_next == 0;
+    m->desc_len = (control >> 16) != 0 ? control >> 16 : 1;
+    m->desc_count = 0;
+
+    if (m->new_start) {
+        m->start_pending = 1;
+    } else {
+        m->restart_pending = 1;
+    }
+    if (m->desc_read) {
+        // sequential read, every byte waits for the decision
+        m->transaction_pending = 1;
+        m->seq_state = SEQ_READ;
+    } else {
+        m->seq_state = SEQ_WRITE;
+    }
+}
+
+static void seq_finish(void) {
+    m->seq_running = 0;
+    m->pending |= ST_SEQ_DONE;
+}
+
+// Status write back, then the next descriptor or the end of the list
+static void seq_end_descriptor(uint32_t flags) {
+    mem_write32(m->desc_addr + 12, DESC_DONE | flags | m->desc_count);
+    if (flags != 0) {
+        m->seq_error = 1;
+        seq_finish();
+    } else if (m->desc_next == 0) {
+        seq_finish();
+    } else {
+        m->new_start = m->desc_stop;
+        m->desc_addr = m->desc_next;
+        seq_issue();
+    }
+}
+
+static void seq_start(void) {
+    m->seq_running = 1;
+    m->seq_error = 0;
+    m->pending &= ~ST_SEQ_DONE;
+    m->new_start = 1;
+    m->desc_addr = m->seq_head;
+    seq_issue();
+}
+
+// data_valid: the byte goes to the buffer, the ack/nack decision follows
+static void seq_data_valid(unsigned char data) {
+    if (m->seq_state != SEQ_READ) {
+        return;
+    }
+    mem_write8(m->desc_buf + m->desc_count, data);
+    m->desc_count++;
+    if (m->desc_count < m->desc_len) {
+        m->transaction_pending = 1;
+    } else if (m->desc_stop) {
+        m->stop_pending = 1;
+        m->seq_state = SEQ_WAIT_DONE;
+    } else {
+        seq_end_descriptor(0);
+    }
+}
+
+// ---- auto poller
+
+static uint64_t poll_period_cycles(void) {
+    uint32_t ms = m->poll_control >> 16;
+    return (uint64_t)(ms != 0 ? ms : 1) * (I2C_MODEL_CLK_HZ / 1000);
+}
+
+// Time the next poll is due, only on a free bus: no transaction, no start on the way
+static int poll_due(uint64_t *when) {
+    if (!(m->poll_control & POLL_ENABLE) || m->state != BUS_IDLE || m->start_pending || m->seq_running) {
+        return 0;
+    }
+    *when = m->poll_started ? m->poll_last_start + poll_period_cycles() : m->t;
+    return 1;
+}
+
+static void poll_begin(void) {
+    m->poll_running = 1;
+    m->poll_owner = 1;
+    m->poll_rw = 0;
+    m->poll_state = POLL_POINTER;
+    m->poll_bytes = 0;
+    m->poll_started = 1;
+    m->stats.polls++;
+    m->poll_last_start = m->t;
+    m->start_pending = 1;
+}
+
+static void poll_pointer_acked(void) {
+    m->poll_rw = 1;
+    m->restart_pending = 1;
+    m->transaction_pending = 1;   // sequential read
+    m->poll_state = POLL_READ;
+}
+
+static void poll_data_valid(unsigned char data) {
+    if (m->poll_state != POLL_READ) {
+        return;
+    }
+    m->poll_mirror[!m->poll_front][m->poll_bytes++] = data;
+    if (m->poll_bytes < m->poll_length) {
+        m->transaction_pending = 1;
+    } else {
+        m->stop_pending = 1;
+        m->poll_state = POLL_WAIT_DONE;
+    }
+}
+
+// End of the poll, the held cpu and sequencer starts follow
+static void poll_end(int failed) {
+    m->poll_running = 0;
+    m->poll_failed = failed;
+    if (!failed) {
+        m->poll_front = !m->poll_front;
+        m->poll_count++;
+        m->poll_updated = 1;
+        m->poll_last_update = m->t;
+    }
+    if (m->cpu_start_held) {
+        m->start_pending = 1;
+    }
+    if (m->cpu_continue_held) {
+        m->transaction_pending = 1;
+    }
+    if (m->cpu_restart_held) {
+        m->restart_pending = 1;
+    }
+    // the stop of the poll follows and clears stop_pending, a held stop is set with the held start
+    if (!m->cpu_start_held) {
+        m->cpu_stop_held = 0;
+    }
+    m->cpu_start_held = 0;
+    m->cpu_continue_held = 0;
+    m->cpu_restart_held = 0;
+    if (m->seq_start_held) {
+        m->seq_start_held = 0;
+        seq_start();
+    }
+    if (m->next_full && !m->cpu_transfer && !m->seq_running) {
+        m->next_due = 1;
+    }
+}
+
+static uint32_t poll_status(void) {
+    uint64_t ms = (m->t - m->poll_last_update) / (I2C_MODEL_CLK_HZ / 1000);
+    if (!m->poll_updated || ms > 0xFFFF) {
+        ms = 0xFFFF;
+    }
+    return ((uint32_t)m->poll_failed << 31) | (uint32_t)ms;
+}
+
+static uint32_t poll_mirror_word(unsigned int word) {
+    const unsigned char *b = &m->poll_mirror[m->poll_front][4 * word];
+    return b[0] | (b[1] << 8) | (b[2] << 16) | ((uint32_t)b[3] << 24);
+}
+
+// ---- master
+
+// read_write and the address byte of the master, from the poller or the sequencer while they run
+static int master_rw(void) {
+    if (m->poll_running) {
+        return m->poll_rw;
+    }
+    return m->seq_running ? m->desc_read : m->rw;
+}
+
+static unsigned char address_byte(void) {
+    if (m->poll_running) {
+        return (((m->poll_control >> 8) & 0x7F) << 1) | m->poll_rw;
+    }
+    if (m->seq_running) {
+        return (m->desc_slave << 1) | m->desc_read;
+    }
+    return ((m->write_reg >> 7) & 0xFE) | m->rw;
+}
+
+// The holding register feeds the master while a transaction runs, the first byte
+// after a start comes from the write register
+static int hold_select(void) {
+    return !m->poll_running && m->hold_full && m->busy && m->state != BUS_IDLE && !m->fifo_enable;
+}
+
+// data_in of the master, the tx fifo head in fifo mode
+static unsigned char data_in(void) {
+    if (m->poll_running) {
+        return m->poll_first;
+    }
+    if (m->seq_running) {
+        return m->seq_state == SEQ_WRITE ? mem_read8(m->desc_buf + m->desc_count) : 0;
+    }
+    if (m->fifo_enable) {
+        return m->tx_count > 0 ? (tx_head_entry() & 0xFF) : 0;
+    }
+    if (hold_select()) {
+        return m->hold & 0xFF;
+    }
+    return m->write_reg & 0xFF;
+}
+
+// data_taken: the byte is on its way, an entry with the stop bit ends the transaction
+static void data_taken(void) {
+    if (m->poll_running) {
+        return;
+    }
+    if (m->seq_running) {
+        if (m->seq_state == SEQ_WRITE && ++m->desc_count == m->desc_len) {
+            if (m->desc_stop) {
+                m->stop_pending = 1;   // stop after the ack of this byte
+                m->seq_state = SEQ_WAIT_DONE;
+            } else {
+                m->seq_state = SEQ_WRITE_END;
+            }
+        }
+    } else if (m->fifo_enable && m->tx_count > 0) {
+        if (tx_head_entry() & 0x100) {
+            m->stop_pending = 1;
+        }
+        tx_pop();
+    } else if (hold_select()) {
+        if (m->hold & 0x100) {
+            m->stop_pending = 1;
+        }
+        m->hold_full = 0;
+        m->pending |= ST_HOLD_EMPTY;
+    }
+}
+
+// The fifo handshake signals are levels that keep setting the master latches
+static void latch_levels(void) {
+    if (m->poll_running) {
+        // the poller gives its own continue pulses
+    } else if (m->seq_running) {
+        if (m->seq_state == SEQ_WRITE) {
+            m->transaction_pending = 1;
+        }
+    } else if (m->fifo_enable && m->tx_count > 0 && !m->rw) {
+        m->transaction_pending = 1;
+    }
+    if (hold_select() && !master_rw()) {
+        m->transaction_pending = 1;
+    }
+    if (m->rx_active && master_rw() && !m->poll_running) {
+        if (m->rx_remaining > 1 && m->rx_count < I2C_MODEL_FIFO_DEPTH - 1) {
+            m->transaction_pending = 1;
+        }
+        if (m->rx_remaining <= 1) {
+            m->stop_pending = 1;
+        }
+    }
+    if (m->transaction_pending || m->stop_pending || m->restart_pending) {
+        set_ready(0);
+    }
+}
+
+// The first scl low of a phase is stretched while the slave holds scl after the last ack
+static void begin_phase(enum bus_state state, uint64_t start, uint64_t cycles) {
+    uint64_t release = start + m->scl_low;
+    uint64_t extra = 0;
+
+    if (state != BUS_START && m->stretch_until > release) {
+        extra = m->stretch_until - release;
+    }
+    m->stretch_until = 0;
+    if (extra != 0 && m->stretch_limit != 0 && extra > m->stretch_limit) {
+        m->stretch_until = release + extra;
+        extra = m->stretch_limit;
+        state = BUS_TIMEOUT;
+        cycles = m->scl_low;
+    }
+    m->stats.stretch_cycles += extra;
+    m->perf[PERF_STRETCH] += (uint32_t)extra;
+
+    m->state = state;
+    m->phase_active = 1;
+    m->phase_end = start + cycles + extra;
+}
+
+static uint64_t bit_time(void) {
+    return (uint64_t)m->scl_low + m->scl_high + SCL_SYNC_CYCLES;
+}
+
+// The selected slave holds scl low after the ack that just ended
+static void slave_stretch(void) {
+    if (m->selected != NULL && m->selected->stretch != 0) {
+        m->stretch_until = m->t + m->selected->stretch;
+    }
+}
+
+static void begin_byte(enum bus_state state) {
+    m->stats.bytes++;
+    m->stats.scl_cycles += state == BUS_READ ? 8 : 9;
+    begin_phase(state, m->t, (state == BUS_READ ? 8 : 9) * bit_time());
+}
+
+static void next_launch(void);
+
+static void begin_stop(void) {
+    m->stats.scl_cycles++;
+    m->stop_pending = 0;
+    begin_phase(BUS_STOP, m->t, m->scl_low + m->tsu_sto);
+    if (m->next_due) {
+        next_launch();
+    }
+}
+
+// A slave in the middle of a byte lets sda go within nine clocks, sampled with scl high
+static void begin_recover(uint64_t begin) {
+    unsigned int pulses = m->sda_hold < 9 ? m->sda_hold + 1 : 9;
+
+    m->start_pending = 0;
+    m->transaction_pending = 0;
+    m->recover = 0;
+    m->recover_ok = m->sda_hold < 9;
+    m->sda_hold = m->sda_hold < 9 ? 0 : m->sda_hold - 9;
+    m->start_time = begin;
+    m->stats.scl_cycles += pulses;
+    trace("R%u", pulses);
+    begin_phase(BUS_RECOVER, begin, pulses * bit_time());
+}
+
+static void begin_restart(void) {
+    m->addr_rw = address_byte();
+    m->stats.scl_cycles++;
+    begin_phase(BUS_RESTART, m->t, (uint64_t)m->scl_low + m->tsu_sta + m->thd_sta);
+}
+
+// ---- performance counters
+
+// Cycles from since (at the earliest the last clear) to m->t
+static uint32_t perf_span(uint64_t since) {
+    if (since < m->perf_base) {
+        since = m->perf_base;
+    }
+    return since < m->t ? (uint32_t)(m->t - since) : 0;
+}
+
+static void perf_snapshot(void) {
+    memcpy(m->perf_snap, m->perf, sizeof(m->perf_snap));
+    if (m->state != BUS_IDLE) {
+        m->perf_snap[PERF_BUSY] += perf_span(m->start_time);
+    }
+    if (m->state == BUS_WAIT_WRITE || m->state == BUS_WAIT_READ) {
+        m->perf_snap[PERF_STALL] += perf_span(m->stall_start);
+    }
+    m->perf_snap[PERF_CYCLES] = perf_span(m->perf_base);
+}
+
+static void perf_clear(void) {
+    memset(m->perf, 0, sizeof(m->perf));
+    m->perf_base = m->t;
+}
+
+static void end_stall(void) {
+    m->stats.stall_cycles += m->t - m->stall_start;
+    m->perf[PERF_STALL] += perf_span(m->stall_start);
+}
+
+static void select_slave(void) {
+    int i;
+    m->selected = NULL;
+    for (i = 0; i < m->slave_count; i++) {
+        if (m->slaves[i]->address == (m->addr_rw >> 1)) {
+            m->selected = m->slaves[i];
+            if (m->selected->start != NULL) {
+                m->selected->start(m->selected->ctx);
+            }
+            return;
+        }
+    }
+}
+
+// End of the timed phase at m->t
+static void finish_phase(void) {
+    int ack;
+    unsigned char data;
+
+    m->phase_active = 0;
+    switch (m->state) {
+    case BUS_START:
+    case BUS_RESTART:
+        if (m->state == BUS_RESTART) {
+            m->restart_pending = 0;
+            m->transfer = data_in();
+            if (!master_rw()) {
+                data_taken();
+            }
+            m->seq_read = m->transaction_pending;
+            m->transaction_pending = 0;
+            m->stats.restarts++;
+        } else {
+            m->perf[PERF_TRANS]++;
+        }
+        trace(m->state == BUS_START ? "S %02X" : " Sr %02X", m->addr_rw);
+        trace_entry(m->t - m->thd_sta, TRACE_START, m->state == BUS_RESTART, 0);
+        select_slave();
+        begin_byte(BUS_ADDRESS);
+        break;
+
+    case BUS_ADDRESS:
+        m->perf[PERF_TX]++;
+        trace_byte(m->addr_rw, m->selected == NULL, 1);
+        if (m->selected == NULL) {
+            trace(" N");
+            set_ack_error(1);
+            set_done(1);
+            m->busy = 0;
+            begin_stop();
+        } else if ((m->addr_rw & 1) == 0) {
+            slave_stretch();
+            trace(" A %02X", m->transfer);
+            begin_byte(BUS_WRITE);
+        } else {
+            slave_stretch();
+            trace(" A");
+            begin_byte(BUS_READ);
+        }
+        break;
+
+    case BUS_WRITE:
+        m->perf[PERF_TX]++;
+        ack = m->selected != NULL && m->selected->write != NULL && m->selected->write(m->selected->ctx, m->transfer);
+        trace(ack ? " A" : " N");
+        trace_byte(m->transfer, !ack, 0);
+        if (ack) {
+            slave_stretch();
+        }
+        if (ack && !m->stop_pending) {
+            m->transaction_pending = 0;
+            set_ready(1);
+            m->state = BUS_WAIT_WRITE;
+            m->stall_start = m->t;
+        } else if (m->stop_pending) {
+            m->transaction_pending = 0;
+            set_done(1);
+            m->busy = 0;
+            begin_stop();
+        } else {
+            m->transaction_pending = 0;
+            set_ack_error(1);
+            set_done(1);
+            m->busy = 0;
+            begin_stop();
+        }
+        break;
+
+    case BUS_READ:
+        data = m->selected != NULL && m->selected->read != NULL ? m->selected->read(m->selected->ctx) : 0xFF;
+        trace(" %02X", data);
+        // data_valid
+        m->read_reg = data;
+        m->perf[PERF_RX]++;
+        if (m->poll_running) {
+            poll_data_valid(data);
+        } else if (m->seq_running) {
+            seq_data_valid(data);
+        } else if (m->fifo_enable) {
+            rx_push(data);
+        }
+        if (m->seq_read) {
+            set_ready(1);
+        }
+        m->state = BUS_WAIT_READ;
+        m->stall_start = m->t;
+        break;
+
+    case BUS_MASTER_ACK:
+        trace(m->master_nack ? " N" : " A");
+        trace_byte(m->read_reg, m->master_nack, 0);
+        if (!m->restart_pending) {
+            m->transaction_pending = 0;
+        }
+        if (!m->master_nack) {
+            slave_stretch();
+            begin_byte(BUS_READ);
+        } else if (m->restart_pending) {
+            begin_restart();
+        } else {
+            set_done(1);
+            m->busy = 0;
+            begin_stop();
+        }
+        break;
+
+    case BUS_STOP:
+        trace(" P\n");
+        trace_entry(m->t, TRACE_STOP, 0, 0);
+        if (m->selected != NULL && m->selected->stop != NULL) {
+            m->selected->stop(m->selected->ctx);
+        }
+        m->selected = NULL;
+        m->busy = 0;
+        // a stop or continue given with the enable of the next start is kept for it
+        if (!m->start_pending) {
+            m->stop_pending = 0;
+            m->transaction_pending = 0;
+        }
+        m->last_stop = m->t;
+        m->stats.transactions++;
+        m->stats.busy_cycles += m->t - m->start_time;
+        m->perf[PERF_BUSY] += perf_span(m->start_time);
+        m->state = BUS_IDLE;
+        break;
+
+    case BUS_RECOVER:
+        if (m->recover_ok) {
+            set_done(1);
+            m->busy = 0;
+            begin_stop();
+            break;
+        }
+        trace(" N\n");
+        set_ack_error(1);
+        set_done(1);
+        m->busy = 0;
+        m->stats.busy_cycles += m->t - m->start_time;
+        m->perf[PERF_BUSY] += perf_span(m->start_time);
+        m->state = BUS_IDLE;
+        break;
+
+    case BUS_TIMEOUT:
+        // no stop on the bus, the next start waits until the slave released scl
+        trace(" T\n");
+        trace_entry(m->t, TRACE_TIMEOUT, 0, ((m->trace_control >> 4) & 3) == TRIGGER_TIMEOUT);
+        m->selected = NULL;
+        m->busy = 0;
+        m->stop_pending = 0;
+        m->transaction_pending = 0;
+        set_timeout(1);
+        set_done(1);
+        m->last_stop = m->stretch_until;
+        m->stretch_until = 0;
+        m->stats.transactions++;
+        m->stats.timeouts++;
+        m->stats.busy_cycles += m->t - m->start_time;
+        m->perf[PERF_BUSY] += perf_span(m->start_time);
+        m->state = BUS_IDLE;
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Decision points, returns 1 when a new phase was started at m->t
+static int decide(void) {
+    uint64_t begin;
+
+    latch_levels();
+    switch (m->state) {
+    case BUS_IDLE:
+        m->restart_pending = 0;
+        // a poll that ended without a stop leaves the next transaction for here
+        if (m->next_due) {
+            next_launch();
+        }
+        if (!m->start_pending) {
+            return 0;
+        }
+        m->busy = 1;
+        if (!m->poll_running) {
+            m->poll_owner = 0;
+            m->next_waiting = 0;
+            if (m->cpu_stop_held) {
+                m->stop_pending = 1;
+                m->cpu_stop_held = 0;
+            }
+        }
+        set_ack_error(0);
+        set_timeout(0);
+        set_done(0);
+        // a new start waits for the bus free time after the last stop
+        begin = m->t;
+        if (m->last_stop != 0 && begin < m->last_stop + m->tbuf) {
+            begin = m->last_stop + m->tbuf;
+        }
+        if (m->recover) {
+            begin_recover(begin);
+            return 1;
+        }
+        if (m->sda_hold != 0) {
+            // sda low, the start waits until the stretch timeout, without one forever
+            if (m->stretch_limit == 0) {
+                return 0;
+            }
+            m->start_pending = 0;
+            m->transaction_pending = 0;
+            m->start_time = begin;
+            begin_phase(BUS_TIMEOUT, begin, m->stretch_limit);
+            m->stretch_until = m->phase_end;
+            return 1;
+        }
+        m->start_pending = 0;
+        m->transfer = data_in();
+        if (!master_rw()) {
+            data_taken();
+        }
+        m->addr_rw = address_byte();
+        m->seq_read = m->transaction_pending;
+        m->transaction_pending = 0;
+        m->start_time = begin;
+        begin_phase(BUS_START, begin, m->thd_sta);
+        return 1;
+
+    case BUS_WAIT_WRITE:
+        if (m->restart_pending) {
+            end_stall();
+            begin_restart();
+        } else if (m->transaction_pending) {
+            end_stall();
+            m->transfer = data_in();
+            data_taken();
+            trace(" %02X", m->transfer);
+            begin_byte(BUS_WRITE);
+        } else if (m->stop_pending) {
+            end_stall();
+            set_done(1);
+            begin_stop();
+        } else {
+            return 0;
+        }
+        return 1;
+
+    case BUS_WAIT_READ:
+        if (m->stop_pending || m->restart_pending) {
+            m->master_nack = 1;
+        } else if (m->transaction_pending) {
+            m->master_nack = 0;
+        } else if (!m->seq_read) {
+            m->master_nack = 1;
+        } else {
+            return 0;
+        }
+        // the fifo read counts a byte once its ack/nack is decided, as the
+        // master does before data_valid reaches rx_remaining
+        if (m->rx_active && m->rx_remaining != 0) {
+            m->rx_remaining--;
+        }
+        end_stall();
+        m->stats.scl_cycles++;
+        begin_phase(BUS_MASTER_ACK, m->t, bit_time());
+        return 1;
+
+    default:
+        return 0;
+    }
+}
+
+static void run_until(uint64_t target) {
+    uint64_t when;
+
+    for (;;) {
+        if (m->phase_active) {
+            if (m->phase_end > target) {
+                return;
+            }
+            m->t = m->phase_end;
+            finish_phase();
+            continue;
+        }
+        if (poll_due(&when) && when <= target) {
+            if (m->t < when) {
+                m->t = when;
+            }
+            poll_begin();
+        }
+        if (!decide()) {
+            break;
+        }
+    }
+    if (m->t < target) {
+        m->t = target;
+    }
+}
+
+// Every channel runs up to the time of the cpu, m is left alone
+static void run_channels(void) {
+    struct model *cur = m;
+    int c;
+    for (c = 0; c < I2C_MODEL_CHANNELS; c++) {
+        m = &channel[c];
+        run_until(now);
+    }
+    m = cur;
+}
+
+// Channels with their interrupt line high, IRQ_SUMMARY of i2c_multi_top
+static uint32_t irq_summary(void) {
+    struct model *cur = m;
+    uint32_t pending = 0;
+    int c;
+    for (c = 0; c < I2C_MODEL_CHANNELS; c++) {
+        m = &channel[c];
+        if ((status_register() & m->irq_enable) != 0) {
+            pending |= 1U << c;
+        }
+    }
+    m = cur;
+    return pending;
+}
+
+// The channels share one interrupt line
+static void irq_check(void) {
+    uint32_t pending = irq_summary();
+    int c;
+    if (pending == 0) {
+        return;
+    }
+    for (c = 0; c < I2C_MODEL_CHANNELS; c++) {
+        if (pending & (1U << c)) {
+            channel[c].stats.interrupts++;
+        }
+    }
+    i2c_regs_irq();
+}
+
+// Select the channel of the access and make the offset relative to its window.
+// Returns 0 for the shared registers behind the last channel.
+static int access(uint32_t *offset) {
+    int c = 0;
+    init();
+    now += I2C_MODEL_ACCESS_CYCLES;
+    run_channels();
+    if (I2C_MODEL_CHANNELS > 1) {
+        c = *offset / I2C_MODEL_CHANNEL_SPAN;
+        *offset %= I2C_MODEL_CHANNEL_SPAN;
+        if (c >= I2C_MODEL_CHANNELS) {
+            m = &channel[0];
+            return 0;
+        }
+    }
+    m = &channel[c];
+    return 1;
+}
+
+static uint32_t shared_read(uint32_t offset) {
+    switch (offset) {
+    case REG_IRQ_SUMMARY:
+        return irq_summary();
+    case REG_CHANNELS:
+        return I2C_MODEL_CHANNELS;
+    default:
+        return 0;
+    }
+}
+
+// ---- register interface
+
+static void control_write(uint32_t value) {
+    m->rw = (value & CTRL_RW) != 0;
+    if (value & CTRL_ENABLE) {
+        m->cpu_transfer = 1;
+    }
+    // enable is ignored while a transaction is on the bus, it waits for the end of a poll
+    if ((value & CTRL_ENABLE) && m->poll_running) {
+        m->cpu_start_held = 1;
+    } else if ((value & CTRL_ENABLE) && (m->state == BUS_IDLE || m->state == BUS_STOP)) {
+        m->start_pending = 1;
+    }
+    if ((value & CTRL_ENABLE) && (m->poll_running || m->state == BUS_IDLE || m->state == BUS_STOP)) {
+        m->recover = (value & CTRL_RECOVER) != 0;
+    }
+    // stop, continue and restart given while the poller has the bus are kept for the held enable
+    if ((value & CTRL_STOP) && m->poll_running) {
+        m->cpu_stop_held = 1;
+    } else if (value & CTRL_STOP) {
+        m->stop_pending = 1;
+    }
+    if ((value & CTRL_CONTINUE) && m->poll_running) {
+        m->cpu_continue_held = 1;
+    } else if (value & CTRL_CONTINUE) {
+        m->transaction_pending = 1;
+    }
+    if ((value & CTRL_RESTART) && m->poll_running) {
+        m->cpu_restart_held = 1;
+    } else if (value & CTRL_RESTART) {
+        m->restart_pending = 1;
+    }
+    if ((value & CTRL_RW) && (value & (CTRL_ENABLE | CTRL_RESTART)) && m->fifo_enable) {
+        m->rx_active = 1;
+        m->rx_remaining = m->rx_length;
+    }
+}
+
+// The next transaction goes to the master like a write of WRITE_REGISTER and CONTROL
+static void next_launch(void) {
+    m->next_full = 0;
+    m->next_due = 0;
+    m->next_waiting = 1;
+    m->write_reg = m->next & 0x7FFF;
+    control_write(CTRL_ENABLE | ((m->next >> 16) & (CTRL_CONTINUE | CTRL_RW | CTRL_STOP)));
+}
+
+uint32_t i2c_model_read(uint32_t offset) {
+    uint32_t v = 0;
+
+    if (!access(&offset)) {
+        v = shared_read(offset);
+        irq_check();
+        return v;
+    }
+    m->stats.reg_reads++;
+    switch (offset) {
+    case REG_CONTROL:
+        v = m->rw ? CTRL_RW : 0;
+        break;
+    case REG_WRITE:
+        v = m->write_reg;
+        break;
+    case REG_STATUS:
+        m->stats.status_polls++;
+        v = status_register();
+        break;
+    case REG_READ:
+        v = m->read_reg;
+        break;
+    case REG_IRQ_ENABLE:
+        v = m->irq_enable;
+        break;
+    case REG_RX_DATA:
+        v = rx_pop();
+        break;
+    case REG_FIFO_STATUS:
+        v = (rx_thr_flag() << 21) | (tx_thr_flag() << 20)
+          | ((m->rx_count == I2C_MODEL_FIFO_DEPTH) << 19) | ((m->rx_count == 0) << 18)
+          | ((m->tx_count == I2C_MODEL_FIFO_DEPTH) << 17) | ((m->tx_count == 0) << 16)
+          | (m->rx_count << 8) | m->tx_count;
+        break;
+    case REG_FIFO_CONTROL:
+        v = (m->rx_length << 24) | (m->rx_threshold << 16) | (m->tx_threshold << 8) | m->fifo_enable;
+        break;
+    case REG_SCL_TIMING:
+        v = ((uint32_t)m->scl_high << 16) | m->scl_low;
+        break;
+    case REG_START_TIMING:
+        v = ((uint32_t)m->thd_sta << 16) | m->tsu_sta;
+        break;
+    case REG_STOP_TIMING:
+        v = ((uint32_t)m->tbuf << 16) | m->tsu_sto;
+        break;
+    case REG_STRETCH_LIMIT:
+        v = m->stretch_limit;
+        break;
+    case REG_ADDRESS:
+        v = (m->write_reg >> 8) & 0x7F;
+        break;
+    case REG_PACK_CONTROL:
+        v = (m->pack_rx_count << 8) | (m->pack_stop ? PACK_STOP : 0) | m->pack_tx_count;
+        break;
+    case REG_RX_PACKED:
+        v = rx_pop_packed();
+        break;
+    case REG_SEQ_CONTROL:
+        v = (m->seq_error << 1) | m->seq_running;
+        break;
+    case REG_SEQ_HEAD:
+        v = m->seq_head;
+        break;
+    case REG_SEQ_CURRENT:
+        v = m->desc_addr;
+        break;
+    case REG_POLL_CONTROL:
+        v = m->poll_control;
+        break;
+    case REG_POLL_RANGE:
+        v = (m->poll_length << 8) | m->poll_first;
+        break;
+    case REG_POLL_COUNT:
+        v = m->poll_count;
+        break;
+    case REG_POLL_STATUS:
+        v = poll_status();
+        break;
+    case REG_TRACE_CONTROL:
+        v = m->trace_control;
+        break;
+    case REG_TRACE_STATUS:
+        v = trace_status();
+        break;
+    case REG_TRACE_DATA:
+        v = trace_pop();
+        break;
+    case REG_NEXT:
+        v = m->next | (m->next_full || m->next_waiting ? NEXT_ENABLE : 0);
+        break;
+    default:
+        if (offset >= REG_PERF_TX && offset < REG_PERF_TX + 4 * PERF_COUNT && (offset & 3) == 0) {
+            v = m->perf_snap[(offset - REG_PERF_TX) / 4];
+        } else if (offset >= REG_POLL_MIRROR && offset < REG_POLL_MIRROR + POLL_MAX && (offset & 3) == 0) {
+            v = poll_mirror_word((offset - REG_POLL_MIRROR) / 4);
+        }
+        break;
+    }
+    run_until(now);
+    irq_check();
+    return v;
+}
+
+void i2c_model_write(uint32_t offset, uint32_t value) {
+    if (!access(&offset)) {
+        // the shared registers are read only
+        return;
+    }
+    m->stats.reg_writes++;
+    switch (offset) {
+    case REG_CONTROL:
+        control_write(value);
+        break;
+    case REG_WRITE:
+        m->write_reg = value & 0x7FFF;
+        break;
+    case REG_STATUS:
+        m->pending &= ~(value & (ST_SEQ_DONE | ST_HOLD_EMPTY | ST_TIMEOUT | ST_READY | ST_ACKERROR | ST_DONE));
+        break;
+    case REG_IRQ_ENABLE:
+        m->irq_enable = value & 0x1FD;
+        break;
+    case REG_TX_DATA:
+        tx_push(value & 0x1FF);
+        break;
+    case REG_FIFO_CONTROL:
+        m->fifo_enable = value & 1;
+        if (value & 2) {
+            m->tx_head = 0;
+            m->tx_count = 0;
+        }
+        if (value & 4) {
+            m->rx_head = 0;
+            m->rx_count = 0;
+        }
+        m->tx_threshold = (value >> 8) & 0xFF;
+        m->rx_threshold = (value >> 16) & 0xFF;
+        m->rx_length = (value >> 24) & 0xFF;
+        break;
+    case REG_SCL_TIMING:
+        m->scl_low = value & 0xFFFF;
+        m->scl_high = value >> 16;
+        break;
+    case REG_START_TIMING:
+        m->tsu_sta = value & 0xFFFF;
+        m->thd_sta = value >> 16;
+        break;
+    case REG_STOP_TIMING:
+        m->tsu_sto = value & 0xFFFF;
+        m->tbuf = value >> 16;
+        break;
+    case REG_STRETCH_LIMIT:
+        m->stretch_limit = value;
+        break;
+    case REG_TX_HOLD:
+        m->hold = value & 0x1FF;
+        m->hold_full = 1;
+        m->pending &= ~ST_HOLD_EMPTY;
+        break;
+    case REG_ADDRESS:
+        m->write_reg = (m->write_reg & 0xFF) | ((value & 0x7F) << 8);
+        break;
+    case REG_TX_PACKED:
+        tx_push_packed(value);
+        break;
+    case REG_PACK_CONTROL:
+        m->pack_tx_count = (value & 7) >= 1 && (value & 7) <= 3 ? (value & 7) : 4;
+        m->pack_stop = (value & PACK_STOP) != 0;
+        break;
+    case REG_SEQ_CONTROL:
+        if ((value & SEQ_START) && !m->seq_running && m->poll_running) {
+            m->seq_start_held = 1;
+        } else if ((value & SEQ_START) && !m->seq_running) {
+            seq_start();
+        }
+        break;
+    case REG_SEQ_HEAD:
+        m->seq_head = value & ~3UL;
+        break;
+    case REG_POLL_CONTROL:
+        m->poll_control = value & 0xFFFF7F01UL;
+        break;
+    case REG_POLL_RANGE:
+        m->poll_first = value & 0xFF;
+        m->poll_length = ((value >> 8) & 0xFF) >= 1 && ((value >> 8) & 0xFF) <= POLL_MAX ? (value >> 8) & 0xFF : POLL_MAX;
+        break;
+    case REG_NEXT:
+        // a write without enable empties the slot, one with nothing of the cpu running starts at once,
+        // during a poll it starts with the stop of the poll
+        m->next = value & NEXT_MASK;
+        m->next_full = (value & NEXT_ENABLE) != 0;
+        m->next_due = 0;
+        if (m->next_full && !m->cpu_transfer && !m->seq_running && !m->poll_running) {
+            next_launch();
+        }
+        break;
+    case REG_TRACE_CONTROL:
+        m->trace_control = value & TRACE_CONTROL_MASK;
+        if (value & TRACE_CLEAR) {
+            trace_clear();
+        }
+        break;
+    case REG_PERF_CONTROL:
+        if (value & PERF_SNAPSHOT) {
+            perf_snapshot();
+        }
+        if (value & PERF_CLEAR) {
+            perf_clear();
+        }
+        break;
+    default:
+        break;
+    }
+    run_until(now);
+    irq_check();
+}
+
+void i2c_model_idle(void) {
+    init();
+    channel[0].stats.idle_calls++;
+    now += I2C_MODEL_IDLE_CYCLES;
+    run_channels();
+    irq_check();
+}
+
+// ---- statistics
+
+const struct i2c_model_stats *i2c_model_get_stats(void) {
+    return &channel[0].stats;
+}
+
+const struct i2c_model_stats *i2c_model_get_channel_stats(int ch) {
+    return ch >= 0 && ch < I2C_MODEL_CHANNELS ? &channel[ch].stats : NULL;
+}
+
+void i2c_model_clear_stats(void) {
+    int c;
+    for (c = 0; c < I2C_MODEL_CHANNELS; c++) {
+        memset(&channel[c].stats, 0, sizeof(channel[c].stats));
+    }
+}
+
+static void report_channel(FILE *f, const char *p) {
+    const struct i2c_model_stats *s = &m->stats;
+    double us_per_cycle = 1e6 / I2C_MODEL_CLK_HZ;
+
+    // let a transaction that is still on the bus run to its end
+    while (m->phase_active) {
+        run_until(m->phase_end);
+    }
+
+    fprintf(f, "%s: %llu transactions (%llu repeated starts), %llu bytes on the bus, %.1f bytes/transaction, %llu nacks\n",
+            p, (unsigned long long)s->transactions, (unsigned long long)s->restarts,
+            (unsigned long long)s->bytes,
+            s->transactions ? (double)s->bytes / s->transactions : 0.0,
+            (unsigned long long)s->nacks);
+    fprintf(f, "%s: bus busy %.1f us, %llu scl cycles, scl held low %.1f us waiting for the cpu, %.1f us by slaves\n",
+            p, s->busy_cycles * us_per_cycle, (unsigned long long)s->scl_cycles,
+            s->stall_cycles * us_per_cycle, s->stretch_cycles * us_per_cycle);
+    if (s->polls != 0) {
+        fprintf(f, "%s: %llu transactions by the auto poller\n", p, (unsigned long long)s->polls);
+    }
+    if (s->descriptors != 0) {
+        fprintf(f, "%s: %llu descriptors run by the command sequencer\n", p, (unsigned long long)s->descriptors);
+    }
+    if (s->timeouts != 0) {
+        fprintf(f, "%s: %llu transactions ended by the stretch timeout\n", p, (unsigned long long)s->timeouts);
+    }
+    fprintf(f, "%s: cpu %llu status polls, %llu register reads, %llu register writes, %llu idle waits, %llu interrupts\n",
+            p, (unsigned long long)s->status_polls, (unsigned long long)s->reg_reads,
+            (unsigned long long)s->reg_writes, (unsigned long long)s->idle_calls,
+            (unsigned long long)s->interrupts);
+}
+
+void i2c_model_report(FILE *f) {
+    char prefix[32];
+    int c;
+
+    if (I2C_MODEL_CHANNELS == 1) {
+        m = &channel[0];
+        report_channel(f, "i2c model");
+    } else {
+        // channels that were never used stay out of the report
+        for (c = 0; c < I2C_MODEL_CHANNELS; c++) {
+            m = &channel[c];
+            if (c == 0 || m->stats.reg_reads != 0 || m->stats.reg_writes != 0) {
+                snprintf(prefix, sizeof(prefix), "i2c model ch%d", c);
+                report_channel(f, prefix);
+            }
+        }
+    }
+    fprintf(f, "i2c model: elapsed %.1f us\n", now * 1e6 / I2C_MODEL_CLK_HZ);
+}
@@ -0,0 +1,88 @@
+/* i2c_model.h */
+#ifndef I2C_MODEL_H
+#define I2C_MODEL_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Behavioral model of i2c_top (i2c_registerbank + i2c_master) for the host build.
+// Time is counted in core clock cycles. Every register access and every idle
+// call of the CPU advances it, the bus runs with the programmed timing registers.
+//
+// With I2C_MODEL_CHANNELS above 1 it models i2c_multi_top: channel n at offset
+// n * I2C_MODEL_CHANNEL_SPAN, the shared IRQ_SUMMARY/CHANNELS registers after the
+// last one. The channels run in parallel on the time of the cpu and share the
+// interrupt line and the memory of the sequencers.
+
+#define I2C_MODEL_CLK_HZ      50000000UL  // SYS_CLK_FREQ_HZ generic
+#define I2C_MODEL_FIFO_DEPTH  16          // FIFO_DEPTH generic
+#define I2C_MODEL_TRACE_DEPTH 64          // TRACE_DEPTH generic, the bus trace records no fsm states
+#define I2C_MODEL_MAX_SLAVES  8
+#ifndef I2C_MODEL_CHANNELS
+#define I2C_MODEL_CHANNELS    1           // CHANNELS generic of i2c_multi_top
+#endif
+#define I2C_MODEL_CHANNEL_SPAN  0x100     // bytes of register window per channel
+
+// Slave on the modelled bus, all calls happen at the end of the bus phase
+struct i2c_slave_model {
+    unsigned char address;                      // 7 bit address
+    void *ctx;
+    void (*start)(void *ctx);                   // START or repeated START addressed to the slave
+    int  (*write)(void *ctx, unsigned char data);   // returns 1 for ACK
+    unsigned char (*read)(void *ctx);           // next byte of a read
+    void (*stop)(void *ctx);
+    unsigned int stretch;                       // core clock cycles scl is held low after each ack, 0 = none
+};
+
+struct i2c_model_stats {
+    uint64_t transactions;     // START ... STOP
+    uint64_t restarts;
+    uint64_t bytes;            // bytes on the wire, address bytes included
+    uint64_t scl_cycles;
+    uint64_t busy_cycles;      // core clock cycles between START and the end of STOP
+    uint64_t stall_cycles;     // scl held low waiting for the cpu
+    uint64_t stretch_cycles;   // scl held low by a slave
+    uint64_t timeouts;         // transactions ended by the stretch timeout
+    uint64_t nacks;
+    uint64_t status_polls;     // reads of STATUS_REGISTER
+    uint64_t reg_reads;
+    uint64_t reg_writes;
+    uint64_t idle_calls;       // I2C_IDLE_HOOK() while waiting for an interrupt
+    uint64_t interrupts;
+    uint64_t descriptors;      // run by the command sequencer
+    uint64_t polls;            // transactions of the auto poller
+};
+
+// Back to the reset state, attached slaves and statistics are kept
+void i2c_model_reset(void);
+
+// Register access at the given byte offset, costs I2C_MODEL_ACCESS_CYCLES
+uint32_t i2c_model_read(uint32_t offset);
+void i2c_model_write(uint32_t offset, uint32_t value);
+
+// CPU waits for an interrupt, costs I2C_MODEL_IDLE_CYCLES
+void i2c_model_idle(void);
+
+// Attach a slave to the bus of channel 0, or of the given channel
+int i2c_model_attach(const struct i2c_slave_model *slave);
+int i2c_model_attach_channel(int ch, const struct i2c_slave_model *slave);
+
+// A slave on channel 0 holds sda low for the next pulses scl clocks, like one cut off in the middle
+// of a read by a reset of the cpu. Starts wait for sda until the stretch timeout, the
+// bus recovery of the core clocks it free.
+void i2c_model_hold_sda(unsigned int pulses);
+
+// Memory the command sequencer reaches over its Avalon master, host[0] is at bus_address
+void i2c_model_map_memory(void *host, uint32_t bus_address, uint32_t size);
+
+uint64_t i2c_model_now(void);
+// Statistics of channel 0, or of the given channel (NULL outside)
+const struct i2c_model_stats *i2c_model_get_stats(void);
+const struct i2c_model_stats *i2c_model_get_channel_stats(int ch);
+void i2c_model_clear_stats(void);
+void i2c_model_report(FILE *f);
+
+// Bus trace on stderr (also enabled by I2C_MODEL_TRACE=1 in the environment)
+void i2c_model_trace(int on);
+
+#endif // I2C_MODEL_H
@@ -0,0 +1,83 @@
+#include <stddef.h>
+#include "i2c_regs.h"
+#include "host_board.h"
+
+static const struct i2c_reg_backend *backend = NULL;
+
+static void (*irq_handler)(void *context) = NULL;
+static void *irq_context = NULL;
+static int in_isr = 0;
+static int irq_line = 0;
+static unsigned int irq_enabled = 1;
+static int irq_deferred = 0;
+
+void i2c_regs_set_backend(const struct i2c_reg_backend *b) {
+    backend = b;
+}
+
+static const struct i2c_reg_backend *get_backend(void) {
+    if (backend == NULL) {
+        backend = host_board_init();
+    }
+    return backend;
+}
+
+uint32_t i2c_regs_read(uint32_t base, uint32_t offset) {
+    const struct i2c_reg_backend *b = get_backend();
+    return b->read(b->ctx, base, offset);
+}
+
+void i2c_regs_write(uint32_t base, uint32_t offset, uint32_t value) {
+    const struct i2c_reg_backend *b = get_backend();
+    b->write(b->ctx, base, offset, value);
+}
+
+void i2c_regs_idle(void) {
+    const struct i2c_reg_backend *b = get_backend();
+    if (b->idle != NULL) {
+        b->idle(b->ctx);
+    }
+}
+
+int i2c_regs_register_isr(void (*isr)(void *context), void *context) {
+    irq_handler = isr;
+    irq_context = context;
+    irq_line = isr != NULL;
+    return 0;
+}
+
+void i2c_regs_irq_line(int enabled) {
+    irq_line = enabled;
+}
+
+int i2c_regs_irq_wanted(void) {
+    return irq_handler != NULL && irq_line;
+}
+
+void i2c_regs_irq(void) {
+    if (!irq_enabled) {
+        irq_deferred = 1;
+        return;
+    }
+    // the handler accesses registers itself, no nesting
+    if (irq_handler == NULL || !irq_line || in_isr) {
+        return;
+    }
+    in_isr = 1;
+    irq_handler(irq_context);
+    in_isr = 0;
+}
+
+unsigned int i2c_regs_irq_disable(void) {
+    unsigned int enabled = irq_enabled;
+    irq_enabled = 0;
+    return enabled;
+}
+
+void i2c_regs_irq_restore(unsigned int enabled) {
+    irq_enabled = enabled;
+    if (irq_enabled && irq_deferred) {
+        irq_deferred = 0;
+        i2c_regs_irq();
+    }
+}
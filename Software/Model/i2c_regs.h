@@ -0,0 +1,41 @@
+/* i2c_regs.h */
+#ifndef I2C_REGS_H
+#define I2C_REGS_H
+
+#include <stdint.h>
+
+// Register access layer of the host build. IORD_32DIRECT/IOWR_32DIRECT from
+// host/io.h end up here and are passed on to the selected backend.
+struct i2c_reg_backend {
+    const char *name;
+    uint32_t (*read)(void *ctx, uint32_t base, uint32_t offset);
+    void     (*write)(void *ctx, uint32_t base, uint32_t offset, uint32_t value);
+    void     (*idle)(void *ctx);   // CPU waits for an interrupt, I2C_IDLE_HOOK()
+    void     *ctx;
+};
+
+// Select the backend; without a call the i2c_top model with a DS3231 is used
+void i2c_regs_set_backend(const struct i2c_reg_backend *backend);
+
+uint32_t i2c_regs_read(uint32_t base, uint32_t offset);
+void i2c_regs_write(uint32_t base, uint32_t offset, uint32_t value);
+void i2c_regs_idle(void);
+
+// Interrupt handler of the driver, registered through alt_ic_isr_register()
+int i2c_regs_register_isr(void (*isr)(void *context), void *context);
+
+// Called by the backend while its interrupt line is high
+void i2c_regs_irq(void);
+
+// alt_ic_irq_enable()/alt_ic_irq_disable(), registering a handler enables the line.
+// i2c_regs_irq_wanted(): a handler is registered and its line enabled, an idle
+// backend waits for the interrupt only then
+void i2c_regs_irq_line(int enabled);
+int i2c_regs_irq_wanted(void);
+
+// alt_irq_disable_all()/alt_irq_enable_all(), an interrupt raised in between is
+// delivered when the previous state is restored
+unsigned int i2c_regs_irq_disable(void);
+void i2c_regs_irq_restore(unsigned int enabled);
+
+#endif // I2C_REGS_H
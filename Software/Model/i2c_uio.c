@@ -0,0 +1,137 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "i2c_uio.h"
+
+// Accesses outside the window read 0 and are dropped, like an unmapped Avalon address
+static uint32_t uio_read(void *ctx, uint32_t base, uint32_t offset) {
+    struct i2c_uio *u = ctx;
+    uint32_t a = base - u->base + offset;
+    if (a > u->size - 4 || (a & 3) != 0) {
+        return 0;
+    }
+    return u->regs[a / 4];
+}
+
+static void uio_write(void *ctx, uint32_t base, uint32_t offset, uint32_t value) {
+    struct i2c_uio *u = ctx;
+    uint32_t a = base - u->base + offset;
+    if (a > u->size - 4 || (a & 3) != 0) {
+        return;
+    }
+    u->regs[a / 4] = value;
+}
+
+static void uio_idle(void *ctx) {
+    struct i2c_uio *u = ctx;
+    struct pollfd pfd;
+    struct timespec ts;
+    uint32_t v = 1;
+
+    // without the interrupt in use by the driver (polling mode) nothing ends the wait,
+    // the delays of the driver run through here and must not grow to I2C_UIO_IRQ_MS
+    if (!u->irq || !i2c_regs_irq_wanted()) {
+        ts.tv_sec = 0;
+        ts.tv_nsec = I2C_UIO_POLL_US * 1000L;
+        nanosleep(&ts, NULL);
+        i2c_regs_irq();
+        return;
+    }
+    // the UIO driver masks the interrupt when it fires, writing 1 enables it again
+    if (write(u->fd, &v, sizeof(v)) != sizeof(v)) {
+        u->irq = 0;
+        return;
+    }
+    pfd.fd = u->fd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, I2C_UIO_IRQ_MS) == 1 && (pfd.revents & POLLIN)) {
+        if (read(u->fd, &v, sizeof(v)) == sizeof(v)) {
+            u->irq_count++;
+            i2c_regs_irq();
+        }
+    }
+}
+
+// Size of map 0 of a UIO device, 0 when sysfs does not have it
+static size_t uio_map_size(const char *path) {
+    const char *name = strrchr(path, '/');
+    char sysfs[128];
+    unsigned long size = 0;
+    FILE *f;
+
+    snprintf(sysfs, sizeof(sysfs), "/sys/class/uio/%s/maps/map0/size", name != NULL ? name + 1 : path);
+    f = fopen(sysfs, "r");
+    if (f != NULL) {
+        if (fscanf(f, "%lx", &size) != 1) {
+            size = 0;
+        }
+        fclose(f);
+    }
+    return size;
+}
+
+// Close the file after a failed open, errno of the failure is kept
+static const struct i2c_reg_backend *open_failed(struct i2c_uio *u) {
+    int err = errno;
+    close(u->fd);
+    u->fd = -1;
+    errno = err;
+    return NULL;
+}
+
+const struct i2c_reg_backend *i2c_uio_open(struct i2c_uio *u, const char *path,
+                                           uint32_t base, size_t size) {
+    struct stat st;
+    void *p;
+
+    memset(u, 0, sizeof(*u));
+    u->fd = open(path, O_RDWR | O_SYNC);
+    if (u->fd < 0) {
+        return NULL;
+    }
+    if (fstat(u->fd, &st) != 0) {
+        return open_failed(u);
+    }
+    // other character devices (/dev/mem) map fine but have no interrupt to wait for
+    u->irq = S_ISCHR(st.st_mode) && uio_map_size(path) != 0;
+    if (size == 0) {
+        size = u->irq ? uio_map_size(path) : (size_t)st.st_size;
+    }
+    if (size < 4) {
+        errno = EINVAL;
+        return open_failed(u);
+    }
+
+    // map N of a UIO device is at offset N pages
+    p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, u->fd, 0);
+    if (p == MAP_FAILED) {
+        return open_failed(u);
+    }
+    u->regs = p;
+    u->size = size;
+    u->base = base;
+    u->backend.name = "uio";
+    u->backend.read = uio_read;
+    u->backend.write = uio_write;
+    u->backend.idle = uio_idle;
+    u->backend.ctx = u;
+    return &u->backend;
+}
+
+void i2c_uio_close(struct i2c_uio *u) {
+    if (u->regs != NULL) {
+        munmap((void *)u->regs, u->size);
+        u->regs = NULL;
+    }
+    if (u->fd >= 0) {
+        close(u->fd);
+        u->fd = -1;
+    }
+}
@@ -0,0 +1,44 @@
+/* i2c_uio.h */
+#ifndef I2C_UIO_H
+#define I2C_UIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "i2c_regs.h"
+
+// Register backend of a Linux build (HPS): the register window of the core is
+// mmapped from a UIO device (map 0 of /dev/uioN) and accessed directly, without a
+// syscall per access. Any other file that can be mmapped works as well, e.g. a
+// memory-backed fake of the core in a test.
+//
+// Interrupts: on a UIO device the idle call unmasks the interrupt, waits for it in
+// poll() and runs the handler of the driver when it came. That needs the driver in
+// interrupt mode (handler registered, line enabled); in polling mode, and on a plain
+// file that has no interrupt line, the idle call sleeps I2C_UIO_POLL_US and runs the
+// handler anyway, the handler finds no event when nothing happened.
+
+#ifndef I2C_UIO_IRQ_MS
+#define I2C_UIO_IRQ_MS   10     // longest wait for the interrupt, the driver checks its timeouts in between
+#endif
+#ifndef I2C_UIO_POLL_US
+#define I2C_UIO_POLL_US  100
+#endif
+
+struct i2c_uio {
+    int fd;
+    volatile uint32_t *regs;
+    size_t size;                // bytes of the window
+    uint32_t base;              // bus address of the window, I2C_0_BASE of the driver
+    int irq;                    // fd is a UIO device with an interrupt
+    unsigned long irq_count;    // interrupts seen
+    struct i2c_reg_backend backend;
+};
+
+// Map size bytes of path (0: size of the UIO map from sysfs, or of the file) as the
+// registers at bus address base. Returns the backend for i2c_regs_set_backend(),
+// NULL with errno set when the file cannot be opened or mapped.
+const struct i2c_reg_backend *i2c_uio_open(struct i2c_uio *u, const char *path,
+                                           uint32_t base, size_t size);
+void i2c_uio_close(struct i2c_uio *u);
+
+#endif // I2C_UIO_H
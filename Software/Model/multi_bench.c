@@ -0,0 +1,100 @@
+// Clock registers read from the DS3231 on every channel of the i2c_multi_top model,
+// one channel after the other and all channels at once.
+// usage: multi_bench [irq]     (built with I2C_CHANNELS = I2C_MODEL_CHANNELS)
+#include <stdlib.h>
+#include <string.h>
+#include "rtc_driver.h"
+#include "i2c_model.h"
+
+#define ROUNDS        200
+
+static byte reg = REG_SECONDS;
+static byte data[I2C_CHANNELS][7];
+static struct i2c_msg msgs[I2C_CHANNELS][2];
+static struct i2c_async reqs[I2C_CHANNELS];
+
+static double cycles_to_us(uint64_t cycles) {
+    return cycles * 1e6 / I2C_MODEL_CLK_HZ;
+}
+
+// Seconds to year from the DS3231 of the first n channels, all transfers started
+// before the first one is waited for when parallel is set
+static unsigned long run(int n, int parallel, unsigned long *errors) {
+    unsigned long bytes = 0;
+    int round, c, busy;
+
+    for (round = 0; round < ROUNDS; round++) {
+        for (c = 0; c < n; c++) {
+            if (i2c_submit(i2c_get_channel(c), &reqs[c], msgs[c], 2, NULL, NULL) != 0) {
+                reqs[c].status = I2C_ERR_INVAL;
+            }
+            if (!parallel) {
+                i2c_wait(&reqs[c]);
+            }
+        }
+        // every channel advances on its own status while polling
+        for (busy = 1; busy; ) {
+            busy = 0;
+            for (c = 0; c < n; c++) {
+                i2c_poll(i2c_get_channel(c));
+                busy |= reqs[c].status == I2C_ASYNC_BUSY;
+            }
+            I2C_IDLE_HOOK();
+        }
+        for (c = 0; c < n; c++) {
+            if (reqs[c].status < 0) {
+                (*errors)++;
+            } else {
+                bytes += sizeof(data[c]);
+            }
+        }
+    }
+    return bytes;
+}
+
+int main(int argc, char **argv) {
+    uint64_t start, elapsed, busy;
+    unsigned long bytes, errors;
+    int i, c, n, parallel, irq = 0;
+
+    for (i = 1; i < argc; i++) {
+        irq |= strcmp(argv[i], "irq") == 0;
+    }
+    for (c = 0; c < I2C_CHANNELS; c++) {
+        msgs[c][0].addr = RTC_ADDRESS;
+        msgs[c][0].flags = 0;
+        msgs[c][0].len = 1;
+        msgs[c][0].buf = &reg;
+        msgs[c][1].addr = RTC_ADDRESS;
+        msgs[c][1].flags = I2C_M_RD;
+        msgs[c][1].len = sizeof(data[c]);
+        msgs[c][1].buf = data[c];
+        if (irq && i2c_enable_interrupts(i2c_get_channel(c)) != 0) {
+            return 1;
+        }
+        i2c_set_device_speed(i2c_get_channel(c), RTC_ADDRESS, RTC_BUS_SPEED);
+    }
+
+    printf("%s, %d reads of seconds to year per channel\n", irq ? "interrupts" : "polling", ROUNDS);
+    printf("  %8s %-10s %10s %10s %9s\n", "channels", "order", "time us", "kB/s", "bus busy");
+    for (n = 1; n <= I2C_CHANNELS; n *= 2) {
+        for (parallel = 0; parallel <= 1; parallel++) {
+            if (n == 1 && parallel) {
+                continue;
+            }
+            i2c_model_clear_stats();
+            errors = 0;
+            start = i2c_model_now();
+            bytes = run(n, parallel, &errors);
+            elapsed = i2c_model_now() - start;
+            busy = 0;
+            for (c = 0; c < n; c++) {
+                busy += i2c_model_get_channel_stats(c)->busy_cycles;
+            }
+            printf("  %8d %-10s %10.0f %10.1f %8.0f%%%s\n", n, parallel ? "parallel" : "sequential",
+                   cycles_to_us(elapsed), bytes / (cycles_to_us(elapsed) / 1e3),
+                   100.0 * busy / ((double)elapsed * n), errors ? "  errors" : "");
+        }
+    }
+    return 0;
+}
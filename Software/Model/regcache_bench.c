@@ -0,0 +1,95 @@
+// Periodic reconfiguration of the DS3231 (alarm 1, alarm 2, control, aging offset)
+// written one register per transaction and through the shadow of rtc_regcache(),
+// with the bus traffic of both. Every round recomputes all of the settings, only a
+// few of them change from one round to the next.
+// usage: regcache_bench
+#include <string.h>
+#include "rtc_driver.h"
+#include "i2c_model.h"
+
+#define ROUNDS      1000
+#define FIRST_REG   REG_ALARM1_SECONDS
+#define CONFIG_LEN  (REG_AGING - REG_ALARM1_SECONDS + 1)   // alarms, control, status, aging
+
+// Settings of a round, the alarm minutes move every 10 rounds, the alarm interrupt
+// is switched every 50. The status register is left to the DS3231.
+static void settings(int round, byte *cfg) {
+    cfg[0] = 0x00;                                  // alarm 1 seconds
+    cfg[1] = (byte)(((round / 10) % 6) << 4);       // alarm 1 minutes
+    cfg[2] = 0x07;                                  // alarm 1 hours
+    cfg[3] = 0x80;                                  // alarm 1 every day
+    cfg[4] = 0x30;                                  // alarm 2 minutes
+    cfg[5] = 0x12;                                  // alarm 2 hours
+    cfg[6] = 0x80;                                  // alarm 2 every day
+    cfg[7] = 0x1C | ((round / 50) & 1);             // control: A1IE
+    cfg[8] = 0x00;                                  // status, not written
+    cfg[9] = 0x05;                                  // aging offset
+}
+
+// Registers of the device, past the shadow
+static int device_regs(byte *cfg) {
+    byte reg = FIRST_REG;
+    struct i2c_msg msgs[2] = {
+        { RTC_ADDRESS, 0, 1, &reg },
+        { RTC_ADDRESS, I2C_M_RD, CONFIG_LEN, cfg },
+    };
+    return i2c_transfer(i2c_get_channel(0), msgs, 2);
+}
+
+static void report(const char *name, const struct i2c_model_stats *s, int ok) {
+    printf("  %-22s %8lu %8lu %10.1f   %s\n", name, (unsigned long)s->transactions, (unsigned long)s->bytes,
+           s->busy_cycles * 1e3 / I2C_MODEL_CLK_HZ, ok ? "ok" : "DEVICE DIFFERS");
+}
+
+int main(void) {
+    struct i2c_channel *bus = i2c_get_channel(0);
+    struct i2c_regcache *cache = rtc_regcache();
+    byte cfg[CONFIG_LEN], dev[CONFIG_LEN], buf[2];
+    struct i2c_msg msg = { RTC_ADDRESS, 0, 2, buf };
+    int round, i, ok, failed = 0;
+
+    i2c_set_device_speed(bus, RTC_ADDRESS, RTC_BUS_SPEED);
+    printf("%d rounds of %d configuration registers\n", ROUNDS, CONFIG_LEN - 1);
+    printf("  %-22s %8s %8s %10s\n", "", "transact", "bytes", "busy ms");
+
+    // one transaction per register, as the register-at-a-time code did
+    i2c_model_clear_stats();
+    for (round = 0; round < ROUNDS; round++) {
+        settings(round, cfg);
+        for (i = 0; i < CONFIG_LEN; i++) {
+            if (FIRST_REG + i == REG_STATUS) {
+                continue;
+            }
+            buf[0] = FIRST_REG + i;
+            buf[1] = cfg[i];
+            i2c_transfer(bus, &msg, 1);
+        }
+    }
+    ok = device_regs(dev) >= 0 && memcmp(dev, cfg, CONFIG_LEN - 2) == 0 && dev[CONFIG_LEN - 1] == cfg[CONFIG_LEN - 1];
+    failed |= !ok;
+    report("register per write", i2c_model_get_stats(), ok);
+
+    // through the shadow, flushed once per round
+    i2c_model_clear_stats();
+    for (round = 0; round < ROUNDS; round++) {
+        settings(round + 1, cfg);
+        i2c_regcache_write(cache, FIRST_REG, cfg, REG_STATUS - FIRST_REG);
+        i2c_regcache_write(cache, REG_AGING, &cfg[CONFIG_LEN - 1], 1);
+        i2c_regcache_flush(cache);
+    }
+    ok = device_regs(dev) >= 0 && memcmp(dev, cfg, CONFIG_LEN - 2) == 0 && dev[CONFIG_LEN - 1] == cfg[CONFIG_LEN - 1];
+    failed |= !ok;
+    report("shadow, flush per round", i2c_model_get_stats(), ok);
+    printf("  shadow: %lu register writes, %lu elided, %lu transactions\n",
+           cache->stats.writes, cache->stats.elided, cache->stats.transactions);
+
+    // reads of cacheable registers come from memory, volatile ones from the device
+    i2c_model_clear_stats();
+    for (round = 0; round < ROUNDS; round++) {
+        i2c_regcache_read(cache, REG_CONTROL, buf, 1);
+        i2c_regcache_read(cache, REG_STATUS, buf, 1);
+    }
+    printf("  %d control and status reads: %lu transactions, %lu of %lu registers from memory\n",
+           ROUNDS, (unsigned long)i2c_model_get_stats()->transactions, cache->stats.hits, cache->stats.reads);
+    return failed;
+}
@@ -0,0 +1,148 @@
+// Several clients sharing the RTC through the scheduler, run against the model.
+// usage: sched_bench [coalesce] [irq]
+#include <stdlib.h>
+#include <string.h>
+#include "i2c_sched.h"
+#include "i2c_model.h"
+
+#define RUN_MS        200
+#define MAX_SAMPLES   4096
+
+struct client {
+    const char *name;
+    byte priority;
+    byte reg;
+    int len;
+    int write;
+    unsigned int period_us;
+
+    struct i2c_request req;
+    byte buf[I2C_SCHED_MAX_BURST];
+    uint64_t release;           // model time the current request was due
+    int pending;
+    unsigned long errors;
+    unsigned int count;
+    uint64_t latency[MAX_SAMPLES];
+};
+
+static struct client clients[] = {
+    { "time",    0, 0x00, 7, 0, 1000,  {0}, {0}, 0, 0, 0, 0, {0} },
+    { "alarm1",  1, 0x07, 4, 0, 1500,  {0}, {0}, 0, 0, 0, 0, {0} },
+    { "status",  1, 0x0E, 2, 0,  500,  {0}, {0}, 0, 0, 0, 0, {0} },
+    { "temp",    2, 0x11, 2, 0, 2500,  {0}, {0}, 0, 0, 0, 0, {0} },
+    { "display", 3, 0x00, 3, 0,  500,  {0}, {0}, 0, 0, 0, 0, {0} },
+    { "alarm2",  3, 0x0B, 3, 1, 5000,  {0}, {0}, 0, 0, 0, 0, {0} },
+};
+#define CLIENTS (int)(sizeof(clients) / sizeof(clients[0]))
+
+static uint64_t us_to_cycles(unsigned int us) {
+    return (uint64_t)us * (I2C_MODEL_CLK_HZ / 1000000UL);
+}
+
+static double cycles_to_us(uint64_t cycles) {
+    return cycles * 1e6 / I2C_MODEL_CLK_HZ;
+}
+
+static void complete(struct i2c_request *req) {
+    struct client *c = req->context;
+    if (req->status < 0) {
+        c->errors++;
+    }
+    if (c->count < MAX_SAMPLES) {
+        c->latency[c->count++] = i2c_model_now() - c->release;
+    }
+    c->pending = 0;
+}
+
+static void release(struct client *c) {
+    memset(&c->req, 0, sizeof(c->req));
+    c->req.addr = RTC_ADDRESS;
+    c->req.reg = c->reg;
+    c->req.len = c->len;
+    c->req.flags = c->write ? 0 : I2C_REQ_READ;
+    c->req.priority = c->priority;
+    c->req.buf = c->buf;
+    c->req.complete = complete;
+    c->req.context = c;
+    c->pending = 1;
+    if (i2c_sched_submit(&c->req) != 0) {
+        c->pending = 0;
+        c->errors++;
+    }
+}
+
+static int compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv) {
+    const struct i2c_sched_stats *s;
+    const struct i2c_model_stats *ms;
+    uint64_t start, end, elapsed, sum;
+    int i, n, irq = 0, merge = 0;
+    struct client *c;
+    struct i2c_channel *bus = i2c_get_channel(I2C_SCHED_CHANNEL);
+
+    for (i = 1; i < argc; i++) {
+        merge |= strcmp(argv[i], "coalesce") == 0;
+        irq |= strcmp(argv[i], "irq") == 0;
+    }
+    if (irq && i2c_enable_interrupts(bus) != 0) {
+        return 1;
+    }
+    i2c_set_device_speed(bus, RTC_ADDRESS, RTC_BUS_SPEED);
+    i2c_sched_coalesce(merge);
+
+    start = i2c_model_now();
+    end = start + us_to_cycles(RUN_MS * 1000);
+    for (i = 0; i < CLIENTS; i++) {
+        clients[i].release = start;
+    }
+    i2c_model_clear_stats();
+
+    while (i2c_model_now() < end) {
+        for (i = 0; i < CLIENTS; i++) {
+            c = &clients[i];
+            if (!c->pending && i2c_model_now() >= c->release + (c->count ? us_to_cycles(c->period_us) : 0)) {
+                if (c->count) {
+                    c->release += us_to_cycles(c->period_us);
+                }
+                release(c);
+            }
+        }
+        i2c_poll(bus);
+        I2C_IDLE_HOOK();
+    }
+    for (i = 0; i < CLIENTS; i++) {
+        if (clients[i].pending) {
+            i2c_sched_wait(&clients[i].req);
+        }
+    }
+    elapsed = i2c_model_now() - start;
+
+    s = i2c_sched_get_stats();
+    ms = i2c_model_get_stats();
+    printf("%s, %s: %lu requests in %lu transactions (%lu coalesced), %.0f requests/s, %.1f kB/s data, bus busy %.0f%%\n",
+           irq ? "interrupts" : "polling", merge ? "coalescing" : "no coalescing",
+           s->requests, s->transactions, s->merged,
+           s->requests / (cycles_to_us(elapsed) / 1e6),
+           s->bytes / (cycles_to_us(elapsed) / 1e3),
+           100.0 * ms->busy_cycles / elapsed);
+    printf("  %-8s %4s %6s %6s %9s %9s %9s\n", "client", "prio", "done", "errors", "mean us", "p99 us", "max us");
+    for (i = 0; i < CLIENTS; i++) {
+        c = &clients[i];
+        n = c->count;
+        sum = 0;
+        qsort(c->latency, n, sizeof(c->latency[0]), compare);
+        for (int k = 0; k < n; k++) {
+            sum += c->latency[k];
+        }
+        printf("  %-8s %4d %6d %6lu %9.1f %9.1f %9.1f\n", c->name, c->priority, n, c->errors,
+               n ? cycles_to_us(sum / n) : 0.0,
+               n ? cycles_to_us(c->latency[(n * 99) / 100]) : 0.0,
+               n ? cycles_to_us(c->latency[n - 1]) : 0.0);
+    }
+    return 0;
+}
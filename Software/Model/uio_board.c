@@ -0,0 +1,58 @@
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "host_board.h"
+#include "i2c_uio.h"
+
+// Board of the Linux build: the core behind a UIO device, I2C_UIO_DEVICE in the
+// environment (default /dev/uio0), I2C_UIO_SIZE the bytes of its window when the
+// device is not a UIO device. The window starts at I2C_0_BASE of the driver.
+
+#define UIO_DEFAULT_DEVICE  "/dev/uio0"
+#define UIO_I2C_BASE        0x00081000UL
+
+static struct i2c_uio uio;
+
+static void report(void) {
+    if (uio.irq_count != 0) {
+        fprintf(stderr, "uio: %lu interrupts\n", uio.irq_count);
+    }
+    i2c_uio_close(&uio);
+}
+
+// The command sequencer masters memory the cpu of a Linux build does not reach
+// through the window, its lists cannot be run from here
+uint32_t host_bus_address(const void *p) {
+    (void)p;
+    return 0;
+}
+
+// Timestamp timer of the Linux build, CLOCK_MONOTONIC in us
+uint32_t host_timestamp(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000UL + (uint64_t)ts.tv_nsec / 1000UL);
+}
+
+uint32_t host_timestamp_freq(void) {
+    return 1000000UL;
+}
+
+const struct i2c_reg_backend *host_board_init(void) {
+    const char *dev = getenv("I2C_UIO_DEVICE");
+    const char *size = getenv("I2C_UIO_SIZE");
+    const struct i2c_reg_backend *b;
+
+    if (dev == NULL) {
+        dev = UIO_DEFAULT_DEVICE;
+    }
+    b = i2c_uio_open(&uio, dev, UIO_I2C_BASE, size != NULL ? strtoul(size, NULL, 0) : 0);
+    if (b == NULL) {
+        fprintf(stderr, "uio: %s: %s\n", dev, strerror(errno));
+        exit(1);
+    }
+    atexit(report);
+    return b;
+}
@@ -0,0 +1,155 @@
+// The Linux build (UIO backend, uio_board.c) against a fake of the core: a child
+// process runs the i2c_top model with a DS3231 behind a shared file and keeps the
+// auto poller registers of the file in step with it. A file can only carry registers
+// without side effects on access (the fake cannot see a read of RX_DATA or a write-1-
+// to-clear of STATUS), so the transfers are left to the other programs and this one
+// checks the window, the auto poller and the idle call of the driver on top of it.
+// usage: uio_test
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include "rtc_driver.h"
+#include "i2c_model.h"
+#include "ds3231_model.h"
+#include "i2c_uio.h"
+
+#define WINDOW  0x1000  // bytes of the fake, one page
+
+// Configuration registers the fake passes on to the model when the cpu changed them
+static const uint32_t forwarded[] = {
+    SCL_TIMING_REGISTER, START_TIMING_REGISTER, STOP_TIMING_REGISTER, STRETCH_TIMEOUT_REGISTER,
+    POLL_CONTROL_REGISTER, POLL_RANGE_REGISTER
+};
+#define FORWARDED  (sizeof(forwarded) / sizeof(forwarded[0]))
+
+static int failures = 0;
+
+static void check(int ok, const char *what) {
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAILED");
+    failures += !ok;
+}
+
+// The fake: the model advances on its own time, the mirror goes out before the count
+// so a cpu that sees the new count reads the new mirror
+static void fake_core(volatile uint32_t *regs, int ready) {
+    struct ds3231_model rtc;
+    uint32_t last[FORWARDED], count;
+    unsigned int i, loops = 0;
+    pid_t parent = getppid();
+
+    ds3231_model_init(&rtc);
+    rtc.regs[REG_HOURS] = 0x12;
+    rtc.regs[REG_YEAR] = 0x25;
+    i2c_model_attach(&rtc.slave);
+    for (i = 0; i < FORWARDED; i++) {
+        last[i] = regs[forwarded[i] / 4] = i2c_model_read(forwarded[i]);
+    }
+    regs[POLL_STATUS_REGISTER / 4] = i2c_model_read(POLL_STATUS_REGISTER);
+    count = regs[POLL_COUNT_REGISTER / 4] = i2c_model_read(POLL_COUNT_REGISTER);
+    if (write(ready, "", 1) != 1) {
+        exit(1);
+    }
+
+    // until the test kills it, or ended without doing so
+    while (++loops % 1024 != 0 || getppid() == parent) {
+        for (i = 0; i < FORWARDED; i++) {
+            if (regs[forwarded[i] / 4] != last[i]) {
+                last[i] = regs[forwarded[i] / 4];
+                i2c_model_write(forwarded[i], last[i]);
+            }
+        }
+        i2c_model_idle();
+        if (i2c_model_read(POLL_COUNT_REGISTER) != count) {
+            for (i = 0; i < POLL_MAX; i += 4) {
+                regs[(POLL_MIRROR_REGISTER + i) / 4] = i2c_model_read(POLL_MIRROR_REGISTER + i);
+            }
+            count = regs[POLL_COUNT_REGISTER / 4] = i2c_model_read(POLL_COUNT_REGISTER);
+        }
+        regs[POLL_STATUS_REGISTER / 4] = i2c_model_read(POLL_STATUS_REGISTER);
+    }
+    exit(0);
+}
+
+// Idle calls until the auto poller finished the given number of polls, returns the poll
+// count then, 0 when they did not come within a second
+static unsigned long wait_polls(struct i2c_channel *ch, unsigned long polls) {
+    byte buf[1];
+    unsigned long first = i2c_autopoll_read(ch, buf, 0, 1, NULL), now = first;
+    int n;
+
+    for (n = 0; n < 1000000 / I2C_UIO_POLL_US && now - first < polls; n++) {
+        I2C_IDLE_HOOK();
+        now = i2c_autopoll_read(ch, buf, 0, 1, NULL);
+    }
+    return now - first >= polls ? now : 0;
+}
+
+int main(void) {
+    char path[] = "/tmp/uio_test.XXXXXX";
+    volatile uint32_t *fake;
+    struct i2c_channel *ch;
+    byte regs[DS3231_REGISTERS];
+    unsigned int age;
+    unsigned long count;
+    uint32_t t0;
+    int fd, ready[2], status;
+    pid_t pid;
+    char c;
+
+    fd = mkstemp(path);
+    if (fd < 0 || ftruncate(fd, WINDOW) != 0 || pipe(ready) != 0) {
+        perror("uio_test");
+        return 1;
+    }
+    pid = fork();
+    if (pid == 0) {
+        fake = mmap(NULL, WINDOW, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (fake == MAP_FAILED) {
+            exit(1);
+        }
+        fake_core(fake, ready[1]);
+    }
+    if (pid < 0 || read(ready[0], &c, 1) != 1) {
+        perror("uio_test: fake core");
+        unlink(path);
+        return 1;
+    }
+    close(fd);
+
+    // the driver opens the fake through the board of the Linux build
+    setenv("I2C_UIO_DEVICE", path, 1);
+    ch = i2c_get_channel(0);
+    printf("UIO backend on a fake core in %s\n", path);
+
+    i2c_set_stretch_timeout(ch, 1000);
+    check(i2c_regs_read(I2C_0_BASE, STRETCH_TIMEOUT_REGISTER) == 1000 * (I2C_SYS_CLK_HZ / 1000000UL),
+          "register written through the mapping");
+    check(i2c_regs_read(I2C_0_BASE, WINDOW) == 0, "read outside the window");
+    check(i2c_enable_interrupts(ch) == 0, "interrupt handler registered");
+
+    t0 = alt_timestamp();
+    I2C_IDLE_HOOK();
+    check((uint32_t)(alt_timestamp() - t0) >= I2C_UIO_POLL_US, "idle call waits without an interrupt line");
+
+    i2c_autopoll_start(ch, RTC_ADDRESS, REG_SECONDS, DS3231_REGISTERS, 1);
+    count = wait_polls(ch, 3);
+    check(count != 0, "auto poller runs in the fake");
+    i2c_autopoll_read(ch, regs, REG_SECONDS, DS3231_REGISTERS, &age);
+    check(regs[REG_HOURS] == 0x12 && regs[REG_DAY] == 0x01 && regs[REG_MONTH] == 0x01 &&
+          regs[REG_YEAR] == 0x25, "clock registers in the mirror");
+    check(regs[REG_TEMP_HIGH] == 0x19 && regs[REG_TEMP_LOW] == 0x40, "temperature registers in the mirror");
+    check(age <= 2, "age of the mirror");
+
+    i2c_autopoll_stop(ch);
+    count = wait_polls(ch, 1);
+    count = wait_polls(ch, 1);
+    check(count == 0, "auto poller stopped");
+
+    kill(pid, SIGTERM);
+    waitpid(pid, &status, 0);
+    unlink(path);
+    printf("%s\n", failures ? "uio_test FAILED" : "uio_test passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+// Soak test of the driver with its tracing compiled in: write_byte, read_byte, burst
+// write, burst read and get_rtc_time on the DS3231 in turn, every read checked against
+// the write before it, then the latency percentiles of each kind and the bytes/s.
+// Runs on the target and in the host build against the model (Software/Model).
+// usage: soaktest [transactions] [irq]
+#define I2C_DRIVER_TRACE  1
+#include "rtc_driver.h"
+#include "rtc_driver.c"
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef SOAK_TRANSACTIONS
+#define SOAK_TRANSACTIONS  1000000UL
+#endif
+#define SOAK_PROGRESS      100000UL  // transactions between two progress lines
+#define SOAK_LOG           10        // events of the log printed at the end
+
+#define REG_ALARM1         0x07      // alarm registers, nothing runs on their contents
+#define BURST_LEN          6         // alarm 1 minutes to alarm 2 day
+
+static unsigned long transactions = 0, errors = 0, mismatches = 0;
+static unsigned long long bytes = 0;
+
+// One transfer, counted
+static int soak_transfer(const struct i2c_msg *msgs, int num) {
+    int result = i2c_transfer(i2c_get_channel(0), msgs, num);
+    transactions++;
+    if (result < 0) {
+        errors++;
+    } else {
+        for (num--; num >= 0; num--) {
+            bytes += msgs[num].len;
+        }
+    }
+    return result;
+}
+
+// The five kinds once, the data depends on round
+static void soak_round(unsigned long round) {
+    byte out[1 + BURST_LEN], in[BURST_LEN], reg;
+    struct i2c_msg msgs[2];
+    byte s, m, h, wd, d, mo, yr;
+    int i;
+
+    // write_byte, read_byte
+    out[0] = REG_ALARM1;
+    out[1] = (byte)round;
+    msgs[0].addr = RTC_ADDRESS;
+    msgs[0].flags = 0;
+    msgs[0].len = 2;
+    msgs[0].buf = out;
+    soak_transfer(msgs, 1);
+    reg = REG_ALARM1;
+    msgs[0].len = 1;
+    msgs[0].buf = &reg;
+    msgs[1].addr = RTC_ADDRESS;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = 1;
+    msgs[1].buf = in;
+    if (soak_transfer(msgs, 2) >= 0 && in[0] != out[1]) {
+        mismatches++;
+    }
+
+    // burst write, burst read
+    out[0] = REG_ALARM1 + 1;
+    for (i = 0; i < BURST_LEN; i++) {
+        out[1 + i] = (byte)(round * 7 + i);
+    }
+    msgs[0].len = 1 + BURST_LEN;
+    msgs[0].buf = out;
+    soak_transfer(msgs, 1);
+    reg = REG_ALARM1 + 1;
+    msgs[0].len = 1;
+    msgs[0].buf = &reg;
+    msgs[1].len = BURST_LEN;
+    if (soak_transfer(msgs, 2) >= 0 && memcmp(in, out + 1, BURST_LEN) != 0) {
+        mismatches++;
+    }
+
+    transactions++;
+    if (get_rtc_time(&s, &m, &h, &wd, &d, &mo, &yr) != 0) {
+        errors++;
+    } else {
+        bytes += 8;
+    }
+}
+
+int main(int argc, char **argv) {
+    unsigned long count = SOAK_TRANSACTIONS, next = SOAK_PROGRESS, round;
+    unsigned long long ticks = 0;
+    struct i2c_log_event log[SOAK_LOG];
+    struct i2c_channel *bus = i2c_get_channel(0);
+    alt_timestamp_type start;
+    double seconds;
+    int i, irq = 0;
+
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "irq") == 0) {
+            irq = 1;
+        } else {
+            count = strtoul(argv[i], NULL, 0);
+        }
+    }
+    if (alt_timestamp_start() < 0) {
+        printf("soak test needs the timestamp timer\n");
+        return 1;
+    }
+    if (irq && i2c_enable_interrupts(bus) != 0) {
+        printf("I2C interrupt not available\n");
+        return 1;
+    }
+    i2c_set_device_speed(bus, RTC_ADDRESS, RTC_BUS_SPEED);
+    i2c_stats_clear();
+
+    printf("Soak test, %lu transactions, %s\n", count, irq ? "interrupts" : "polling");
+    for (round = 0; transactions < count; round++) {
+        // the 32 bit timer wraps, every round is timed on its own
+        start = alt_timestamp();
+        soak_round(round);
+        ticks += (alt_timestamp_type)(alt_timestamp() - start);
+        if (transactions >= next) {
+            printf("  %9lu transactions, %lu errors, %lu mismatches\n", transactions, errors, mismatches);
+            next += SOAK_PROGRESS;
+        }
+    }
+
+    seconds = (double)ticks / alt_timestamp_freq();
+    printf("%lu transactions in %.2f s: %.0f transactions/s, %.0f bytes/s, %lu errors, %lu mismatches\n",
+           transactions, seconds, transactions / seconds, bytes / seconds, errors, mismatches);
+    i2c_stats_print();
+    printf("Last events:\n");
+    i2c_log_print(log, i2c_log_read(log, SOAK_LOG));
+    return errors != 0 || mismatches != 0;
+}
@@ -0,0 +1,35 @@
+# One configuration of the core for the Fmax report, run in its work directory:
+#   quartus_sh -t compile.tcl <family> <device> <name> <top level> <period ns> [GENERIC=value ...]
+
+load_package flow
+
+lassign $argv family device name top period
+set generics [lrange $argv 5 end]
+set core [file normalize [file join [file dirname [info script]] .. Core]]
+
+project_new $name -overwrite
+set_global_assignment -name FAMILY $family
+set_global_assignment -name DEVICE $device
+set_global_assignment -name TOP_LEVEL_ENTITY $top
+foreach f {i2c_fifo.vhd i2c_trace.vhd {i2c_master (2) 17.39.48.vhd} i2c_poller.vhd i2c_sequencer.vhd
+           {i2c_registerbank 17.39.19 17.39.48.vhd} {i2c_top 17.39.19 17.39.48.vhd} i2c_multi_top.vhd} {
+    set_global_assignment -name VHDL_FILE [file join $core $f]
+}
+foreach g $generics {
+    lassign [split $g =] generic value
+    set_parameter -name $generic $value
+}
+
+# clock of the configuration, read before the constraints of the core
+set fh [open clock.sdc w]
+puts $fh "set SYS_CLK_PERIOD $period"
+close $fh
+set_global_assignment -name SDC_FILE clock.sdc
+set_global_assignment -name SDC_FILE [file join $core {time_constraints 17.39.48.sdc}]
+
+# first stages of the sda/scl synchronizers, kept together and out of the Fmax
+set_instance_assignment -name SYNCHRONIZER_IDENTIFICATION "FORCED IF ASYNCHRONOUS" -to "*scl_sync*"
+set_instance_assignment -name SYNCHRONIZER_IDENTIFICATION "FORCED IF ASYNCHRONOUS" -to "*sda_sync*"
+
+execute_flow -compile
+project_close
@@ -0,0 +1,26 @@
+# Fmax and worst slacks of a compiled configuration into fmax.txt:
+#   quartus_sta -t sta.tcl <name>
+
+lassign $argv name
+
+project_open $name
+create_timing_netlist
+read_sdc
+update_timing_netlist
+
+set fmax "-"
+foreach info [get_clock_fmax_info] {
+    lassign $info clock_name unrestricted restricted
+    if {$clock_name eq "clk"} {
+        set fmax $restricted
+    }
+}
+set setup [lindex [report_timing -setup -npaths 1 -detail summary -quiet] 1]
+set hold  [lindex [report_timing -hold  -npaths 1 -detail summary -quiet] 1]
+
+set fh [open fmax.txt w]
+puts $fh [format "%-16s fmax_mhz=%s setup_slack_ns=%s hold_slack_ns=%s" $name $fmax $setup $hold]
+close $fh
+
+delete_timing_netlist
+project_close
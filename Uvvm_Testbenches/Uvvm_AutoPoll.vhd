@@ -0,0 +1,338 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+  signal irq : std_logic;
+
+  -- bus conditions seen on the bus
+  signal start_count   : natural := 0;
+  signal stop_count    : natural := 0;
+
+  -- bytes written to the slave after the address, in bus order
+  type t_byte_array is array (natural range <>) of std_logic_vector(7 downto 0);
+  signal wr_log        : t_byte_array(0 to 15) := (others => x"00");
+  signal wr_count      : natural := 0;
+
+  -- slave register content, register n holds 0x40 + n
+  function slave_reg(constant ptr : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned(16#40# + ptr, 8));
+  end function;
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+  -- start/stop detector: sda changing while scl is high
+  condition_monitor : process(sda)
+  begin
+    if to_x01(scl) = '1' then
+      if to_x01(sda) = '0' and to_x01(sda'last_value) = '1' then
+        start_count <= start_count + 1;
+      elsif to_x01(sda) = '1' and to_x01(sda'last_value) = '0' then
+        stop_count  <= stop_count + 1;
+      end if;
+    end if;
+  end process;
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);
+    end;
+
+    -- poll count, waits for a poll to update the mirror
+    procedure wait_poll(
+      constant count_exp    : in natural) is
+      begin
+        poll_count : for i in 0 to 2000 loop
+          read(32, status, "reading poll count register");
+          exit poll_count when to_integer(unsigned(status)) >= count_exp;
+          wait for 100 * T;
+        end loop;
+        check_value(to_integer(unsigned(status)), count_exp, ERROR, "poll count", C_SCOPE);
+    end;
+
+    procedure wait_done is
+      begin
+        poll_done : for i in 0 to 2000 loop
+          read(2, status, "polling status register");
+          exit poll_done when status(0) = '1';
+          wait for 100 * T;
+        end loop;
+        check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+        check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+        write(2, x"0000000F", "clearing status flags");
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of the auto poller", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+
+    log(ID_LOG_HDR, "registers 2 to 5 of slave 0x68 every 2 ms, without the cpu", C_SCOPE);
+
+    write(31, x"00000402", "poll range: 4 registers from 0x02");
+    write(30, x"00026801", "poll control: every 2 ms, slave 0x68, enable");
+    wait_poll(1);
+    wait for 500 * T; -- stop condition
+
+    check(56, slave_reg(5) & slave_reg(4) & slave_reg(3) & slave_reg(2), ERROR, "checking poll mirror");
+    check(57, x"00000000", ERROR, "checking poll mirror");-- past the range
+    read(33, status, "reading poll status register");
+    check_value(status(31), '0', ERROR, "poll did not fail", C_SCOPE);
+    check_value(to_integer(unsigned(status(15 downto 0))) < 2, ERROR, "mirror updated less than 2 ms ago", C_SCOPE);
+    check(2, x"00000000", ERROR, "checking status register");-- the poll does not show up in the cpu flags
+    check_value(start_count, 2, ERROR, "start and repeated start of the poll", C_SCOPE);
+    check_value(stop_count, 1, ERROR, "one stop after the last register", C_SCOPE);
+    check_value(wr_count, 1, ERROR, "register pointer written", C_SCOPE);
+    check_value(wr_log(0), x"02", ERROR, "register pointer", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "a cpu write given while the poller has the bus follows the poll", C_SCOPE);
+
+    write(8, x"00000001", "fifo mode on");
+    write(23, x"00000068", "writing to address register, slave 0x68");
+    write(25, x"0000000A", "pack control: 2 bytes, stop after the last one");
+    write(24, x"00001110", "tx packed: bytes 0x10 and 0x11");
+    wait until start_count = 3;   -- second poll on the bus
+    write(0, x"00000001", "writing to control register, enable = 1");
+    wait_done;
+    wait for 500 * T; -- stop condition
+
+    check_value(start_count, 5, ERROR, "the poll ran to its end before the cpu write", C_SCOPE);
+    check_value(stop_count, 3, ERROR, "three stops", C_SCOPE);
+    check_value(wr_count, 4, ERROR, "register pointer and two bytes written", C_SCOPE);
+    check_value(wr_log(1), x"02", ERROR, "register pointer of the second poll", C_SCOPE);
+    check_value(wr_log(2), x"10", ERROR, "first byte of the cpu write", C_SCOPE);
+    check_value(wr_log(3), x"11", ERROR, "second byte of the cpu write", C_SCOPE);
+    check(32, x"00000002", ERROR, "checking poll count register");
+    check(56, slave_reg(5) & slave_reg(4) & slave_reg(3) & slave_reg(2), ERROR, "checking poll mirror");
+    write(8, x"00000006", "flush both fifos, fifo mode off");
+
+
+    log(ID_LOG_HDR, "a register mode write with enable and stop given during a poll keeps its stop", C_SCOPE);
+
+    write(1, x"00006807", "writing to write register, slave 0x68, data 0x07");
+    wait until start_count = 6;   -- third poll on the bus
+    write(0, x"00000003", "writing to control register, enable = 1, stop = 1");
+    wait_done;
+    wait for 500 * T; -- stop condition
+
+    check_value(start_count, 8, ERROR, "the poll ran to its end before the cpu write", C_SCOPE);
+    check_value(stop_count, 5, ERROR, "the cpu write ended with a stop", C_SCOPE);
+    check_value(wr_count, 6, ERROR, "register pointer and one byte written", C_SCOPE);
+    check_value(wr_log(4), x"02", ERROR, "register pointer of the third poll", C_SCOPE);
+    check_value(wr_log(5), x"07", ERROR, "byte of the cpu write", C_SCOPE);
+    check(32, x"00000003", ERROR, "checking poll count register");
+
+
+    log(ID_LOG_HDR, "a poll that ends on a nack keeps the mirror", C_SCOPE);
+
+    write(30, x"00025001", "poll control: slave 0x50 does not answer");
+    poll_failed : for i in 0 to 2000 loop
+      read(33, status, "reading poll status register");
+      exit poll_failed when status(31) = '1';
+      wait for 100 * T;
+    end loop;
+    check_value(status(31), '1', ERROR, "poll failed", C_SCOPE);
+    wait for 500 * T; -- stop condition
+
+    check(32, x"00000003", ERROR, "checking poll count register");-- no update
+    check(56, slave_reg(5) & slave_reg(4) & slave_reg(3) & slave_reg(2), ERROR, "checking poll mirror");
+    check(2, x"00000000", ERROR, "checking status register");-- the nack is not reported to the cpu
+
+    write(30, x"00000000", "poll control: disable");
+    wait for 3 ms;
+    check_value(start_count, 9, ERROR, "no poll while disabled", C_SCOPE);
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+
+  -- slave 0x68 with an auto incrementing register pointer, the first written byte sets the pointer.
+  -- Other addresses are not acknowledged.
+  slave_dummy : process(scl, start_count)
+    variable bit_cnt : natural := 0;   -- scl falling edges in the current byte, 9 = ack slot
+    variable rx_byte : std_logic_vector(7 downto 0);
+    variable is_addr : boolean := true;
+    variable reading : boolean := false;
+    variable first   : boolean := true;
+    variable selected: boolean := true;
+    variable ptr     : natural := 0;
+    variable wr_idx  : natural := 0;
+    begin
+      if start_count'event then
+        bit_cnt  := 0;
+        is_addr  := true;
+        reading  := false;
+        first    := true;
+        selected := true;
+        sda <= 'Z';
+
+      elsif not selected then
+        null;
+
+      elsif rising_edge(scl) then
+        if bit_cnt >= 1 and bit_cnt <= 8 then
+          rx_byte(8 - bit_cnt) := to_x01(sda);
+        elsif bit_cnt = 9 and reading and not is_addr then
+          -- master acknowledge of a read byte
+          if to_x01(sda) = '1' then
+            reading := false;   -- release sda for the stop
+          end if;
+          ptr := ptr + 1;
+        end if;
+
+      elsif falling_edge(scl) then
+        if bit_cnt = 9 then
+          bit_cnt := 1;
+          is_addr := false;
+        else
+          bit_cnt := bit_cnt + 1;
+        end if;
+
+        if bit_cnt = 9 then
+          if is_addr and rx_byte(7 downto 1) /= "1101000" then
+            selected := false;
+            sda <= 'Z';   -- not addressed, nack
+          elsif is_addr then
+            reading := rx_byte(0) = '1';
+            sda <= '0';   -- ack address
+          elsif not reading then
+            if first then
+              ptr := to_integer(unsigned(rx_byte));
+              first := false;
+            end if;
+            if wr_idx <= wr_log'high then
+              wr_log(wr_idx) <= rx_byte;
+            end if;
+            wr_idx := wr_idx + 1;
+            wr_count <= wr_idx;
+            sda <= '0';   -- ack data
+          else
+            sda <= 'Z';   -- master ack/nack
+          end if;
+        elsif reading and not is_addr and slave_reg(ptr)(8 - bit_cnt) = '0' then
+          sda <= '0';
+        else
+          sda <= 'Z';
+        end if;
+      end if;
+	end process;
+end architecture;
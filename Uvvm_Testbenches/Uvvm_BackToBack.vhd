@@ -0,0 +1,397 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+-- Start latency and back-to-back transactions at 100 kHz and 400 kHz against the slave model:
+-- the time from the write of the enable to the start and from the start to the first scl
+-- low, for enables at different points of the scl period (must not move by a clock), and
+-- the bus free time between transactions chained through the next transaction register
+-- (0x94), which must be tBUF plus the few clocks of the master. The gap of the same
+-- transactions started by polling DONE is logged for comparison. A next transaction written
+-- during an auto poll waits for the end of the poll and keeps its stop.
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  component i2c_slave_bfm
+    generic (
+      ADDRESS      : std_logic_vector(6 downto 0);
+      STRETCH_TIME : time);
+    port (
+      scl       : inout std_logic;
+      sda       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+
+  -- last start, last stop and the first scl low after the last start on the bus,
+  -- bus free time between two transactions since the last measure_clear
+  signal measure_clear : boolean := false;
+  signal start_count   : natural := 0;
+  signal t_start       : time := 0 ns;
+  signal t_first_low   : time := 0 ns;
+  signal min_gap       : time := 1 sec;
+  signal max_gap       : time := 0 ns;
+
+  constant C_NEXT      : natural := 37;  -- 0x94
+
+  type t_mode is record
+    tbuf     : time;   -- stop timing register
+    spec_buf : time;   -- specification minimum
+    spec_hd  : time;
+  end record;
+
+  constant C_STANDARD  : t_mode := (235 * T, 4.7 us, 4.0 us);
+  constant C_FAST      : t_mode := (65 * T, 1.3 us, 0.6 us);
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => open,
+      sda        => sda,
+      scl        => scl);
+
+  slave0 : i2c_slave_bfm
+    generic map (
+      ADDRESS      => "1101000",
+      STRETCH_TIME => 0 ns)
+    port map (
+      scl        => scl,
+      sda        => sda);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+  -- bus monitor
+  start_monitor : process(scl, sda, measure_clear)
+    variable t_stop      : time := 0 ns;
+    variable stop_seen   : boolean := false;
+    variable after_start : boolean := false;
+    variable gap_min     : time := 1 sec;
+    variable gap_max     : time := 0 ns;
+  begin
+    if measure_clear'event then
+      gap_min := 1 sec; gap_max := 0 ns;
+      stop_seen := false;
+    end if;
+
+    if scl'event and to_x01(scl) = '0' and after_start then
+      t_first_low <= now;
+      after_start := false;
+    end if;
+
+    if sda'event and to_x01(scl) = '1' then
+      if to_x01(sda) = '0' and to_x01(sda'last_value) = '1' then
+        if stop_seen then
+          if now - t_stop < gap_min then gap_min := now - t_stop; end if;
+          if now - t_stop > gap_max then gap_max := now - t_stop; end if;
+          stop_seen := false;
+        end if;
+        t_start     <= now;
+        after_start := true;
+        start_count <= start_count + 1;
+      elsif to_x01(sda) = '1' and to_x01(sda'last_value) = '0' then
+        t_stop    := now;
+        stop_seen := true;
+      end if;
+    end if;
+
+    min_gap <= gap_min;
+    max_gap <= gap_max;
+  end process;
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+   variable starts      : natural;
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);
+    end;
+
+    -- done of the last transaction: the next transaction register has nothing waiting
+    procedure wait_done is
+      begin
+        poll_done : for i in 0 to 5000 loop
+          read(C_NEXT, status, "polling next transaction register");
+          if status(16) = '0' then
+            read(2, status, "polling status register");
+            exit poll_done when status(0) = '1';
+          end if;
+          wait for 10 * T;
+        end loop;
+        check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+        check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+        write(2, x"0000000F", "clearing status flags");
+    end;
+
+    -- the transaction in the slot has gone to the master
+    procedure wait_taken is
+      begin
+        poll_taken : for i in 0 to 5000 loop
+          read(C_NEXT, status, "polling next transaction register");
+          exit poll_taken when status(16) = '0';
+          wait for 10 * T;
+        end loop;
+        check_value(status(16), '0', ERROR, "next transaction started", C_SCOPE);
+    end;
+
+    procedure measure_clear_gaps is
+      begin
+        measure_clear <= not measure_clear;
+        wait for 0 ns;
+    end;
+
+    function slave_byte(constant value : natural) return std_logic_vector is
+      begin
+        return std_logic_vector(to_unsigned(value mod 256, 8));
+    end;
+
+    -- register pointer writes, the enable at a different point of the scl period each time.
+    -- busy drops before the stop, the bus is idle for longer than tBUF before every enable.
+    procedure start_latency(
+      constant spec         : in t_mode;
+      constant mode         : in string) is
+        variable t_enable          : time;
+        variable latency, hold     : time;
+        variable lat_min, hold_min : time := 1 sec;
+        variable lat_max, hold_max : time := 0 ns;
+      begin
+        for i in 0 to 7 loop
+          wait for 30 us + (i * 61) * T;
+          write(1, x"000068" & slave_byte(16#20# + i), "writing to write register, slave 0x68");
+          write(0, x"00000003", "writing to control register, enable = 1, stop = 1");
+          t_enable := now;
+          wait_done;
+          poll(2, x"00000000", ERROR, "waiting for the stop, busy = 0");
+          latency := t_start - t_enable;
+          hold    := t_first_low - t_start;
+          if latency < lat_min then lat_min := latency; end if;
+          if latency > lat_max then lat_max := latency; end if;
+          if hold < hold_min then hold_min := hold; end if;
+          if hold > hold_max then hold_max := hold; end if;
+        end loop;
+        log(ID_SEQUENCER, mode & ": enable to start " & to_string(lat_min) & " - " & to_string(lat_max) &
+            ", start to first scl low " & to_string(hold_min) & " - " & to_string(hold_max), C_SCOPE);
+        check_value(lat_max - lat_min < T, ERROR, mode & " enable to start does not depend on the scl phase", C_SCOPE);
+        check_value(lat_max <= 5 * T, ERROR, mode & " start within a few clocks of the enable", C_SCOPE);
+        check_value(hold_max - hold_min < T, ERROR, mode & " tHD;STA does not depend on the scl phase", C_SCOPE);
+        check_value(hold_min >= spec.spec_hd, ERROR, mode & " start hold time tHD;STA", C_SCOPE);
+    end;
+
+    -- pointer write, read of the register, and so on, each staged while the one before runs.
+    -- the read of register n returns n.
+    procedure chained(
+      constant spec         : in t_mode;
+      constant mode         : in string) is
+      begin
+        measure_clear_gaps;
+        starts := start_count;
+        write(1, x"00006840", "writing to write register, slave 0x68 register 0x40");
+        write(0, x"00000003", "writing to control register, enable = 1, stop = 1");
+        for i in 0 to 2 loop
+          write(C_NEXT, x"00076800", "next transaction: read one byte, enable = 1, rw = 1, stop = 1");
+          check(C_NEXT, x"00076800", ERROR, "checking next transaction register, waiting");
+          wait_taken;
+          write(C_NEXT, x"000368" & slave_byte(16#41# + i), "next transaction: register pointer, enable = 1, stop = 1");
+          wait_taken;
+          check(3, x"000000" & slave_byte(16#40# + i), ERROR, "checking reading register");
+        end loop;
+        wait_done;
+        poll(2, x"00000000", ERROR, "waiting for the stop, busy = 0");
+        check_value(start_count - starts, 7, ERROR, mode & " chained transactions on the bus", C_SCOPE);
+        log(ID_SEQUENCER, mode & ": bus free time between chained transactions " & to_string(min_gap) &
+            " - " & to_string(max_gap) & ", tBUF " & to_string(spec.tbuf), C_SCOPE);
+        check_value(min_gap >= spec.tbuf and min_gap >= spec.spec_buf, ERROR, mode & " bus free time tBUF", C_SCOPE);
+        check_value(max_gap <= spec.tbuf + 4 * T, ERROR, mode & " next transaction starts tBUF after the stop", C_SCOPE);
+
+        -- the same transactions, each started after polling DONE
+        measure_clear_gaps;
+        for i in 0 to 2 loop
+          write(1, x"000068" & slave_byte(16#40# + i), "writing to write register, slave 0x68");
+          write(0, x"00000003", "writing to control register, enable = 1, stop = 1");
+          wait_done;
+          write(0, x"00000007", "writing to control register, enable = 1, rw = 1, stop = 1");
+          wait_done;
+        end loop;
+        poll(2, x"00000000", ERROR, "waiting for the stop, busy = 0");
+        log(ID_SEQUENCER, mode & ": bus free time when started by polling " & to_string(min_gap) &
+            " - " & to_string(max_gap), C_SCOPE);
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+    disable_log_msg(ID_BFM);  -- the register accesses of the polling loops
+
+    log(ID_LOG_HDR, "Start Simulation of start latency and back-to-back transactions", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+    check(C_NEXT, x"00000000", ERROR, "checking next transaction register");
+
+
+    log(ID_LOG_HDR, "100 kHz", C_SCOPE);
+
+    start_latency(C_STANDARD, "Standard-mode 100 kHz");
+    chained(C_STANDARD, "Standard-mode 100 kHz");
+
+
+    log(ID_LOG_HDR, "400 kHz", C_SCOPE);
+
+    -- 400 kHz: low 1.5 us, high 1.0 us, tSU;STA/tHD;STA/tSU;STO 0.6 us, tBUF 1.3 us
+    write(9, x"0032004B", "writing to scl timing register");
+    write(10, x"001E001E", "writing to start timing register");
+    write(11, x"0041001E", "writing to stop timing register");
+
+    start_latency(C_FAST, "Fast-mode 400 kHz");
+    chained(C_FAST, "Fast-mode 400 kHz");
+
+
+    log(ID_LOG_HDR, "next transaction after a nack, with the bus idle, emptied", C_SCOPE);
+
+    starts := start_count;
+    write(1, x"00005000", "writing to write register, slave 0x50 (not on the bus)");
+    write(0, x"00000003", "writing to control register, enable = 1, stop = 1");
+    write(C_NEXT, x"00036811", "next transaction: register pointer, enable = 1, stop = 1");
+    poll(2, x"00000005", ERROR, "polling status register");-- done and ack error
+    wait for 20 * T;
+    check(C_NEXT, x"00026811", ERROR, "checking next transaction register, dropped");
+    wait for 20 us;
+    check_value(start_count - starts, 1, ERROR, "no start after the nack", C_SCOPE);
+    write(2, x"0000000F", "clearing status flags");
+
+    write(C_NEXT, x"00036811", "next transaction with nothing running: register pointer, enable = 1, stop = 1");
+    wait_done;
+    poll(2, x"00000000", ERROR, "waiting for the stop, busy = 0");
+    check_value(start_count - starts, 2, ERROR, "next transaction started at once", C_SCOPE);
+
+    write(1, x"00006812", "writing to write register, slave 0x68");
+    write(0, x"00000003", "writing to control register, enable = 1, stop = 1");
+    write(C_NEXT, x"00036813", "next transaction: register pointer, enable = 1, stop = 1");
+    write(C_NEXT, x"00026813", "next transaction: enable = 0 empties the slot");
+    check(C_NEXT, x"00026813", ERROR, "checking next transaction register, empty");
+    wait_done;
+    poll(2, x"00000000", ERROR, "waiting for the stop, busy = 0");
+    check_value(start_count - starts, 3, ERROR, "no start from an emptied slot", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "next transaction written while the poller has the bus", C_SCOPE);
+
+    starts := start_count;
+    write(31, x"00000220", "poll range: 2 registers from 0x20");
+    write(30, x"00016801", "poll control: every 1 ms, slave 0x68, enable");
+    wait until start_count = starts + 1;   -- the poll is on the bus
+    measure_clear_gaps;
+    write(C_NEXT, x"00036814", "next transaction: register pointer, enable = 1, stop = 1");
+    check(C_NEXT, x"00036814", ERROR, "checking next transaction register, waiting for the poll");
+    wait_done;
+    poll(2, x"00000000", ERROR, "waiting for the stop, busy = 0");
+    write(30, x"00000000", "poll control: disable");
+    check(32, x"00000001", ERROR, "checking poll count register");-- the poll ran to its end
+    check(C_NEXT, x"00026814", ERROR, "checking next transaction register, started");
+    check_value(start_count - starts, 3, ERROR, "start and repeated start of the poll, start of the next transaction", C_SCOPE);
+    check_value(min_gap >= C_FAST.tbuf, ERROR, "next transaction after the stop of the poll", C_SCOPE);
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+    wait;
+  end process;
+end architecture;
@@ -0,0 +1,337 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+  signal irq : std_logic;
+
+  -- start and stop conditions seen on the bus, a start resets the slave
+  signal start_count   : natural := 0;
+  signal stop_count    : natural := 0;
+  signal scl_pulses    : natural := 0;
+
+  -- a second slave holds sda low until it saw hold_pulses falling scl edges
+  signal hold_pulses   : natural := 0;
+
+  -- slave memory
+  type mem_type is array (0 to 15) of std_logic_vector(7 downto 0);
+  signal slave_mem     : mem_type := (others => x"00");
+
+  constant C_STRETCH_LIMIT : natural := 21;
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+  -- start: sda falling while scl is high, stop: sda rising while scl is high
+  condition_monitor : process(sda)
+  begin
+    if to_x01(scl) = '1' and to_x01(sda) = '0' and to_x01(sda'last_value) = '1' then
+      start_count <= start_count + 1;
+    elsif to_x01(scl) = '1' and to_x01(sda) = '1' and to_x01(sda'last_value) = '0' then
+      stop_count <= stop_count + 1;
+    end if;
+  end process;
+
+  pulse_monitor : process(scl)
+  begin
+    if rising_edge(scl) then
+      scl_pulses <= scl_pulses + 1;
+    end if;
+  end process;
+
+  -- slave that lost track of the transaction in the middle of a byte
+  stuck_slave : process
+    variable pulses : natural;
+  begin
+    sda <= 'Z';
+    wait until hold_pulses > 0;
+    sda <= '0';
+    pulses := 0;
+    while pulses < hold_pulses loop
+      wait until falling_edge(scl) or hold_pulses = 0;
+      exit when hold_pulses = 0;
+      pulses := pulses + 1;
+    end loop;
+  end process;
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);
+    end;
+
+    procedure wait_done is
+      begin
+        poll_done : for i in 0 to 2000 loop
+          read(2, status, "polling status register");
+          exit poll_done when status(0) = '1';
+          wait for 100 * T;
+        end loop;
+        check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+    end;
+
+    -- write data to register reg of slave 0x68
+    procedure write_reg(
+      constant reg  : in std_logic_vector(7 downto 0);
+      constant data : in std_logic_vector(7 downto 0)) is
+      begin
+        write(0, x"00000000", "writing to control register, rw = 0");
+        write(1, x"000068" & reg, "writing to write register, slave 0x68 and register pointer");
+        write(0, x"00000001", "writing to control register, enable = 1");
+        poll(2 , x"0000000A", ERROR, "waiting for the pointer, ready and busy = 1");
+        write(1, x"000068" & data, "writing to write register, data");
+        write(2, x"00000008", "clearing ready");
+        write(0, x"00000008", "writing to control register, continue = 1");
+        poll(2 , x"0000000A", ERROR, "waiting for the data byte, ready and busy = 1");
+        write(2, x"00000008", "clearing ready");
+        write(0, x"00000002", "writing to control register, stop = 1");
+        wait_done;
+    end;
+
+    variable starts : natural;
+    variable stops  : natural;
+    variable pulses : natural;
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of bus recovery", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+    write(C_STRETCH_LIMIT, x"000003E8", "stretch timeout 1000 cycles");
+    write_reg(x"03", x"11");
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+    write(2, x"0000004F", "clearing status flags");
+    wait for 500 * T; -- stop condition
+    check_value(slave_mem(3), x"11", ERROR, "byte written on a free bus", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "sda held low, the start waits for it until the stretch timeout", C_SCOPE);
+
+    hold_pulses <= 5;
+    wait for 10 * T;
+    starts := start_count;
+    write(0, x"00000000", "writing to control register, rw = 0");
+    write(1, x"00006805", "writing to write register, slave 0x68 register 0x05");
+    write(0, x"00000001", "writing to control register, enable = 1");
+    wait for 100 * T;
+    read(2, status, "reading status register");
+    check_value(status(1), '1', ERROR, "busy while the start waits", C_SCOPE);
+    check_value(status(0), '0', ERROR, "no done yet", C_SCOPE);
+    wait_done;
+    check_value(status(6), '1', ERROR, "timeout set", C_SCOPE);
+    check_value(status(1), '0', ERROR, "not busy", C_SCOPE);
+    check_value(start_count, starts, ERROR, "no start on the held bus", C_SCOPE);
+    write(0, x"00000000", "writing to control register, enable = 0");
+    write(2, x"0000004F", "clearing status flags");
+    check(2, x"00000000", ERROR, "status cleared");
+
+
+    log(ID_LOG_HDR, "recovery, the slave lets sda go after 5 clocks, then a stop", C_SCOPE);
+
+    stops  := stop_count;
+    pulses := scl_pulses;
+    write(0, x"00000021", "writing to control register, recover = 1, enable = 1");
+    check(0, x"00000000", ERROR, "enable and recover are strobes");
+    wait_done;
+    check_value(status(2), '0', ERROR, "no ack error, the bus is free", C_SCOPE);
+    check_value(status(6), '0', ERROR, "no timeout", C_SCOPE);
+    wait for 500 * T; -- stop condition
+    check_value(stop_count, stops + 1, ERROR, "stop after the recovery", C_SCOPE);
+    check_value(scl_pulses - pulses, 7, ERROR, "5 clocks for the slave, sda high at the 6th, the 7th for the stop", C_SCOPE);
+    write(0, x"00000000", "writing to control register, enable = 0");
+    write(2, x"0000004F", "clearing status flags");
+    hold_pulses <= 0;
+
+    write_reg(x"05", x"A5");
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+    check_value(status(6), '0', ERROR, "no timeout", C_SCOPE);
+    write(2, x"0000004F", "clearing status flags");
+    wait for 500 * T; -- stop condition
+    check_value(slave_mem(5), x"A5", ERROR, "byte written after the recovery", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "sda still low after 9 clocks, the recovery ends with an ack error", C_SCOPE);
+
+    hold_pulses <= 20;
+    wait for 10 * T;
+    pulses := scl_pulses;
+    write(0, x"00000021", "writing to control register, recover = 1, enable = 1");
+    wait_done;
+    check_value(status(2), '1', ERROR, "ack error, the bus is still held", C_SCOPE);
+    check_value(scl_pulses - pulses, 9, ERROR, "9 clocks", C_SCOPE);
+    write(0, x"00000000", "writing to control register, enable = 0");
+    write(2, x"0000004F", "clearing status flags");
+    hold_pulses <= 0;
+    wait for 10 * T;
+
+    write_reg(x"06", x"5A");
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+    write(2, x"0000004F", "clearing status flags");
+    wait for 500 * T; -- stop condition
+    check_value(slave_mem(6), x"5A", ERROR, "byte written once the slave let go", C_SCOPE);
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+
+  -- slave 0x68 with an auto incrementing register pointer, the first written byte sets the pointer
+  slave_dummy : process(scl, start_count)
+    variable bit_cnt  : natural := 0;   -- scl falling edges in the current byte, 9 = ack slot
+    variable rx_byte  : std_logic_vector(7 downto 0);
+    variable is_addr  : boolean := true;
+    variable is_ptr   : boolean := false;
+    variable selected : boolean := false;
+    variable ptr      : natural := 0;
+    begin
+      if start_count'event then
+        bit_cnt := 0;
+        is_addr := true;
+        sda <= 'Z';
+
+      elsif rising_edge(scl) then
+        if bit_cnt >= 1 and bit_cnt <= 8 then
+          rx_byte(8 - bit_cnt) := to_x01(sda);
+        end if;
+
+      elsif falling_edge(scl) then
+        if bit_cnt = 9 then
+          bit_cnt := 1;
+          if is_addr then
+            is_ptr := true;
+          elsif is_ptr then
+            is_ptr := false;
+            ptr := to_integer(unsigned(rx_byte)) mod 16;
+          else
+            slave_mem(ptr) <= rx_byte;
+            ptr := (ptr + 1) mod 16;
+          end if;
+          is_addr := false;
+        else
+          bit_cnt := bit_cnt + 1;
+        end if;
+
+        if bit_cnt = 9 then
+          if is_addr then
+            selected := rx_byte(7 downto 1) = "1101000";
+          end if;
+          if selected then
+            sda <= '0';   -- ack
+          end if;
+        else
+          sda <= 'Z';
+        end if;
+      end if;
+	end process;
+end architecture;
@@ -0,0 +1,360 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+-- Bus timing at Standard-mode (reset values), Fast-mode and Fast-mode Plus.
+-- The monitor measures the parameters of the start/stop and scl waveforms
+-- (see SS/Timing_SS) and they are checked against the I2C specification minima.
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+  signal irq : std_logic;
+
+  -- smallest values seen by the monitor since the last measure_clear
+  signal measure_clear : boolean := false;
+  signal min_scl_low   : time := 1 sec;
+  signal min_scl_high  : time := 1 sec;
+  signal min_tsu_sta   : time := 1 sec;  -- repeated start only
+  signal min_thd_sta   : time := 1 sec;
+  signal min_tsu_sto   : time := 1 sec;
+  signal min_tbuf      : time := 1 sec;
+  signal start_count   : natural := 0;
+
+  constant C_DATA_BYTE : std_logic_vector(7 downto 0) := x"A5";
+
+  -- specification minima
+  type t_bus_timing is record
+    scl_low  : time;
+    scl_high : time;
+    tsu_sta  : time;
+    thd_sta  : time;
+    tsu_sto  : time;
+    tbuf     : time;
+    period   : time;
+  end record;
+
+  constant C_STANDARD  : t_bus_timing := (4.7 us, 4.0 us, 4.7 us, 4.0 us, 4.0 us, 4.7 us, 10 us);
+  constant C_FAST      : t_bus_timing := (1.3 us, 0.6 us, 0.6 us, 0.6 us, 0.6 us, 1.3 us, 2.5 us);
+  constant C_FAST_PLUS : t_bus_timing := (0.5 us, 0.26 us, 0.26 us, 0.26 us, 0.26 us, 0.5 us, 1 us);
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+  -- bus monitor
+  timing_monitor : process(scl, sda, measure_clear)
+    variable t_scl_edge  : time := 0 ns;
+    variable t_start     : time := 0 ns;
+    variable t_stop      : time := 0 ns;
+    variable in_transfer : boolean := false;
+    variable after_start : boolean := false;
+    variable stop_seen   : boolean := false;
+    variable low, high, su_sta, hd_sta, su_sto, buf : time := 1 sec;
+  begin
+    if measure_clear'event then
+      low := 1 sec; high := 1 sec; su_sta := 1 sec;
+      hd_sta := 1 sec; su_sto := 1 sec; buf := 1 sec;
+      stop_seen := false;
+    end if;
+
+    if scl'event and in_transfer then
+      if to_x01(scl) = '0' then
+        if after_start then
+          -- first scl low after a (repeated) start
+          if now - t_start < hd_sta then hd_sta := now - t_start; end if;
+          after_start := false;
+        elsif now - t_scl_edge < high then
+          high := now - t_scl_edge;
+        end if;
+      elsif to_x01(scl) = '1' then
+        if now - t_scl_edge < low then low := now - t_scl_edge; end if;
+      end if;
+    end if;
+    if scl'event then
+      t_scl_edge := now;
+    end if;
+
+    if sda'event and to_x01(scl) = '1' then
+      if to_x01(sda) = '0' and to_x01(sda'last_value) = '1' then
+        if in_transfer then
+          if now - t_scl_edge < su_sta then su_sta := now - t_scl_edge; end if;
+        elsif stop_seen then
+          if now - t_stop < buf then buf := now - t_stop; end if;
+        end if;
+        t_start     := now;
+        in_transfer := true;
+        after_start := true;
+        start_count <= start_count + 1;
+      elsif to_x01(sda) = '1' and to_x01(sda'last_value) = '0' then
+        if now - t_scl_edge < su_sto then su_sto := now - t_scl_edge; end if;
+        t_stop      := now;
+        in_transfer := false;
+        stop_seen   := true;
+      end if;
+    end if;
+
+    min_scl_low  <= low;
+    min_scl_high <= high;
+    min_tsu_sta  <= su_sta;
+    min_thd_sta  <= hd_sta;
+    min_tsu_sto  <= su_sto;
+    min_tbuf     <= buf;
+  end process;
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);
+    end;
+
+    procedure wait_done is
+      begin
+        poll_done : for i in 0 to 1000 loop
+          read(2, status, "polling status register");
+          exit poll_done when status(0) = '1';
+          wait for 20 * T;
+        end loop;
+        check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+        check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+        write(2, x"0000000F", "clearing status flags");
+    end;
+
+    -- write of a register pointer and one data byte from the tx fifo
+    procedure write_transaction is
+      begin
+        write(8, x"00000001", "fifo mode on");
+        write(1, x"00006800", "writing to write register, slave 0x68");
+        write(5, x"00000011", "tx fifo: register pointer");
+        write(5, x"000001" & C_DATA_BYTE, "tx fifo: data byte and stop");
+        write(0, x"00000001", "writing to control register, enable = 1");
+        wait_done;
+        write(8, x"00000006", "flush both fifos, fifo mode off");
+        poll(2, x"00000000", ERROR, "waiting for the stop, busy = 0");
+    end;
+
+    -- register pointer write, repeated start and one byte read
+    procedure read_transaction is
+      begin
+        write(1, x"00006811", "writing to write register, slave 0x68 register 0x11");
+        write(0, x"00000001", "writing to control register, enable = 1");
+        poll(2, x"0000000A", ERROR, "polling status register");-- waiting for ready and busy = 1
+        write(0, x"00000014", "writing to control register, restart = 1, rw = 1");
+        wait_done;
+        check(3, x"000000" & C_DATA_BYTE, ERROR, "checking reading register");
+        write(0, x"00000000", "writing to control register, rw = 0");
+        poll(2, x"00000000", ERROR, "waiting for the stop, busy = 0");
+    end;
+
+    procedure check_timing(
+      constant spec : in t_bus_timing;
+      constant mode : in string) is
+      begin
+        log(ID_SEQUENCER, mode & ": tLOW " & to_string(min_scl_low) & ", tHIGH " & to_string(min_scl_high) &
+            ", tSU;STA " & to_string(min_tsu_sta) & ", tHD;STA " & to_string(min_thd_sta) &
+            ", tSU;STO " & to_string(min_tsu_sto) & ", tBUF " & to_string(min_tbuf), C_SCOPE);
+        check_value(min_scl_low  >= spec.scl_low,  ERROR, mode & " scl low time tLOW", C_SCOPE);
+        check_value(min_scl_high >= spec.scl_high, ERROR, mode & " scl high time tHIGH", C_SCOPE);
+        check_value(min_scl_low + min_scl_high >= spec.period, ERROR, mode & " scl frequency", C_SCOPE);
+        check_value(min_tsu_sta  >= spec.tsu_sta,  ERROR, mode & " repeated start setup time tSU;STA", C_SCOPE);
+        check_value(min_thd_sta  >= spec.thd_sta,  ERROR, mode & " start hold time tHD;STA", C_SCOPE);
+        check_value(min_tsu_sto  >= spec.tsu_sto,  ERROR, mode & " stop setup time tSU;STO", C_SCOPE);
+        check_value(min_tbuf     >= spec.tbuf,     ERROR, mode & " bus free time tBUF", C_SCOPE);
+    end;
+
+    procedure run_mode(
+      constant spec : in t_bus_timing;
+      constant mode : in string) is
+      begin
+        log(ID_LOG_HDR, mode, C_SCOPE);
+        measure_clear <= not measure_clear;
+        wait for 0 ns;
+        write_transaction;
+        read_transaction;
+        write_transaction;
+        check_timing(spec, mode);
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of bus timing", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+    -- reset values, 100 kHz at 50 MHz
+    check(9, x"00FA00FA", ERROR, "checking scl timing register");
+    check(10, x"00C800EB", ERROR, "checking start timing register");
+    check(11, x"00EB00C8", ERROR, "checking stop timing register");
+
+    run_mode(C_STANDARD, "Standard-mode 100 kHz");
+
+    -- 400 kHz: low 1.5 us, high 1.0 us, tSU;STA/tHD;STA/tSU;STO 0.6 us, tBUF 1.3 us
+    write(9, x"0032004B", "writing to scl timing register");
+    write(10, x"001E001E", "writing to start timing register");
+    write(11, x"0041001E", "writing to stop timing register");
+    run_mode(C_FAST, "Fast-mode 400 kHz");
+
+    -- 1 MHz: low 0.56 us, high 0.46 us, tSU;STA/tHD;STA/tSU;STO 0.26 us, tBUF 0.5 us
+    write(9, x"0017001C", "writing to scl timing register");
+    write(10, x"000D000D", "writing to start timing register");
+    write(11, x"0019000D", "writing to stop timing register");
+    run_mode(C_FAST_PLUS, "Fast-mode Plus 1 MHz");
+
+    check_value(start_count, 12, ERROR, "starts and repeated starts on the bus", C_SCOPE);
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+
+  -- slave 0x68: acks address and written bytes, answers reads with C_DATA_BYTE
+  slave_dummy : process(scl, start_count)
+    variable bit_cnt : natural := 0;   -- scl falling edges in the current byte, 9 = ack slot
+    variable rx_byte : std_logic_vector(7 downto 0);
+    variable is_addr : boolean := true;
+    variable reading : boolean := false;
+    begin
+      if start_count'event then
+        bit_cnt := 0;
+        is_addr := true;
+        reading := false;
+        sda <= 'Z';
+
+      elsif rising_edge(scl) then
+        if bit_cnt >= 1 and bit_cnt <= 8 then
+          rx_byte(8 - bit_cnt) := to_x01(sda);
+        end if;
+
+      elsif falling_edge(scl) then
+        if bit_cnt = 9 then
+          bit_cnt := 1;
+        else
+          bit_cnt := bit_cnt + 1;
+        end if;
+
+        if bit_cnt = 9 then
+          if is_addr then
+            reading := rx_byte(0) = '1';
+          end if;
+          if is_addr or not reading then
+            sda <= '0';   -- ack
+          else
+            sda <= 'Z';   -- master ack/nack
+          end if;
+          is_addr := false;
+        elsif reading and C_DATA_BYTE(8 - bit_cnt) = '0' then
+          sda <= '0';
+        else
+          sda <= 'Z';
+        end if;
+      end if;
+	end process;
+end architecture;
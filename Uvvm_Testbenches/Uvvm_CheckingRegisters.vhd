@@ -1,136 +1,212 @@
-library std;
-use     std.textio.all;
-
-library ieee;
-use     ieee.std_logic_1164.all;
-use     ieee.numeric_std.all;
-
-library uvvm_util;
-context uvvm_util.uvvm_util_context;
-use     uvvm_util.sbi_bfm_pkg.all;
-
-entity i2c_tb_uvvm is
-end entity;
-
-architecture behav of i2c_tb_uvvm is
-  component i2c_top
-    port (
-      clk       : in  std_logic;
-      reset     : in  std_logic;
-      sbi_cs    : in  std_logic;
-      sbi_we    : in  std_logic;
-      sbi_re    : in  std_logic;
-      sbi_addr  : in  std_logic_vector(1 downto 0);
-      sbi_wdata : in  std_logic_vector(31 downto 0);
-      sbi_rdata : out std_logic_vector(31 downto 0);
-      sda       : inout std_logic;
-      scl       : out  std_logic);
-  end component;
-
-  -- sbi interface record
-  signal sbi_if : t_sbi_if(addr(1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
-  := init_sbi_if_signals(2, 32);
-
-
-  -- clock & reset
-  constant T : time := 20 ns;
-  signal clk    : std_logic := '0';
-  signal reset  : std_logic := '0';
-  signal term_poll      : std_logic := '0';
-  signal clock_ena : boolean := false;
-
-  
-  signal sda : std_logic := 'Z';
-  signal scl : std_logic;
-begin
-
-  i2c_top0 : i2c_top
-    port map (
-      clk        => clk,
-      reset      => reset,
-      sbi_cs     => sbi_if.cs,
-      sbi_we     => sbi_if.wena,
-      sbi_re     => sbi_if.rena,
-      sbi_addr   => std_logic_vector(sbi_if.addr),
-      sbi_wdata  => sbi_if.wdata,
-      sbi_rdata  => sbi_if.rdata,
-      sda        => sda,
-      scl        => scl);
-
-  sbi_if.ready <= '1';
-  clock_generator(clk, clock_ena, T, "clk");
-
-  
-  main : process
-   
-   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
-
-    procedure write(
-      constant addr_value   : in natural;
-      constant data_value   : in std_logic_vector;
-      constant msg          : in string) is
-      begin
-        sbi_write(to_unsigned(addr_value, 2), data_value, msg, CLK, sbi_if, C_SCOPE);
-    end;
-
-    procedure check(
-      constant addr_value   : in natural;
-      constant data_exp     : in std_logic_vector;
-      constant alert_level  : in t_alert_level;
-      constant msg          : in string) is
-      begin
-        sbi_check(to_unsigned(addr_value, 2), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
-    end;
-   
-    procedure poll(
-      constant addr_value   : in natural;
-      constant data_exp     : in std_logic_vector;
-      constant alert_level  : in t_alert_level;
-      constant msg          : in string) is
-      begin
-        sbi_poll_until(to_unsigned(addr_value, 2),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);      
-    end;
-    
-
-  begin
-
-    set_alert_stop_limit(ERROR,0);
-    report_global_ctrl(VOID);
-      --report_msg_id_panel(VOID);
-    enable_log_msg(ALL_MESSAGES);
-      --disable_log_msg(ALL_MESSAGES);
-      --enable_log_msg(ID_LOG_HDR);
-      
-    log(ID_LOG_HDR, "Start Simulation of master", C_SCOPE);
-      
-    clock_ena <= true; -- to start clock generator
-     wait for 10*T;
-      
-    gen_pulse(reset, T, "reset");
-     wait for 10*T;
-
-    log(ID_LOG_HDR, "checking regiters after reset", C_SCOPE);
-      
-    check(0, x"00000000", ERROR, "checking control register");
-    check(1, x"00000000", ERROR, "checking write register");
-    check(2, x"00000000", ERROR, "checking status register");
-    check(3, x"00000000", ERROR, "checking reading register");
-    
-    write(0, x"FFFFFFFF","writing to control register");
-    write(1, x"FFFFFFFF","writing to write register");
-    write(2, x"FFFFFFFF","writing to status register");
-    write(3, x"FFFFFFFF","writing to reading register");
-
-    check(0, x"00000004", ERROR, "checking control register");-- only expecting read/write to stay asserted
-    check(1, x"00007FFF", ERROR, "checking write register");  -- upper 17 bits is unused, rest is 1 
-    check(2, x"00000000", ERROR, "checking status register"); -- expecting 0 at the time of checking 
-    check(3, x"00000000", ERROR, "checking reading register");-- expecting 0 
-    
-    wait for 100 *T;
-   
-    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
-    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
-
-    wait for 1 sec;
-  end process;
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+  
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => open,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  scl <= 'H';
+
+  
+  main : process
+   
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+   
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);      
+    end;
+    
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+      
+    log(ID_LOG_HDR, "Start Simulation of master", C_SCOPE);
+      
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+      
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+    log(ID_LOG_HDR, "checking regiters after reset", C_SCOPE);
+      
+    check(0, x"00000000", ERROR, "checking control register");
+    check(1, x"00000000", ERROR, "checking write register");
+    check(2, x"00000000", ERROR, "checking status register");
+    check(3, x"00000000", ERROR, "checking reading register");
+    check(4, x"00000000", ERROR, "checking interrupt enable register");
+    check(6, x"00000000", ERROR, "checking rx data register");
+    check(7, x"00050000", ERROR, "checking fifo status register");-- both fifos empty
+    check(8, x"00000000", ERROR, "checking fifo control register");
+    check(9, x"00FA00FA", ERROR, "checking scl timing register");  -- 250/250 cycles, 100 kHz at 50 MHz
+    check(10, x"00C800EB", ERROR, "checking start timing register");-- tHD;STA 4.0 us, tSU;STA 4.7 us
+    check(11, x"00EB00C8", ERROR, "checking stop timing register"); -- tBUF 4.7 us, tSU;STO 4.0 us
+    check(12, x"00000000", ERROR, "checking perf control register");-- write only
+    for i in 13 to 20 loop
+      check(i, x"00000000", ERROR, "checking performance counter, no snapshot yet");
+    end loop;
+    check(21, x"001312D0", ERROR, "checking stretch timeout register");-- 25 ms
+    check(22, x"00000000", ERROR, "checking tx hold register");    -- write only
+    check(23, x"00000000", ERROR, "checking address register");
+    check(24, x"00000000", ERROR, "checking tx packed register");  -- write only
+    check(25, x"00000004", ERROR, "checking pack control register");-- 4 bytes per packed write
+    check(26, x"00000000", ERROR, "checking rx packed register");  -- rx fifo empty
+    check(27, x"00000000", ERROR, "checking sequencer control register");-- not running, no error
+    check(28, x"00000000", ERROR, "checking sequencer head register");
+    check(29, x"00000000", ERROR, "checking sequencer current register");
+    check(30, x"00000000", ERROR, "checking poll control register");
+    check(31, x"00002000", ERROR, "checking poll range register"); -- 32 registers from 0
+    check(32, x"00000000", ERROR, "checking poll count register");
+    check(33, x"0000FFFF", ERROR, "checking poll status register");-- no update yet
+    check(34, x"00000000", ERROR, "checking trace control register");
+    check(35, x"00000000", ERROR, "checking trace status register"); -- empty, not recording
+    check(36, x"00000000", ERROR, "checking trace data register");   -- empty
+    check(37, x"00000000", ERROR, "checking next transaction register");
+    for i in 56 to 63 loop
+      check(i, x"00000000", ERROR, "checking poll mirror");
+    end loop;
+    
+    write(0, x"FFFFFFFF","writing to control register");
+    write(1, x"FFFFFFFF","writing to write register");
+    write(2, x"FFFFFFFF","writing to status register");
+    write(3, x"FFFFFFFF","writing to reading register");
+    write(4, x"FFFFFFFF","writing to interrupt enable register");
+
+    check(0, x"00000004", ERROR, "checking control register");-- only expecting read/write to stay asserted
+    check(1, x"00007FFF", ERROR, "checking write register");  -- upper 17 bits is unused, rest is 1 
+    check(2, x"00000000", ERROR, "checking status register"); -- expecting 0 at the time of checking 
+    check(3, x"00000000", ERROR, "checking reading register");-- expecting 0 
+    check(4, x"000001FD", ERROR, "checking interrupt enable register");-- busy has no interrupt enable
+    check(23, x"0000007F", ERROR, "checking address register");  -- slave address of the write register
+
+    write(23, x"FFFFFF25", "writing to address register");
+    check(1, x"000025FF", ERROR, "checking write register");      -- only the slave address changes
+    write(25, x"FFFFFFFF", "writing to pack control register");
+    check(25, x"0000000C", ERROR, "checking pack control register");-- count 7 selects 4, stop set
+    write(25, x"00000002", "writing to pack control register");
+    check(25, x"00000002", ERROR, "checking pack control register");
+    write(28, x"FFFFFFFF", "writing to sequencer head register");
+    check(28, x"FFFFFFFC", ERROR, "checking sequencer head register");-- word aligned
+    check(27, x"00000000", ERROR, "checking sequencer control register");-- head write does not start
+    write(28, x"00000000", "writing to sequencer head register");
+    write(31, x"FFFF0512", "writing to poll range register");
+    check(31, x"00000512", ERROR, "checking poll range register");
+    write(31, x"00004011", "writing to poll range register");
+    check(31, x"00002011", ERROR, "checking poll range register"); -- length 64 selects 32
+    write(30, x"FFFFFFFE", "writing to poll control register");
+    check(30, x"FFFF7F00", ERROR, "checking poll control register");-- not enabled
+    write(30, x"00000000", "writing to poll control register");
+    check(32, x"00000000", ERROR, "checking poll count register");
+    check(35, x"00000000", ERROR, "checking trace status register");
+    write(34, x"FFFFFFFF", "writing to trace control register");
+    check(34, x"0FFF7F35", ERROR, "checking trace control register");-- clear reads 0, enable reads back
+    write(34, x"00000000", "writing to trace control register");
+    write(37, x"FFFEFFFF", "writing to next transaction register");
+    check(37, x"000E7FFF", ERROR, "checking next transaction register");-- enable clear, nothing waits
+    write(37, x"00000000", "writing to next transaction register");
+
+    write(9, x"00320048", "writing to scl timing register");
+    write(10, x"001E001F", "writing to start timing register");
+    write(11, x"0041001D", "writing to stop timing register");
+    check(9, x"00320048", ERROR, "checking scl timing register");
+    check(10, x"001E001F", ERROR, "checking start timing register");
+    check(11, x"0041001D", ERROR, "checking stop timing register");
+    
+    wait for 100 *T;
+   
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
 end architecture; 
\ No newline at end of file
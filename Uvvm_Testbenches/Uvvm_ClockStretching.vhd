@@ -0,0 +1,318 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+  signal irq : std_logic;
+
+  -- start conditions seen on the bus, resets the slave
+  signal start_count   : natural := 0;
+
+  -- clock stretching by the slave after every ack, 0 ns: none
+  signal stretch_time  : time := 0 ns;
+  signal stretch_req   : boolean := false;
+  signal min_scl_high  : time := 1 sec;
+
+  -- slave memory
+  type mem_type is array (0 to 15) of std_logic_vector(7 downto 0);
+  signal slave_mem     : mem_type := (others => x"00");
+
+  constant C_PERF_CONTROL  : natural := 12;
+  constant C_PERF_STRETCH  : natural := 19;
+  constant C_STRETCH_LIMIT : natural := 21;
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+  -- start detector: sda falling while scl is high
+  condition_monitor : process(sda)
+  begin
+    if to_x01(scl) = '1' and to_x01(sda) = '0' and to_x01(sda'last_value) = '1' then
+      start_count <= start_count + 1;
+    end if;
+  end process;
+
+  -- shortest scl high time, measured from the moment the slave released scl
+  high_monitor : process(scl)
+    variable t_rise : time := 0 ns;
+  begin
+    if rising_edge(scl) then
+      t_rise := now;
+    elsif falling_edge(scl) and t_rise /= 0 ns then
+      if now - t_rise < min_scl_high then
+        min_scl_high <= now - t_rise;
+      end if;
+    end if;
+  end process;
+
+  -- the slave holds scl low for stretch_time after the falling edge that ends an ack slot
+  stretcher : process
+  begin
+    scl <= 'Z';
+    wait on stretch_req;
+    if stretch_time > 0 ns then
+      scl <= '0';
+      wait for stretch_time;
+    end if;
+  end process;
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);
+    end;
+
+    procedure wait_done is
+      begin
+        poll_done : for i in 0 to 2000 loop
+          read(2, status, "polling status register");
+          exit poll_done when status(0) = '1';
+          wait for 100 * T;
+        end loop;
+        check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+    end;
+
+    -- write data to register reg of slave 0x68
+    procedure write_reg(
+      constant reg  : in std_logic_vector(7 downto 0);
+      constant data : in std_logic_vector(7 downto 0)) is
+      begin
+        write(0, x"00000000", "writing to control register, rw = 0");
+        write(1, x"000068" & reg, "writing to write register, slave 0x68 and register pointer");
+        write(0, x"00000001", "writing to control register, enable = 1");
+        poll(2 , x"0000000A", ERROR, "waiting for the pointer, ready and busy = 1");
+        write(1, x"000068" & data, "writing to write register, data");
+        write(2, x"00000008", "clearing ready");
+        write(0, x"00000008", "writing to control register, continue = 1");
+        poll(2 , x"0000000A", ERROR, "waiting for the data byte, ready and busy = 1");
+        write(2, x"00000008", "clearing ready");
+        write(0, x"00000002", "writing to control register, stop = 1");
+        wait_done;
+    end;
+
+    variable value : std_logic_vector(31 downto 0);
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of clock stretching", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+    check(C_STRETCH_LIMIT, x"001312D0", ERROR, "checking stretch timeout register, 25 ms");
+
+
+    log(ID_LOG_HDR, "write with 30 us clock stretching after every byte", C_SCOPE);
+
+    write(C_PERF_CONTROL, x"00000002", "clear performance counters");
+    stretch_time <= 30 us;
+    write_reg(x"05", x"A5");
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+    check_value(status(6), '0', ERROR, "no timeout", C_SCOPE);
+    write(2, x"0000004F", "clearing status flags");
+    wait for 500 * T; -- stop condition
+    check_value(slave_mem(5), x"A5", ERROR, "byte written to the stretching slave", C_SCOPE);
+    check_value(min_scl_high >= 4 us, ERROR, "scl high time counted from the end of the stretch", C_SCOPE);
+
+    write(C_PERF_CONTROL, x"00000001", "snapshot");
+    read(C_PERF_STRETCH, value, "reading stretch cycles");
+    check_value(to_integer(unsigned(value)) >= 3 * 1000, ERROR, "3 acks stretched by about 25 us each", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "stretch timeout, the slave holds scl longer than 20 us", C_SCOPE);
+
+    write(C_STRETCH_LIMIT, x"000003E8", "stretch timeout 1000 cycles");
+    check(C_STRETCH_LIMIT, x"000003E8", ERROR, "checking stretch timeout register");
+    write(4, x"00000040", "interrupt on timeout");
+    stretch_time <= 50 us;
+    write(0, x"00000000", "writing to control register, rw = 0");
+    write(1, x"00006806", "writing to write register, slave 0x68 register 0x06");
+    write(0, x"00000001", "writing to control register, enable = 1");
+    wait until irq = '1' for 1 ms;
+    check_value(irq, '1', ERROR, "timeout interrupt", C_SCOPE);
+    read(2, status, "reading status register");
+    check_value(status(6), '1', ERROR, "timeout set", C_SCOPE);
+    check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+    check_value(status(1), '0', ERROR, "not busy", C_SCOPE);
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+    write(2, x"0000004F", "clearing status flags");
+    check(2, x"00000000", ERROR, "status cleared");
+    write(4, x"00000000", "interrupts off");
+
+
+    log(ID_LOG_HDR, "the next transaction waits for scl and runs normally", C_SCOPE);
+
+    stretch_time <= 0 ns;
+    write_reg(x"07", x"5A");
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+    check_value(status(6), '0', ERROR, "no timeout", C_SCOPE);
+    write(2, x"0000004F", "clearing status flags");
+    wait for 500 * T; -- stop condition
+    check_value(slave_mem(7), x"5A", ERROR, "byte written after the timeout", C_SCOPE);
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+
+  -- slave 0x68 with an auto incrementing register pointer, the first written byte sets the pointer
+  slave_dummy : process(scl, start_count)
+    variable bit_cnt  : natural := 0;   -- scl falling edges in the current byte, 9 = ack slot
+    variable rx_byte  : std_logic_vector(7 downto 0);
+    variable is_addr  : boolean := true;
+    variable is_ptr   : boolean := false;
+    variable selected : boolean := false;
+    variable ptr      : natural := 0;
+    begin
+      if start_count'event then
+        bit_cnt := 0;
+        is_addr := true;
+        sda <= 'Z';
+
+      elsif rising_edge(scl) then
+        if bit_cnt >= 1 and bit_cnt <= 8 then
+          rx_byte(8 - bit_cnt) := to_x01(sda);
+        end if;
+
+      elsif falling_edge(scl) then
+        if bit_cnt = 9 then
+          bit_cnt := 1;
+          if selected then
+            stretch_req <= not stretch_req;
+          end if;
+          if is_addr then
+            is_ptr := true;
+          elsif is_ptr then
+            is_ptr := false;
+            ptr := to_integer(unsigned(rx_byte)) mod 16;
+          else
+            slave_mem(ptr) <= rx_byte;
+            ptr := (ptr + 1) mod 16;
+          end if;
+          is_addr := false;
+        else
+          bit_cnt := bit_cnt + 1;
+        end if;
+
+        if bit_cnt = 9 then
+          if is_addr then
+            selected := rx_byte(7 downto 1) = "1101000";
+          end if;
+          if selected then
+            sda <= '0';   -- ack
+          end if;
+        else
+          sda <= 'Z';
+        end if;
+      end if;
+	end process;
+end architecture;
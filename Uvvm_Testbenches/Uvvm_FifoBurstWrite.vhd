@@ -0,0 +1,220 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+  signal irq : std_logic;
+
+  -- bytes queued in the tx fifo: register pointer followed by a page of data
+  type t_byte_array is array (natural range <>) of std_logic_vector(7 downto 0);
+  constant C_TX_BYTES : t_byte_array(0 to 4) := (x"00", x"30", x"46", x"07", x"25");
+
+  -- one scl period plus margin, anything longer between two bytes is a stall
+  constant C_MAX_BYTE_GAP : time := 11 us;
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of fifo burst write", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+    log(ID_LOG_HDR, "filling tx fifo", C_SCOPE);
+
+    write(8, x"00000201", "fifo control, fifo enable = 1, tx threshold = 2");
+    write(1, x"00006800", "writing to write register, slave address");
+
+    for i in C_TX_BYTES'range loop
+      if i = C_TX_BYTES'high then
+        write(5, x"00000100" or (x"000000" & C_TX_BYTES(i)), "pushing last byte, stop = 1");
+      else
+        write(5, x"000000" & C_TX_BYTES(i), "pushing byte");
+      end if;
+    end loop;
+
+    check(7, x"00040005", ERROR, "checking fifo status register");-- 5 bytes in tx fifo, rx fifo empty
+    check(2, x"00000000", ERROR, "checking status register");-- above tx threshold
+
+
+    log(ID_LOG_HDR, "running burst", C_SCOPE);
+
+    write(4, x"00000015", "enable done, ack_error and tx threshold interrupts");
+    write(0, x"00000001", "writing to control register, enable = 1");
+
+    await_value(irq, '1', 0 ns, 1 ms, ERROR, "waiting for tx threshold irq", C_SCOPE);
+    read(2, status, "reading status register");
+    check_value(status(4), '1', ERROR, "tx threshold reached", C_SCOPE);
+    write(4, x"00000005", "tx threshold handled, keep done and ack_error");
+
+    await_value(irq, '1', 0 ns, 1 ms, ERROR, "waiting for irq on done", C_SCOPE);
+    read(2, status, "reading status register");
+    check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+
+    check(7, x"00150000", ERROR, "checking fifo status register");-- both fifos empty, tx below threshold
+
+    write(2, x"0000000F", "clearing status flags");
+    write(8, x"00000006", "flush both fifos, fifo mode off");
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+
+  slave_dummy : process
+    constant C_SCOPE : string := "slave";
+    variable rx_byte : std_logic_vector(7 downto 0);
+    variable t_ack   : time;
+    begin
+
+        sda <= 'Z';
+        wait until to_x01(scl) = '0';
+
+        -- Master : start and writes adress
+        for bit_idx in 7 downto 0 loop
+          wait until to_x01(scl) = '1';
+          rx_byte(bit_idx) := to_x01(sda);
+          wait until to_x01(scl) = '0';
+        end loop;
+        check_value(rx_byte, x"D0", ERROR, "address 0x68 with write", C_SCOPE);
+
+        -- ack for slave address
+        sda <= '0';
+        wait until to_x01(scl) = '1';
+        wait until to_x01(scl) = '0';
+        sda <= 'Z';
+
+        -- Master : writes the fifo content back to back
+        for i in C_TX_BYTES'range loop
+          for bit_idx in 7 downto 0 loop
+            wait until to_x01(scl) = '1';
+            if bit_idx = 7 and i /= C_TX_BYTES'low then
+              check_value(now - t_ack < C_MAX_BYTE_GAP, ERROR, "no scl stall between bytes", C_SCOPE);
+            end if;
+            rx_byte(bit_idx) := to_x01(sda);
+            wait until to_x01(scl) = '0';
+          end loop;
+          check_value(rx_byte, C_TX_BYTES(i), ERROR, "byte received by slave", C_SCOPE);
+
+          -- ack for data byte
+          sda <= '0';
+          wait until to_x01(scl) = '1';
+          t_ack := now;
+          wait until to_x01(scl) = '0';
+          sda <= 'Z';
+        end loop;
+
+		wait;
+	end process;
+end architecture;
@@ -0,0 +1,325 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+  signal irq : std_logic;
+
+  -- start conditions seen on the bus, resets the slave
+  signal start_count   : natural := 0;
+
+  -- longest scl low time since the last clear
+  signal max_scl_low   : time := 0 ns;
+  signal measure_clear : boolean := false;
+
+  -- slave memory
+  type mem_type is array (0 to 15) of std_logic_vector(7 downto 0);
+  signal slave_mem     : mem_type := (others => x"00");
+
+  -- cpu reaction time to a status change (interrupt latency)
+  constant C_CPU_LATENCY : time := 2 us;
+
+  constant C_PERF_CONTROL : natural := 12;
+  constant C_PERF_STALL   : natural := 18;
+  constant C_TX_HOLD      : natural := 22;
+
+  -- data of the runs, 0xA0 + i in the first, 0xB0 + i in the second
+  function test_byte(constant run, i : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned(16#A0# + 16 * run + i, 8));
+  end function;
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+  -- start detector: sda falling while scl is high
+  condition_monitor : process(sda)
+  begin
+    if to_x01(scl) = '1' and to_x01(sda) = '0' and to_x01(sda'last_value) = '1' then
+      start_count <= start_count + 1;
+    end if;
+  end process;
+
+  low_monitor : process(scl, measure_clear)
+    variable t_fall : time := 0 ns;
+  begin
+    if measure_clear'event then
+      max_scl_low <= 0 ns;
+    elsif falling_edge(scl) then
+      t_fall := now;
+    elsif rising_edge(scl) and t_fall /= 0 ns then
+      if now - t_fall > max_scl_low then
+        max_scl_low <= now - t_fall;
+      end if;
+    end if;
+  end process;
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);
+    end;
+
+    procedure wait_done is
+      begin
+        poll_done : for i in 0 to 2000 loop
+          read(2, status, "polling status register");
+          exit poll_done when status(0) = '1';
+          wait for 100 * T;
+        end loop;
+        check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+        check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+        write(2, x"000000FF", "clearing status flags");
+    end;
+
+    procedure wait_hold_empty is
+      begin
+        poll_hold : for i in 0 to 2000 loop
+          read(2, status, "polling status register");
+          exit poll_hold when status(7) = '1';
+          wait for 10 * T;
+        end loop;
+        check_value(status(7), '1', ERROR, "holding register empty", C_SCOPE);
+    end;
+
+    -- clear the counters and the scl low measurement before a run
+    procedure start_measure is
+      begin
+        write(C_PERF_CONTROL, x"00000002", "clear performance counters");
+        measure_clear <= not measure_clear;
+    end;
+
+    -- stall cycles of the run, the slave must have received all bytes
+    procedure end_measure(constant mode : in string; constant run : in natural; variable stall : out natural) is
+        variable value : std_logic_vector(31 downto 0);
+      begin
+        write(C_PERF_CONTROL, x"00000001", "snapshot");
+        read(C_PERF_STALL, value, "reading stall cycles");
+        stall := to_integer(unsigned(value));
+        log(ID_SEQUENCER, mode & ": scl held low for the cpu " & to_string(stall) & " cycles, " &
+            to_string(stall / 9) & " per byte, longest scl low " & to_string(max_scl_low), C_SCOPE);
+        for i in 0 to 7 loop
+          check_value(slave_mem(i), test_byte(run, i), ERROR, mode & ": byte written", C_SCOPE);
+        end loop;
+    end;
+
+    variable stall : natural;
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of the holding register", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+
+    log(ID_LOG_HDR, "8 byte write, the cpu writes every byte after ready", C_SCOPE);
+
+    start_measure;
+    write(1, x"00006800", "writing to write register, slave 0x68 register 0x00");
+    write(0, x"00000001", "writing to control register, enable = 1");
+    for i in 0 to 7 loop
+      poll(2 , x"0000000A", ERROR, "waiting for ready, ready and busy = 1");
+      wait for C_CPU_LATENCY;
+      write(1, x"000068" & test_byte(0, i), "writing to write register, data");
+      write(2, x"00000008", "clearing ready");
+      write(0, x"00000008", "writing to control register, continue = 1");
+    end loop;
+    poll(2 , x"0000000A", ERROR, "waiting for ready, ready and busy = 1");
+    wait for C_CPU_LATENCY;
+    write(2, x"00000008", "clearing ready");
+    write(0, x"00000002", "writing to control register, stop = 1");
+    wait_done;
+    wait for 500 * T; -- stop condition
+
+    end_measure("write register", 0, stall);
+    check_value(stall >= 9 * 100, ERROR, "scl stalls for the cpu latency at every byte", C_SCOPE);
+    check_value(max_scl_low > 5 us + C_CPU_LATENCY, ERROR, "scl low longer than tLOW", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "8 byte write, the next byte is loaded into the holding register", C_SCOPE);
+
+    start_measure;
+    write(1, x"00006800", "writing to write register, slave 0x68 register 0x00");
+    write(0, x"00000001", "writing to control register, enable = 1");
+    write(C_TX_HOLD, x"000000" & test_byte(1, 0), "holding register, first data byte");
+    for i in 1 to 7 loop
+      wait_hold_empty;
+      wait for C_CPU_LATENCY;
+      if i < 7 then
+        write(C_TX_HOLD, x"000000" & test_byte(1, i), "holding register, data");
+      else
+        write(C_TX_HOLD, x"000001" & test_byte(1, i), "holding register, last byte with stop");
+      end if;
+    end loop;
+    wait_done;
+    wait for 500 * T; -- stop condition
+
+    end_measure("holding register", 1, stall);
+    check_value(stall < 9 * 3, ERROR, "no scl stall between the bytes", C_SCOPE);
+    check_value(max_scl_low < 5 us + 10 * T, ERROR, "scl low for tLOW only", C_SCOPE);
+    check(2, x"00000000", ERROR, "checking status register");
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+
+  -- slave 0x68 with an auto incrementing register pointer, the first written byte sets the pointer
+  slave_dummy : process(scl, start_count)
+    variable bit_cnt  : natural := 0;   -- scl falling edges in the current byte, 9 = ack slot
+    variable rx_byte  : std_logic_vector(7 downto 0);
+    variable is_addr  : boolean := true;
+    variable is_ptr   : boolean := false;
+    variable selected : boolean := false;
+    variable ptr      : natural := 0;
+    begin
+      if start_count'event then
+        bit_cnt := 0;
+        is_addr := true;
+        sda <= 'Z';
+
+      elsif rising_edge(scl) then
+        if bit_cnt >= 1 and bit_cnt <= 8 then
+          rx_byte(8 - bit_cnt) := to_x01(sda);
+        end if;
+
+      elsif falling_edge(scl) then
+        if bit_cnt = 9 then
+          bit_cnt := 1;
+          if is_addr then
+            is_ptr := true;
+          elsif is_ptr then
+            is_ptr := false;
+            ptr := to_integer(unsigned(rx_byte)) mod 16;
+          else
+            slave_mem(ptr) <= rx_byte;
+            ptr := (ptr + 1) mod 16;
+          end if;
+          is_addr := false;
+        else
+          bit_cnt := bit_cnt + 1;
+        end if;
+
+        if bit_cnt = 9 then
+          if is_addr then
+            selected := rx_byte(7 downto 1) = "1101000";
+          end if;
+          if selected then
+            sda <= '0';   -- ack
+          end if;
+        else
+          sda <= 'Z';
+        end if;
+      end if;
+	end process;
+end architecture;
@@ -0,0 +1,239 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+  signal irq : std_logic;
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up, a slave that does not answer leaves sda high (nack)
+  sda <= 'H';
+  scl <= 'H';
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of interrupts", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+    log(ID_LOG_HDR, "checking interrupt registers after reset", C_SCOPE);
+
+    check(2, x"00000000", ERROR, "checking status register");
+    check(4, x"00000000", ERROR, "checking interrupt enable register");
+    check_value(irq, '0', ERROR, "irq low after reset", C_SCOPE);
+
+    write(4, x"0000000D", "enable ready, ack_error and done interrupts");
+    check(4, x"0000000D", ERROR, "checking interrupt enable register");
+
+
+    log(ID_LOG_HDR, "ready interrupt", C_SCOPE);
+
+    write(1, x"0000683C", "writing to write register");
+    write(0, x"00000001", "writing to control register, enable = 1");
+
+    await_value(irq, '1', 0 ns, 1 ms, ERROR, "waiting for irq on ready", C_SCOPE);
+    check(2, x"0000000A", ERROR, "checking status register");-- ready and busy
+
+    write(2, x"00000008", "clearing ready, write 1 to clear");
+    wait for 2*T;
+    check_value(irq, '0', ERROR, "irq low after clearing ready", C_SCOPE);
+    check(2, x"00000002", ERROR, "checking status register");-- ready cleared, still busy
+
+
+    log(ID_LOG_HDR, "done interrupt", C_SCOPE);
+
+    write(0, x"00000002", "write control register, stop = 1");
+
+    await_value(irq, '1', 0 ns, 1 ms, ERROR, "waiting for irq on done", C_SCOPE);
+    read(2, status, "reading status register");
+    check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+
+    write(2, x"00000001", "clearing done, write 1 to clear");
+    wait for 2*T;
+    check_value(irq, '0', ERROR, "irq low after clearing done", C_SCOPE);
+    read(2, status, "reading status register");
+    check_value(status(0), '0', ERROR, "done cleared", C_SCOPE);
+
+    wait for 500 * T; -- stop condition and bus free time
+
+
+    log(ID_LOG_HDR, "ack_error interrupt", C_SCOPE);
+
+    write(1, x"00005000", "writing to write register, slave that does not answer");
+    write(0, x"00000001", "writing to control register, enable = 1");
+
+    await_value(irq, '1', 0 ns, 1 ms, ERROR, "waiting for irq on ack_error", C_SCOPE);
+    read(2, status, "reading status register");
+    check_value(status(2), '1', ERROR, "ack error set", C_SCOPE);
+    check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+
+    write(2, x"00000004", "clearing ack_error only");
+    wait for 2*T;
+    check_value(irq, '1', ERROR, "irq still high, done is pending", C_SCOPE);
+
+    write(2, x"00000001", "clearing done");
+    wait for 2*T;
+    check_value(irq, '0', ERROR, "irq low after clearing all flags", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "masked interrupts", C_SCOPE);
+
+    write(4, x"00000000", "disable all interrupts");
+    write(1, x"00005000", "writing to write register, slave that does not answer");
+    write(0, x"00000001", "writing to control register, enable = 1");
+
+    poll_until_done : for i in 0 to 1000 loop
+      read(2, status, "polling status register");
+      exit poll_until_done when status(0) = '1';
+      wait for 100 * T;
+    end loop;
+    check_value(status(0), '1', ERROR, "done set while masked", C_SCOPE);
+    check_value(irq, '0', ERROR, "irq stays low while masked", C_SCOPE);
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+
+  slave_dummy : process
+    begin
+
+        sda <= 'Z';
+        wait until to_x01(scl) = '0';
+
+        -- Master : start, idle and writes adress
+		    for bit in 7 downto 0 loop
+          wait until to_x01(scl) = '1';
+          wait until to_x01(scl) = '0';
+        end loop;
+
+        -- first ack for slave address
+        wait until to_x01(scl) = '1';
+        sda <= '0';
+        wait until to_x01(scl) = '0';
+        sda <= 'Z';
+
+        -- Master :writes register adress
+		    for bit in 7 downto 0 loop
+          wait until to_x01(scl) = '1';
+          wait until to_x01(scl) = '0';
+        end loop;
+
+        -- second ack for register address
+        wait until to_x01(scl) = '1';
+        sda <= '0';
+        wait until to_x01(scl) = '0';
+        sda <= 'Z';
+
+        -- the following transactions address 0x50, nobody answers
+		wait;
+	end process;
+end architecture;
@@ -0,0 +1,197 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_CHANNELS   : natural := 2;
+  constant C_CH_BITS    : natural := 2;
+  constant C_ADDR_WIDTH : natural := C_CH_BITS + 6;
+
+  component i2c_multi_top
+    generic (
+      CHANNELS  : integer;
+      CH_BITS   : integer);
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic_vector(C_CHANNELS-1 downto 0);
+      scl       : inout std_logic_vector(C_CHANNELS-1 downto 0));
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic_vector(C_CHANNELS-1 downto 0);
+  signal scl : std_logic_vector(C_CHANNELS-1 downto 0);
+  signal irq : std_logic;
+begin
+
+  i2c_multi_top0 : i2c_multi_top
+    generic map (
+      CHANNELS   => C_CHANNELS,
+      CH_BITS    => C_CH_BITS)
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-ups, no slaves on either bus
+  sda <= (others => 'H');
+  scl <= (others => 'H');
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   constant C_SHARED    : natural := C_CHANNELS * 64;
+   variable status      : std_logic_vector(31 downto 0);
+
+    -- register reg of channel ch, ch = C_CHANNELS is the shared window
+    procedure write(
+      constant ch           : in natural;
+      constant reg          : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(ch * 64 + reg, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant ch           : in natural;
+      constant reg          : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(ch * 64 + reg, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant ch           : in natural;
+      constant reg          : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(ch * 64 + reg, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of the multi channel top", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+    log(ID_LOG_HDR, "shared window after reset", C_SCOPE);
+
+    check(C_CHANNELS, 0, x"00000000", ERROR, "checking irq summary register");
+    check(C_CHANNELS, 1, std_logic_vector(to_unsigned(C_CHANNELS, 32)), ERROR, "checking channels register");
+    write(C_CHANNELS, 1, x"FFFFFFFF", "writing to channels register");
+    check(C_CHANNELS, 1, std_logic_vector(to_unsigned(C_CHANNELS, 32)), ERROR, "checking channels register");-- read only
+    check_value(irq, '0', ERROR, "irq low after reset", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "channel windows", C_SCOPE);
+
+    for ch in 0 to C_CHANNELS - 1 loop
+      check(ch, 9, x"00FA00FA", ERROR, "checking scl timing register");
+    end loop;
+    write(1, 9, x"00320048", "writing to scl timing register of channel 1");
+    check(1, 9, x"00320048", ERROR, "checking scl timing register of channel 1");
+    check(0, 9, x"00FA00FA", ERROR, "checking scl timing register of channel 0");-- not changed
+    write(0, 23, x"00000025", "writing to address register of channel 0");
+    check(0, 23, x"00000025", ERROR, "checking address register of channel 0");
+    check(1, 23, x"00000000", ERROR, "checking address register of channel 1");
+    write(0, 23, x"00000000", "writing to address register of channel 0");
+
+
+    log(ID_LOG_HDR, "irq summary", C_SCOPE);
+
+    write(1, 4, x"00000001", "enable done interrupt of channel 1");
+    write(1, 1, x"00005000", "writing to write register of channel 1, slave that does not answer");
+    write(1, 0, x"00000001", "writing to control register of channel 1, enable = 1");
+
+    await_value(irq, '1', 0 ns, 1 ms, ERROR, "waiting for irq of channel 1", C_SCOPE);
+    check(C_CHANNELS, 0, x"00000002", ERROR, "checking irq summary register");-- channel 1 only
+    read(1, 2, status, "reading status register of channel 1");
+    check_value(status(2), '1', ERROR, "ack error set on channel 1", C_SCOPE);
+    check(0, 2, x"00000000", ERROR, "checking status register of channel 0");
+
+    write(0, 4, x"00000001", "enable done interrupt of channel 0");
+    write(0, 1, x"00005000", "writing to write register of channel 0, slave that does not answer");
+    write(0, 0, x"00000001", "writing to control register of channel 0, enable = 1");
+
+    for i in 0 to 1000 loop
+      read(0, 2, status, "polling status register of channel 0");
+      exit when status(0) = '1';
+      wait for 100 * T;
+    end loop;
+    check(C_CHANNELS, 0, x"00000003", ERROR, "checking irq summary register");-- both channels
+
+    write(1, 2, x"00000005", "clearing done and ack_error of channel 1");
+    check(C_CHANNELS, 0, x"00000001", ERROR, "checking irq summary register");
+    check_value(irq, '1', ERROR, "irq high while channel 0 is pending", C_SCOPE);
+    write(0, 2, x"00000005", "clearing done and ack_error of channel 0");
+    wait for 2*T;
+    check(C_CHANNELS, 0, x"00000000", ERROR, "checking irq summary register");
+    check_value(irq, '0', ERROR, "irq low after clearing both channels", C_SCOPE);
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+end architecture;
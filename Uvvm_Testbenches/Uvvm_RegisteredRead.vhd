@@ -0,0 +1,251 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+-- Registered read path (REGISTERED_READ = true): every read takes one wait state on
+-- sbi_ready, reads that pop the rx fifo or the trace pop once per access.
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    generic (
+      REGISTERED_READ : boolean);
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      sbi_ready : out std_logic;
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  component i2c_slave_bfm
+    generic (
+      ADDRESS      : std_logic_vector(6 downto 0);
+      STRETCH_TIME : time);
+    port (
+      scl       : inout std_logic;
+      sda       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+
+  -- read accesses and the clock cycles they took
+  signal read_count  : natural := 0;
+  signal read_cycles : natural := 0;
+begin
+
+  i2c_top0 : i2c_top
+    generic map (
+      REGISTERED_READ => true)
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      sbi_ready  => sbi_if.ready,
+      irq        => open,
+      sda        => sda,
+      scl        => scl);
+
+  slave0 : i2c_slave_bfm
+    generic map (
+      ADDRESS      => "1101000",
+      STRETCH_TIME => 0 ns)
+    port map (
+      scl        => scl,
+      sda        => sda);
+
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+  read_monitor : process(clk)
+  begin
+    if rising_edge(clk) then
+      if sbi_if.cs = '1' and sbi_if.rena = '1' then
+        read_cycles <= read_cycles + 1;
+        if sbi_if.ready = '1' then
+          read_count <= read_count + 1;
+        end if;
+      end if;
+    end if;
+  end process;
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+   variable level       : natural;
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);
+    end;
+
+    procedure wait_done is
+      begin
+        poll_done : for i in 0 to 5000 loop
+          read(2, status, "polling status register");
+          exit poll_done when status(0) = '1';
+          wait for 10 * T;
+        end loop;
+        check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+        check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+        write(2, x"0000000F", "clearing status flags");
+        wait for 500 * T; -- stop condition
+    end;
+
+    -- register pointer, repeated start and count bytes into the rx fifo
+    procedure fifo_read(
+      constant pointer      : in std_logic_vector(7 downto 0);
+      constant count        : in natural) is
+      begin
+        write(8, std_logic_vector(to_unsigned(count, 8)) & x"000007", "flush fifos, fifo mode on, rx length");
+        write(1, x"00006800", "writing to write register, slave 0x68");
+        write(5, x"000000" & pointer, "tx fifo: register pointer, no stop");
+        write(0, x"00000001", "writing to control register, enable = 1");
+        poll(2 , x"0000001A", ERROR, "polling status register");-- ready, busy and tx threshold
+        write(0, x"00000014", "writing to control register, restart = 1, rw = 1");
+        wait_done;
+        write(0, x"00000000", "writing to control register, rw = 0");
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of the registered read path", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+
+    log(ID_LOG_HDR, "Register values through the read register", C_SCOPE);
+
+    check(0, x"00000000", ERROR, "checking control register");
+    check(25, x"00000004", ERROR, "checking pack control register");
+    check(31, x"00002000", ERROR, "checking poll range register");
+    check(33, x"0000FFFF", ERROR, "checking poll status register");
+    write(9, x"00320048", "writing to scl timing register");
+    check(9, x"00320048", ERROR, "checking scl timing register");
+    write(9, x"00FA00FA", "writing to scl timing register"); -- back to 100 kHz
+    check(9, x"00FA00FA", ERROR, "checking scl timing register");
+
+
+    log(ID_LOG_HDR, "Reads that pop, once per access", C_SCOPE);
+
+    write(34, x"00000003", "writing to trace control register, clear, enable");
+    fifo_read(x"20", 8);
+    check(7, x"00310800", ERROR, "checking fifo status register"); -- 8 bytes in the rx fifo, tx empty
+    for i in 0 to 3 loop
+      check(6, x"000000" & std_logic_vector(to_unsigned(16#20# + i, 8)), ERROR, "checking rx data register");
+    end loop;
+    check(26, x"27262524", ERROR, "checking rx packed register");
+    check(25, x"00000404", ERROR, "checking pack control register"); -- 4 bytes in the last packed read
+    check(26, x"00000000", ERROR, "checking rx packed register");    -- empty
+    check(25, x"00000004", ERROR, "checking pack control register");
+
+    write(34, x"00000000", "writing to trace control register, disable");
+    read(35, status, "reading trace status register");
+    level := to_integer(unsigned(status(31 downto 16)));
+    check_value(level > 10, ERROR, "trace entries of the read", C_SCOPE);
+    for i in level - 1 downto 0 loop
+      read(36, status, "reading trace data register");
+      read(35, status, "reading trace status register");
+      check_value(to_integer(unsigned(status(31 downto 16))), i, ERROR, "one entry popped", C_SCOPE);
+    end loop;
+
+
+    log(ID_LOG_HDR, "Wait states", C_SCOPE);
+
+    wait for 10*T;
+    check_value(read_cycles, 2 * read_count, ERROR, "every read takes two cycles", C_SCOPE);
+
+    write(8, x"00000006", "flush both fifos, fifo mode off");
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+    wait;
+  end process;
+end architecture;
@@ -0,0 +1,350 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+  signal irq : std_logic;
+
+  -- bus conditions seen by the monitors
+  signal start_count   : natural := 0;
+  signal stop_count    : natural := 0;
+  signal start_setup   : time := 0 ns;
+  signal restart_hold  : time := 0 ns;
+  signal t_last_start  : time := 0 ns;
+
+  constant C_DATA_BYTE : std_logic_vector(7 downto 0) := x"A5";
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+  -- start/stop detector: sda changing while scl is high
+  condition_monitor : process(sda)
+  begin
+    if to_x01(scl) = '1' then
+      if to_x01(sda) = '0' and to_x01(sda'last_value) = '1' then
+        start_count   <= start_count + 1;
+        start_setup   <= scl'last_event;    -- scl high before sda falls, tSU;STA
+        t_last_start  <= now;
+      elsif to_x01(sda) = '1' and to_x01(sda'last_value) = '0' then
+        stop_count    <= stop_count + 1;
+      end if;
+    end if;
+  end process;
+
+  -- sda low before scl falls after the repeated start, tHD;STA
+  hold_monitor : process(scl)
+  begin
+    if falling_edge(scl) and start_count = 2 and restart_hold = 0 ns then
+      restart_hold <= now - t_last_start;
+    end if;
+  end process;
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of repeated start", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+    log(ID_LOG_HDR, "register pointer write", C_SCOPE);
+
+    write(1, x"00006811", "writing to write register, slave 0x68 register 0x11");
+    write(0, x"00000001", "writing to control register, enable = 1");
+    poll(2 , x"0000000A", ERROR, "polling status register");-- waiting for ready and busy = 1
+
+
+    log(ID_LOG_HDR, "repeated start into read", C_SCOPE);
+
+    write(0, x"00000014", "writing to control register, restart = 1, rw = 1");
+
+    poll_done : for i in 0 to 1000 loop
+      read(2, status, "polling status register");
+      exit poll_done when status(0) = '1';
+      wait for 100 * T;
+    end loop;
+    check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+
+    wait for 500 * T; -- stop condition
+
+    check(3, x"000000" & C_DATA_BYTE, ERROR, "checking reading register");
+
+    check_value(start_count, 2, ERROR, "start and repeated start on the bus", C_SCOPE);
+    check_value(stop_count, 1, ERROR, "only the final stop on the bus", C_SCOPE);
+    check_value(start_setup >= 4.7 us, ERROR, "repeated start setup time tSU;STA", C_SCOPE);
+    check_value(restart_hold >= 4.0 us, ERROR, "repeated start hold time tHD;STA", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "repeated start into write", C_SCOPE);
+
+    write(2, x"0000000F", "clearing status flags");
+    write(1, x"0000680E", "writing to write register, slave 0x68 register 0x0E");
+    write(0, x"00000001", "writing to control register, enable = 1");
+    poll(2 , x"0000000A", ERROR, "polling status register");-- waiting for ready and busy = 1
+
+    write(1, x"0000681C", "writing to write register, first byte after the repeated start");
+    write(0, x"00000010", "writing to control register, restart = 1, rw = 0");
+    wait for 10 * T;
+    read(2, status, "reading status register");
+    check_value(status(3), '0', ERROR, "ready dropped by the repeated start", C_SCOPE);
+    poll(2 , x"0000000A", ERROR, "polling status register");-- 0x1C acked
+
+    write(0, x"00000002", "writing to control register, stop = 1");
+    poll_done_write : for i in 0 to 1000 loop
+      read(2, status, "polling status register");
+      exit poll_done_write when status(0) = '1';
+      wait for 100 * T;
+    end loop;
+    check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+
+    wait for 500 * T; -- stop condition
+
+    check_value(start_count, 4, ERROR, "start and repeated start on the bus", C_SCOPE);
+    check_value(stop_count, 2, ERROR, "only the final stop on the bus", C_SCOPE);
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+
+  slave_dummy : process
+    constant C_SCOPE : string := "slave";
+    variable rx_byte : std_logic_vector(7 downto 0);
+    begin
+
+        sda <= 'Z';
+        wait until to_x01(scl) = '0';
+
+        -- Master : start and writes adress
+        for bit_idx in 7 downto 0 loop
+          wait until to_x01(scl) = '1';
+          rx_byte(bit_idx) := to_x01(sda);
+          wait until to_x01(scl) = '0';
+        end loop;
+        check_value(rx_byte, x"D0", ERROR, "address 0x68 with write", C_SCOPE);
+
+        -- ack for slave address
+        sda <= '0';
+        wait until to_x01(scl) = '1';
+        wait until to_x01(scl) = '0';
+        sda <= 'Z';
+
+        -- Master : writes register pointer
+        for bit_idx in 7 downto 0 loop
+          wait until to_x01(scl) = '1';
+          rx_byte(bit_idx) := to_x01(sda);
+          wait until to_x01(scl) = '0';
+        end loop;
+        check_value(rx_byte, x"11", ERROR, "register pointer", C_SCOPE);
+
+        -- ack for register pointer
+        sda <= '0';
+        wait until to_x01(scl) = '1';
+        wait until to_x01(scl) = '0';
+        sda <= 'Z';
+
+        -- Master : repeated start, scl goes high once before the address
+        wait until start_count = 2;
+        wait until to_x01(scl) = '0';
+
+        for bit_idx in 7 downto 0 loop
+          wait until to_x01(scl) = '1';
+          rx_byte(bit_idx) := to_x01(sda);
+          wait until to_x01(scl) = '0';
+        end loop;
+        check_value(rx_byte, x"D1", ERROR, "address 0x68 with read", C_SCOPE);
+
+        -- ack for slave address
+        sda <= '0';
+        wait until to_x01(scl) = '1';
+        wait until to_x01(scl) = '0';
+
+        -- dummy drives data
+        for bit_idx in 7 downto 0 loop
+          sda <= C_DATA_BYTE(bit_idx);
+          wait until to_x01(scl) = '1';
+          wait until to_x01(scl) = '0';
+        end loop;
+        sda <= 'Z';
+
+        -- Master : nack and stop
+        wait until to_x01(scl) = '1';
+        check_value(to_x01(sda), '1', ERROR, "master nack on the last byte", C_SCOPE);
+
+        -- Master : start, adress and register pointer of the second transaction
+        wait until start_count = 3;
+        wait until to_x01(scl) = '0';
+
+        for bit_idx in 7 downto 0 loop
+          wait until to_x01(scl) = '1';
+          rx_byte(bit_idx) := to_x01(sda);
+          wait until to_x01(scl) = '0';
+        end loop;
+        check_value(rx_byte, x"D0", ERROR, "address 0x68 with write", C_SCOPE);
+
+        sda <= '0';
+        wait until to_x01(scl) = '1';
+        wait until to_x01(scl) = '0';
+        sda <= 'Z';
+
+        for bit_idx in 7 downto 0 loop
+          wait until to_x01(scl) = '1';
+          rx_byte(bit_idx) := to_x01(sda);
+          wait until to_x01(scl) = '0';
+        end loop;
+        check_value(rx_byte, x"0E", ERROR, "register pointer", C_SCOPE);
+
+        sda <= '0';
+        wait until to_x01(scl) = '1';
+        wait until to_x01(scl) = '0';
+        sda <= 'Z';
+
+        -- Master : repeated start into write, the data byte comes from the write register
+        wait until start_count = 4;
+        wait until to_x01(scl) = '0';
+
+        for bit_idx in 7 downto 0 loop
+          wait until to_x01(scl) = '1';
+          rx_byte(bit_idx) := to_x01(sda);
+          wait until to_x01(scl) = '0';
+        end loop;
+        check_value(rx_byte, x"D0", ERROR, "address 0x68 with write after the repeated start", C_SCOPE);
+
+        sda <= '0';
+        wait until to_x01(scl) = '1';
+        wait until to_x01(scl) = '0';
+        sda <= 'Z';
+
+        for bit_idx in 7 downto 0 loop
+          wait until to_x01(scl) = '1';
+          rx_byte(bit_idx) := to_x01(sda);
+          wait until to_x01(scl) = '0';
+        end loop;
+        check_value(rx_byte, x"1C", ERROR, "data byte after the repeated start", C_SCOPE);
+
+        sda <= '0';
+        wait until to_x01(scl) = '1';
+        wait until to_x01(scl) = '0';
+        sda <= 'Z';
+
+		wait;
+	end process;
+end architecture;
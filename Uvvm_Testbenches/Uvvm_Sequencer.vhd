@@ -0,0 +1,396 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+  constant C_MEM_LATENCY : natural := 2;   -- clocks waitrequest is held for every memory access
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      avm_address     : out std_logic_vector(31 downto 0);
+      avm_read        : out std_logic;
+      avm_write       : out std_logic;
+      avm_writedata   : out std_logic_vector(31 downto 0);
+      avm_byteenable  : out std_logic_vector(3 downto 0);
+      avm_readdata    : in  std_logic_vector(31 downto 0);
+      avm_waitrequest : in  std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+  signal irq : std_logic;
+
+  -- avalon-mm master of the sequencer
+  signal avm_address     : std_logic_vector(31 downto 0);
+  signal avm_read        : std_logic;
+  signal avm_write       : std_logic;
+  signal avm_writedata   : std_logic_vector(31 downto 0);
+  signal avm_byteenable  : std_logic_vector(3 downto 0);
+  signal avm_readdata    : std_logic_vector(31 downto 0);
+  signal avm_waitrequest : std_logic;
+
+  -- memory model, 64 words from address 0, loaded by the main process through the backdoor
+  type t_word_array is array (natural range <>) of std_logic_vector(31 downto 0);
+  signal mem           : t_word_array(0 to 63) := (others => (others => '0'));
+  signal mem_wait      : natural := 0;
+  signal bd_we         : std_logic := '0';
+  signal bd_addr       : natural := 0;
+  signal bd_data       : std_logic_vector(31 downto 0) := (others => '0');
+
+  -- bus conditions seen on the bus
+  signal start_count   : natural := 0;
+  signal stop_count    : natural := 0;
+
+  -- bytes written to the slave after the address, in bus order
+  type t_byte_array is array (natural range <>) of std_logic_vector(7 downto 0);
+  signal wr_log        : t_byte_array(0 to 15) := (others => x"00");
+  signal wr_count      : natural := 0;
+
+  -- slave register content, register n holds 0x40 + n
+  function slave_reg(constant ptr : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned(16#40# + ptr, 8));
+  end function;
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      avm_address     => avm_address,
+      avm_read        => avm_read,
+      avm_write       => avm_write,
+      avm_writedata   => avm_writedata,
+      avm_byteenable  => avm_byteenable,
+      avm_readdata    => avm_readdata,
+      avm_waitrequest => avm_waitrequest,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+  -- start/stop detector: sda changing while scl is high
+  condition_monitor : process(sda)
+  begin
+    if to_x01(scl) = '1' then
+      if to_x01(sda) = '0' and to_x01(sda'last_value) = '1' then
+        start_count <= start_count + 1;
+      elsif to_x01(sda) = '1' and to_x01(sda'last_value) = '0' then
+        stop_count  <= stop_count + 1;
+      end if;
+    end if;
+  end process;
+
+  -- avalon slave: waitrequest for C_MEM_LATENCY clocks, readdata valid with waitrequest low
+  avm_waitrequest <= '1' when (avm_read = '1' or avm_write = '1') and mem_wait /= C_MEM_LATENCY else '0';
+  avm_readdata    <= mem(to_integer(unsigned(avm_address(7 downto 2))));
+
+  avalon_memory : process(clk)
+    variable idx : natural;
+  begin
+    if rising_edge(clk) then
+      if bd_we = '1' then
+        mem(bd_addr / 4) <= bd_data;
+      end if;
+
+      if (avm_read = '1' or avm_write = '1') then
+        if mem_wait = C_MEM_LATENCY then
+          mem_wait <= 0;
+          idx := to_integer(unsigned(avm_address(7 downto 2)));
+          if avm_write = '1' then
+            for i in 0 to 3 loop
+              if avm_byteenable(i) = '1' then
+                mem(idx)(8*i+7 downto 8*i) <= avm_writedata(8*i+7 downto 8*i);
+              end if;
+            end loop;
+          end if;
+        else
+          mem_wait <= mem_wait + 1;
+        end if;
+      else
+        mem_wait <= 0;
+      end if;
+    end if;
+  end process;
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    -- word into the memory model, byte address
+    procedure mem_write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector(31 downto 0)) is
+      begin
+        bd_addr <= addr_value;
+        bd_data <= data_value;
+        bd_we   <= '1';
+        wait until rising_edge(clk);
+        bd_we   <= '0';
+        wait until rising_edge(clk);
+    end;
+
+    -- descriptor with a cleared status word
+    procedure descriptor(
+      constant addr_value   : in natural;
+      constant next_value   : in natural;
+      constant control      : in std_logic_vector(31 downto 0);
+      constant buffer_value : in natural) is
+      begin
+        mem_write(addr_value,      std_logic_vector(to_unsigned(next_value, 32)));
+        mem_write(addr_value + 4,  control);
+        mem_write(addr_value + 8,  std_logic_vector(to_unsigned(buffer_value, 32)));
+        mem_write(addr_value + 12, x"00000000");
+    end;
+
+    procedure wait_seq_done is
+      begin
+        poll_seq : for i in 0 to 4000 loop
+          read(27, status, "polling sequencer control register");
+          exit poll_seq when status(0) = '0';
+          wait for 100 * T;
+        end loop;
+        check_value(status(0), '0', ERROR, "list finished", C_SCOPE);
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of the command sequencer", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+
+    log(ID_LOG_HDR, "pointer write, repeated start read, then a write after a new start", C_SCOPE);
+
+    -- 0x00: write the register pointer 0x02, repeated start follows
+    descriptor(16#00#, 16#10#, x"00010068", 16#80#);
+    -- 0x10: read 5 bytes, stop
+    descriptor(16#10#, 16#20#, x"00050368", 16#A0#);
+    -- 0x20: write 6 bytes, last descriptor ends with a stop by itself
+    descriptor(16#20#, 16#00#, x"00060068", 16#84#);
+    mem_write(16#80#, x"00000002");
+    mem_write(16#84#, x"13121110");
+    mem_write(16#88#, x"00001514");
+    mem_write(16#A0#, x"FFFFFFFF");
+    mem_write(16#A4#, x"FFFFFFFF");
+
+    write(4, x"00000100", "interrupt on sequencer done only");
+    write(28, x"00000000", "writing to sequencer head register");
+    write(27, x"00000001", "start the list");
+    check(27, x"00000001", ERROR, "checking sequencer control register");-- running
+    check_value(irq, '0', ERROR, "no interrupt while the list runs", C_SCOPE);
+    wait_seq_done;
+    wait for 500 * T; -- stop condition
+
+    check(27, x"00000000", ERROR, "checking sequencer control register");-- no error
+    check(29, x"00000020", ERROR, "checking sequencer current register");-- last descriptor
+    check_value(irq, '1', ERROR, "interrupt at the end of the list", C_SCOPE);
+    read(2, status, "reading status register");
+    check_value(status(8), '1', ERROR, "sequencer done set", C_SCOPE);
+    check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+    write(2, x"000001FF", "clearing status flags");
+    wait for 2 * T;
+    check_value(irq, '0', ERROR, "interrupt cleared", C_SCOPE);
+
+    check_value(start_count, 3, ERROR, "start, repeated start and start", C_SCOPE);
+    check_value(stop_count, 2, ERROR, "stop after the read and after the write", C_SCOPE);
+    check_value(wr_count, 7, ERROR, "pointer and 6 data bytes written", C_SCOPE);
+    check_value(wr_log(0), x"02", ERROR, "register pointer", C_SCOPE);
+    for i in 0 to 5 loop
+      check_value(wr_log(i + 1), std_logic_vector(to_unsigned(16#10# + i, 8)), ERROR, "write bytes from two buffer words", C_SCOPE);
+    end loop;
+    check_value(mem(16#A0# / 4), slave_reg(5) & slave_reg(4) & slave_reg(3) & slave_reg(2), ERROR, "first read word", C_SCOPE);
+    check_value(mem(16#A4# / 4), x"FFFFFF" & slave_reg(6), ERROR, "last read byte, other lanes untouched", C_SCOPE);
+    check_value(mem(16#0C# / 4), x"80000001", ERROR, "status of the pointer write", C_SCOPE);
+    check_value(mem(16#1C# / 4), x"80000005", ERROR, "status of the read", C_SCOPE);
+    check_value(mem(16#2C# / 4), x"80000006", ERROR, "status of the write", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "a nack ends the list", C_SCOPE);
+
+    -- 0x30: write to the missing slave 0x50, 0x40 is not run
+    descriptor(16#30#, 16#40#, x"00010250", 16#80#);
+    descriptor(16#40#, 16#00#, x"00010068", 16#80#);
+
+    write(28, x"00000030", "writing to sequencer head register");
+    write(27, x"00000001", "start the list");
+    wait_seq_done;
+    wait for 500 * T; -- stop condition
+
+    check(27, x"00000002", ERROR, "checking sequencer control register");-- error
+    check(29, x"00000030", ERROR, "checking sequencer current register");-- failed descriptor
+    check_value(mem(16#3C# / 4)(31), '1', ERROR, "failed descriptor done", C_SCOPE);
+    check_value(mem(16#3C# / 4)(16), '1', ERROR, "failed descriptor ack error", C_SCOPE);
+    check_value(mem(16#4C# / 4), x"00000000", ERROR, "next descriptor not run", C_SCOPE);
+    check_value(start_count, 4, ERROR, "one more start", C_SCOPE);
+    check_value(stop_count, 3, ERROR, "stop after the nack", C_SCOPE);
+    read(2, status, "reading status register");
+    check_value(status(8), '1', ERROR, "sequencer done set", C_SCOPE);
+    check_value(status(2), '1', ERROR, "ack error set", C_SCOPE);
+    write(2, x"000001FF", "clearing status flags");
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+
+  -- slave 0x68 with an auto incrementing register pointer, the first written byte sets the pointer
+  slave_dummy : process(scl, start_count)
+    variable bit_cnt : natural := 0;   -- scl falling edges in the current byte, 9 = ack slot
+    variable rx_byte : std_logic_vector(7 downto 0);
+    variable is_addr : boolean := true;
+    variable selected : boolean := false;
+    variable reading : boolean := false;
+    variable first   : boolean := true;
+    variable ptr     : natural := 0;
+    variable wr_idx  : natural := 0;
+    begin
+      if start_count'event then
+        bit_cnt := 0;
+        is_addr := true;
+        selected := false;
+        reading := false;
+        first   := true;
+        sda <= 'Z';
+
+      elsif rising_edge(scl) then
+        if bit_cnt >= 1 and bit_cnt <= 8 then
+          rx_byte(8 - bit_cnt) := to_x01(sda);
+        elsif bit_cnt = 9 and reading and not is_addr then
+          -- master acknowledge of a read byte
+          if to_x01(sda) = '1' then
+            reading := false;   -- release sda for the stop
+          end if;
+          ptr := ptr + 1;
+        end if;
+
+      elsif falling_edge(scl) then
+        if bit_cnt = 9 then
+          bit_cnt := 1;
+          is_addr := false;
+        else
+          bit_cnt := bit_cnt + 1;
+        end if;
+
+        if bit_cnt = 9 then
+          if is_addr then
+            selected := rx_byte(7 downto 1) = "1101000";
+            reading := selected and rx_byte(0) = '1';
+            if selected then
+              sda <= '0';   -- ack address
+            end if;
+          elsif not selected then
+            sda <= 'Z';
+          elsif not reading then
+            if first then
+              ptr := to_integer(unsigned(rx_byte));
+              first := false;
+            end if;
+            if wr_idx <= wr_log'high then
+              wr_log(wr_idx) <= rx_byte;
+            end if;
+            wr_idx := wr_idx + 1;
+            wr_count <= wr_idx;
+            sda <= '0';   -- ack data
+          else
+            sda <= 'Z';   -- master ack/nack
+          end if;
+        elsif reading and not is_addr and slave_reg(ptr)(8 - bit_cnt) = '0' then
+          sda <= '0';
+        else
+          sda <= 'Z';
+        end if;
+      end if;
+	end process;
+end architecture;
@@ -0,0 +1,311 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+  signal irq : std_logic;
+
+  -- bus conditions and master acknowledges seen on the bus
+  signal start_count   : natural := 0;
+  signal stop_count    : natural := 0;
+  signal ack_count     : natural := 0;
+  signal nack_count    : natural := 0;
+
+  -- slave register content, register n holds 0x40 + n
+  function slave_reg(constant ptr : natural) return std_logic_vector is
+  begin
+    return std_logic_vector(to_unsigned(16#40# + ptr, 8));
+  end function;
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => irq,
+      sda        => sda,
+      scl        => scl);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+  -- start/stop detector: sda changing while scl is high
+  condition_monitor : process(sda)
+  begin
+    if to_x01(scl) = '1' then
+      if to_x01(sda) = '0' and to_x01(sda'last_value) = '1' then
+        start_count <= start_count + 1;
+      elsif to_x01(sda) = '1' and to_x01(sda'last_value) = '0' then
+        stop_count  <= stop_count + 1;
+      end if;
+    end if;
+  end process;
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);
+    end;
+
+    procedure wait_done is
+      begin
+        poll_done : for i in 0 to 2000 loop
+          read(2, status, "polling status register");
+          exit poll_done when status(0) = '1';
+          wait for 100 * T;
+        end loop;
+        check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+        check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+        write(2, x"0000000F", "clearing status flags");
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of sequential read", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+
+    log(ID_LOG_HDR, "7 byte read, continue/stop from the control register", C_SCOPE);
+
+    write(1, x"00006800", "writing to write register, slave 0x68 register 0x00");
+    write(0, x"00000001", "writing to control register, enable = 1");
+    poll(2 , x"0000000A", ERROR, "polling status register");-- waiting for ready and busy = 1
+
+    write(2, x"00000008", "clearing ready");
+    write(0, x"0000001C", "writing to control register, restart = 1, continue = 1, rw = 1");
+
+    for i in 0 to 6 loop
+      poll(2 , x"0000000A", ERROR, "waiting for the byte, ready and busy = 1");
+      check(3, x"000000" & slave_reg(i), ERROR, "checking reading register");
+      write(2, x"00000008", "clearing ready");
+      if i < 6 then
+        write(0, x"0000000C", "writing to control register, continue = 1, rw = 1");-- ack
+      else
+        write(0, x"00000006", "writing to control register, stop = 1, rw = 1");    -- nack and stop
+      end if;
+    end loop;
+    wait_done;
+    wait for 500 * T; -- stop condition
+
+    check_value(start_count, 2, ERROR, "start and repeated start on the bus", C_SCOPE);
+    check_value(stop_count, 1, ERROR, "one stop for all 7 bytes", C_SCOPE);
+    check_value(ack_count, 6, ERROR, "master ack on bytes 1 to 6", C_SCOPE);
+    check_value(nack_count, 1, ERROR, "master nack on the last byte", C_SCOPE);
+    write(0, x"00000000", "writing to control register, rw = 0");
+
+
+    log(ID_LOG_HDR, "7 byte read into the rx fifo", C_SCOPE);
+
+    write(8, x"07000001", "fifo mode on, rx length 7");
+    write(1, x"00006800", "writing to write register, slave 0x68");
+    write(5, x"00000000", "tx fifo: register pointer 0x00, no stop");
+    write(0, x"00000001", "writing to control register, enable = 1");
+    poll(2 , x"0000001A", ERROR, "polling status register");-- ready, busy and tx threshold
+    write(0, x"00000014", "writing to control register, restart = 1, rw = 1");
+    wait_done;
+    wait for 500 * T; -- stop condition
+
+    check(7, x"00310700", ERROR, "checking fifo status register");-- 7 bytes in rx fifo, tx empty
+    for i in 0 to 6 loop
+      check(6, x"000000" & slave_reg(i), ERROR, "checking rx data register");
+    end loop;
+
+    check_value(start_count, 4, ERROR, "start and repeated start on the bus", C_SCOPE);
+    check_value(stop_count, 2, ERROR, "one stop for all 7 bytes", C_SCOPE);
+    check_value(ack_count, 12, ERROR, "master ack on bytes 1 to 6", C_SCOPE);
+    check_value(nack_count, 2, ERROR, "master nack on the last byte", C_SCOPE);
+
+
+    log(ID_LOG_HDR, "20 byte read, the master waits while the rx fifo is full", C_SCOPE);
+
+    write(8, x"14000007", "flush fifos, fifo mode on, rx length 20");
+    write(5, x"00000000", "tx fifo: register pointer 0x00, no stop");
+    write(0, x"00000000", "writing to control register, rw = 0");
+    write(0, x"00000001", "writing to control register, enable = 1");
+    poll(2 , x"0000001A", ERROR, "polling status register");-- ready, busy and tx threshold
+    write(0, x"00000014", "writing to control register, restart = 1, rw = 1");
+
+    wait for 2 ms; -- more than 16 bytes on the bus
+    read(7, status, "reading fifo status register");
+    check_value(to_integer(unsigned(status(15 downto 8))), 16, ERROR, "rx fifo full", C_SCOPE);
+    check_value(ack_count, 12 + 15, ERROR, "16th byte not acked yet, scl held low", C_SCOPE);
+    check_value(scl, '0', ERROR, "scl held low", C_SCOPE);
+
+    for i in 0 to 7 loop
+      check(6, x"000000" & slave_reg(i), ERROR, "checking rx data register");
+    end loop;
+    wait_done;
+    wait for 500 * T; -- stop condition
+
+    for i in 8 to 19 loop
+      check(6, x"000000" & slave_reg(i), ERROR, "checking rx data register");
+    end loop;
+    check_value(stop_count, 3, ERROR, "one stop for all 20 bytes", C_SCOPE);
+    check_value(ack_count, 12 + 19, ERROR, "master ack on bytes 1 to 19", C_SCOPE);
+    check_value(nack_count, 3, ERROR, "master nack on the last byte", C_SCOPE);
+
+    write(8, x"00000006", "flush both fifos, fifo mode off");
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+
+    wait;
+  end process;
+
+  -- slave 0x68 with an auto incrementing register pointer, the first written byte sets the pointer
+  slave_dummy : process(scl, start_count)
+    variable bit_cnt : natural := 0;   -- scl falling edges in the current byte, 9 = ack slot
+    variable rx_byte : std_logic_vector(7 downto 0);
+    variable is_addr : boolean := true;
+    variable reading : boolean := false;
+    variable ptr     : natural := 0;
+    begin
+      if start_count'event then
+        bit_cnt := 0;
+        is_addr := true;
+        reading := false;
+        sda <= 'Z';
+
+      elsif rising_edge(scl) then
+        if bit_cnt >= 1 and bit_cnt <= 8 then
+          rx_byte(8 - bit_cnt) := to_x01(sda);
+        elsif bit_cnt = 9 and reading and not is_addr then
+          -- master acknowledge of a read byte
+          if to_x01(sda) = '0' then
+            ack_count <= ack_count + 1;
+          else
+            nack_count <= nack_count + 1;
+            reading := false;   -- release sda for the stop
+          end if;
+          ptr := ptr + 1;
+        end if;
+
+      elsif falling_edge(scl) then
+        if bit_cnt = 9 then
+          bit_cnt := 1;
+          is_addr := false;
+        else
+          bit_cnt := bit_cnt + 1;
+        end if;
+
+        if bit_cnt = 9 then
+          if is_addr then
+            reading := rx_byte(0) = '1';
+            sda <= '0';   -- ack address
+          elsif not reading then
+            ptr := to_integer(unsigned(rx_byte));
+            sda <= '0';   -- ack pointer
+          else
+            sda <= 'Z';   -- master ack/nack
+          end if;
+        elsif reading and not is_addr and slave_reg(ptr)(8 - bit_cnt) = '0' then
+          sda <= '0';
+        else
+          sda <= 'Z';
+        end if;
+      end if;
+	end process;
+end architecture;
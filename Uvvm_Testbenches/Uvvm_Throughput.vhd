@@ -0,0 +1,302 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+library work;
+use     work.i2c_sim_pkg.all;
+
+-- Throughput scenarios against the slave model in Sim/, every scenario prints a PERF line
+-- (bytes/s, scl duty, gaps between bytes, start/stop time per transaction).
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  component i2c_slave_bfm
+    generic (
+      ADDRESS      : std_logic_vector(6 downto 0);
+      STRETCH_TIME : time);
+    port (
+      scl       : inout std_logic;
+      sda       : inout std_logic);
+  end component;
+
+  component i2c_bus_monitor
+    port (
+      scl       : in  std_logic;
+      sda       : in  std_logic;
+      clear     : in  std_logic;
+      stats     : out t_i2c_bus_stats);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+
+  signal mon_clear : std_logic := '0';
+  signal bus_stats : t_i2c_bus_stats;
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => open,
+      sda        => sda,
+      scl        => scl);
+
+  slave0 : i2c_slave_bfm
+    generic map (
+      ADDRESS      => "1101000",
+      STRETCH_TIME => 0 ns)
+    port map (
+      scl        => scl,
+      sda        => sda);
+
+  monitor0 : i2c_bus_monitor
+    port map (
+      scl        => scl,
+      sda        => sda,
+      clear      => mon_clear,
+      stats      => bus_stats);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure poll(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_poll_until(to_unsigned(addr_value, C_ADDR_WIDTH),data_exp ,1000,1 ms,msg, clk, sbi_if, term_poll);
+    end;
+
+    procedure wait_done is
+      begin
+        poll_done : for i in 0 to 5000 loop
+          read(2, status, "polling status register");
+          exit poll_done when status(0) = '1';
+          wait for 10 * T;
+        end loop;
+        check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+        check_value(status(2), '0', ERROR, "no ack error", C_SCOPE);
+        write(2, x"0000000F", "clearing status flags");
+    end;
+
+    function slave_byte(constant value : natural) return std_logic_vector is
+      begin
+        return std_logic_vector(to_unsigned(value mod 256, 8));
+    end;
+
+    -- one transaction from the tx fifo: register pointer and count data bytes, the last with stop
+    procedure fifo_write(
+      constant pointer      : in natural;
+      constant first_data   : in natural;
+      constant count        : in natural) is
+      begin
+        write(8, x"00000007", "flush fifos, fifo mode on");
+        write(1, x"00006800", "writing to write register, slave 0x68");
+        write(5, x"000000" & slave_byte(pointer), "tx fifo: register pointer");
+        for i in 0 to count - 1 loop
+          if i = count - 1 then
+            write(5, x"00000100" or (x"000000" & slave_byte(first_data + i)), "pushing last byte, stop = 1");
+          else
+            write(5, x"000000" & slave_byte(first_data + i), "pushing byte");
+          end if;
+        end loop;
+        write(0, x"00000001", "writing to control register, enable = 1");
+        wait_done;
+    end;
+
+    -- register pointer, repeated start and count bytes into the rx fifo, checked against expected
+    procedure fifo_read(
+      constant pointer      : in natural;
+      constant first_exp    : in natural;
+      constant count        : in natural) is
+      begin
+        write(8, std_logic_vector(to_unsigned(count, 8)) & x"000007", "flush fifos, fifo mode on, rx length");
+        write(1, x"00006800", "writing to write register, slave 0x68");
+        write(5, x"000000" & slave_byte(pointer), "tx fifo: register pointer, no stop");
+        write(0, x"00000001", "writing to control register, enable = 1");
+        poll(2 , x"0000001A", ERROR, "polling status register");-- ready, busy and tx threshold
+        write(0, x"00000014", "writing to control register, restart = 1, rw = 1");
+        wait_done;
+        write(0, x"00000000", "writing to control register, rw = 0");
+        for i in 0 to count - 1 loop
+          check(6, x"000000" & slave_byte(first_exp + i), ERROR, "checking rx data register");
+        end loop;
+    end;
+
+    procedure start_measure is
+      begin
+        gen_pulse(mon_clear, T, "clearing bus monitor");
+    end;
+
+    procedure end_measure(
+      constant scenario     : in string;
+      constant data_bytes   : in natural;
+      constant transactions : in natural) is
+      begin
+        wait for 500 * T; -- stop condition
+        check_value(bus_stats.data_bytes, data_bytes, ERROR, scenario & ": bytes after the address", C_SCOPE);
+        check_value(bus_stats.transactions, transactions, ERROR, scenario & ": transactions", C_SCOPE);
+        report_bus_stats(scenario, bus_stats);
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+    disable_log_msg(ID_BFM);  -- the register accesses of every scenario
+
+    log(ID_LOG_HDR, "Start Simulation of bus throughput", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+
+    log(ID_LOG_HDR, "100 kHz: single byte writes", C_SCOPE);
+
+    start_measure;
+    for i in 0 to 7 loop
+      fifo_write(16#80# + i, 16#C0# + i, 1);
+    end loop;
+    end_measure("std_write_1x8", 8 * 2, 8);
+
+
+    log(ID_LOG_HDR, "100 kHz: 15 byte burst write", C_SCOPE);
+
+    start_measure;
+    fifo_write(16#90#, 16#A0#, 15);
+    end_measure("std_write_16", 16, 1);
+
+
+    log(ID_LOG_HDR, "100 kHz: sequential reads", C_SCOPE);
+
+    start_measure;
+    fifo_read(16#90#, 16#A0#, 15);  -- the burst written above
+    end_measure("std_read_15", 1 + 15, 1);
+
+    start_measure;
+    fifo_read(16#00#, 16#00#, 16);
+    end_measure("std_read_16", 1 + 16, 1);
+
+
+    log(ID_LOG_HDR, "400 kHz", C_SCOPE);
+
+    -- 400 kHz: low 1.5 us, high 1.0 us, tSU;STA/tHD;STA/tSU;STO 0.6 us, tBUF 1.3 us
+    write(9, x"0032004B", "writing to scl timing register");
+    write(10, x"001E001E", "writing to start timing register");
+    write(11, x"0041001E", "writing to stop timing register");
+
+    start_measure;
+    for i in 0 to 7 loop
+      fifo_write(16#80# + i, 16#D0# + i, 1);
+    end loop;
+    end_measure("fast_write_1x8", 8 * 2, 8);
+
+    start_measure;
+    fifo_write(16#90#, 16#B0#, 15);
+    end_measure("fast_write_16", 16, 1);
+
+    start_measure;
+    fifo_read(16#00#, 16#00#, 16);
+    end_measure("fast_read_16", 1 + 16, 1);
+
+    write(8, x"00000006", "flush both fifos, fifo mode off");
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+    wait;
+  end process;
+end architecture;
@@ -0,0 +1,255 @@
+library std;
+use     std.textio.all;
+
+library ieee;
+use     ieee.std_logic_1164.all;
+use     ieee.numeric_std.all;
+
+library uvvm_util;
+context uvvm_util.uvvm_util_context;
+use     uvvm_util.sbi_bfm_pkg.all;
+
+-- Bus trace buffer: entries of writes to the slave model in Sim/ and to an address
+-- nobody acks, the nack and address triggers, fsm states and a wrapped buffer.
+
+entity i2c_tb_uvvm is
+end entity;
+
+architecture behav of i2c_tb_uvvm is
+  constant C_ADDR_WIDTH : natural := 6;
+
+  component i2c_top
+    port (
+      clk       : in  std_logic;
+      reset     : in  std_logic;
+      sbi_cs    : in  std_logic;
+      sbi_we    : in  std_logic;
+      sbi_re    : in  std_logic;
+      sbi_addr  : in  std_logic_vector(C_ADDR_WIDTH-1 downto 0);
+      sbi_wdata : in  std_logic_vector(31 downto 0);
+      sbi_rdata : out std_logic_vector(31 downto 0);
+      irq       : out std_logic;
+      sda       : inout std_logic;
+      scl       : inout std_logic);
+  end component;
+
+  component i2c_slave_bfm
+    generic (
+      ADDRESS      : std_logic_vector(6 downto 0);
+      STRETCH_TIME : time);
+    port (
+      scl       : inout std_logic;
+      sda       : inout std_logic);
+  end component;
+
+  -- sbi interface record
+  signal sbi_if : t_sbi_if(addr(C_ADDR_WIDTH-1 downto 0), wdata(31 downto 0), rdata(31 downto 0))
+  := init_sbi_if_signals(C_ADDR_WIDTH, 32);
+
+
+  -- clock & reset
+  constant T : time := 20 ns;
+  signal clk    : std_logic := '0';
+  signal reset  : std_logic := '0';
+  signal term_poll      : std_logic := '0';
+  signal clock_ena : boolean := false;
+
+
+  signal sda : std_logic := 'Z';
+  signal scl : std_logic;
+
+  -- entry types
+  constant C_STATE : std_logic_vector(2 downto 0) := "000";
+  constant C_START : std_logic_vector(2 downto 0) := "001";
+  constant C_STOP  : std_logic_vector(2 downto 0) := "010";
+  constant C_BYTE  : std_logic_vector(2 downto 0) := "011";
+begin
+
+  i2c_top0 : i2c_top
+    port map (
+      clk        => clk,
+      reset      => reset,
+      sbi_cs     => sbi_if.cs,
+      sbi_we     => sbi_if.wena,
+      sbi_re     => sbi_if.rena,
+      sbi_addr   => std_logic_vector(sbi_if.addr),
+      sbi_wdata  => sbi_if.wdata,
+      sbi_rdata  => sbi_if.rdata,
+      irq        => open,
+      sda        => sda,
+      scl        => scl);
+
+  slave0 : i2c_slave_bfm
+    generic map (
+      ADDRESS      => "1101000",
+      STRETCH_TIME => 0 ns)
+    port map (
+      scl        => scl,
+      sda        => sda);
+
+  sbi_if.ready <= '1';
+  clock_generator(clk, clock_ena, T, "clk");
+
+  -- pull-up
+  sda <= 'H';
+  scl <= 'H';
+
+
+  main : process
+
+   constant C_SCOPE     : string  := C_TB_SCOPE_DEFAULT;
+   variable status      : std_logic_vector(31 downto 0);
+   variable entry       : std_logic_vector(31 downto 0);
+
+    procedure write(
+      constant addr_value   : in natural;
+      constant data_value   : in std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_write(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, CLK, sbi_if, C_SCOPE);
+    end;
+
+    procedure read(
+      constant addr_value   : in natural;
+      variable data_value   : out std_logic_vector;
+      constant msg          : in string) is
+      begin
+        sbi_read(to_unsigned(addr_value, C_ADDR_WIDTH), data_value, msg, clk, sbi_if, C_SCOPE);
+    end;
+
+    procedure check(
+      constant addr_value   : in natural;
+      constant data_exp     : in std_logic_vector;
+      constant alert_level  : in t_alert_level;
+      constant msg          : in string) is
+      begin
+        sbi_check(to_unsigned(addr_value, C_ADDR_WIDTH), data_exp, msg, clk, sbi_if, alert_level, C_SCOPE);
+    end;
+
+    procedure wait_done(
+      constant ack_error    : in std_logic) is
+      begin
+        poll_done : for i in 0 to 5000 loop
+          read(2, status, "polling status register");
+          exit poll_done when status(0) = '1';
+          wait for 10 * T;
+        end loop;
+        check_value(status(0), '1', ERROR, "done set", C_SCOPE);
+        check_value(status(2), ack_error, ERROR, "ack error", C_SCOPE);
+        write(2, x"0000000F", "clearing status flags");
+        wait for 500 * T; -- stop condition
+    end;
+
+    -- register pointer and one data byte with stop from the tx fifo
+    procedure fifo_write(
+      constant slave        : in std_logic_vector(6 downto 0);
+      constant pointer      : in std_logic_vector(7 downto 0);
+      constant data         : in std_logic_vector(7 downto 0);
+      constant ack_error    : in std_logic) is
+      begin
+        write(8, x"00000007", "flush fifos, fifo mode on");
+        write(1, x"0000" & '0' & slave & x"00", "writing to write register");
+        write(5, x"000000" & pointer, "tx fifo: register pointer");
+        write(5, x"00000100" or (x"000000" & data), "tx fifo: data, stop = 1");
+        write(0, x"00000001", "writing to control register, enable = 1");
+        wait_done(ack_error);
+    end;
+
+    -- pops the oldest entry and checks type, trigger and payload
+    procedure check_entry(
+      constant kind         : in std_logic_vector(2 downto 0);
+      constant trig         : in std_logic;
+      constant payload      : in std_logic_vector(8 downto 0);
+      constant msg          : in string) is
+      begin
+        read(36, entry, "reading trace data register");
+        check_value(entry(31 downto 19), kind & trig & payload, ERROR, msg, C_SCOPE);
+    end;
+
+
+  begin
+
+    set_alert_stop_limit(ERROR,0);
+    report_global_ctrl(VOID);
+      --report_msg_id_panel(VOID);
+    enable_log_msg(ALL_MESSAGES);
+      --disable_log_msg(ALL_MESSAGES);
+      --enable_log_msg(ID_LOG_HDR);
+
+    log(ID_LOG_HDR, "Start Simulation of the bus trace", C_SCOPE);
+
+    clock_ena <= true; -- to start clock generator
+     wait for 10*T;
+
+    gen_pulse(reset, T, "reset");
+     wait for 10*T;
+
+
+    log(ID_LOG_HDR, "Trigger on a nack, one entry after it", C_SCOPE);
+
+    write(34, x"00010013", "writing to trace control register, post 1, nack trigger, clear, enable");
+    check(35, x"00000001", ERROR, "checking trace status register"); -- recording, empty
+    fifo_write("1101000", x"10", x"A5", '0');
+    fifo_write("1010000", x"10", x"A5", '1');
+    fifo_write("1101000", x"11", x"5A", '0');  -- after the trace stopped
+    check(35, x"00080006", ERROR, "checking trace status register"); -- 8 entries, stopped, triggered
+
+    check_entry(C_START, '0', "000000000", "start");
+    check_entry(C_BYTE,  '0', '0' & x"D0", "address 0x68 write, ack");
+    check_entry(C_BYTE,  '0', '0' & x"10", "register pointer, ack");
+    -- nine bit times at 100 kHz since the address
+    check_value_in_range(to_integer(unsigned(entry(18 downto 0))), 4000, 5000, ERROR, "delta of one byte", C_SCOPE);
+    check_entry(C_BYTE,  '0', '0' & x"A5", "data, ack");
+    check_entry(C_STOP,  '0', "000000000", "stop");
+    check_entry(C_START, '0', "000000000", "start");
+    check_entry(C_BYTE,  '1', '1' & x"A0", "address 0x50 write, nack fires the trigger");
+    check_entry(C_STOP,  '0', "000000000", "stop, the entry after the trigger");
+    check(35, x"00000006", ERROR, "checking trace status register"); -- drained
+    check(36, x"00000000", ERROR, "checking trace data register");   -- empty reads 0
+
+
+    log(ID_LOG_HDR, "Trigger on an address, no entry after it", C_SCOPE);
+
+    write(34, x"00006823", "writing to trace control register, address 0x68 trigger, clear, enable");
+    check(35, x"00000001", ERROR, "checking trace status register"); -- clear restarts the trigger
+    fifo_write("1010000", x"10", x"A5", '1');
+    fifo_write("1101000", x"12", x"C3", '0');
+    check(35, x"00050006", ERROR, "checking trace status register");
+
+    check_entry(C_START, '0', "000000000", "start");
+    check_entry(C_BYTE,  '0', '1' & x"A0", "address 0x50 write, nack");
+    check_entry(C_STOP,  '0', "000000000", "stop");
+    check_entry(C_START, '0', "000000000", "start");
+    check_entry(C_BYTE,  '1', '0' & x"D0", "address 0x68 write fires the trigger");
+
+
+    log(ID_LOG_HDR, "Fsm states, wrapped buffer", C_SCOPE);
+
+    write(34, x"00000007", "writing to trace control register, states, clear, enable");
+    fifo_write("1101000", x"13", x"01", '0');
+    read(35, status, "reading trace status register");
+    check_value(status(3), '0', ERROR, "not wrapped after one write", C_SCOPE);
+    check_entry(C_STATE, '0', "000000001", "idle to start");
+    for i in 0 to 3 loop
+      fifo_write("1101000", x"14", x"02", '0');
+    end loop;
+    check(35, x"00400009", ERROR, "checking trace status register"); -- full, wrapped, recording
+
+    write(34, x"00000000", "writing to trace control register, disable");
+    for i in 0 to 63 loop
+      read(36, entry, "reading trace data register");
+    end loop;
+    check(35, x"00000008", ERROR, "checking trace status register"); -- empty, wrapped
+    check(36, x"00000000", ERROR, "checking trace data register");
+    fifo_write("1101000", x"15", x"03", '0');
+    check(35, x"00000008", ERROR, "checking trace status register"); -- nothing recorded while disabled
+
+    wait for 100 *T;
+
+    report_alert_counters(FINAL); -- Report final counters and print conclusion for simulation (Success/Fail)
+    log(ID_LOG_HDR, "SIMULATION COMPLETED", C_SCOPE);
+
+    std.env.stop;
+    wait;
+  end process;
+end architecture;